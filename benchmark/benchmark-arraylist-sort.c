@@ -0,0 +1,110 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/* Benchmark for sorting ArrayLists.
+ *
+ * A list of random integers is sorted with arraylist_sort, and with
+ * arraylist_sort_parallel using increasing numbers of threads up to
+ * the number of processors. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arraylist.h"
+#include "compare-int.h"
+
+#define NUM_VALUES 10000000
+
+static int *values;
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* Sort the values, and return the time taken in seconds.  If nthreads
+ * is zero, the sequential sort is used. */
+
+static double run_benchmark(unsigned int nthreads)
+{
+	ArrayList *arraylist;
+	double start, end;
+	unsigned int i;
+
+	arraylist = arraylist_new(NUM_VALUES);
+
+	for (i=0; i<NUM_VALUES; ++i) {
+		arraylist_append(arraylist, &values[i]);
+	}
+
+	start = get_time();
+
+	if (nthreads == 0) {
+		arraylist_sort(arraylist, int_compare);
+	} else {
+		arraylist_sort_parallel(arraylist, int_compare, nthreads);
+	}
+
+	end = get_time();
+
+	arraylist_free(arraylist);
+
+	return end - start;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max_threads;
+	unsigned int n;
+	long num_processors;
+	unsigned int i;
+
+	num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_processors < 1) {
+		max_threads = 1;
+	} else {
+		max_threads = (unsigned int) num_processors;
+	}
+
+	values = malloc(sizeof(int) * NUM_VALUES);
+
+	for (i=0; i<NUM_VALUES; ++i) {
+		values[i] = rand();
+	}
+
+	printf("Time to sort %i values, in seconds.\n\n", NUM_VALUES);
+
+	printf("Sequential %8.2f\n", run_benchmark(0));
+
+	for (n=1; n<=max_threads; n *= 2) {
+		printf("%2u threads %8.2f\n", n, run_benchmark(n));
+	}
+
+	free(values);
+
+	return 0;
+}
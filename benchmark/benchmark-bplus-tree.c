@@ -0,0 +1,194 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/* Benchmark comparing lookups in the B+ tree with the AVL tree and the
+ * red-black tree.
+ *
+ * Each tree is filled with the same keys, inserted in random order,
+ * then the same sequence of random lookups is performed on each.  The
+ * number of keys defaults to one million, and can be given on the
+ * command line to see how each tree behaves once it no longer fits in
+ * the processor's caches, for example:
+ *
+ *   ./benchmark-bplus-tree 100000000 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "avl-tree.h"
+#include "bplus-tree.h"
+#include "rb-tree.h"
+#include "compare-int.h"
+
+#define DEFAULT_NUM_KEYS 1000000
+#define NUM_LOOKUPS 1000000
+
+typedef enum {
+	BENCHMARK_AVL,
+	BENCHMARK_RB,
+	BENCHMARK_BPLUS
+} BenchmarkType;
+
+typedef struct {
+	double inserts_per_second;
+	double lookups_per_second;
+} BenchmarkResult;
+
+static int *keys;
+static unsigned int num_keys;
+static unsigned int *lookups;
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void run_benchmark(BenchmarkType type, BenchmarkResult *result)
+{
+	AVLTree *avl_tree = NULL;
+	RBTree *rb_tree = NULL;
+	BPlusTree *bplus_tree = NULL;
+	double start, insert_time, lookup_time;
+	void *value;
+	unsigned int i;
+
+	if (type == BENCHMARK_AVL) {
+		avl_tree = avl_tree_new((AVLTreeCompareFunc) int_compare);
+	} else if (type == BENCHMARK_RB) {
+		rb_tree = rb_tree_new((RBTreeCompareFunc) int_compare);
+	} else {
+		bplus_tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+	}
+
+	start = get_time();
+
+	for (i=0; i<num_keys; ++i) {
+		if (type == BENCHMARK_AVL) {
+			avl_tree_insert(avl_tree, &keys[i], &keys[i]);
+		} else if (type == BENCHMARK_RB) {
+			rb_tree_insert(rb_tree, &keys[i], &keys[i]);
+		} else {
+			bplus_tree_insert(bplus_tree, &keys[i], &keys[i]);
+		}
+	}
+
+	insert_time = get_time() - start;
+
+	start = get_time();
+
+	for (i=0; i<NUM_LOOKUPS; ++i) {
+		if (type == BENCHMARK_AVL) {
+			value = avl_tree_lookup(avl_tree, &keys[lookups[i]]);
+		} else if (type == BENCHMARK_RB) {
+			value = rb_tree_lookup(rb_tree, &keys[lookups[i]]);
+		} else {
+			value = bplus_tree_lookup(bplus_tree,
+			                          &keys[lookups[i]]);
+		}
+
+		if (value != &keys[lookups[i]]) {
+			fprintf(stderr, "Lookup returned the wrong value\n");
+			exit(1);
+		}
+	}
+
+	lookup_time = get_time() - start;
+
+	if (type == BENCHMARK_AVL) {
+		avl_tree_free(avl_tree);
+	} else if (type == BENCHMARK_RB) {
+		rb_tree_free(rb_tree);
+	} else {
+		bplus_tree_free(bplus_tree);
+	}
+
+	result->inserts_per_second = num_keys / insert_time;
+	result->lookups_per_second = NUM_LOOKUPS / lookup_time;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkResult avl, rb, bplus;
+	unsigned int i, j;
+	int tmp;
+
+	if (argc > 1) {
+		num_keys = (unsigned int) strtoul(argv[1], NULL, 10);
+	} else {
+		num_keys = DEFAULT_NUM_KEYS;
+	}
+
+	if (num_keys == 0) {
+		fprintf(stderr, "Usage: %s [num-keys]\n", argv[0]);
+		return 1;
+	}
+
+	keys = malloc(sizeof(int) * num_keys);
+	lookups = malloc(sizeof(unsigned int) * NUM_LOOKUPS);
+
+	if (keys == NULL || lookups == NULL) {
+		fprintf(stderr, "Failed to allocate key arrays\n");
+		return 1;
+	}
+
+	/* Distinct keys, shuffled so that they are inserted in random
+	 * order. */
+
+	srand(1);
+
+	for (i=0; i<num_keys; ++i) {
+		keys[i] = (int) i;
+	}
+
+	for (i=num_keys - 1; i>0; --i) {
+		j = (unsigned int) rand() % (i + 1);
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+
+	for (i=0; i<NUM_LOOKUPS; ++i) {
+		lookups[i] = (unsigned int) rand() % num_keys;
+	}
+
+	run_benchmark(BENCHMARK_AVL, &avl);
+	run_benchmark(BENCHMARK_RB, &rb);
+	run_benchmark(BENCHMARK_BPLUS, &bplus);
+
+	printf("%i lookups in a tree of %u keys.\n\n", NUM_LOOKUPS, num_keys);
+
+	printf("                             AVL        RB        B+\n");
+	printf("Inserts per second (M) %9.2f %9.2f %9.2f\n",
+	       avl.inserts_per_second / 1e6, rb.inserts_per_second / 1e6,
+	       bplus.inserts_per_second / 1e6);
+	printf("Lookups per second (M) %9.2f %9.2f %9.2f\n",
+	       avl.lookups_per_second / 1e6, rb.lookups_per_second / 1e6,
+	       bplus.lookups_per_second / 1e6);
+
+	free(keys);
+	free(lookups);
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/* Benchmark for the concurrent queue.
+ *
+ * Values are passed from producer threads to consumer threads, with the
+ * number of threads increased up to the number of processors.  A Queue
+ * protected by a mutex is measured for comparison. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "queue.h"
+#include "concurrent-queue.h"
+
+#define NUM_VALUES 2000000
+#define QUEUE_CAPACITY 1024
+
+typedef enum {
+	BENCHMARK_MUTEX,
+	BENCHMARK_CONCURRENT
+} BenchmarkType;
+
+static BenchmarkType benchmark_type;
+static Queue *mutex_queue;
+static pthread_mutex_t mutex_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static ConcurrentQueue *concurrent_queue;
+static unsigned int values_per_producer;
+static int end_marker;
+static int value;
+
+static int benchmark_push(QueueValue data)
+{
+	int result;
+
+	if (benchmark_type == BENCHMARK_CONCURRENT) {
+		return concurrent_queue_push(concurrent_queue, data);
+	}
+
+	pthread_mutex_lock(&mutex_queue_lock);
+	result = queue_push_tail(mutex_queue, data);
+	pthread_mutex_unlock(&mutex_queue_lock);
+
+	return result;
+}
+
+static QueueValue benchmark_pop(void)
+{
+	QueueValue result;
+
+	if (benchmark_type == BENCHMARK_CONCURRENT) {
+		return concurrent_queue_pop(concurrent_queue);
+	}
+
+	pthread_mutex_lock(&mutex_queue_lock);
+	result = queue_pop_head(mutex_queue);
+	pthread_mutex_unlock(&mutex_queue_lock);
+
+	return result;
+}
+
+static void *producer_thread(void *arg)
+{
+	unsigned int i;
+
+	for (i=0; i<values_per_producer; ++i) {
+		while (!benchmark_push(&value)) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void *consumer_thread(void *arg)
+{
+	QueueValue data;
+
+	for (;;) {
+		data = benchmark_pop();
+
+		if (data == &end_marker) {
+			break;
+		} else if (data == NULL) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* Pass values from producers to consumers, and return the number of
+ * values passed per second. */
+
+static double run_benchmark(BenchmarkType type, unsigned int flags,
+                            unsigned int num_producers,
+                            unsigned int num_consumers)
+{
+	pthread_t *producers;
+	pthread_t *consumers;
+	double start, end;
+	unsigned int i;
+
+	benchmark_type = type;
+
+	if (type == BENCHMARK_CONCURRENT) {
+		concurrent_queue = concurrent_queue_new_full(QUEUE_CAPACITY,
+		                                             flags);
+	} else {
+		mutex_queue = queue_new();
+	}
+
+	values_per_producer = NUM_VALUES / num_producers;
+
+	producers = malloc(sizeof(pthread_t) * num_producers);
+	consumers = malloc(sizeof(pthread_t) * num_consumers);
+
+	start = get_time();
+
+	for (i=0; i<num_consumers; ++i) {
+		pthread_create(&consumers[i], NULL, consumer_thread, NULL);
+	}
+
+	for (i=0; i<num_producers; ++i) {
+		pthread_create(&producers[i], NULL, producer_thread, NULL);
+	}
+
+	for (i=0; i<num_producers; ++i) {
+		pthread_join(producers[i], NULL);
+	}
+
+	for (i=0; i<num_consumers; ++i) {
+		while (!benchmark_push(&end_marker)) {
+			sched_yield();
+		}
+	}
+
+	for (i=0; i<num_consumers; ++i) {
+		pthread_join(consumers[i], NULL);
+	}
+
+	end = get_time();
+
+	free(producers);
+	free(consumers);
+
+	if (type == BENCHMARK_CONCURRENT) {
+		concurrent_queue_free(concurrent_queue);
+	} else {
+		queue_free(mutex_queue);
+	}
+
+	return (double) (values_per_producer * num_producers) / (end - start);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max_threads;
+	unsigned int n;
+	long num_processors;
+
+	num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_processors < 2) {
+		max_threads = 1;
+	} else {
+		max_threads = (unsigned int) num_processors / 2;
+	}
+
+	printf("Values passed per second, in millions.\n\n");
+
+	printf("Producers and consumers    Mutex    MPMC\n");
+
+	for (n=1; n<=max_threads; ++n) {
+		printf("%23u %8.2f %7.2f\n", n,
+		       run_benchmark(BENCHMARK_MUTEX, 0, n, n) / 1e6,
+		       run_benchmark(BENCHMARK_CONCURRENT, 0, n, n) / 1e6);
+	}
+
+	printf("\nProducers, one consumer      Mutex    MPMC    MPSC\n");
+
+	for (n=1; n<=max_threads; ++n) {
+		printf("%23u %10.2f %7.2f %7.2f\n", n,
+		       run_benchmark(BENCHMARK_MUTEX, 0, n, 1) / 1e6,
+		       run_benchmark(BENCHMARK_CONCURRENT, 0, n, 1) / 1e6,
+		       run_benchmark(BENCHMARK_CONCURRENT,
+		                     CONCURRENT_QUEUE_SINGLE_CONSUMER,
+		                     n, 1) / 1e6);
+	}
+
+	printf("\nOne producer, one consumer   Mutex    MPMC    SPSC\n");
+	printf("%34.2f %7.2f %7.2f\n",
+	       run_benchmark(BENCHMARK_MUTEX, 0, 1, 1) / 1e6,
+	       run_benchmark(BENCHMARK_CONCURRENT, 0, 1, 1) / 1e6,
+	       run_benchmark(BENCHMARK_CONCURRENT,
+	                     CONCURRENT_QUEUE_SINGLE_PRODUCER
+	                     | CONCURRENT_QUEUE_SINGLE_CONSUMER,
+	                     1, 1) / 1e6);
+
+	return 0;
+}
+
@@ -0,0 +1,194 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/* Benchmark comparing the red-black tree with the AVL tree.
+ *
+ * Each tree is filled with random keys, then a random mix of inserts
+ * and removes is performed, keeping the size of the tree steady.  The
+ * throughput and the number of rotations performed are reported.
+ *
+ * The tree sources are compiled directly into this program with
+ * TREE_ROTATION_COUNTING defined, so that rotations can be counted. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TREE_ROTATION_COUNTING
+
+#include "avl-tree.c"
+#include "rb-tree.c"
+
+#include "compare-int.h"
+
+#define TREE_SIZE 1000000
+#define NUM_OPERATIONS 1000000
+
+typedef enum {
+	BENCHMARK_AVL,
+	BENCHMARK_RB
+} BenchmarkType;
+
+typedef struct {
+	double inserts_per_second;
+	double removes_per_second;
+	double insert_rotations;
+	double remove_rotations;
+	unsigned long max_remove_rotations;
+} BenchmarkResult;
+
+static int *keys;
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static unsigned long rotation_count(BenchmarkType type)
+{
+	if (type == BENCHMARK_AVL) {
+		return avl_tree_rotation_count;
+	} else {
+		return rb_tree_rotation_count;
+	}
+}
+
+/* Fill a tree, then replace random keys with new ones.  The keys
+ * currently in the tree are kept in the first TREE_SIZE entries of
+ * the keys array. */
+
+static void run_benchmark(BenchmarkType type, BenchmarkResult *result)
+{
+	AVLTree *avl_tree = NULL;
+	RBTree *rb_tree = NULL;
+	double insert_time, remove_time;
+	double start;
+	unsigned long rotations;
+	unsigned long insert_rotations, remove_rotations;
+	unsigned int i, j;
+
+	srand(1);
+
+	for (i=0; i<TREE_SIZE + NUM_OPERATIONS; ++i) {
+		keys[i] = rand();
+	}
+
+	if (type == BENCHMARK_AVL) {
+		avl_tree = avl_tree_new((AVLTreeCompareFunc) int_compare);
+	} else {
+		rb_tree = rb_tree_new((RBTreeCompareFunc) int_compare);
+	}
+
+	for (i=0; i<TREE_SIZE; ++i) {
+		if (type == BENCHMARK_AVL) {
+			avl_tree_insert(avl_tree, &keys[i], &keys[i]);
+		} else {
+			rb_tree_insert(rb_tree, &keys[i], &keys[i]);
+		}
+	}
+
+	insert_time = 0;
+	remove_time = 0;
+	insert_rotations = 0;
+	remove_rotations = 0;
+	result->max_remove_rotations = 0;
+
+	for (i=0; i<NUM_OPERATIONS; ++i) {
+
+		/* Remove a random key and replace it with a new one */
+
+		j = (unsigned int) rand() % TREE_SIZE;
+
+		rotations = rotation_count(type);
+		start = get_time();
+
+		if (type == BENCHMARK_AVL) {
+			avl_tree_remove(avl_tree, &keys[j]);
+		} else {
+			rb_tree_remove(rb_tree, &keys[j]);
+		}
+
+		remove_time += get_time() - start;
+		rotations = rotation_count(type) - rotations;
+		remove_rotations += rotations;
+
+		if (rotations > result->max_remove_rotations) {
+			result->max_remove_rotations = rotations;
+		}
+
+		keys[j] = keys[TREE_SIZE + i];
+
+		rotations = rotation_count(type);
+		start = get_time();
+
+		if (type == BENCHMARK_AVL) {
+			avl_tree_insert(avl_tree, &keys[j], &keys[j]);
+		} else {
+			rb_tree_insert(rb_tree, &keys[j], &keys[j]);
+		}
+
+		insert_time += get_time() - start;
+		insert_rotations += rotation_count(type) - rotations;
+	}
+
+	if (type == BENCHMARK_AVL) {
+		avl_tree_free(avl_tree);
+	} else {
+		rb_tree_free(rb_tree);
+	}
+
+	result->inserts_per_second = NUM_OPERATIONS / insert_time;
+	result->removes_per_second = NUM_OPERATIONS / remove_time;
+	result->insert_rotations = (double) insert_rotations / NUM_OPERATIONS;
+	result->remove_rotations = (double) remove_rotations / NUM_OPERATIONS;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkResult avl, rb;
+
+	keys = malloc(sizeof(int) * (TREE_SIZE + NUM_OPERATIONS));
+
+	run_benchmark(BENCHMARK_AVL, &avl);
+	run_benchmark(BENCHMARK_RB, &rb);
+
+	printf("%i operations on a tree of %i keys.\n\n",
+	       NUM_OPERATIONS, TREE_SIZE);
+
+	printf("                             AVL        RB\n");
+	printf("Inserts per second (M) %9.2f %9.2f\n",
+	       avl.inserts_per_second / 1e6, rb.inserts_per_second / 1e6);
+	printf("Removes per second (M) %9.2f %9.2f\n",
+	       avl.removes_per_second / 1e6, rb.removes_per_second / 1e6);
+	printf("Rotations per insert   %9.3f %9.3f\n",
+	       avl.insert_rotations, rb.insert_rotations);
+	printf("Rotations per remove   %9.3f %9.3f\n",
+	       avl.remove_rotations, rb.remove_rotations);
+	printf("Most rotations, remove %9lu %9lu\n",
+	       avl.max_remove_rotations, rb.max_remove_rotations);
+
+	free(keys);
+
+	return 0;
+}
@@ -47,8 +47,17 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * in a list with links that point in one direction.
  * @li @link queue.h Queue @endlink: Double ended queue which can be used
  * as a FIFO or a stack.
+ * @li @link concurrent-queue.h Concurrent queue @endlink: Bounded
+ * lock-free FIFO queue which can be shared between threads.
+ * @li @link work-stealing-deque.h Work-stealing deque @endlink: Deque
+ * used to share tasks between threads, which other threads can steal
+ * from.
  * @li @link set.h Set @endlink: Unordered set of values.
  * @li @link bloom-filter.h Bloom Filter @endlink: Space-efficient set.
+ * @li @link counting-bloom-filter.h Counting Bloom Filter @endlink:
+ * Space-efficient set which supports removal.
+ * @li @link cuckoo-filter.h Cuckoo Filter @endlink: Space-efficient set
+ * which supports removal, storing fingerprints of values.
  *
  * @subsection Mappings
  *
@@ -60,6 +69,15 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  *
  * @li @link avl-tree.h AVL tree @endlink: Balanced binary search tree
  * with O(log n) worst case performance.
+ * @li @link bplus-tree.h B+ tree @endlink: Balanced search tree with many
+ * keys per node, for fewer cache misses on large maps.
+ *
+ * @section Memory_allocation Memory allocation
+ *
+ * @li @link allocator.h Allocator @endlink: Custom allocation functions
+ * for the nodes of a data structure.
+ * @li @link slab-allocator.h Slab allocator @endlink: Fixed-size pool
+ * allocator.
  *
  * @section Utility_functions Utility functions
  *
@@ -0,0 +1,118 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file allocator.h
+ *
+ * @brief Custom memory allocators for data structures.
+ *
+ * By default, the data structures in this library allocate memory for
+ * their nodes using malloc() and free().  An @ref Allocator structure
+ * can be used to provide alternative functions; it is passed to the
+ * constructor for a data structure, for example
+ * @ref hash_table_new_with_allocator or @ref avl_tree_new_with_allocator.
+ * Only the memory for individual nodes (list entries, tree nodes, etc.)
+ * is allocated through the allocator; the main data structure and any
+ * arrays are still allocated using malloc().
+ *
+ * The allocator must remain valid for the lifetime of any data
+ * structures using it.  A fixed-size pool allocator is provided in
+ * @ref slab-allocator.h.
+ */
+
+#ifndef ALGORITHM_ALLOCATOR_H
+#define ALGORITHM_ALLOCATOR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function used to allocate memory.
+ *
+ * @param user_data      The user_data field of the @ref Allocator.
+ * @param size           Size of the block to allocate, in bytes.
+ * @return               Pointer to the new block, or NULL if it was not
+ *                       possible to allocate the block.
+ */
+
+typedef void *(*AllocatorAllocFunc)(void *user_data, size_t size);
+
+/**
+ * Function used to free memory.
+ *
+ * @param user_data      The user_data field of the @ref Allocator.
+ * @param ptr            Pointer to the block to free.
+ * @param size           Size of the block, as passed to the allocation
+ *                       function when it was allocated.
+ */
+
+typedef void (*AllocatorFreeFunc)(void *user_data, void *ptr, size_t size);
+
+/**
+ * A custom memory allocator.
+ */
+
+typedef struct _Allocator {
+
+	/** Function used to allocate memory. */
+
+	AllocatorAllocFunc alloc_func;
+
+	/** Function used to free memory.  If this is NULL, memory is never
+	 *  freed back individually, which is useful for arena allocators
+	 *  where all memory is freed at once. */
+
+	AllocatorFreeFunc free_func;
+
+	/** Arbitrary pointer passed to the allocation functions. */
+
+	void *user_data;
+
+} Allocator;
+
+/**
+ * Allocate a block of memory using an allocator.
+ *
+ * @param allocator      The allocator, or NULL to use malloc().
+ * @param size           Size of the block to allocate, in bytes.
+ * @return               Pointer to the new block, or NULL if it was not
+ *                       possible to allocate the block.
+ */
+
+void *allocator_alloc(Allocator *allocator, size_t size);
+
+/**
+ * Free a block of memory allocated using @ref allocator_alloc.
+ *
+ * @param allocator      The allocator, or NULL to use free().
+ * @param ptr            Pointer to the block to free.
+ * @param size           Size of the block, in bytes.
+ */
+
+void allocator_free(Allocator *allocator, void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_ALLOCATOR_H */
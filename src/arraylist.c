@@ -18,9 +18,21 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "arraylist.h"
 
 /* malloc() / free() testing */
@@ -187,87 +199,870 @@ void arraylist_clear(ArrayList *arraylist)
 	arraylist->length = 0;
 }
 
-static void arraylist_sort_internal(ArrayListValue *list_data,
-                                    unsigned int list_length,
-                                    ArrayListCompareFunc compare_func)
+/* Sorting is done using pattern-defeating quicksort (pdqsort), after
+ * Orson Peters.  This is an introsort variant: small ranges are
+ * sorted with insertion sort, pivots are chosen with median-of-3 or
+ * Tukey's ninther, partitions that come out badly unbalanced have
+ * their elements shuffled to break up adversarial patterns, and if
+ * too many bad partitions are seen the range is finished with
+ * heapsort, guaranteeing O(n log n) worst case behaviour. */
+
+/* Ranges smaller than this are sorted with insertion sort. */
+
+#define ARRAYLIST_INSERTION_SORT_THRESHOLD 24
+
+/* Ranges larger than this use the ninther to choose a pivot. */
+
+#define ARRAYLIST_NINTHER_THRESHOLD 128
+
+/* Maximum number of moves made by an optimistic insertion sort
+ * before it gives up. */
+
+#define ARRAYLIST_PARTIAL_INSERTION_SORT_LIMIT 8
+
+/* Number of elements scanned at a time by the block partitioner.
+ * Offsets into a block are stored as unsigned chars, so this must
+ * not exceed 255. */
+
+#define ARRAYLIST_SORT_BLOCK_SIZE 64
+
+static void arraylist_sort_swap(ArrayListValue *a, ArrayListValue *b)
 {
-	ArrayListValue pivot;
 	ArrayListValue tmp;
-	unsigned int i;
-	unsigned int list1_length;
-	unsigned int list2_length;
 
-	/* If less than two items, it is always sorted. */
+	tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+/* Order two values, so that *a <= *b. */
 
-	if (list_length <= 1) {
+static void arraylist_sort2(ArrayListValue *a, ArrayListValue *b,
+                            ArrayListCompareFunc compare_func)
+{
+	if (compare_func(*b, *a) < 0) {
+		arraylist_sort_swap(a, b);
+	}
+}
+
+/* Order three values, so that *a <= *b <= *c. */
+
+static void arraylist_sort3(ArrayListValue *a, ArrayListValue *b,
+                            ArrayListValue *c,
+                            ArrayListCompareFunc compare_func)
+{
+	arraylist_sort2(a, b, compare_func);
+	arraylist_sort2(b, c, compare_func);
+	arraylist_sort2(a, b, compare_func);
+}
+
+/* Sort [begin, end) using insertion sort.  If 'guarded' is zero, the
+ * value immediately before begin must be no greater than any value in
+ * the range; this allows the bounds check in the inner loop to be
+ * skipped. */
+
+static void arraylist_insertion_sort(ArrayListValue *begin,
+                                     ArrayListValue *end,
+                                     ArrayListCompareFunc compare_func,
+                                     int guarded)
+{
+	ArrayListValue *cur;
+	ArrayListValue *sift;
+	ArrayListValue tmp;
+
+	if (begin == end) {
 		return;
 	}
 
-	/* Take the last item as the pivot. */
+	for (cur = begin + 1; cur != end; ++cur) {
+
+		if (compare_func(*cur, *(cur - 1)) >= 0) {
+			continue;
+		}
+
+		tmp = *cur;
+		sift = cur;
+
+		do {
+			*sift = *(sift - 1);
+			--sift;
+		} while ((!guarded || sift != begin)
+		      && compare_func(tmp, *(sift - 1)) < 0);
+
+		*sift = tmp;
+	}
+}
+
+/* Attempt to sort [begin, end) with insertion sort, giving up if more
+ * than a handful of values need to be moved.  Returns non-zero if the
+ * range was sorted. */
 
-	pivot = list_data[list_length-1];
+static int arraylist_partial_insertion_sort(ArrayListValue *begin,
+                                            ArrayListValue *end,
+                                            ArrayListCompareFunc compare_func)
+{
+	ArrayListValue *cur;
+	ArrayListValue *sift;
+	ArrayListValue tmp;
+	size_t moves;
 
-	/* Divide the list into two lists:
-	 *
-	 * List 1 contains data less than the pivot.
-	 * List 2 contains data more than the pivot.
-	 *
-	 * As the lists are build up, they are stored sequentially after
-	 * each other, ie. list_data[list1_length-1] is the last item
-	 * in list 1, list_data[list1_length] is the first item in
-	 * list 2.
-	 */
+	if (begin == end) {
+		return 1;
+	}
 
-	list1_length = 0;
+	moves = 0;
 
-	for (i=0; i<list_length-1; ++i) {
+	for (cur = begin + 1; cur != end; ++cur) {
 
-		if (compare_func(list_data[i], pivot) < 0) {
+		if (compare_func(*cur, *(cur - 1)) >= 0) {
+			continue;
+		}
 
-			/* This should be in list 1.  Therefore it is in the
-			 * wrong position. Swap the data immediately following
-			 * the last item in list 1 with this data. */
+		tmp = *cur;
+		sift = cur;
 
-			tmp = list_data[i];
-			list_data[i] = list_data[list1_length];
-			list_data[list1_length] = tmp;
+		do {
+			*sift = *(sift - 1);
+			--sift;
+		} while (sift != begin && compare_func(tmp, *(sift - 1)) < 0);
 
-			++list1_length;
+		*sift = tmp;
+		moves += (size_t) (cur - sift);
 
-		} else {
-			/* This should be in list 2.  This is already in the
-			 * right position. */
+		if (moves > ARRAYLIST_PARTIAL_INSERTION_SORT_LIMIT) {
+			return 0;
 		}
 	}
 
-	/* The length of list 2 can be calculated. */
+	return 1;
+}
+
+/* Heapsort, used as a fallback when quicksort is performing badly. */
+
+static void arraylist_sift_down(ArrayListValue *data, size_t index,
+                                size_t length,
+                                ArrayListCompareFunc compare_func)
+{
+	ArrayListValue value;
+	size_t child;
 
-	list2_length = list_length - list1_length - 1;
+	value = data[index];
 
-	/* list_data[0..list1_length-1] now contains all items which are
-	 * before the pivot.
-	 * list_data[list1_length..list_length-2] contains all items after
-	 * or equal to the pivot. */
+	for (;;) {
+		child = index * 2 + 1;
 
-	/* Move the pivot into place, by swapping it with the item
-	 * immediately following the end of list 1.  */
+		if (child >= length) {
+			break;
+		}
 
-	list_data[list_length-1] = list_data[list1_length];
-	list_data[list1_length] = pivot;
+		if (child + 1 < length
+		 && compare_func(data[child], data[child + 1]) < 0) {
+			++child;
+		}
 
-	/* Recursively sort the sublists. */
+		if (compare_func(value, data[child]) >= 0) {
+			break;
+		}
 
-	arraylist_sort_internal(list_data, list1_length, compare_func);
+		data[index] = data[child];
+		index = child;
+	}
 
-	arraylist_sort_internal(&list_data[list1_length + 1], list2_length,
-	                        compare_func);
+	data[index] = value;
+}
+
+static void arraylist_heap_sort(ArrayListValue *begin, ArrayListValue *end,
+                                ArrayListCompareFunc compare_func)
+{
+	size_t length;
+	size_t i;
+
+	length = (size_t) (end - begin);
+
+	for (i = length / 2; i > 0; --i) {
+		arraylist_sift_down(begin, i - 1, length, compare_func);
+	}
+
+	for (i = length; i > 1; --i) {
+		arraylist_sort_swap(&begin[0], &begin[i - 1]);
+		arraylist_sift_down(begin, 0, i - 1, compare_func);
+	}
+}
+
+/* Swap 'num' pairs of misplaced values found by the block partitioner.
+ * When the two offset buffers are not the same length, the values are
+ * rotated through a cycle rather than swapped pairwise, which halves
+ * the number of stores. */
+
+static void arraylist_swap_offsets(ArrayListValue *first,
+                                   ArrayListValue *last,
+                                   unsigned char *offsets_l,
+                                   unsigned char *offsets_r,
+                                   size_t num, int use_swaps)
+{
+	ArrayListValue *l;
+	ArrayListValue *r;
+	ArrayListValue tmp;
+	size_t i;
+
+	if (use_swaps) {
+		for (i = 0; i < num; ++i) {
+			arraylist_sort_swap(first + offsets_l[i],
+			                    last - offsets_r[i]);
+		}
+	} else if (num > 0) {
+		l = first + offsets_l[0];
+		r = last - offsets_r[0];
+		tmp = *l;
+		*l = *r;
+
+		for (i = 1; i < num; ++i) {
+			l = first + offsets_l[i];
+			*r = *l;
+			r = last - offsets_r[i];
+			*l = *r;
+		}
+
+		*r = tmp;
+	}
+}
+
+/* Partition [begin, end) around the pivot *begin.  Values less than
+ * the pivot are placed to its left, values greater than or equal to
+ * it to its right.  Returns the final position of the pivot, and sets
+ * *already_partitioned if no values needed to be moved.
+ *
+ * The range is scanned in blocks: first the offsets of all misplaced
+ * values in a block on each side are recorded, then the values are
+ * swapped in bulk.  The result of each comparison is added to a
+ * counter rather than branched on (after BlockQuicksort, Edelkamp and
+ * Weiss), so the scanning loops contain no data-dependent branches. */
+
+static ArrayListValue *arraylist_partition_right(ArrayListValue *begin,
+                                                 ArrayListValue *end,
+                                                 ArrayListCompareFunc compare_func,
+                                                 int *already_partitioned)
+{
+	unsigned char offsets_l[ARRAYLIST_SORT_BLOCK_SIZE];
+	unsigned char offsets_r[ARRAYLIST_SORT_BLOCK_SIZE];
+	ArrayListValue *offsets_l_base;
+	ArrayListValue *offsets_r_base;
+	ArrayListValue *first;
+	ArrayListValue *last;
+	ArrayListValue *pivot_pos;
+	ArrayListValue pivot;
+	size_t num_l, num_r, start_l, start_r;
+	size_t num_unknown, left_split, right_split;
+	size_t num;
+	size_t i;
+
+	pivot = *begin;
+	first = begin;
+	last = end;
+
+	/* Find the first value greater than or equal to the pivot.  The
+	 * pivot selection guarantees that one exists. */
+
+	while (compare_func(*++first, pivot) < 0);
+
+	/* Find the last value less than the pivot.  This search must be
+	 * bounded if nothing before 'first' was less than the pivot. */
+
+	if (first - 1 == begin) {
+		while (first < last && compare_func(*--last, pivot) >= 0);
+	} else {
+		while (compare_func(*--last, pivot) >= 0);
+	}
+
+	*already_partitioned = first >= last;
+
+	if (!*already_partitioned) {
+		arraylist_sort_swap(first, last);
+		++first;
+
+		offsets_l_base = first;
+		offsets_r_base = last;
+		num_l = num_r = start_l = start_r = 0;
+
+		while (first < last) {
+
+			/* Decide how many values to scan on each side.  Only
+			 * a side whose offset buffer is empty is refilled. */
+
+			num_unknown = (size_t) (last - first);
+
+			if (num_l == 0) {
+				left_split = num_r == 0 ? num_unknown / 2
+				                        : num_unknown;
+			} else {
+				left_split = 0;
+			}
+
+			right_split = num_r == 0 ? num_unknown - left_split : 0;
+
+			if (left_split > ARRAYLIST_SORT_BLOCK_SIZE) {
+				left_split = ARRAYLIST_SORT_BLOCK_SIZE;
+			}
+			if (right_split > ARRAYLIST_SORT_BLOCK_SIZE) {
+				right_split = ARRAYLIST_SORT_BLOCK_SIZE;
+			}
+
+			for (i = 0; i < left_split; ++i) {
+				offsets_l[num_l] = (unsigned char) i;
+				num_l += compare_func(*first, pivot) >= 0;
+				++first;
+			}
+
+			for (i = 0; i < right_split; ++i) {
+				--last;
+				offsets_r[num_r] = (unsigned char) (i + 1);
+				num_r += compare_func(*last, pivot) < 0;
+			}
+
+			/* Swap as many misplaced pairs as possible. */
+
+			num = num_l < num_r ? num_l : num_r;
+
+			arraylist_swap_offsets(offsets_l_base, offsets_r_base,
+			                       offsets_l + start_l,
+			                       offsets_r + start_r,
+			                       num, num_l == num_r);
+
+			num_l -= num;
+			num_r -= num;
+			start_l += num;
+			start_r += num;
+
+			if (num_l == 0) {
+				start_l = 0;
+				offsets_l_base = first;
+			}
+
+			if (num_r == 0) {
+				start_r = 0;
+				offsets_r_base = last;
+			}
+		}
+
+		/* One side may have misplaced values left over.  Everything
+		 * between the blocks has now been classified, so move them
+		 * into the middle. */
+
+		if (num_l > 0) {
+			while (num_l > 0) {
+				--num_l;
+				--last;
+				arraylist_sort_swap(offsets_l_base
+				                    + offsets_l[start_l + num_l],
+				                    last);
+			}
+			first = last;
+		}
+
+		if (num_r > 0) {
+			while (num_r > 0) {
+				--num_r;
+				arraylist_sort_swap(offsets_r_base
+				                    - offsets_r[start_r + num_r],
+				                    first);
+				++first;
+			}
+			last = first;
+		}
+	}
+
+	/* Put the pivot in its final place. */
+
+	pivot_pos = first - 1;
+	*begin = *pivot_pos;
+	*pivot_pos = pivot;
+
+	return pivot_pos;
+}
+
+/* Partition [begin, end) around the pivot *begin, placing values
+ * equal to the pivot to its left.  This is used when the pivot is
+ * known to equal a pivot chosen previously, so that everything to the
+ * left is equal and does not need to be sorted further.  Returns the
+ * final position of the pivot. */
+
+static ArrayListValue *arraylist_partition_left(ArrayListValue *begin,
+                                                ArrayListValue *end,
+                                                ArrayListCompareFunc compare_func)
+{
+	ArrayListValue *first;
+	ArrayListValue *last;
+	ArrayListValue pivot;
+
+	pivot = *begin;
+	first = begin;
+	last = end;
+
+	while (compare_func(pivot, *--last) < 0);
+
+	if (last + 1 == end) {
+		while (first < last && compare_func(pivot, *++first) >= 0);
+	} else {
+		while (compare_func(pivot, *++first) >= 0);
+	}
+
+	while (first < last) {
+		arraylist_sort_swap(first, last);
+		while (compare_func(pivot, *--last) < 0);
+		while (compare_func(pivot, *++first) >= 0);
+	}
+
+	*begin = *last;
+	*last = pivot;
+
+	return last;
+}
+
+/* Shuffle some values around to break up patterns that caused an
+ * unbalanced partition. */
+
+static void arraylist_break_patterns(ArrayListValue *begin,
+                                     ArrayListValue *end)
+{
+	size_t size;
+	size_t quarter;
+
+	size = (size_t) (end - begin);
+
+	if (size < ARRAYLIST_INSERTION_SORT_THRESHOLD) {
+		return;
+	}
+
+	quarter = size / 4;
+
+	arraylist_sort_swap(begin, begin + quarter);
+	arraylist_sort_swap(end - 1, end - quarter);
+
+	if (size > ARRAYLIST_NINTHER_THRESHOLD) {
+		arraylist_sort_swap(begin + 1, begin + (quarter + 1));
+		arraylist_sort_swap(begin + 2, begin + (quarter + 2));
+		arraylist_sort_swap(end - 2, end - (quarter + 1));
+		arraylist_sort_swap(end - 3, end - (quarter + 2));
+	}
+}
+
+/* Sort [begin, end).  'bad_allowed' is the number of unbalanced
+ * partitions tolerated before switching to heapsort.  'leftmost' is
+ * zero if the value before begin is known to be no greater than any
+ * value in the range (it is the pivot of an enclosing partition). */
+
+static void arraylist_sort_internal(ArrayListValue *begin,
+                                    ArrayListValue *end,
+                                    ArrayListCompareFunc compare_func,
+                                    int bad_allowed, int leftmost)
+{
+	ArrayListValue *pivot_pos;
+	size_t size, half;
+	size_t l_size, r_size;
+	int already_partitioned;
+
+	/* Loop rather than recursing on the right hand partition. */
+
+	for (;;) {
+		size = (size_t) (end - begin);
+
+		if (size < ARRAYLIST_INSERTION_SORT_THRESHOLD) {
+			arraylist_insertion_sort(begin, end, compare_func,
+			                         leftmost);
+			return;
+		}
+
+		/* Choose the pivot and move it to the start of the range. */
+
+		half = size / 2;
+
+		if (size > ARRAYLIST_NINTHER_THRESHOLD) {
+			arraylist_sort3(begin, begin + half, end - 1,
+			                compare_func);
+			arraylist_sort3(begin + 1, begin + (half - 1), end - 2,
+			                compare_func);
+			arraylist_sort3(begin + 2, begin + (half + 1), end - 3,
+			                compare_func);
+			arraylist_sort3(begin + (half - 1), begin + half,
+			                begin + (half + 1), compare_func);
+			arraylist_sort_swap(begin, begin + half);
+		} else {
+			arraylist_sort3(begin + half, begin, end - 1,
+			                compare_func);
+		}
+
+		/* If the pivot equals the value preceding the range (the
+		 * pivot of the enclosing partition), every value equal to
+		 * it can be gathered on the left and skipped over. */
+
+		if (!leftmost && compare_func(*(begin - 1), *begin) >= 0) {
+			begin = arraylist_partition_left(begin, end,
+			                                 compare_func) + 1;
+			continue;
+		}
+
+		pivot_pos = arraylist_partition_right(begin, end, compare_func,
+		                                      &already_partitioned);
+
+		l_size = (size_t) (pivot_pos - begin);
+		r_size = (size_t) (end - (pivot_pos + 1));
+
+		if (l_size < size / 8 || r_size < size / 8) {
+
+			/* A badly unbalanced partition.  If there have been
+			 * too many, fall back to heapsort. */
+
+			if (--bad_allowed == 0) {
+				arraylist_heap_sort(begin, end, compare_func);
+				return;
+			}
+
+			arraylist_break_patterns(begin, pivot_pos);
+			arraylist_break_patterns(pivot_pos + 1, end);
+
+		} else if (already_partitioned
+		        && arraylist_partial_insertion_sort(begin, pivot_pos,
+		                                            compare_func)
+		        && arraylist_partial_insertion_sort(pivot_pos + 1, end,
+		                                            compare_func)) {
+
+			/* The input looked ordered, and was: nothing more to
+			 * do. */
+
+			return;
+		}
+
+		arraylist_sort_internal(begin, pivot_pos, compare_func,
+		                        bad_allowed, leftmost);
+
+		begin = pivot_pos + 1;
+		leftmost = 0;
+	}
+}
+
+static void arraylist_sort_data(ArrayListValue *data, size_t length,
+                                ArrayListCompareFunc compare_func)
+{
+	size_t n;
+	int bad_allowed;
+
+	/* Allow log2(n) bad partitions before falling back to heapsort. */
+
+	bad_allowed = 1;
+
+	for (n = length; n > 1; n >>= 1) {
+		++bad_allowed;
+	}
+
+	arraylist_sort_internal(data, data + length, compare_func,
+	                        bad_allowed, 1);
 }
 
 void arraylist_sort(ArrayList *arraylist, ArrayListCompareFunc compare_func)
 {
-	/* Perform the recursive sort */
+	arraylist_sort_data(arraylist->data, arraylist->length, compare_func);
+}
+
+/* Parallel sorting is done with a merge sort.  The array is halved
+ * recursively until the pieces are no larger than the threshold
+ * below; each piece is sorted with the sequential sort, then the
+ * pieces are merged back together using a stable merge.  Work is
+ * divided between threads by handing one half of each split (and of
+ * each large merge) to a new thread until the thread budget is used
+ * up.
+ *
+ * The way the array is divided depends only on its length, never on
+ * the number of threads, so the result is the same however many
+ * threads are used. */
+
+/* Arrays no larger than this are sorted sequentially. */
+
+#define ARRAYLIST_PARALLEL_SORT_THRESHOLD 32768
+
+typedef struct {
+	ArrayListValue *data;
+	ArrayListValue *scratch;
+	size_t length;
+	int to_scratch;
+	ArrayListCompareFunc compare_func;
+	unsigned int nthreads;
+} ArrayListSortTask;
+
+typedef struct {
+	ArrayListValue *left;
+	size_t left_length;
+	ArrayListValue *right;
+	size_t right_length;
+	ArrayListValue *dest;
+	ArrayListCompareFunc compare_func;
+	unsigned int nthreads;
+} ArrayListMergeTask;
+
+/* Run two tasks, in parallel if 'parallel' is non-zero.  If a thread
+ * cannot be created, or threads are not available, both tasks are run
+ * in the calling thread. */
+
+static void arraylist_fork_join(void *(*func)(void *), void *task1,
+                                void *task2, int parallel)
+{
+#ifdef HAVE_PTHREAD
+	pthread_t thread;
+
+	if (parallel && pthread_create(&thread, NULL, func, task1) == 0) {
+		func(task2);
+		pthread_join(thread, NULL);
+		return;
+	}
+#endif
+
+	func(task1);
+	func(task2);
+}
+
+/* Find the first value in a sorted array that is not less than
+ * 'value'. */
+
+static size_t arraylist_lower_bound(ArrayListValue *data, size_t length,
+                                    ArrayListValue value,
+                                    ArrayListCompareFunc compare_func)
+{
+	size_t min, max, mid;
+
+	min = 0;
+	max = length;
+
+	while (min < max) {
+		mid = min + (max - min) / 2;
+
+		if (compare_func(data[mid], value) < 0) {
+			min = mid + 1;
+		} else {
+			max = mid;
+		}
+	}
+
+	return min;
+}
+
+/* Find the first value in a sorted array that is greater than
+ * 'value'. */
+
+static size_t arraylist_upper_bound(ArrayListValue *data, size_t length,
+                                    ArrayListValue value,
+                                    ArrayListCompareFunc compare_func)
+{
+	size_t min, max, mid;
+
+	min = 0;
+	max = length;
+
+	while (min < max) {
+		mid = min + (max - min) / 2;
+
+		if (compare_func(value, data[mid]) < 0) {
+			max = mid;
+		} else {
+			min = mid + 1;
+		}
+	}
+
+	return min;
+}
+
+/* Merge two sorted arrays into 'dest'.  Where values compare equal,
+ * those from the left array are placed first. */
+
+static void *arraylist_merge_task(void *data)
+{
+	ArrayListMergeTask *task = data;
+	ArrayListMergeTask parts[2];
+	ArrayListValue *left, *right, *dest;
+	size_t left_split, right_split;
+	size_t i, j;
+
+	if (task->nthreads <= 1
+	 || task->left_length + task->right_length
+	      <= ARRAYLIST_PARALLEL_SORT_THRESHOLD) {
+
+		left = task->left;
+		right = task->right;
+		dest = task->dest;
+		i = 0;
+		j = 0;
+
+		while (i < task->left_length && j < task->right_length) {
+			if (task->compare_func(right[j], left[i]) < 0) {
+				*dest++ = right[j++];
+			} else {
+				*dest++ = left[i++];
+			}
+		}
+
+		memcpy(dest, left + i,
+		       sizeof(ArrayListValue) * (task->left_length - i));
+		dest += task->left_length - i;
+		memcpy(dest, right + j,
+		       sizeof(ArrayListValue) * (task->right_length - j));
+
+		return NULL;
+	}
+
+	/* Split the larger array in half, and find the matching split
+	 * point in the other array.  Values equal to the splitting value
+	 * are divided so that the two halves can be merged independently
+	 * and still give the same result as a single merge. */
+
+	if (task->left_length >= task->right_length) {
+		left_split = task->left_length / 2;
+		right_split = arraylist_lower_bound(task->right,
+		                                    task->right_length,
+		                                    task->left[left_split],
+		                                    task->compare_func);
+	} else {
+		right_split = task->right_length / 2;
+		left_split = arraylist_upper_bound(task->left,
+		                                   task->left_length,
+		                                   task->right[right_split],
+		                                   task->compare_func);
+	}
+
+	parts[0].left = task->left;
+	parts[0].left_length = left_split;
+	parts[0].right = task->right;
+	parts[0].right_length = right_split;
+	parts[0].dest = task->dest;
+	parts[0].compare_func = task->compare_func;
+	parts[0].nthreads = task->nthreads / 2;
+
+	parts[1].left = task->left + left_split;
+	parts[1].left_length = task->left_length - left_split;
+	parts[1].right = task->right + right_split;
+	parts[1].right_length = task->right_length - right_split;
+	parts[1].dest = task->dest + left_split + right_split;
+	parts[1].compare_func = task->compare_func;
+	parts[1].nthreads = task->nthreads - parts[0].nthreads;
+
+	arraylist_fork_join(arraylist_merge_task, &parts[0], &parts[1], 1);
+
+	return NULL;
+}
+
+/* Sort an array.  If 'to_scratch' is non-zero, the sorted result is
+ * left in the scratch array rather than the data array. */
+
+static void *arraylist_sort_task(void *data)
+{
+	ArrayListSortTask *task = data;
+	ArrayListSortTask halves[2];
+	ArrayListMergeTask merge;
+	size_t half;
+
+	if (task->length <= ARRAYLIST_PARALLEL_SORT_THRESHOLD) {
+		arraylist_sort_data(task->data, task->length,
+		                    task->compare_func);
+
+		if (task->to_scratch) {
+			memcpy(task->scratch, task->data,
+			       sizeof(ArrayListValue) * task->length);
+		}
+
+		return NULL;
+	}
+
+	/* Sort both halves into the other array, then merge them back
+	 * into the destination. */
+
+	half = task->length / 2;
+
+	halves[0].data = task->data;
+	halves[0].scratch = task->scratch;
+	halves[0].length = half;
+	halves[0].to_scratch = !task->to_scratch;
+	halves[0].compare_func = task->compare_func;
+	halves[0].nthreads = task->nthreads / 2;
+
+	halves[1].data = task->data + half;
+	halves[1].scratch = task->scratch + half;
+	halves[1].length = task->length - half;
+	halves[1].to_scratch = !task->to_scratch;
+	halves[1].compare_func = task->compare_func;
+	halves[1].nthreads = task->nthreads - halves[0].nthreads;
+
+	arraylist_fork_join(arraylist_sort_task, &halves[0], &halves[1],
+	                    task->nthreads > 1);
 
-	arraylist_sort_internal(arraylist->data, arraylist->length,
-	                        compare_func);
+	if (task->to_scratch) {
+		merge.left = task->data;
+		merge.dest = task->scratch;
+	} else {
+		merge.left = task->scratch;
+		merge.dest = task->data;
+	}
+
+	merge.left_length = half;
+	merge.right = merge.left + half;
+	merge.right_length = task->length - half;
+	merge.compare_func = task->compare_func;
+	merge.nthreads = task->nthreads;
+
+	arraylist_merge_task(&merge);
+
+	return NULL;
+}
+
+/* Find the number of online processors, or 1 if it cannot be found. */
+
+static unsigned int arraylist_num_processors(void)
+{
+#if defined(HAVE_PTHREAD) && defined(HAVE_UNISTD_H) \
+ && defined(_SC_NPROCESSORS_ONLN)
+	long online;
+
+	online = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (online > 0) {
+		return (unsigned int) online;
+	}
+#endif
+
+	return 1;
+}
+
+int arraylist_sort_parallel(ArrayList *arraylist,
+                            ArrayListCompareFunc compare_func,
+                            unsigned int nthreads)
+{
+	ArrayListSortTask task;
+	ArrayListValue *scratch;
+
+	if (nthreads == 0) {
+		nthreads = arraylist_num_processors();
+	}
+
+	/* Small arrays are not worth splitting up. */
+
+	if (arraylist->length <= ARRAYLIST_PARALLEL_SORT_THRESHOLD) {
+		arraylist_sort(arraylist, compare_func);
+		return 1;
+	}
+
+	scratch = malloc(sizeof(ArrayListValue) * arraylist->length);
+
+	if (scratch == NULL) {
+		return 0;
+	}
+
+	task.data = arraylist->data;
+	task.scratch = scratch;
+	task.length = arraylist->length;
+	task.to_scratch = 0;
+	task.compare_func = compare_func;
+	task.nthreads = nthreads;
+
+	arraylist_sort_task(&task);
+
+	free(scratch);
+
+	return 1;
 }
 
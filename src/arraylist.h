@@ -209,12 +209,46 @@ void arraylist_clear(ArrayList *arraylist);
 /**
  * Sort the values in an ArrayList.
  *
+ * The sort is an introspective quicksort (pattern-defeating
+ * quicksort): it runs in O(n log n) time in the worst case, and in
+ * linear time on input that is already sorted, reverse sorted or
+ * made up of a single repeated value.  The sort is not stable.
+ *
  * @param arraylist      The ArrayList.
  * @param compare_func   Function used to compare values in sorting.
  */
 
 void arraylist_sort(ArrayList *arraylist, ArrayListCompareFunc compare_func);
 
+/**
+ * Sort the values in an ArrayList using several threads.
+ *
+ * The list is divided into pieces which are sorted with
+ * @ref arraylist_sort and then merged back together.  Lists of up to
+ * a few tens of thousands of values are simply sorted in the calling
+ * thread.  The order in which equal values end up depends only on the
+ * contents of the list, not on the number of threads used or how they
+ * are scheduled, though it may differ from the order produced by
+ * @ref arraylist_sort.
+ *
+ * The compare function is called from several threads at once, and
+ * must be safe to use in this way.  If the library was built without
+ * POSIX threads, the same sort is run in the calling thread.
+ *
+ * @param arraylist      The ArrayList.
+ * @param compare_func   Function used to compare values in sorting.
+ * @param nthreads       Maximum number of threads to use, including the
+ *                       calling thread.  If zero, the number of online
+ *                       processors is used.
+ * @return               Non-zero if the list was sorted, or zero if it
+ *                       was not possible to allocate memory for the
+ *                       sort, in which case the list is unchanged.
+ */
+
+int arraylist_sort_parallel(ArrayList *arraylist,
+                            ArrayListCompareFunc compare_func,
+                            unsigned int nthreads);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "avl-tree.h"
 
@@ -28,6 +29,13 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
+/* If built with TREE_ROTATION_COUNTING defined, the number of rotations
+ * performed is counted.  This is used by the tree benchmark. */
+
+#ifdef TREE_ROTATION_COUNTING
+unsigned long avl_tree_rotation_count = 0;
+#endif
+
 /* AVL Tree (balanced binary search tree) */
 
 struct _AVLTreeNode {
@@ -36,15 +44,30 @@ struct _AVLTreeNode {
 	AVLTreeKey key;
 	AVLTreeValue value;
 	int height;
+	unsigned int size;
 };
 
 struct _AVLTree {
 	AVLTreeNode *root_node;
 	AVLTreeCompareFunc compare_func;
 	unsigned int num_nodes;
+	Allocator *allocator;
+
+	/* Nodes created by avl_tree_new_from_sorted, allocated in a
+	 * single block.  They are not freed individually; the whole block
+	 * is freed with the tree. */
+
+	AVLTreeNode *node_block;
+	unsigned int node_block_length;
 };
 
 AVLTree *avl_tree_new(AVLTreeCompareFunc compare_func)
+{
+	return avl_tree_new_with_allocator(compare_func, NULL);
+}
+
+AVLTree *avl_tree_new_with_allocator(AVLTreeCompareFunc compare_func,
+                                     Allocator *allocator)
 {
 	AVLTree *new_tree;
 
@@ -57,10 +80,25 @@ AVLTree *avl_tree_new(AVLTreeCompareFunc compare_func)
 	new_tree->root_node = NULL;
 	new_tree->compare_func = compare_func;
 	new_tree->num_nodes = 0;
+	new_tree->allocator = allocator;
+	new_tree->node_block = NULL;
+	new_tree->node_block_length = 0;
 
 	return new_tree;
 }
 
+/* Free a node, unless it is part of the tree's node block. */
+
+static void avl_tree_free_node(AVLTree *tree, AVLTreeNode *node)
+{
+	if ((uintptr_t) node - (uintptr_t) tree->node_block
+	    < sizeof(AVLTreeNode) * tree->node_block_length) {
+		return;
+	}
+
+	allocator_free(tree->allocator, node, sizeof(AVLTreeNode));
+}
+
 static void avl_tree_free_subtree(AVLTree *tree, AVLTreeNode *node)
 {
 	if (node == NULL) {
@@ -70,7 +108,7 @@ static void avl_tree_free_subtree(AVLTree *tree, AVLTreeNode *node)
 	avl_tree_free_subtree(tree, node->children[AVL_TREE_NODE_LEFT]);
 	avl_tree_free_subtree(tree, node->children[AVL_TREE_NODE_RIGHT]);
 
-	free(node);
+	avl_tree_free_node(tree, node);
 }
 
 void avl_tree_free(AVLTree *tree)
@@ -78,6 +116,7 @@ void avl_tree_free(AVLTree *tree)
 	/* Destroy all nodes */
 
 	avl_tree_free_subtree(tree, tree->root_node);
+	free(tree->node_block);
 
 	/* Free back the main tree data structure */
 
@@ -93,9 +132,20 @@ int avl_tree_subtree_height(AVLTreeNode *node)
 	}
 }
 
-/* Update the "height" variable of a node, from the heights of its
- * children.  This does not update the height variable of any parent
- * nodes. */
+/* Find the number of nodes in a subtree. */
+
+static unsigned int avl_tree_subtree_size(AVLTreeNode *node)
+{
+	if (node == NULL) {
+		return 0;
+	} else {
+		return node->size;
+	}
+}
+
+/* Update the "height" and "size" variables of a node, from the heights
+ * and sizes of its children.  This does not update the variables of
+ * any parent nodes. */
 
 static void avl_tree_update_height(AVLTreeNode *node)
 {
@@ -113,6 +163,9 @@ static void avl_tree_update_height(AVLTreeNode *node)
 	} else {
 		node->height = right_height + 1;
 	}
+
+	node->size = avl_tree_subtree_size(left_subtree)
+	           + avl_tree_subtree_size(right_subtree) + 1;
 }
 
 /* Find what side a node is relative to its parent */
@@ -178,6 +231,10 @@ static AVLTreeNode *avl_tree_rotate(AVLTree *tree, AVLTreeNode *node,
 {
 	AVLTreeNode *new_root;
 
+#ifdef TREE_ROTATION_COUNTING
+	++avl_tree_rotation_count;
+#endif
+
 	/* The child of this node will take its place:
 	   for a left rotation, it is the right child, and vice versa. */
 
@@ -200,10 +257,11 @@ static AVLTreeNode *avl_tree_rotate(AVLTree *tree, AVLTreeNode *node,
 		node->children[1-direction]->parent = node;
 	}
 
-	/* Update heights of the affected nodes */
+	/* Update heights of the affected nodes.  The old root is now a
+	 * child of the new root, so must be updated first. */
 
-	avl_tree_update_height(new_root);
 	avl_tree_update_height(node);
+	avl_tree_update_height(new_root);
 
 	return new_root;
 }
@@ -303,6 +361,89 @@ static void avl_tree_balance_to_root(AVLTree *tree, AVLTreeNode *node)
 	}
 }
 
+/* Link an array of nodes, in key order, into a perfectly balanced
+ * subtree: the middle node is the root, and the nodes either side of
+ * it form its subtrees. */
+
+static AVLTreeNode *avl_tree_build_subtree(AVLTreeNode *nodes,
+                                           unsigned int length,
+                                           AVLTreeNode *parent)
+{
+	AVLTreeNode *node;
+	unsigned int middle;
+
+	if (length == 0) {
+		return NULL;
+	}
+
+	middle = length / 2;
+	node = &nodes[middle];
+
+	node->parent = parent;
+	node->children[AVL_TREE_NODE_LEFT]
+	    = avl_tree_build_subtree(nodes, middle, node);
+	node->children[AVL_TREE_NODE_RIGHT]
+	    = avl_tree_build_subtree(nodes + middle + 1,
+	                             length - middle - 1, node);
+
+	avl_tree_update_height(node);
+
+	return node;
+}
+
+AVLTree *avl_tree_new_from_sorted(AVLTreeCompareFunc compare_func,
+                                  AVLTreeKey *keys, AVLTreeValue *values,
+                                  unsigned int length)
+{
+	AVLTree *new_tree;
+	unsigned int i;
+
+	/* The keys must be in strictly increasing order. */
+
+	for (i=1; i<length; ++i) {
+		if (compare_func(keys[i - 1], keys[i]) >= 0) {
+			return NULL;
+		}
+	}
+
+	new_tree = avl_tree_new(compare_func);
+
+	if (new_tree == NULL) {
+		return NULL;
+	}
+
+	if (length == 0) {
+		return new_tree;
+	}
+
+	/* Allocate all nodes at once, in key order. */
+
+	new_tree->node_block = malloc(sizeof(AVLTreeNode) * length);
+
+	if (new_tree->node_block == NULL) {
+		free(new_tree);
+		return NULL;
+	}
+
+	new_tree->node_block_length = length;
+
+	for (i=0; i<length; ++i) {
+		new_tree->node_block[i].key = keys[i];
+
+		if (values != NULL) {
+			new_tree->node_block[i].value = values[i];
+		} else {
+			new_tree->node_block[i].value = AVL_TREE_NULL;
+		}
+	}
+
+	new_tree->root_node = avl_tree_build_subtree(new_tree->node_block,
+	                                             length, NULL);
+	new_tree->num_nodes = length;
+
+	return new_tree;
+}
+
 AVLTreeNode *avl_tree_insert(AVLTree *tree, AVLTreeKey key, AVLTreeValue value)
 {
 	AVLTreeNode **rover;
@@ -325,7 +466,8 @@ AVLTreeNode *avl_tree_insert(AVLTree *tree, AVLTreeKey key, AVLTreeValue value)
 
 	/* Create a new node.  Use the last node visited as the parent link. */
 
-	new_node = (AVLTreeNode *) malloc(sizeof(AVLTreeNode));
+	new_node = (AVLTreeNode *) allocator_alloc(tree->allocator,
+	                                           sizeof(AVLTreeNode));
 
 	if (new_node == NULL) {
 		return NULL;
@@ -337,6 +479,7 @@ AVLTreeNode *avl_tree_insert(AVLTree *tree, AVLTreeKey key, AVLTreeValue value)
 	new_node->key = key;
 	new_node->value = value;
 	new_node->height = 1;
+	new_node->size = 1;
 
 	/* Insert at the NULL pointer that was reached */
 
@@ -459,6 +602,7 @@ void avl_tree_remove_node(AVLTree *tree, AVLTreeNode *node)
 		}
 
 		swap_node->height = node->height;
+		swap_node->size = node->size;
 
 		/* Link the parent's reference to this node */
 
@@ -467,7 +611,7 @@ void avl_tree_remove_node(AVLTree *tree, AVLTreeNode *node)
 
 	/* Destroy the node */
 
-	free(node);
+	avl_tree_free_node(tree, node);
 
 	/* Keep track of the number of nodes */
 
@@ -577,6 +721,235 @@ AVLTreeNode *avl_tree_node_parent(AVLTreeNode *node)
 	return node->parent;
 }
 
+/* Search for the first node with a key greater than the given key,
+ * or if 'inclusive' is non-zero, greater than or equal to it. */
+
+static AVLTreeNode *avl_tree_bound(AVLTree *tree, AVLTreeKey key, int inclusive)
+{
+	AVLTreeNode *node;
+	AVLTreeNode *result;
+	int diff;
+
+	node = tree->root_node;
+	result = NULL;
+
+	while (node != NULL) {
+		diff = tree->compare_func(key, node->key);
+
+		if (diff < 0 || (diff == 0 && inclusive)) {
+
+			/* This node is a candidate; look for an earlier one
+			 * in the left subtree. */
+
+			result = node;
+			node = node->children[AVL_TREE_NODE_LEFT];
+		} else {
+			node = node->children[AVL_TREE_NODE_RIGHT];
+		}
+	}
+
+	return result;
+}
+
+AVLTreeNode *avl_tree_lower_bound(AVLTree *tree, AVLTreeKey key)
+{
+	return avl_tree_bound(tree, key, 1);
+}
+
+AVLTreeNode *avl_tree_upper_bound(AVLTree *tree, AVLTreeKey key)
+{
+	return avl_tree_bound(tree, key, 0);
+}
+
+/* Find the next node in the given direction: for RIGHT, the in-order
+ * successor; for LEFT, the predecessor. */
+
+static AVLTreeNode *avl_tree_node_step(AVLTreeNode *node, AVLTreeNodeSide side)
+{
+	AVLTreeNode *result;
+
+	/* If there is a subtree on this side, the result is its nearest
+	 * node: the furthest node in the opposite direction. */
+
+	if (node->children[side] != NULL) {
+		result = node->children[side];
+
+		while (result->children[1-side] != NULL) {
+			result = result->children[1-side];
+		}
+
+		return result;
+	}
+
+	/* Otherwise, go up until we arrive at a parent from the opposite
+	 * side. */
+
+	while (node->parent != NULL
+	    && node->parent->children[side] == node) {
+		node = node->parent;
+	}
+
+	return node->parent;
+}
+
+AVLTreeNode *avl_tree_node_next(AVLTreeNode *node)
+{
+	return avl_tree_node_step(node, AVL_TREE_NODE_RIGHT);
+}
+
+AVLTreeNode *avl_tree_node_prev(AVLTreeNode *node)
+{
+	return avl_tree_node_step(node, AVL_TREE_NODE_LEFT);
+}
+
+void avl_tree_iterate(AVLTree *tree, AVLTreeIterator *iter)
+{
+	AVLTreeNode *node;
+
+	/* Start from the leftmost node. */
+
+	node = tree->root_node;
+
+	if (node != NULL) {
+		while (node->children[AVL_TREE_NODE_LEFT] != NULL) {
+			node = node->children[AVL_TREE_NODE_LEFT];
+		}
+	}
+
+	iter->next_node = node;
+}
+
+void avl_tree_iterate_from(AVLTree *tree, AVLTreeKey key,
+                           AVLTreeIterator *iter)
+{
+	iter->next_node = avl_tree_lower_bound(tree, key);
+}
+
+int avl_tree_iter_has_more(AVLTreeIterator *iter)
+{
+	return iter->next_node != NULL;
+}
+
+AVLTreeNode *avl_tree_iter_next(AVLTreeIterator *iter)
+{
+	AVLTreeNode *result;
+
+	result = iter->next_node;
+
+	/* Find the following node now, so that the caller can remove
+	 * the node being returned. */
+
+	if (result != NULL) {
+		iter->next_node = avl_tree_node_next(result);
+	}
+
+	return result;
+}
+
+unsigned int avl_tree_range_foreach(AVLTree *tree,
+                                    AVLTreeKey low, AVLTreeKey high,
+                                    AVLTreeRangeFunc callback,
+                                    void *user_data)
+{
+	AVLTreeNode *node;
+	AVLTreeNode *next;
+	unsigned int count;
+
+	count = 0;
+	node = avl_tree_lower_bound(tree, low);
+
+	while (node != NULL && tree->compare_func(node->key, high) <= 0) {
+
+		/* Find the next node before invoking the callback, in case
+		 * the callback removes this one. */
+
+		next = avl_tree_node_next(node);
+
+		callback(node, user_data);
+		++count;
+
+		node = next;
+	}
+
+	return count;
+}
+
+AVLTreeNode *avl_tree_select(AVLTree *tree, unsigned int index)
+{
+	AVLTreeNode *node;
+	unsigned int left_size;
+
+	node = tree->root_node;
+
+	/* Use the subtree sizes to decide which way to go at each node. */
+
+	while (node != NULL) {
+		left_size = avl_tree_subtree_size(
+		                node->children[AVL_TREE_NODE_LEFT]);
+
+		if (index < left_size) {
+			node = node->children[AVL_TREE_NODE_LEFT];
+		} else if (index == left_size) {
+			return node;
+		} else {
+			index -= left_size + 1;
+			node = node->children[AVL_TREE_NODE_RIGHT];
+		}
+	}
+
+	/* Index is out of range. */
+
+	return NULL;
+}
+
+/* Count the nodes with keys less than the given key, or if 'inclusive'
+ * is non-zero, less than or equal to it. */
+
+static unsigned int avl_tree_count_below(AVLTree *tree, AVLTreeKey key,
+                                         int inclusive)
+{
+	AVLTreeNode *node;
+	unsigned int result;
+	int diff;
+
+	node = tree->root_node;
+	result = 0;
+
+	while (node != NULL) {
+		diff = tree->compare_func(key, node->key);
+
+		if (diff < 0 || (diff == 0 && !inclusive)) {
+			node = node->children[AVL_TREE_NODE_LEFT];
+		} else {
+
+			/* This node and its whole left subtree are below
+			 * the key. */
+
+			result += avl_tree_subtree_size(
+			              node->children[AVL_TREE_NODE_LEFT]) + 1;
+			node = node->children[AVL_TREE_NODE_RIGHT];
+		}
+	}
+
+	return result;
+}
+
+unsigned int avl_tree_rank(AVLTree *tree, AVLTreeKey key)
+{
+	return avl_tree_count_below(tree, key, 0);
+}
+
+unsigned int avl_tree_count_range(AVLTree *tree, AVLTreeKey low,
+                                  AVLTreeKey high)
+{
+	if (tree->compare_func(low, high) > 0) {
+		return 0;
+	}
+
+	return avl_tree_count_below(tree, high, 1)
+	     - avl_tree_count_below(tree, low, 0);
+}
+
 unsigned int avl_tree_num_entries(AVLTree *tree)
 {
 	return tree->num_nodes;
@@ -35,7 +35,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * as a set of keys which is always ordered.
  *
  * To create a new AVL tree, use @ref avl_tree_new.  To destroy
- * an AVL tree, use @ref avl_tree_free.
+ * an AVL tree, use @ref avl_tree_free.  To build a tree from entries
+ * that are already sorted, use @ref avl_tree_new_from_sorted.
  *
  * To insert a new key-value pair into an AVL tree, use
  * @ref avl_tree_insert.  To remove an entry from an
@@ -44,6 +45,20 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * To search an AVL tree, use @ref avl_tree_lookup or
  * @ref avl_tree_lookup_node.
  *
+ * To visit nodes in order, use @ref avl_tree_iterate or
+ * @ref avl_tree_iterate_from to initialise a @ref AVLTreeIterator, and
+ * @ref avl_tree_iter_next and @ref avl_tree_iter_has_more to step through
+ * the nodes.  @ref avl_tree_lower_bound, @ref avl_tree_upper_bound,
+ * @ref avl_tree_node_next and @ref avl_tree_node_prev find neighbouring
+ * nodes, and @ref avl_tree_range_foreach visits all nodes with keys in a
+ * range.
+ *
+ * Each node records the size of its subtree, so that the tree can
+ * answer order statistic queries in O(log n) time: use
+ * @ref avl_tree_select to find the n-th entry, @ref avl_tree_rank to
+ * find the position of a key, and @ref avl_tree_count_range to count
+ * the entries between two keys.
+ *
  * Tree nodes can be queried using the
  * @ref avl_tree_node_child,
  * @ref avl_tree_node_parent,
@@ -54,6 +69,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #ifndef ALGORITHM_AVLTREE_H
 #define ALGORITHM_AVLTREE_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -118,6 +135,31 @@ typedef enum {
 
 typedef int (*AVLTreeCompareFunc)(AVLTreeValue value1, AVLTreeValue value2);
 
+/**
+ * Structure used to iterate over the nodes of an AVL tree in order.
+ */
+
+typedef struct _AVLTreeIterator AVLTreeIterator;
+
+/**
+ * Definition of an @ref AVLTreeIterator.
+ */
+
+struct _AVLTreeIterator {
+	AVLTreeNode *next_node;
+};
+
+/**
+ * Callback function invoked for each node by
+ * @ref avl_tree_range_foreach.
+ *
+ * @param node             The tree node.
+ * @param user_data        The user data pointer passed to
+ *                         @ref avl_tree_range_foreach.
+ */
+
+typedef void (*AVLTreeRangeFunc)(AVLTreeNode *node, void *user_data);
+
 /**
  * Create a new AVL tree.
  *
@@ -128,6 +170,40 @@ typedef int (*AVLTreeCompareFunc)(AVLTreeValue value1, AVLTreeValue value2);
 
 AVLTree *avl_tree_new(AVLTreeCompareFunc compare_func);
 
+/**
+ * Create a new AVL tree, using a custom allocator for its nodes.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @param allocator       The allocator to use, or NULL to use malloc().
+ * @return                A new AVL tree, or NULL if it was not possible
+ *                        to allocate the memory.
+ */
+
+AVLTree *avl_tree_new_with_allocator(AVLTreeCompareFunc compare_func,
+                                     Allocator *allocator);
+
+/**
+ * Create a new AVL tree from arrays of keys and values already sorted
+ * by key.  This builds a perfectly balanced tree in linear time, which
+ * is much faster than inserting the entries one at a time.  The nodes
+ * are allocated as a single block using malloc(); nodes added to the
+ * tree later are allocated individually.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @param keys            The keys, in strictly increasing order according
+ *                        to compare_func.
+ * @param values          The value for each key, or NULL to give every
+ *                        key the value @ref AVL_TREE_NULL.
+ * @param length          The number of keys.
+ * @return                A new AVL tree, or NULL if the keys are not in
+ *                        strictly increasing order or it was not possible
+ *                        to allocate the memory.
+ */
+
+AVLTree *avl_tree_new_from_sorted(AVLTreeCompareFunc compare_func,
+                                  AVLTreeKey *keys, AVLTreeValue *values,
+                                  unsigned int length);
+
 /**
  * Destroy an AVL tree.
  *
@@ -257,6 +333,164 @@ AVLTreeNode *avl_tree_node_parent(AVLTreeNode *node);
 
 int avl_tree_subtree_height(AVLTreeNode *node);
 
+/**
+ * Find the node at a given position in the tree, in the order of the
+ * keys.  This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param index           The position of the node, counting from zero
+ *                        for the node with the smallest key.
+ * @return                The node at the given position, or NULL if the
+ *                        index is not less than the number of entries
+ *                        in the tree.
+ */
+
+AVLTreeNode *avl_tree_select(AVLTree *tree, unsigned int index);
+
+/**
+ * Find the rank of a key in the tree: the number of entries with keys
+ * less than the given key.  If the key is in the tree, this is the
+ * index of its first node as used by @ref avl_tree_select.  This takes
+ * O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key.  It does not need to be in the tree.
+ * @return                The number of entries with keys less than the
+ *                        given key.
+ */
+
+unsigned int avl_tree_rank(AVLTree *tree, AVLTreeKey key);
+
+/**
+ * Count the entries in the tree with keys in a given range.  This
+ * takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param low             The lower bound of the range.
+ * @param high            The upper bound of the range.
+ * @return                The number of entries with keys greater than or
+ *                        equal to low, and less than or equal to high.
+ */
+
+unsigned int avl_tree_count_range(AVLTree *tree, AVLTreeKey low,
+                                  AVLTreeKey high);
+
+/**
+ * Find the first node in the tree with a key greater than or equal to
+ * a given key.  This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key to search for.
+ * @return                The first node with a key not less than the
+ *                        given key, or NULL if there is no such node.
+ */
+
+AVLTreeNode *avl_tree_lower_bound(AVLTree *tree, AVLTreeKey key);
+
+/**
+ * Find the first node in the tree with a key greater than a given key.
+ * This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key to search for.
+ * @return                The first node with a key greater than the
+ *                        given key, or NULL if there is no such node.
+ */
+
+AVLTreeNode *avl_tree_upper_bound(AVLTree *tree, AVLTreeKey key);
+
+/**
+ * Find the node following a given node, in the order of the keys.
+ * This takes O(log n) time in the worst case, but O(1) time on
+ * average when stepping through the whole tree.
+ *
+ * @param node            The tree node.
+ * @return                The next node in the tree, or NULL if this is
+ *                        the last node.
+ */
+
+AVLTreeNode *avl_tree_node_next(AVLTreeNode *node);
+
+/**
+ * Find the node preceding a given node, in the order of the keys.
+ * This takes O(log n) time in the worst case, but O(1) time on
+ * average when stepping through the whole tree.
+ *
+ * @param node            The tree node.
+ * @return                The previous node in the tree, or NULL if this
+ *                        is the first node.
+ */
+
+AVLTreeNode *avl_tree_node_prev(AVLTreeNode *node);
+
+/**
+ * Initialise a @ref AVLTreeIterator to iterate over the nodes in a tree,
+ * in the order of their keys.  No memory is allocated.  The node most
+ * recently returned by @ref avl_tree_iter_next may be removed from the
+ * tree while iterating; any other change to the tree invalidates the
+ * iterator.
+ *
+ * @param tree            The tree.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void avl_tree_iterate(AVLTree *tree, AVLTreeIterator *iter);
+
+/**
+ * Initialise a @ref AVLTreeIterator to iterate over the nodes in a tree,
+ * starting from the first node with a key greater than or equal to a
+ * given key (see @ref avl_tree_lower_bound).
+ *
+ * @param tree            The tree.
+ * @param key             The key to start from.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void avl_tree_iterate_from(AVLTree *tree, AVLTreeKey key,
+                           AVLTreeIterator *iter);
+
+/**
+ * Determine if there are more nodes to iterate over.
+ *
+ * @param iter            The iterator.
+ * @return                Zero if there are no more nodes, non-zero if
+ *                        there are more nodes to read.
+ */
+
+int avl_tree_iter_has_more(AVLTreeIterator *iter);
+
+/**
+ * Using an iterator, retrieve the next node in the tree.
+ *
+ * @param iter            The iterator.
+ * @return                The next node, or NULL if there are no more
+ *                        nodes.
+ */
+
+AVLTreeNode *avl_tree_iter_next(AVLTreeIterator *iter);
+
+/**
+ * Invoke a callback function for every node in the tree with a key in
+ * a given range, in the order of the keys.  This takes O(log n + k)
+ * time, where k is the number of nodes in the range.  The callback may
+ * remove the node it is passed from the tree, but must not otherwise
+ * modify the tree.
+ *
+ * @param tree            The tree.
+ * @param low             The lower bound of the range.
+ * @param high            The upper bound of the range.
+ * @param callback        Function to invoke for each node with a key
+ *                        greater than or equal to low, and less than or
+ *                        equal to high.
+ * @param user_data       Extra data to pass to the callback function.
+ * @return                The number of nodes visited.
+ */
+
+unsigned int avl_tree_range_foreach(AVLTree *tree,
+                                    AVLTreeKey low, AVLTreeKey high,
+                                    AVLTreeRangeFunc callback,
+                                    void *user_data);
+
 /**
  * Convert the keys in an AVL tree into a C array.  This allows
  * the tree to be used as an ordered set.
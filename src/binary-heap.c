@@ -19,6 +19,9 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
 
 #include "binary-heap.h"
 
@@ -28,29 +31,292 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
+/* The values are stored in a d-ary tree: the children of the value at
+ * index i are at indexes i * arity + 1 to i * arity + arity.  The array
+ * is aligned so that each group of children starts on a cache line
+ * boundary (for the default arity of 4, two groups fit in a line), so
+ * comparing the children of a node touches only one cache line. */
+
+#define BINARY_HEAP_DEFAULT_ARITY 4
+#define BINARY_HEAP_CACHE_LINE 64
+
+typedef unsigned int (*BinaryHeapSiftFunc)(BinaryHeap *heap,
+                                           unsigned int index,
+                                           BinaryHeapValue value,
+                                           BinaryHeapHandle *handle);
+
+/* A handle records the index of its value in the heap, which is updated
+ * whenever the value moves.  Handles are stored in an array parallel to
+ * the values, which is only allocated once the first handle is
+ * requested. */
+
+struct _BinaryHeapHandle {
+	unsigned int index;
+};
+
 struct _BinaryHeap {
 	BinaryHeapType heap_type;
 	BinaryHeapValue *values;
+	void *alloced_values;
+	BinaryHeapHandle **handles;
 	unsigned int num_values;
 	unsigned int alloced_size;
+	unsigned int arity;
 	BinaryHeapCompareFunc compare_func;
+	BinaryHeapSiftFunc sift_up;
+	BinaryHeapSiftFunc sift_down;
 };
 
-static int binary_heap_cmp(BinaryHeap *heap, BinaryHeapValue data1,
-                           BinaryHeapValue data2)
+/* Returns true if value1 belongs above value2 in the heap.  is_max is
+ * always a constant, so that each of the sift functions below is
+ * compiled for one type of heap and does not test the type on each
+ * comparison. */
+
+static inline int binary_heap_before(BinaryHeap *heap,
+                                     BinaryHeapValue value1,
+                                     BinaryHeapValue value2,
+                                     const int is_max)
 {
-	if (heap->heap_type == BINARY_HEAP_TYPE_MIN) {
-		return heap->compare_func(data1, data2);
+	if (is_max) {
+		return heap->compare_func(value2, value1) < 0;
 	} else {
-		return -heap->compare_func(data1, data2);
+		return heap->compare_func(value1, value2) < 0;
+	}
+}
+
+/* Store a value and its handle (if the heap has handles) at an index */
+
+static inline void binary_heap_set(BinaryHeap *heap, unsigned int index,
+                                   BinaryHeapValue value,
+                                   BinaryHeapHandle *handle)
+{
+	heap->values[index] = value;
+
+	if (heap->handles != NULL) {
+		heap->handles[index] = handle;
+
+		if (handle != NULL) {
+			handle->index = index;
+		}
+	}
+}
+
+/* Move the value at one index to another */
+
+static inline void binary_heap_move(BinaryHeap *heap, unsigned int dest,
+                                    unsigned int src)
+{
+	binary_heap_set(heap, dest, heap->values[src],
+	                heap->handles != NULL ? heap->handles[src] : NULL);
+}
+
+/* Move a value up from the given index until it is below a value that
+ * comes before it, and store it there.  Returns the final index. */
+
+static inline unsigned int binary_heap_sift_up_type(BinaryHeap *heap,
+                                                    unsigned int index,
+                                                    BinaryHeapValue value,
+                                                    BinaryHeapHandle *handle,
+                                                    const int is_max)
+{
+	unsigned int parent;
+
+	while (index > 0) {
+		parent = (index - 1) / heap->arity;
+
+		/* Compare the node with its parent */
+
+		if (!binary_heap_before(heap, value, heap->values[parent],
+		                        is_max)) {
+
+			/* Ordered correctly */
+
+			break;
+		}
+
+		/* Move the parent down and advance up to it */
+
+		binary_heap_move(heap, index, parent);
+		index = parent;
+	}
+
+	binary_heap_set(heap, index, value, handle);
+
+	return index;
+}
+
+/* Move a value down from the given index until none of its children
+ * come before it, and store it there.  Returns the final index. */
+
+static inline unsigned int binary_heap_sift_down_type(BinaryHeap *heap,
+                                                      unsigned int index,
+                                                      BinaryHeapValue value,
+                                                      BinaryHeapHandle *handle,
+                                                      const int is_max)
+{
+	BinaryHeapValue *values;
+	unsigned int first_child;
+	unsigned int end_child;
+	unsigned int next_index;
+	unsigned int child;
+
+	values = heap->values;
+
+	for (;;) {
+
+		/* Calculate the array indexes of the children of this node */
+
+		first_child = index * heap->arity + 1;
+
+		if (first_child >= heap->num_values) {
+			break;
+		}
+
+		end_child = first_child + heap->arity;
+
+		if (end_child > heap->num_values) {
+			end_child = heap->num_values;
+		}
+
+		/* Find the child which comes first */
+
+		next_index = first_child;
+
+		for (child=first_child + 1; child<end_child; ++child) {
+			if (binary_heap_before(heap, values[child],
+			                       values[next_index], is_max)) {
+				next_index = child;
+			}
+		}
+
+		/* If the value comes before all its children, the heap
+		 * condition is satisfied and we can stop */
+
+		if (!binary_heap_before(heap, values[next_index], value,
+		                        is_max)) {
+			break;
+		}
+
+		/* Move the child up, and advance to it */
+
+		binary_heap_move(heap, index, next_index);
+		index = next_index;
+	}
+
+	binary_heap_set(heap, index, value, handle);
+
+	return index;
+}
+
+static unsigned int binary_heap_sift_up_min(BinaryHeap *heap,
+                                            unsigned int index,
+                                            BinaryHeapValue value,
+                                            BinaryHeapHandle *handle)
+{
+	return binary_heap_sift_up_type(heap, index, value, handle, 0);
+}
+
+static unsigned int binary_heap_sift_up_max(BinaryHeap *heap,
+                                            unsigned int index,
+                                            BinaryHeapValue value,
+                                            BinaryHeapHandle *handle)
+{
+	return binary_heap_sift_up_type(heap, index, value, handle, 1);
+}
+
+static unsigned int binary_heap_sift_down_min(BinaryHeap *heap,
+                                              unsigned int index,
+                                              BinaryHeapValue value,
+                                              BinaryHeapHandle *handle)
+{
+	return binary_heap_sift_down_type(heap, index, value, handle, 0);
+}
+
+static unsigned int binary_heap_sift_down_max(BinaryHeap *heap,
+                                              unsigned int index,
+                                              BinaryHeapValue value,
+                                              BinaryHeapHandle *handle)
+{
+	return binary_heap_sift_down_type(heap, index, value, handle, 1);
+}
+
+/* Enlarge the arrays of values and handles.  The values are aligned so
+ * that the first child of the root starts a cache line. */
+
+static int binary_heap_alloc_values(BinaryHeap *heap, unsigned int size)
+{
+	void *alloced_values;
+	BinaryHeapValue *values;
+	BinaryHeapHandle **handles;
+	uintptr_t first_child;
+
+	/* Limit the size so that child indexes cannot overflow */
+
+	if (size > UINT_MAX / heap->arity - 1
+	 || size > (SIZE_MAX - BINARY_HEAP_CACHE_LINE)
+	           / sizeof(BinaryHeapValue)) {
+		return 0;
+	}
+
+	alloced_values = malloc(sizeof(BinaryHeapValue) * size
+	                        + BINARY_HEAP_CACHE_LINE);
+
+	if (alloced_values == NULL) {
+		return 0;
+	}
+
+	if (heap->handles != NULL) {
+		handles = realloc(heap->handles,
+		                  sizeof(BinaryHeapHandle *) * size);
+
+		if (handles == NULL) {
+			free(alloced_values);
+			return 0;
+		}
+
+		heap->handles = handles;
+	}
+
+	first_child = (uintptr_t) alloced_values + sizeof(BinaryHeapValue);
+	first_child = (first_child + BINARY_HEAP_CACHE_LINE - 1)
+	            & ~((uintptr_t) BINARY_HEAP_CACHE_LINE - 1);
+	values = (BinaryHeapValue *) first_child - 1;
+
+	/* Copy the existing values */
+
+	if (heap->alloced_values != NULL) {
+		memcpy(values, heap->values,
+		       sizeof(BinaryHeapValue) * heap->num_values);
+		free(heap->alloced_values);
 	}
+
+	heap->alloced_values = alloced_values;
+	heap->values = values;
+	heap->alloced_size = size;
+
+	return 1;
 }
 
 BinaryHeap *binary_heap_new(BinaryHeapType heap_type,
                             BinaryHeapCompareFunc compare_func)
+{
+	return binary_heap_new_with_arity(heap_type, compare_func,
+	                                  BINARY_HEAP_DEFAULT_ARITY);
+}
+
+/* Create a new heap, with space for the given number of values */
+
+static BinaryHeap *binary_heap_create(BinaryHeapType heap_type,
+                                      BinaryHeapCompareFunc compare_func,
+                                      unsigned int arity,
+                                      unsigned int size)
 {
 	BinaryHeap *heap;
 
+	if (arity < 2) {
+		return NULL;
+	}
+
 	heap = malloc(sizeof(BinaryHeap));
 
 	if (heap == NULL) {
@@ -59,14 +325,23 @@ BinaryHeap *binary_heap_new(BinaryHeapType heap_type,
 
 	heap->heap_type = heap_type;
 	heap->num_values = 0;
+	heap->arity = arity;
 	heap->compare_func = compare_func;
+	heap->handles = NULL;
 
-	/* Initial size of 16 elements */
+	/* Choose the sift functions for the heap type */
+
+	if (heap_type == BINARY_HEAP_TYPE_MIN) {
+		heap->sift_up = binary_heap_sift_up_min;
+		heap->sift_down = binary_heap_sift_down_min;
+	} else {
+		heap->sift_up = binary_heap_sift_up_max;
+		heap->sift_down = binary_heap_sift_down_max;
+	}
 
-	heap->alloced_size = 16;
-	heap->values = malloc(sizeof(BinaryHeapValue) * heap->alloced_size);
+	heap->alloced_values = NULL;
 
-	if (heap->values == NULL) {
+	if (!binary_heap_alloc_values(heap, size)) {
 		free(heap);
 		return NULL;
 	}
@@ -74,158 +349,227 @@ BinaryHeap *binary_heap_new(BinaryHeapType heap_type,
 	return heap;
 }
 
-void binary_heap_free(BinaryHeap *heap)
+BinaryHeap *binary_heap_new_with_arity(BinaryHeapType heap_type,
+                                       BinaryHeapCompareFunc compare_func,
+                                       unsigned int arity)
 {
-	free(heap->values);
-	free(heap);
+	/* Initial size of 16 elements */
+
+	return binary_heap_create(heap_type, compare_func, arity, 16);
 }
 
-int binary_heap_insert(BinaryHeap *heap, BinaryHeapValue value)
+BinaryHeap *binary_heap_new_from_array(BinaryHeapType heap_type,
+                                       BinaryHeapCompareFunc compare_func,
+                                       BinaryHeapValue *values,
+                                       unsigned int length)
 {
-	BinaryHeapValue *new_values;
-	unsigned int index;
-	unsigned int new_size;
-	unsigned int parent;
+	BinaryHeap *heap;
+	unsigned int i;
 
-	/* Possibly realloc the heap to a larger size */
+	heap = binary_heap_create(heap_type, compare_func,
+	                          BINARY_HEAP_DEFAULT_ARITY,
+	                          length > 16 ? length : 16);
 
-	if (heap->num_values >= heap->alloced_size) {
+	if (heap == NULL) {
+		return NULL;
+	}
 
-		/* Double the table size */
+	if (length == 0) {
+		return heap;
+	}
 
-		new_size = heap->alloced_size * 2;
-		new_values = realloc(heap->values,
-		                     sizeof(BinaryHeapValue) * new_size);
+	memcpy(heap->values, values, sizeof(BinaryHeapValue) * length);
+	heap->num_values = length;
 
-		if (new_values == NULL) {
-			return 0;
-		}
+	/* Floyd's method: sift down each value that has children, starting
+	 * from the last one.  Most values are near the bottom of the tree
+	 * and move only a short distance, so this takes linear time. */
+
+	if (length > 1) {
+		i = (length - 2) / heap->arity + 1;
 
-		heap->alloced_size = new_size;
-		heap->values = new_values;
+		while (i > 0) {
+			--i;
+			heap->sift_down(heap, i, heap->values[i], NULL);
+		}
 	}
 
-	/* Add to the bottom of the heap and start from there */
+	return heap;
+}
 
-	index = heap->num_values;
-	++heap->num_values;
+void binary_heap_free(BinaryHeap *heap)
+{
+	unsigned int i;
 
-	/* Percolate the value up to the top of the heap */
+	/* Free any handles that are still in use */
 
-	while (index > 0) {
+	if (heap->handles != NULL) {
+		for (i=0; i<heap->num_values; ++i) {
+			free(heap->handles[i]);
+		}
+
+		free(heap->handles);
+	}
+
+	free(heap->alloced_values);
+	free(heap);
+}
 
-		/* The parent index is found by halving the node index */
+/* Make space to add a new value to the heap */
 
-		parent = (index - 1) / 2;
+static int binary_heap_reserve(BinaryHeap *heap)
+{
+	if (heap->num_values < heap->alloced_size) {
+		return 1;
+	}
 
-		/* Compare the node with its parent */
+	/* Double the table size */
 
-		if (binary_heap_cmp(heap, heap->values[parent], value) < 0) {
+	return heap->alloced_size <= UINT_MAX / 2
+	    && binary_heap_alloc_values(heap, heap->alloced_size * 2);
+}
 
-			/* Ordered correctly - insertion is complete */
+int binary_heap_insert(BinaryHeap *heap, BinaryHeapValue value)
+{
+	/* Possibly enlarge the heap */
 
-			break;
+	if (!binary_heap_reserve(heap)) {
+		return 0;
+	}
+
+	/* Add to the bottom of the heap and percolate the value up to the
+	 * top of the heap */
+
+	++heap->num_values;
+	heap->sift_up(heap, heap->num_values - 1, value, NULL);
 
-		} else {
+	return 1;
+}
 
-			/* Need to swap this node with its parent */
+BinaryHeapHandle *binary_heap_insert_handle(BinaryHeap *heap,
+                                            BinaryHeapValue value)
+{
+	BinaryHeapHandle *handle;
 
-			heap->values[index] = heap->values[parent];
+	/* Allocate the array of handles when the first handle is used */
 
-			/* Advance up to the parent */
+	if (heap->handles == NULL) {
+		heap->handles = calloc(heap->alloced_size,
+		                       sizeof(BinaryHeapHandle *));
 
-			index = parent;
+		if (heap->handles == NULL) {
+			return NULL;
 		}
 	}
 
-	/* Save the new value in the final location */
+	handle = malloc(sizeof(BinaryHeapHandle));
 
-	heap->values[index] = value;
+	if (handle == NULL) {
+		return NULL;
+	}
 
-	return 1;
+	if (!binary_heap_reserve(heap)) {
+		free(handle);
+		return NULL;
+	}
+
+	++heap->num_values;
+	heap->sift_up(heap, heap->num_values - 1, value, handle);
+
+	return handle;
 }
 
-BinaryHeapValue binary_heap_pop(BinaryHeap *heap)
+/* Remove the value at an index from the heap, filling the gap with the
+ * last value.  Returns the value that was removed. */
+
+static BinaryHeapValue binary_heap_remove_index(BinaryHeap *heap,
+                                                unsigned int index)
 {
 	BinaryHeapValue result;
-	BinaryHeapValue new_value;
-	unsigned int index;
-	unsigned int next_index;
-	unsigned int child1, child2;
+	BinaryHeapValue last_value;
+	BinaryHeapHandle *last_handle;
 
-	/* Empty heap? */
+	result = heap->values[index];
 
-	if (heap->num_values == 0) {
-		return BINARY_HEAP_NULL;
+	if (heap->handles != NULL) {
+		free(heap->handles[index]);
 	}
 
-	/* Take the value from the top of the heap */
-
-	result = heap->values[0];
+	/* Remove the last value from the heap */
 
-	/* Remove the last value from the heap; we will percolate this down
-	 * from the top. */
-
-	new_value = heap->values[heap->num_values - 1];
 	--heap->num_values;
 
-	/* Percolate the new top value down */
+	if (index == heap->num_values) {
+		return result;
+	}
 
-	index = 0;
+	last_value = heap->values[heap->num_values];
+	last_handle = NULL;
 
-	for (;;) {
+	if (heap->handles != NULL) {
+		last_handle = heap->handles[heap->num_values];
+	}
 
-		/* Calculate the array indexes of the children of this node */
+	/* Put the last value in the gap, and move it up or down to where
+	 * it belongs */
 
-		child1 = index * 2 + 1;
-		child2 = index * 2 + 2;
+	if (heap->sift_up(heap, index, last_value, last_handle) == index) {
+		heap->sift_down(heap, index, last_value, last_handle);
+	}
 
-		if (child1 < heap->num_values
-		 && binary_heap_cmp(heap,
-		                    new_value,
-		                    heap->values[child1]) > 0) {
+	return result;
+}
 
-			/* Left child is less than the node.  We need to swap
-			 * with one of the children, whichever is less. */
+BinaryHeapValue binary_heap_pop(BinaryHeap *heap)
+{
+	/* Empty heap? */
 
-			if (child2 < heap->num_values
-			 && binary_heap_cmp(heap,
-			                    heap->values[child1],
-			                    heap->values[child2]) > 0) {
-				next_index = child2;
-			} else {
-				next_index = child1;
-			}
+	if (heap->num_values == 0) {
+		return BINARY_HEAP_NULL;
+	}
+
+	/* Take the value from the top of the heap */
 
-		} else if (child2 < heap->num_values
-		        && binary_heap_cmp(heap,
-		                           new_value,
-		                           heap->values[child2]) > 0) {
+	return binary_heap_remove_index(heap, 0);
+}
 
-			/* Right child is less than the node.  Swap with the
-			 * right child. */
+unsigned int binary_heap_pop_n(BinaryHeap *heap, BinaryHeapValue *values,
+                               unsigned int count)
+{
+	unsigned int i;
 
-			next_index = child2;
+	if (count > heap->num_values) {
+		count = heap->num_values;
+	}
 
-		} else {
-			/* Node is less than both its children. The heap
-			 * condition is satisfied.  * We can stop percolating
-			 * down. */
+	for (i=0; i<count; ++i) {
+		values[i] = binary_heap_remove_index(heap, 0);
+	}
 
-			heap->values[index] = new_value;
-			break;
-		}
+	return count;
+}
 
-		/* Swap the current node with the least of the child nodes. */
+void binary_heap_decrease_key(BinaryHeap *heap, BinaryHeapHandle *handle,
+                              BinaryHeapValue value)
+{
+	heap->sift_up(heap, handle->index, value, handle);
+}
 
-		heap->values[index] = heap->values[next_index];
+void binary_heap_update(BinaryHeap *heap, BinaryHeapHandle *handle,
+                        BinaryHeapValue value)
+{
+	unsigned int index;
 
-		/* Advance to the child we chose */
+	index = handle->index;
 
-		index = next_index;
+	if (heap->sift_up(heap, index, value, handle) == index) {
+		heap->sift_down(heap, index, value, handle);
 	}
+}
 
-	return result;
+BinaryHeapValue binary_heap_remove(BinaryHeap *heap, BinaryHeapHandle *handle)
+{
+	return binary_heap_remove_index(heap, handle->index);
 }
 
 unsigned int binary_heap_num_entries(BinaryHeap *heap)
@@ -32,6 +32,23 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * To insert a value into a binary heap, use @ref binary_heap_insert.
  *
  * To remove the first value from a binary heap, use @ref binary_heap_pop.
+ * To remove several values at once, use @ref binary_heap_pop_n.
+ *
+ * To create a heap from an array of values, which is faster than
+ * inserting them one at a time, use @ref binary_heap_new_from_array.
+ *
+ * By default, the heap is a 4-ary tree rather than a binary tree: each
+ * node has four children, which are stored next to each other in the
+ * same cache line.  This halves the depth of the tree, and the number
+ * of cache misses when values are added and removed.  A heap with a
+ * different number of children per node can be created using
+ * @ref binary_heap_new_with_arity.
+ *
+ * To change the priority of a value or to remove it from the heap, it
+ * must be inserted using @ref binary_heap_insert_handle, which returns a
+ * handle to the value.  The priority can then be changed using
+ * @ref binary_heap_decrease_key or @ref binary_heap_update, and the
+ * value removed using @ref binary_heap_remove.
  *
  */
 
@@ -91,6 +108,14 @@ typedef int (*BinaryHeapCompareFunc)(BinaryHeapValue value1,
 
 typedef struct _BinaryHeap BinaryHeap;
 
+/**
+ * A handle to a value in a @ref BinaryHeap, which can be used to change
+ * its priority or to remove it.  A handle is valid until its value is
+ * removed from the heap.
+ */
+
+typedef struct _BinaryHeapHandle BinaryHeapHandle;
+
 /**
  * Create a new @ref BinaryHeap.
  *
@@ -104,6 +129,45 @@ typedef struct _BinaryHeap BinaryHeap;
 BinaryHeap *binary_heap_new(BinaryHeapType heap_type,
                             BinaryHeapCompareFunc compare_func);
 
+/**
+ * Create a new @ref BinaryHeap with the given number of children for
+ * each node.
+ *
+ * @param heap_type        The type of heap: min heap or max heap.
+ * @param compare_func     Pointer to a function used to compare the priority
+ *                         of values in the heap.
+ * @param arity            The number of children of each node, which must
+ *                         be at least 2.  The default is 4.  When the
+ *                         arity is 2, 4 or 8, the children of each node
+ *                         are within one cache line.
+ * @return                 A new heap, or NULL if it was not possible to
+ *                         allocate the memory or the arity is invalid.
+ */
+
+BinaryHeap *binary_heap_new_with_arity(BinaryHeapType heap_type,
+                                       BinaryHeapCompareFunc compare_func,
+                                       unsigned int arity);
+
+/**
+ * Create a new @ref BinaryHeap containing the values in an array.  This
+ * takes linear time, and is faster than inserting the values one at a
+ * time.
+ *
+ * @param heap_type        The type of heap: min heap or max heap.
+ * @param compare_func     Pointer to a function used to compare the priority
+ *                         of values in the heap.
+ * @param values           The values to add to the heap.  The array is
+ *                         copied.
+ * @param length           The number of values in the array.
+ * @return                 A new binary heap, or NULL if it was not possible
+ *                         to allocate the memory.
+ */
+
+BinaryHeap *binary_heap_new_from_array(BinaryHeapType heap_type,
+                                       BinaryHeapCompareFunc compare_func,
+                                       BinaryHeapValue *values,
+                                       unsigned int length);
+
 /**
  * Destroy a binary heap.
  *
@@ -124,6 +188,18 @@ void binary_heap_free(BinaryHeap *heap);
 
 int binary_heap_insert(BinaryHeap *heap, BinaryHeapValue value);
 
+/**
+ * Insert a value into a binary heap, returning a handle to it.
+ *
+ * @param heap             The heap to insert into.
+ * @param value            The value to insert.
+ * @return                 A handle to the new entry, or NULL if it was not
+ *                         possible to allocate memory for the new entry.
+ */
+
+BinaryHeapHandle *binary_heap_insert_handle(BinaryHeap *heap,
+                                            BinaryHeapValue value);
+
 /**
  * Remove the first value from a binary heap.
  *
@@ -134,6 +210,57 @@ int binary_heap_insert(BinaryHeap *heap, BinaryHeapValue value);
 
 BinaryHeapValue binary_heap_pop(BinaryHeap *heap);
 
+/**
+ * Remove several values from the top of a binary heap.
+ *
+ * @param heap             The heap.
+ * @param values           Array to store the values in, in the order they
+ *                         were removed.
+ * @param count            The number of values to remove.
+ * @return                 The number of values removed, which is less
+ *                         than count if the heap did not contain enough
+ *                         values.
+ */
+
+unsigned int binary_heap_pop_n(BinaryHeap *heap, BinaryHeapValue *values,
+                               unsigned int count);
+
+/**
+ * Replace a value in a binary heap with one which is at least as near
+ * to the top of the heap: a value of lower or equal priority for a min
+ * heap, or of greater or equal priority for a max heap.  If the priority
+ * of the value was changed directly, the same value can be passed again.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void binary_heap_decrease_key(BinaryHeap *heap, BinaryHeapHandle *handle,
+                              BinaryHeapValue value);
+
+/**
+ * Replace a value in a binary heap with one of any priority.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void binary_heap_update(BinaryHeap *heap, BinaryHeapHandle *handle,
+                        BinaryHeapValue value);
+
+/**
+ * Remove a value from a binary heap.  The handle is no longer valid
+ * afterwards.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to remove.
+ * @return                 The value that was removed.
+ */
+
+BinaryHeapValue binary_heap_remove(BinaryHeap *heap, BinaryHeapHandle *handle);
+
 /**
  * Find the number of values stored in a binary heap.
  *
@@ -32,14 +32,29 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 typedef struct _BinomialTree BinomialTree;
 
+/* Trees are never modified while a merge is in progress: merging two
+ * trees creates a new tree which refers to their subtrees, so that the
+ * merge can be undone if it runs out of memory.  The parent pointers of
+ * the subtrees, and the handles of values which have moved to new
+ * trees, are updated once the merge has succeeded.  New trees are
+ * marked as "fresh" until this is done. */
+
 struct _BinomialTree
 {
 	BinomialHeapValue value;
+	BinomialHeapHandle *handle;
 	unsigned short order;
 	unsigned short refcount;
+	unsigned char fresh;
+	BinomialTree *parent;
 	BinomialTree **subtrees;
 };
 
+struct _BinomialHeapHandle
+{
+	BinomialTree *tree;
+};
+
 struct _BinomialHeap
 {
 	BinomialHeapType heap_type;
@@ -123,10 +138,13 @@ static BinomialTree *binomial_tree_merge(BinomialHeap *heap,
 
 	new_tree->refcount = 0;
 	new_tree->order = (unsigned short) (tree1->order + 1);
+	new_tree->fresh = 1;
+	new_tree->parent = NULL;
 
 	/* Take the smallest value of the two trees */
 
 	new_tree->value = tree1->value;
+	new_tree->handle = tree1->handle;
 
 	/* Copy subtrees of the smallest tree.  The last entry in the
 	 * array is the larger tree */
@@ -151,8 +169,32 @@ static BinomialTree *binomial_tree_merge(BinomialHeap *heap,
 	return new_tree;
 }
 
+/* Once a merge has succeeded, update the parent pointers below a fresh
+ * tree, and the handle of its value. */
+
+static void binomial_tree_commit(BinomialTree *tree)
+{
+	BinomialTree *subtree;
+	int i;
+
+	tree->fresh = 0;
+
+	if (tree->handle != NULL) {
+		tree->handle->tree = tree;
+	}
+
+	for (i=0; i<tree->order; ++i) {
+		subtree = tree->subtrees[i];
+		subtree->parent = tree;
+
+		if (subtree->fresh) {
+			binomial_tree_commit(subtree);
+		}
+	}
+}
+
 /* Used to perform an "undo" when an error occurs during
- * binomial_heap_merge.  Go through the list of roots so far and remove
+ * binomial_heap_merge_roots.  Go through the list of roots so far and remove
  * references that have been added. */
 
 static void binomial_heap_merge_undo(BinomialTree **new_roots,
@@ -170,7 +212,8 @@ static void binomial_heap_merge_undo(BinomialTree **new_roots,
 /* Merge the data in the 'other' heap into the 'heap' heap.
  * Returns non-zero if successful. */
 
-static int binomial_heap_merge(BinomialHeap *heap, BinomialHeap *other)
+static int binomial_heap_merge_roots(BinomialHeap *heap,
+                                     BinomialHeap *other)
 {
 	BinomialTree **new_roots;
 	unsigned int new_roots_length;
@@ -295,6 +338,18 @@ static int binomial_heap_merge(BinomialHeap *heap, BinomialHeap *other)
 		binomial_tree_ref(carry);
 	}
 
+	/* Update the parent pointers and handles of the new trees */
+
+	for (i=0; i<new_roots_length; ++i) {
+		if (new_roots[i] != NULL) {
+			new_roots[i]->parent = NULL;
+
+			if (new_roots[i]->fresh) {
+				binomial_tree_commit(new_roots[i]);
+			}
+		}
+	}
+
 	/* Unreference all values in the old 'roots' array, freeing unused
 	 * BinomialTree structures as necessary. */
 
@@ -336,6 +391,19 @@ BinomialHeap *binomial_heap_new(BinomialHeapType heap_type,
 	return new_heap;
 }
 
+/* Free the handles of all values in a tree */
+
+static void binomial_tree_free_handles(BinomialTree *tree)
+{
+	int i;
+
+	free(tree->handle);
+
+	for (i=0; i<tree->order; ++i) {
+		binomial_tree_free_handles(tree->subtrees[i]);
+	}
+}
+
 void binomial_heap_free(BinomialHeap *heap)
 {
 	unsigned int i;
@@ -344,6 +412,10 @@ void binomial_heap_free(BinomialHeap *heap)
 	 * back all subtrees. */
 
 	for (i=0; i<heap->roots_length; ++i) {
+		if (heap->roots[i] != NULL) {
+			binomial_tree_free_handles(heap->roots[i]);
+		}
+
 		binomial_tree_unref(heap->roots[i]);
 	}
 
@@ -353,7 +425,12 @@ void binomial_heap_free(BinomialHeap *heap)
 	free(heap);
 }
 
-int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value)
+/* Insert a value into the heap, with the given handle (which may be
+ * NULL). */
+
+static int binomial_heap_insert_value(BinomialHeap *heap,
+                                      BinomialHeapValue value,
+                                      BinomialHeapHandle *handle)
 {
 	BinomialHeap fake_heap;
 	BinomialTree *new_tree;
@@ -372,10 +449,17 @@ int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value)
 	 * this function. */
 
 	new_tree->value = value;
+	new_tree->handle = handle;
 	new_tree->order = 0;
 	new_tree->refcount = 1;
+	new_tree->fresh = 0;
+	new_tree->parent = NULL;
 	new_tree->subtrees = NULL;
 
+	if (handle != NULL) {
+		handle->tree = new_tree;
+	}
+
 	/* Build a fake heap structure for merging */
 
 	fake_heap.heap_type = heap->heap_type;
@@ -386,7 +470,7 @@ int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value)
 
 	/* Perform the merge */
 
-	result = binomial_heap_merge(heap, &fake_heap);
+	result = binomial_heap_merge_roots(heap, &fake_heap);
 
 	if (result != 0) {
 		++heap->num_values;
@@ -399,10 +483,76 @@ int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value)
 	return result;
 }
 
-BinomialHeapValue binomial_heap_pop(BinomialHeap *heap)
+int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value)
+{
+	return binomial_heap_insert_value(heap, value, NULL);
+}
+
+BinomialHeapHandle *binomial_heap_insert_handle(BinomialHeap *heap,
+                                                BinomialHeapValue value)
+{
+	BinomialHeapHandle *handle;
+
+	handle = malloc(sizeof(BinomialHeapHandle));
+
+	if (handle == NULL) {
+		return NULL;
+	}
+
+	if (!binomial_heap_insert_value(heap, value, handle)) {
+		free(handle);
+		return NULL;
+	}
+
+	return handle;
+}
+
+/* Remove the root of the tree at the given index in the roots array,
+ * merging its subtrees back into the heap.  Returns zero if it was not
+ * possible to allocate memory, in which case the heap is unchanged. */
+
+static int binomial_heap_remove_root(BinomialHeap *heap, unsigned int index)
 {
-	BinomialTree *least_tree;
+	BinomialTree *tree;
 	BinomialHeap fake_heap;
+
+	/* Remove the tree from the heap. */
+
+	tree = heap->roots[index];
+	heap->roots[index] = NULL;
+
+	/* Construct a fake heap containing the data in the tree */
+
+	fake_heap.heap_type = heap->heap_type;
+	fake_heap.compare_func = heap->compare_func;
+	fake_heap.roots = tree->subtrees;
+	fake_heap.roots_length = tree->order;
+
+	/* Merge subtrees of the tree back into the heap */
+
+	if (!binomial_heap_merge_roots(heap, &fake_heap)) {
+
+		/* Add the tree back */
+
+		heap->roots[index] = tree;
+
+		return 0;
+	}
+
+	/* Remove reference to the tree, and free the handle of its value */
+
+	free(tree->handle);
+	binomial_tree_unref(tree);
+
+	/* Update the number of values */
+
+	--heap->num_values;
+
+	return 1;
+}
+
+BinomialHeapValue binomial_heap_pop(BinomialHeap *heap)
+{
 	BinomialHeapValue result;
 	unsigned int i;
 	unsigned int least_index;
@@ -429,45 +579,156 @@ BinomialHeapValue binomial_heap_pop(BinomialHeap *heap)
 		}
 	}
 
-	/* Remove the least_tree from the heap. */
+	/* Remove the root of the least tree */
 
-	least_tree = heap->roots[least_index];
-	heap->roots[least_index] = NULL;
+	result = heap->roots[least_index]->value;
 
-	/* Construct a fake heap containing the data in the least tree */
+	if (binomial_heap_remove_root(heap, least_index)) {
+		return result;
+	} else {
 
-	fake_heap.heap_type = heap->heap_type;
-	fake_heap.compare_func = heap->compare_func;
-	fake_heap.roots = least_tree->subtrees;
-	fake_heap.roots_length = least_tree->order;
+		/* Pop failed */
+
+		return BINOMIAL_HEAP_NULL;
+	}
+}
+
+/* Exchange the values of two trees */
+
+static void binomial_tree_swap(BinomialTree *tree1, BinomialTree *tree2)
+{
+	BinomialHeapValue value;
+	BinomialHeapHandle *handle;
+
+	value = tree1->value;
+	handle = tree1->handle;
+
+	tree1->value = tree2->value;
+	tree1->handle = tree2->handle;
+	tree2->value = value;
+	tree2->handle = handle;
+
+	if (tree1->handle != NULL) {
+		tree1->handle->tree = tree1;
+	}
+
+	if (tree2->handle != NULL) {
+		tree2->handle->tree = tree2;
+	}
+}
+
+/* Move the value of a tree up towards the root until it is in order.  If
+ * force is non-zero, the value is moved all the way to the root.  Returns
+ * the tree that now holds the value. */
+
+static BinomialTree *binomial_heap_sift_up(BinomialHeap *heap,
+                                           BinomialTree *tree, int force)
+{
+	while (tree->parent != NULL
+	    && (force || binomial_heap_cmp(heap, tree->value,
+	                                   tree->parent->value) < 0)) {
+		binomial_tree_swap(tree, tree->parent);
+		tree = tree->parent;
+	}
+
+	return tree;
+}
+
+/* Move the value of a tree down until it is in order */
+
+static void binomial_heap_sift_down(BinomialHeap *heap, BinomialTree *tree)
+{
+	BinomialTree *least;
+	int i;
+
+	for (;;) {
+
+		/* Find the subtree with the least root */
 
-	/* Merge subtrees of least tree back into the heap */
+		least = tree;
+
+		for (i=0; i<tree->order; ++i) {
+			if (binomial_heap_cmp(heap, tree->subtrees[i]->value,
+			                      least->value) < 0) {
+				least = tree->subtrees[i];
+			}
+		}
+
+		if (least == tree) {
+			break;
+		}
 
-	if (binomial_heap_merge(heap, &fake_heap)) {
+		binomial_tree_swap(tree, least);
+		tree = least;
+	}
+}
 
-		/* Merge successful */
+void binomial_heap_decrease_key(BinomialHeap *heap,
+                                BinomialHeapHandle *handle,
+                                BinomialHeapValue value)
+{
+	handle->tree->value = value;
+	binomial_heap_sift_up(heap, handle->tree, 0);
+}
 
-		/* Remove reference to least tree */
+void binomial_heap_update(BinomialHeap *heap, BinomialHeapHandle *handle,
+                          BinomialHeapValue value)
+{
+	BinomialTree *tree;
 
-		result = least_tree->value;
-		binomial_tree_unref(least_tree);
+	tree = handle->tree;
+	tree->value = value;
 
-		/* Update the number of values */
+	if (binomial_heap_sift_up(heap, tree, 0) == tree) {
+		binomial_heap_sift_down(heap, tree);
+	}
+}
 
-		--heap->num_values;
+BinomialHeapValue binomial_heap_remove(BinomialHeap *heap,
+                                       BinomialHeapHandle *handle)
+{
+	BinomialHeapValue result;
+	BinomialTree *root;
 
+	/* Move the value to the root of its tree, and remove it from
+	 * there.  The roots array is indexed by order. */
+
+	result = handle->tree->value;
+	root = binomial_heap_sift_up(heap, handle->tree, 1);
+
+	if (binomial_heap_remove_root(heap, root->order)) {
 		return result;
+	}
 
-	} else {
+	/* Out of memory: move the value back down to where it belongs */
 
-		/* Add the least tree back */
+	binomial_heap_sift_down(heap, root);
 
-		heap->roots[least_index] = least_tree;
+	return BINOMIAL_HEAP_NULL;
+}
 
-		/* Pop failed */
+int binomial_heap_merge(BinomialHeap *heap, BinomialHeap *other)
+{
+	unsigned int i;
 
-		return BINOMIAL_HEAP_NULL;
+	if (!binomial_heap_merge_roots(heap, other)) {
+		return 0;
+	}
+
+	/* The trees now belong to 'heap'.  Empty the other heap. */
+
+	for (i=0; i<other->roots_length; ++i) {
+		binomial_tree_unref(other->roots[i]);
 	}
+
+	free(other->roots);
+	other->roots = NULL;
+	other->roots_length = 0;
+
+	heap->num_values += other->num_values;
+	other->num_values = 0;
+
+	return 1;
 }
 
 unsigned int binomial_heap_num_entries(BinomialHeap *heap)
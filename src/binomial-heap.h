@@ -33,6 +33,15 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  *
  * To remove the first value from a binomial heap, use @ref binomial_heap_pop.
  *
+ * To change the priority of a value or to remove it from the heap, it
+ * must be inserted using @ref binomial_heap_insert_handle, which returns
+ * a handle to the value.  The priority can then be changed using
+ * @ref binomial_heap_decrease_key or @ref binomial_heap_update, and the
+ * value removed using @ref binomial_heap_remove.
+ *
+ * To move all the values from one binomial heap into another, use
+ * @ref binomial_heap_merge.
+ *
  */
 
 #ifndef ALGORITHM_BINOMIAL_HEAP_H
@@ -91,6 +100,14 @@ typedef int (*BinomialHeapCompareFunc)(BinomialHeapValue value1,
 
 typedef struct _BinomialHeap BinomialHeap;
 
+/**
+ * A handle to a value in a @ref BinomialHeap, which can be used to change
+ * its priority or to remove it.  A handle is valid until its value is
+ * removed from the heap.
+ */
+
+typedef struct _BinomialHeapHandle BinomialHeapHandle;
+
 /**
  * Create a new @ref BinomialHeap.
  *
@@ -124,6 +141,18 @@ void binomial_heap_free(BinomialHeap *heap);
 
 int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value);
 
+/**
+ * Insert a value into a binomial heap, returning a handle to it.
+ *
+ * @param heap             The heap to insert into.
+ * @param value            The value to insert.
+ * @return                 A handle to the new entry, or NULL if it was not
+ *                         possible to allocate memory for the new entry.
+ */
+
+BinomialHeapHandle *binomial_heap_insert_handle(BinomialHeap *heap,
+                                                BinomialHeapValue value);
+
 /**
  * Remove the first value from a binomial heap.
  *
@@ -134,6 +163,62 @@ int binomial_heap_insert(BinomialHeap *heap, BinomialHeapValue value);
 
 BinomialHeapValue binomial_heap_pop(BinomialHeap *heap);
 
+/**
+ * Replace a value in a binomial heap with one which is at least as near
+ * to the top of the heap: a value of lower or equal priority for a min
+ * heap, or of greater or equal priority for a max heap.  If the priority
+ * of the value was changed directly, the same value can be passed again.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void binomial_heap_decrease_key(BinomialHeap *heap,
+                                BinomialHeapHandle *handle,
+                                BinomialHeapValue value);
+
+/**
+ * Replace a value in a binomial heap with one of any priority.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void binomial_heap_update(BinomialHeap *heap, BinomialHeapHandle *handle,
+                          BinomialHeapValue value);
+
+/**
+ * Remove a value from a binomial heap.  The handle is no longer valid
+ * afterwards, unless the removal fails.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to remove.
+ * @return                 The value that was removed, or
+ *                         @ref BINOMIAL_HEAP_NULL if it was not possible
+ *                         to allocate memory, in which case the value
+ *                         remains in the heap.
+ */
+
+BinomialHeapValue binomial_heap_remove(BinomialHeap *heap,
+                                       BinomialHeapHandle *handle);
+
+/**
+ * Move all the values from one binomial heap into another.  Both heaps
+ * must be of the same type and use the same compare function.
+ * Afterwards, the other heap is empty; handles to its values can be used
+ * with the heap they were moved to.
+ *
+ * @param heap             The heap to add the values to.
+ * @param other            The heap to take the values from.
+ * @return                 Non-zero if the heaps were merged, or zero if it
+ *                         was not possible to allocate memory, in which
+ *                         case both heaps are unchanged.
+ */
+
+int binomial_heap_merge(BinomialHeap *heap, BinomialHeap *other);
+
 /**
  * Find the number of values stored in a binomial heap.
  *
@@ -20,6 +20,11 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "bloom-filter.h"
 
@@ -31,11 +36,48 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 struct _BloomFilter {
 	BloomFilterHashFunc hash_func;
+	BloomFilterHash64Func hash64_func;
 	unsigned char *table;
+	unsigned char *table_data;
 	unsigned int table_size;
 	unsigned int num_functions;
+	unsigned int flags;
 };
 
+/* Blocked filters set all the bits for a value within one block, which
+ * is the size of a cache line.  The table is aligned so that each block
+ * occupies exactly one cache line. */
+
+#define BLOOM_FILTER_BLOCK_BYTES 64
+#define BLOOM_FILTER_BLOCK_BITS (BLOOM_FILTER_BLOCK_BYTES * 8)
+
+/* Number of values hashed, and their table entries prefetched, at once
+ * by the batch functions. */
+
+#define BLOOM_FILTER_BATCH_SIZE 16
+
+#ifdef __GNUC__
+#define BLOOM_FILTER_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define BLOOM_FILTER_PREFETCH(addr)
+#endif
+
+/* Concurrent filters need atomic operations on 64-bit words.  Relaxed
+ * ordering is sufficient: bits are only ever set, and each bit is
+ * tested independently. */
+
+#if defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+#define BLOOM_FILTER_HAVE_ATOMICS
+#define BLOOM_FILTER_ATOMIC_OR(ptr, bits) \
+	__atomic_fetch_or((ptr), (bits), __ATOMIC_RELAXED)
+#define BLOOM_FILTER_ATOMIC_LOAD(ptr) \
+	__atomic_load_n((ptr), __ATOMIC_RELAXED)
+#else
+/* Concurrent filters cannot be created, so these are never used */
+#define BLOOM_FILTER_ATOMIC_OR(ptr, bits) (*(ptr) |= (bits))
+#define BLOOM_FILTER_ATOMIC_LOAD(ptr) (*(ptr))
+#endif
+
 /* Salt values.  These salts are XORed with the output of the hash function to
  * give multiple unique hashes.
  *
@@ -68,11 +110,15 @@ static const unsigned int salts[] = {
 	0xa27e2a58, 0x66866fc5, 0x12519ce7, 0x437a8456,
 };
 
-BloomFilter *bloom_filter_new(unsigned int table_size,
-                              BloomFilterHashFunc hash_func,
-                              unsigned int num_functions)
+static BloomFilter *bloom_filter_allocate(unsigned int table_size,
+                                          BloomFilterHashFunc hash_func,
+                                          BloomFilterHash64Func hash64_func,
+                                          unsigned int num_functions,
+                                          unsigned int flags)
 {
 	BloomFilter *filter;
+	size_t table_bytes;
+	size_t alignment;
 
 	/* There is a limit on the number of functions which can be
 	 * applied, due to the table size */
@@ -81,6 +127,12 @@ BloomFilter *bloom_filter_new(unsigned int table_size,
 		return NULL;
 	}
 
+#ifndef BLOOM_FILTER_HAVE_ATOMICS
+	if ((flags & BLOOM_FILTER_CONCURRENT) != 0) {
+		return NULL;
+	}
+#endif
+
 	/* Allocate bloom filter structure */
 
 	filter = malloc(sizeof(BloomFilter));
@@ -91,39 +143,231 @@ BloomFilter *bloom_filter_new(unsigned int table_size,
 
 	/* Allocate table, each entry is one bit; these are packed into
 	 * bytes.  When allocating we must round the length up to the nearest
-	 * byte. */
+	 * byte, or for a concurrent filter, to the nearest 64-bit word.  The
+	 * table of a blocked filter is aligned to the start of a block. */
 
-	filter->table = calloc((table_size + 7) / 8, 1);
+	if ((flags & BLOOM_FILTER_CONCURRENT) != 0) {
+		table_bytes = (table_size + 63) / 64 * 8;
+	} else {
+		table_bytes = (table_size + 7) / 8;
+	}
 
-	if (filter->table == NULL) {
+	if (hash64_func != NULL) {
+		alignment = BLOOM_FILTER_BLOCK_BYTES - 1;
+	} else {
+		alignment = 0;
+	}
+
+	filter->table_data = calloc(table_bytes + alignment, 1);
+
+	if (filter->table_data == NULL) {
 		free(filter);
 		return NULL;
 	}
 
+	filter->table = (unsigned char *)
+	    (((uintptr_t) filter->table_data + alignment) & ~(uintptr_t) alignment);
+
 	filter->hash_func = hash_func;
+	filter->hash64_func = hash64_func;
 	filter->num_functions = num_functions;
 	filter->table_size = table_size;
+	filter->flags = flags;
 
 	return filter;
 }
 
+BloomFilter *bloom_filter_new(unsigned int table_size,
+                              BloomFilterHashFunc hash_func,
+                              unsigned int num_functions)
+{
+	return bloom_filter_new_full(table_size, hash_func, num_functions, 0);
+}
+
+BloomFilter *bloom_filter_new_full(unsigned int table_size,
+                                   BloomFilterHashFunc hash_func,
+                                   unsigned int num_functions,
+                                   unsigned int flags)
+{
+	return bloom_filter_allocate(table_size, hash_func, NULL,
+	                             num_functions, flags);
+}
+
+BloomFilter *bloom_filter_new_blocked(unsigned int table_size,
+                                      BloomFilterHash64Func hash_func,
+                                      unsigned int num_functions)
+{
+	return bloom_filter_new_blocked_full(table_size, hash_func,
+	                                     num_functions, 0);
+}
+
+BloomFilter *bloom_filter_new_blocked_full(unsigned int table_size,
+                                           BloomFilterHash64Func hash_func,
+                                           unsigned int num_functions,
+                                           unsigned int flags)
+{
+	unsigned int num_blocks;
+
+	/* Round the table up to a whole number of blocks */
+
+	num_blocks = (table_size + BLOOM_FILTER_BLOCK_BITS - 1)
+	           / BLOOM_FILTER_BLOCK_BITS;
+
+	if (num_blocks == 0) {
+		num_blocks = 1;
+	}
+
+	return bloom_filter_allocate(num_blocks * BLOOM_FILTER_BLOCK_BITS,
+	                             NULL, hash_func, num_functions, flags);
+}
+
 void bloom_filter_free(BloomFilter *bloomfilter)
 {
-	free(bloomfilter->table);
+	free(bloomfilter->table_data);
 	free(bloomfilter);
 }
 
-void bloom_filter_insert(BloomFilter *bloomfilter, BloomFilterValue value)
+/* Find the block of a blocked filter for a hash, and the bits within the
+ * block to set for it.  The upper half of the hash selects the block.
+ * The lower half gives two hashes, h1 and h2, which are combined to
+ * give the bit indexes h1 + i * h2 (Kirsch and Mitzenmacher, "Less
+ * Hashing, Same Performance: Building a Better Bloom Filter").  h2 is
+ * odd, so that the indexes are all different. */
+
+static uint64_t *bloom_filter_block(BloomFilter *bloomfilter, uint64_t hash,
+                                    uint64_t *mask)
 {
-	unsigned int hash;
-	unsigned int subhash;
+	uint32_t h1, h2;
+	unsigned int num_blocks;
+	unsigned int block;
 	unsigned int index;
 	unsigned int i;
-	unsigned char b;
 
-	/* Generate hash of the value to insert */
+	num_blocks = bloomfilter->table_size / BLOOM_FILTER_BLOCK_BITS;
+	block = (unsigned int) (((hash >> 32) * num_blocks) >> 32);
+
+	h1 = (uint32_t) hash;
+	h2 = (h1 >> 16) | 1;
 
-	hash = bloomfilter->hash_func(value);
+	memset(mask, 0, BLOOM_FILTER_BLOCK_BYTES);
+
+	for (i=0; i<bloomfilter->num_functions; ++i) {
+		index = (h1 + i * h2) % BLOOM_FILTER_BLOCK_BITS;
+		mask[index / 64] |= (uint64_t) 1 << (index % 64);
+	}
+
+	return (uint64_t *) (bloomfilter->table
+	                     + block * BLOOM_FILTER_BLOCK_BYTES);
+}
+
+static void bloom_filter_block_insert(BloomFilter *bloomfilter,
+                                     uint64_t *block, uint64_t *mask)
+{
+#ifdef __SSE2__
+	__m128i *b = (__m128i *) block;
+	__m128i *m = (__m128i *) mask;
+#endif
+	unsigned int i;
+
+	/* In a concurrent filter, each word is updated atomically */
+
+	if ((bloomfilter->flags & BLOOM_FILTER_CONCURRENT) != 0) {
+		for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 8; ++i) {
+			if (mask[i] != 0) {
+				BLOOM_FILTER_ATOMIC_OR(&block[i], mask[i]);
+			}
+		}
+
+		return;
+	}
+
+#ifdef __SSE2__
+	for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 16; ++i) {
+		_mm_store_si128(b + i, _mm_or_si128(_mm_load_si128(b + i),
+		                                    _mm_loadu_si128(m + i)));
+	}
+#else
+	for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 8; ++i) {
+		block[i] |= mask[i];
+	}
+#endif
+}
+
+static int bloom_filter_block_query(BloomFilter *bloomfilter,
+                                    uint64_t *block, uint64_t *mask)
+{
+#ifdef __SSE2__
+	__m128i *b = (__m128i *) block;
+	__m128i *m = (__m128i *) mask;
+	__m128i missing;
+#endif
+	unsigned int i;
+
+	if ((bloomfilter->flags & BLOOM_FILTER_CONCURRENT) != 0) {
+		for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 8; ++i) {
+			if ((BLOOM_FILTER_ATOMIC_LOAD(&block[i]) & mask[i])
+			    != mask[i]) {
+				return 0;
+			}
+		}
+
+		return 1;
+	}
+
+#ifdef __SSE2__
+	/* Collect the bits of the mask which are not set in the block */
+
+	missing = _mm_setzero_si128();
+
+	for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 16; ++i) {
+		missing = _mm_or_si128(missing,
+		                       _mm_andnot_si128(_mm_load_si128(b + i),
+		                                        _mm_loadu_si128(m + i)));
+	}
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(missing,
+	                                        _mm_setzero_si128())) == 0xffff;
+#else
+	for (i=0; i<BLOOM_FILTER_BLOCK_BYTES / 8; ++i) {
+		if ((block[i] & mask[i]) != mask[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+#endif
+}
+
+/* Find the 64-bit word of the table of a concurrent filter holding a
+ * bit, and the bit within the word.  The bit is chosen so that the
+ * table has the same layout in memory as a table accessed a byte at a
+ * time, so that filters can be read, loaded and combined alike. */
+
+static uint64_t *bloom_filter_word(BloomFilter *bloomfilter,
+                                   unsigned int index, uint64_t *bit)
+{
+	unsigned int shift;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	shift = (7 - (index % 64) / 8) * 8 + index % 8;
+#else
+	shift = index % 64;
+#endif
+
+	*bit = (uint64_t) 1 << shift;
+
+	return (uint64_t *) bloomfilter->table + index / 64;
+}
+
+static void bloom_filter_insert_hash(BloomFilter *bloomfilter,
+                                     unsigned int hash)
+{
+	uint64_t *word;
+	uint64_t bit;
+	unsigned int subhash;
+	unsigned int index;
+	unsigned int i;
+	unsigned char b;
 
 	/* Generate multiple unique hashes by XORing with values in the
 	 * salt table. */
@@ -138,6 +382,12 @@ void bloom_filter_insert(BloomFilter *bloomfilter, BloomFilterValue value)
 
 		index = subhash % bloomfilter->table_size;
 
+		if ((bloomfilter->flags & BLOOM_FILTER_CONCURRENT) != 0) {
+			word = bloom_filter_word(bloomfilter, index, &bit);
+			BLOOM_FILTER_ATOMIC_OR(word, bit);
+			continue;
+		}
+
 		/* Insert into the table.
 		 * index / 8 finds the byte index of the table,
 		 * index % 8 gives the bit index within that byte to set. */
@@ -147,19 +397,17 @@ void bloom_filter_insert(BloomFilter *bloomfilter, BloomFilterValue value)
 	}
 }
 
-int bloom_filter_query(BloomFilter *bloomfilter, BloomFilterValue value)
+static int bloom_filter_query_hash(BloomFilter *bloomfilter,
+                                   unsigned int hash)
 {
-	unsigned int hash;
+	uint64_t *word;
+	uint64_t word_bit;
 	unsigned int subhash;
 	unsigned int index;
 	unsigned int i;
 	unsigned char b;
 	int bit;
 
-	/* Generate hash of the value to lookup */
-
-	hash = bloomfilter->hash_func(value);
-
 	/* Generate multiple unique hashes by XORing with values in the
 	 * salt table. */
 
@@ -173,6 +421,16 @@ int bloom_filter_query(BloomFilter *bloomfilter, BloomFilterValue value)
 
 		index = subhash % bloomfilter->table_size;
 
+		if ((bloomfilter->flags & BLOOM_FILTER_CONCURRENT) != 0) {
+			word = bloom_filter_word(bloomfilter, index, &word_bit);
+
+			if ((BLOOM_FILTER_ATOMIC_LOAD(word) & word_bit) == 0) {
+				return 0;
+			}
+
+			continue;
+		}
+
 		/* The byte at index / 8 holds the value to test */
 
 		b = bloomfilter->table[index / 8];
@@ -193,6 +451,150 @@ int bloom_filter_query(BloomFilter *bloomfilter, BloomFilterValue value)
 	return 1;
 }
 
+void bloom_filter_insert(BloomFilter *bloomfilter, BloomFilterValue value)
+{
+	uint64_t mask[BLOOM_FILTER_BLOCK_BYTES / 8];
+	uint64_t *block;
+
+	if (bloomfilter->hash64_func != NULL) {
+		block = bloom_filter_block(bloomfilter,
+		                           bloomfilter->hash64_func(value),
+		                           mask);
+		bloom_filter_block_insert(bloomfilter, block, mask);
+	} else {
+		bloom_filter_insert_hash(bloomfilter,
+		                         bloomfilter->hash_func(value));
+	}
+}
+
+int bloom_filter_query(BloomFilter *bloomfilter, BloomFilterValue value)
+{
+	uint64_t mask[BLOOM_FILTER_BLOCK_BYTES / 8];
+	uint64_t *block;
+
+	if (bloomfilter->hash64_func != NULL) {
+		block = bloom_filter_block(bloomfilter,
+		                           bloomfilter->hash64_func(value),
+		                           mask);
+		return bloom_filter_block_query(bloomfilter, block, mask);
+	} else {
+		return bloom_filter_query_hash(bloomfilter,
+		                               bloomfilter->hash_func(value));
+	}
+}
+
+/* Hash a batch of values, and prefetch the parts of the table which
+ * will be accessed for them.  By the time the table is accessed, the
+ * memory accesses for the whole batch are in progress at once. */
+
+static void bloom_filter_prepare_batch(BloomFilter *bloomfilter,
+                                       BloomFilterValue *values,
+                                       unsigned int num_values,
+                                       unsigned int *hashes,
+                                       uint64_t **blocks,
+                                       uint64_t (*masks)[BLOOM_FILTER_BLOCK_BYTES / 8])
+{
+	unsigned int index;
+	unsigned int i, j;
+
+	for (i=0; i<num_values; ++i) {
+		if (bloomfilter->hash64_func != NULL) {
+			blocks[i] = bloom_filter_block(
+			    bloomfilter, bloomfilter->hash64_func(values[i]),
+			    masks[i]);
+			BLOOM_FILTER_PREFETCH(blocks[i]);
+		} else {
+			hashes[i] = bloomfilter->hash_func(values[i]);
+
+			for (j=0; j<bloomfilter->num_functions; ++j) {
+				index = (hashes[i] ^ salts[j])
+				      % bloomfilter->table_size;
+				BLOOM_FILTER_PREFETCH(&bloomfilter->table[index / 8]);
+			}
+		}
+	}
+}
+
+void bloom_filter_insert_batch(BloomFilter *bloomfilter,
+                               BloomFilterValue *values,
+                               unsigned int num_values)
+{
+	uint64_t masks[BLOOM_FILTER_BATCH_SIZE][BLOOM_FILTER_BLOCK_BYTES / 8];
+	uint64_t *blocks[BLOOM_FILTER_BATCH_SIZE];
+	unsigned int hashes[BLOOM_FILTER_BATCH_SIZE];
+	unsigned int batch_size;
+	unsigned int start;
+	unsigned int i;
+
+	for (start=0; start<num_values; start += batch_size) {
+		batch_size = num_values - start;
+
+		if (batch_size > BLOOM_FILTER_BATCH_SIZE) {
+			batch_size = BLOOM_FILTER_BATCH_SIZE;
+		}
+
+		bloom_filter_prepare_batch(bloomfilter, values + start,
+		                           batch_size, hashes, blocks, masks);
+
+		for (i=0; i<batch_size; ++i) {
+			if (bloomfilter->hash64_func != NULL) {
+				bloom_filter_block_insert(bloomfilter,
+				                          blocks[i], masks[i]);
+			} else {
+				bloom_filter_insert_hash(bloomfilter,
+				                         hashes[i]);
+			}
+		}
+	}
+}
+
+void bloom_filter_query_batch(BloomFilter *bloomfilter,
+                              BloomFilterValue *values,
+                              unsigned int num_values,
+                              unsigned char *results)
+{
+	uint64_t masks[BLOOM_FILTER_BATCH_SIZE][BLOOM_FILTER_BLOCK_BYTES / 8];
+	uint64_t *blocks[BLOOM_FILTER_BATCH_SIZE];
+	unsigned int hashes[BLOOM_FILTER_BATCH_SIZE];
+	unsigned int batch_size;
+	unsigned int start;
+	unsigned int i;
+	unsigned int n;
+	int present;
+
+	memset(results, 0, (num_values + 7) / 8);
+
+	for (start=0; start<num_values; start += batch_size) {
+		batch_size = num_values - start;
+
+		if (batch_size > BLOOM_FILTER_BATCH_SIZE) {
+			batch_size = BLOOM_FILTER_BATCH_SIZE;
+		}
+
+		bloom_filter_prepare_batch(bloomfilter, values + start,
+		                           batch_size, hashes, blocks, masks);
+
+		for (i=0; i<batch_size; ++i) {
+			if (bloomfilter->hash64_func != NULL) {
+				present = bloom_filter_block_query(bloomfilter,
+				                                   blocks[i],
+				                                   masks[i]);
+			} else {
+				present = bloom_filter_query_hash(bloomfilter,
+				                                  hashes[i]);
+			}
+
+			/* Results are packed into bytes in the same way
+			 * as the table. */
+
+			if (present) {
+				n = start + i;
+				results[n / 8] |= (unsigned char) (1 << (n % 8));
+			}
+		}
+	}
+}
+
 void bloom_filter_read(BloomFilter *bloomfilter, unsigned char *array)
 {
 	unsigned int array_size;
@@ -232,15 +634,18 @@ BloomFilter *bloom_filter_union(BloomFilter *filter1, BloomFilter *filter2)
 
 	if (filter1->table_size != filter2->table_size
 	 || filter1->num_functions != filter2->num_functions
-	 || filter1->hash_func != filter2->hash_func) {
+	 || filter1->hash_func != filter2->hash_func
+	 || filter1->hash64_func != filter2->hash64_func) {
 		return NULL;
 	}
 
 	/* Create a new bloom filter for the result */
 
-	result = bloom_filter_new(filter1->table_size,
-	                          filter1->hash_func,
-	                          filter1->num_functions);
+	result = bloom_filter_allocate(filter1->table_size,
+	                               filter1->hash_func,
+	                               filter1->hash64_func,
+	                               filter1->num_functions,
+	                               filter1->flags);
 
 	if (result == NULL) {
 		return NULL;
@@ -272,15 +677,18 @@ BloomFilter *bloom_filter_intersection(BloomFilter *filter1,
 
 	if (filter1->table_size != filter2->table_size
 	 || filter1->num_functions != filter2->num_functions
-	 || filter1->hash_func != filter2->hash_func) {
+	 || filter1->hash_func != filter2->hash_func
+	 || filter1->hash64_func != filter2->hash64_func) {
 		return NULL;
 	}
 
 	/* Create a new bloom filter for the result */
 
-	result = bloom_filter_new(filter1->table_size,
-	                          filter1->hash_func,
-	                          filter1->num_functions);
+	result = bloom_filter_allocate(filter1->table_size,
+	                               filter1->hash_func,
+	                               filter1->hash64_func,
+	                               filter1->num_functions,
+	                               filter1->flags);
 
 	if (result == NULL) {
 		return NULL;
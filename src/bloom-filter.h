@@ -35,11 +35,28 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  *
  * To query whether a value is part of the set, use
  * @ref bloom_filter_query.
+ *
+ * Many values can be inserted or queried at once using
+ * @ref bloom_filter_insert_batch and @ref bloom_filter_query_batch.
+ * These hash a batch of values and prefetch the table entries for them
+ * before accessing the table, so that cache misses overlap.
+ *
+ * A blocked bloom filter, created using @ref bloom_filter_new_blocked,
+ * sets all of the bits for a value within a single 64 byte block, so
+ * that each insertion or query touches only one cache line.  This is
+ * much faster for large filters.
+ *
+ * Filters created with the @ref BLOOM_FILTER_CONCURRENT flag can be
+ * shared between threads: any number of threads may insert and query
+ * values at the same time, using atomic operations on the table and
+ * without locking.
  */
 
 #ifndef ALGORITHM_BLOOM_FILTER_H
 #define ALGORITHM_BLOOM_FILTER_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -66,6 +83,36 @@ typedef void *BloomFilterValue;
 
 typedef unsigned int (*BloomFilterHashFunc)(BloomFilterValue data);
 
+/**
+ * 64-bit hash function used to generate hash values for values inserted
+ * into a blocked bloom filter.  All of the bits of the hash are used, so
+ * the hash should be well distributed.
+ *
+ * @param data   The value to generate a hash value for.
+ * @return       The hash value.
+ */
+
+typedef uint64_t (*BloomFilterHash64Func)(BloomFilterValue data);
+
+/**
+ * Flags that can be passed to @ref bloom_filter_new_full and
+ * @ref bloom_filter_new_blocked_full.
+ */
+
+typedef enum {
+	/**
+	 * Allow @ref bloom_filter_insert, @ref bloom_filter_query and the
+	 * batch functions to be called from several threads at once.  Bits
+	 * are set using atomic operations on 64-bit words.  A query made
+	 * while the same value is being inserted may or may not find it.
+	 * Reading, loading, union and intersection are not atomic, and
+	 * must not be used while the filter is being modified.  Filters
+	 * cannot be created with this flag if the compiler does not
+	 * support atomic operations.
+	 */
+	BLOOM_FILTER_CONCURRENT = 1 << 0
+} BloomFilterFlags;
+
 /**
  * Create a new bloom filter.
  *
@@ -90,6 +137,69 @@ BloomFilter *bloom_filter_new(unsigned int table_size,
                               BloomFilterHashFunc hash_func,
                               unsigned int num_functions);
 
+/**
+ * Create a new bloom filter, specifying flags to control its behavior.
+ *
+ * @param table_size       The size of the bloom filter.
+ * @param hash_func        Hash function to use on values stored in the
+ *                         filter.
+ * @param num_functions    Number of hash functions to apply to each
+ *                         element on insertion.  The maximum number of
+ *                         functions is 64.
+ * @param flags            Bitwise OR of @ref BloomFilterFlags values,
+ *                         or zero for the default behavior.
+ * @return                 A new bloom filter, or NULL if it was not
+ *                         possible to allocate the new bloom filter.
+ */
+
+BloomFilter *bloom_filter_new_full(unsigned int table_size,
+                                   BloomFilterHashFunc hash_func,
+                                   unsigned int num_functions,
+                                   unsigned int flags);
+
+/**
+ * Create a new blocked bloom filter.  The bits for each value are all
+ * set within one 64 byte block of the table, chosen using the upper 32
+ * bits of the hash; the lower 32 bits give the bits to set within the
+ * block, using double hashing.
+ *
+ * @param table_size       The size of the bloom filter, in bits.  This is
+ *                         rounded up to a multiple of 512 bits (one
+ *                         block), which is the size to use when reading
+ *                         and loading the filter.
+ * @param hash_func        64-bit hash function to use on values stored
+ *                         in the filter.
+ * @param num_functions    Number of bits to set for each element on
+ *                         insertion.  The maximum is 64.
+ * @return                 A new bloom filter, or NULL if it was not
+ *                         possible to allocate the new bloom filter.
+ */
+
+BloomFilter *bloom_filter_new_blocked(unsigned int table_size,
+                                      BloomFilterHash64Func hash_func,
+                                      unsigned int num_functions);
+
+/**
+ * Create a new blocked bloom filter, specifying flags to control its
+ * behavior.
+ *
+ * @param table_size       The size of the bloom filter, in bits,
+ *                         rounded up to a multiple of 512 bits.
+ * @param hash_func        64-bit hash function to use on values stored
+ *                         in the filter.
+ * @param num_functions    Number of bits to set for each element on
+ *                         insertion.  The maximum is 64.
+ * @param flags            Bitwise OR of @ref BloomFilterFlags values,
+ *                         or zero for the default behavior.
+ * @return                 A new bloom filter, or NULL if it was not
+ *                         possible to allocate the new bloom filter.
+ */
+
+BloomFilter *bloom_filter_new_blocked_full(unsigned int table_size,
+                                           BloomFilterHash64Func hash_func,
+                                           unsigned int num_functions,
+                                           unsigned int flags);
+
 /**
  * Destroy a bloom filter.
  *
@@ -120,6 +230,37 @@ void bloom_filter_insert(BloomFilter *bloomfilter, BloomFilterValue value);
 
 int bloom_filter_query(BloomFilter *bloomfilter, BloomFilterValue value);
 
+/**
+ * Insert an array of values into a bloom filter.
+ *
+ * @param bloomfilter          The bloom filter.
+ * @param values               The values to insert.
+ * @param num_values           The number of values to insert.
+ */
+
+void bloom_filter_insert_batch(BloomFilter *bloomfilter,
+                               BloomFilterValue *values,
+                               unsigned int num_values);
+
+/**
+ * Query a bloom filter for an array of values.
+ *
+ * @param bloomfilter          The bloom filter.
+ * @param values               The values to look up.
+ * @param num_values           The number of values to look up.
+ * @param results              Pointer to an array of
+ *                             (num_values + 7) / 8 bytes, in which
+ *                             the results are stored as bits: bit
+ *                             (i % 8) of byte (i / 8) is set if value i
+ *                             may have been inserted into the filter,
+ *                             and clear if it definitely was not.
+ */
+
+void bloom_filter_query_batch(BloomFilter *bloomfilter,
+                              BloomFilterValue *values,
+                              unsigned int num_values,
+                              unsigned char *results);
+
 /**
  * Read the contents of a bloom filter into an array.
  *
@@ -151,7 +292,8 @@ void bloom_filter_load(BloomFilter *bloomfilter, unsigned char *array);
  * filters.
  *
  * Both of the original filters must have been created using the
- * same parameters to @ref bloom_filter_new.
+ * same parameters to @ref bloom_filter_new or
+ * @ref bloom_filter_new_blocked.
  *
  * @param filter1              The first filter.
  * @param filter2              The second filter.
@@ -171,7 +313,8 @@ BloomFilter *bloom_filter_union(BloomFilter *filter1,
  * original filters.
  *
  * Both of the original filters must have been created using the
- * same parameters to @ref bloom_filter_new.
+ * same parameters to @ref bloom_filter_new or
+ * @ref bloom_filter_new_blocked.
  *
  * @param filter1              The first filter.
  * @param filter2              The second filter.
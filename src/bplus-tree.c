@@ -0,0 +1,860 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bplus-tree.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* Maximum number of keys in a node.  Keys are stored contiguously, so
+ * with 8-byte pointers the keys of a node fill four 64-byte cache
+ * lines, and a binary search within a node reads at most five of
+ * them. */
+
+#define BPLUS_TREE_ORDER 32
+
+/* Minimum number of keys in a node other than the root.  Splitting a
+ * full node leaves both halves with at least this many keys. */
+
+#define BPLUS_TREE_MIN_LEAF_KEYS   (BPLUS_TREE_ORDER / 2)
+#define BPLUS_TREE_MIN_BRANCH_KEYS (BPLUS_TREE_ORDER / 2 - 1)
+
+typedef struct _BPlusTreeBranch BPlusTreeBranch;
+
+/* An internal node.  A branch with n keys has n + 1 children.  All
+ * keys in children[i] are less than keys[i], and all keys in
+ * children[i + 1] are greater than or equal to it.  keys[i] is always
+ * the smallest key in children[i + 1], so that the tree never refers
+ * to a key that has been removed.  The children are leaves if the
+ * branch is on the lowest level of branches, otherwise they are
+ * branches. */
+
+struct _BPlusTreeBranch {
+	unsigned int num_keys;
+	BPlusTreeKey keys[BPLUS_TREE_ORDER];
+	void *children[BPLUS_TREE_ORDER + 1];
+};
+
+/* A leaf node, holding the key-value pairs.  Leaves are linked in key
+ * order. */
+
+struct _BPlusTreeLeaf {
+	unsigned int num_keys;
+	BPlusTreeKey keys[BPLUS_TREE_ORDER];
+	BPlusTreeValue values[BPLUS_TREE_ORDER];
+	BPlusTreeLeaf *prev;
+	BPlusTreeLeaf *next;
+};
+
+/* The root is a leaf if the height is zero; otherwise, the height is
+ * the number of levels of branches above the leaves. */
+
+struct _BPlusTree {
+	void *root;
+	unsigned int height;
+	BPlusTreeCompareFunc compare_func;
+	unsigned int num_entries;
+	Allocator *allocator;
+};
+
+BPlusTree *bplus_tree_new(BPlusTreeCompareFunc compare_func)
+{
+	return bplus_tree_new_with_allocator(compare_func, NULL);
+}
+
+BPlusTree *bplus_tree_new_with_allocator(BPlusTreeCompareFunc compare_func,
+                                         Allocator *allocator)
+{
+	BPlusTree *new_tree;
+
+	new_tree = malloc(sizeof(BPlusTree));
+
+	if (new_tree == NULL) {
+		return NULL;
+	}
+
+	new_tree->root = NULL;
+	new_tree->height = 0;
+	new_tree->compare_func = compare_func;
+	new_tree->num_entries = 0;
+	new_tree->allocator = allocator;
+
+	return new_tree;
+}
+
+static void bplus_tree_free_subtree(BPlusTree *tree, void *node,
+                                    unsigned int level)
+{
+	BPlusTreeBranch *branch;
+	unsigned int i;
+
+	if (level == 0) {
+		allocator_free(tree->allocator, node, sizeof(BPlusTreeLeaf));
+		return;
+	}
+
+	branch = node;
+
+	for (i=0; i<=branch->num_keys; ++i) {
+		bplus_tree_free_subtree(tree, branch->children[i], level - 1);
+	}
+
+	allocator_free(tree->allocator, branch, sizeof(BPlusTreeBranch));
+}
+
+void bplus_tree_free(BPlusTree *tree)
+{
+	/* Free all nodes in the tree */
+
+	if (tree->root != NULL) {
+		bplus_tree_free_subtree(tree, tree->root, tree->height);
+	}
+
+	/* Free back the main tree structure */
+
+	free(tree);
+}
+
+static BPlusTreeLeaf *bplus_tree_new_leaf(BPlusTree *tree)
+{
+	BPlusTreeLeaf *leaf;
+
+	leaf = allocator_alloc(tree->allocator, sizeof(BPlusTreeLeaf));
+
+	if (leaf == NULL) {
+		return NULL;
+	}
+
+	leaf->num_keys = 0;
+	leaf->prev = NULL;
+	leaf->next = NULL;
+
+	return leaf;
+}
+
+static BPlusTreeBranch *bplus_tree_new_branch(BPlusTree *tree)
+{
+	BPlusTreeBranch *branch;
+
+	branch = allocator_alloc(tree->allocator, sizeof(BPlusTreeBranch));
+
+	if (branch == NULL) {
+		return NULL;
+	}
+
+	branch->num_keys = 0;
+
+	return branch;
+}
+
+static unsigned int bplus_tree_node_num_keys(void *node, unsigned int level)
+{
+	if (level == 0) {
+		return ((BPlusTreeLeaf *) node)->num_keys;
+	} else {
+		return ((BPlusTreeBranch *) node)->num_keys;
+	}
+}
+
+/* Binary search the keys of a node for the first key greater than the
+ * given key, or if 'inclusive' is non-zero, greater than or equal to
+ * it. */
+
+static unsigned int bplus_tree_search(BPlusTree *tree, BPlusTreeKey *keys,
+                                      unsigned int num_keys,
+                                      BPlusTreeKey key, int inclusive)
+{
+	unsigned int min, max, mid;
+	int diff;
+
+	min = 0;
+	max = num_keys;
+
+	while (min < max) {
+		mid = (min + max) / 2;
+		diff = tree->compare_func(keys[mid], key);
+
+		if (diff < 0 || (diff == 0 && !inclusive)) {
+			min = mid + 1;
+		} else {
+			max = mid;
+		}
+	}
+
+	return min;
+}
+
+/* Find the leaf that would contain the given key. */
+
+static BPlusTreeLeaf *bplus_tree_find_leaf(BPlusTree *tree, BPlusTreeKey key)
+{
+	BPlusTreeBranch *branch;
+	void *node;
+	unsigned int level;
+	unsigned int index;
+
+	node = tree->root;
+
+	for (level = tree->height; level > 0; --level) {
+		branch = node;
+		index = bplus_tree_search(tree, branch->keys, branch->num_keys,
+		                          key, 0);
+		node = branch->children[index];
+	}
+
+	return node;
+}
+
+/* Split the full node at parent->children[index], which is on the
+ * given level, moving its upper half into a new node.  The parent
+ * must not be full.  Returns zero, and leaves the tree unchanged, if
+ * the new node cannot be allocated. */
+
+static int bplus_tree_split_child(BPlusTree *tree, BPlusTreeBranch *parent,
+                                  unsigned int index, unsigned int level)
+{
+	BPlusTreeLeaf *leaf, *new_leaf;
+	BPlusTreeBranch *branch, *new_branch;
+	BPlusTreeKey separator;
+	void *new_node;
+	unsigned int split;
+
+	split = BPLUS_TREE_ORDER / 2;
+
+	if (level == 0) {
+		leaf = parent->children[index];
+		new_leaf = bplus_tree_new_leaf(tree);
+
+		if (new_leaf == NULL) {
+			return 0;
+		}
+
+		/* Move the upper half into the new leaf, and link it in
+		 * after the old one.  The first key of the new leaf
+		 * separates the two. */
+
+		new_leaf->num_keys = leaf->num_keys - split;
+		memcpy(new_leaf->keys, leaf->keys + split,
+		       sizeof(BPlusTreeKey) * new_leaf->num_keys);
+		memcpy(new_leaf->values, leaf->values + split,
+		       sizeof(BPlusTreeValue) * new_leaf->num_keys);
+		leaf->num_keys = split;
+
+		new_leaf->prev = leaf;
+		new_leaf->next = leaf->next;
+
+		if (leaf->next != NULL) {
+			leaf->next->prev = new_leaf;
+		}
+
+		leaf->next = new_leaf;
+
+		separator = new_leaf->keys[0];
+		new_node = new_leaf;
+	} else {
+		branch = parent->children[index];
+		new_branch = bplus_tree_new_branch(tree);
+
+		if (new_branch == NULL) {
+			return 0;
+		}
+
+		/* The middle key moves up into the parent, and the keys
+		 * and children after it move into the new branch. */
+
+		separator = branch->keys[split];
+
+		new_branch->num_keys = branch->num_keys - split - 1;
+		memcpy(new_branch->keys, branch->keys + split + 1,
+		       sizeof(BPlusTreeKey) * new_branch->num_keys);
+		memcpy(new_branch->children, branch->children + split + 1,
+		       sizeof(void *) * (new_branch->num_keys + 1));
+		branch->num_keys = split;
+
+		new_node = new_branch;
+	}
+
+	/* Insert the separator and the new node into the parent. */
+
+	memmove(parent->keys + index + 1, parent->keys + index,
+	        sizeof(BPlusTreeKey) * (parent->num_keys - index));
+	memmove(parent->children + index + 2, parent->children + index + 1,
+	        sizeof(void *) * (parent->num_keys - index));
+
+	parent->keys[index] = separator;
+	parent->children[index + 1] = new_node;
+	++parent->num_keys;
+
+	return 1;
+}
+
+int bplus_tree_insert(BPlusTree *tree, BPlusTreeKey key, BPlusTreeValue value)
+{
+	BPlusTreeBranch *branch;
+	BPlusTreeLeaf *leaf;
+	void *node;
+	unsigned int level;
+	unsigned int index;
+
+	/* The first entry creates the root leaf. */
+
+	if (tree->root == NULL) {
+		tree->root = bplus_tree_new_leaf(tree);
+
+		if (tree->root == NULL) {
+			return 0;
+		}
+	}
+
+	/* If the root is full, split it, adding a new root above.  The
+	 * tree grows in height this way only. */
+
+	if (bplus_tree_node_num_keys(tree->root, tree->height)
+	    == BPLUS_TREE_ORDER) {
+
+		branch = bplus_tree_new_branch(tree);
+
+		if (branch == NULL) {
+			return 0;
+		}
+
+		branch->children[0] = tree->root;
+
+		if (!bplus_tree_split_child(tree, branch, 0, tree->height)) {
+			allocator_free(tree->allocator, branch,
+			               sizeof(BPlusTreeBranch));
+			return 0;
+		}
+
+		tree->root = branch;
+		++tree->height;
+	}
+
+	/* Walk down the tree, splitting any full nodes on the way, so
+	 * that there is always room in the parent when a split is
+	 * needed.  If an allocation fails part way down, the splits
+	 * already made leave the tree valid. */
+
+	node = tree->root;
+
+	for (level = tree->height; level > 0; --level) {
+		branch = node;
+		index = bplus_tree_search(tree, branch->keys, branch->num_keys,
+		                          key, 0);
+
+		if (bplus_tree_node_num_keys(branch->children[index], level - 1)
+		    == BPLUS_TREE_ORDER) {
+
+			if (!bplus_tree_split_child(tree, branch, index,
+			                            level - 1)) {
+				return 0;
+			}
+
+			if (tree->compare_func(key, branch->keys[index]) >= 0) {
+				++index;
+			}
+		}
+
+		node = branch->children[index];
+	}
+
+	/* Insert into the leaf, or replace the value if the key is
+	 * already present. */
+
+	leaf = node;
+	index = bplus_tree_search(tree, leaf->keys, leaf->num_keys, key, 1);
+
+	if (index < leaf->num_keys
+	 && tree->compare_func(leaf->keys[index], key) == 0) {
+		leaf->values[index] = value;
+		return 1;
+	}
+
+	memmove(leaf->keys + index + 1, leaf->keys + index,
+	        sizeof(BPlusTreeKey) * (leaf->num_keys - index));
+	memmove(leaf->values + index + 1, leaf->values + index,
+	        sizeof(BPlusTreeValue) * (leaf->num_keys - index));
+
+	leaf->keys[index] = key;
+	leaf->values[index] = value;
+	++leaf->num_keys;
+
+	++tree->num_entries;
+
+	return 1;
+}
+
+/* Remove the separator branch->keys[index] and the child to its right
+ * from a branch. */
+
+static void bplus_tree_branch_remove(BPlusTreeBranch *branch,
+                                     unsigned int index)
+{
+	memmove(branch->keys + index, branch->keys + index + 1,
+	        sizeof(BPlusTreeKey) * (branch->num_keys - index - 1));
+	memmove(branch->children + index + 1, branch->children + index + 2,
+	        sizeof(void *) * (branch->num_keys - index - 1));
+
+	--branch->num_keys;
+}
+
+/* Merge parent->children[index + 1] into parent->children[index].
+ * The children are on the given level. */
+
+static void bplus_tree_merge_children(BPlusTree *tree,
+                                      BPlusTreeBranch *parent,
+                                      unsigned int index,
+                                      unsigned int level)
+{
+	BPlusTreeLeaf *left_leaf, *right_leaf;
+	BPlusTreeBranch *left, *right;
+
+	if (level == 0) {
+		left_leaf = parent->children[index];
+		right_leaf = parent->children[index + 1];
+
+		memcpy(left_leaf->keys + left_leaf->num_keys, right_leaf->keys,
+		       sizeof(BPlusTreeKey) * right_leaf->num_keys);
+		memcpy(left_leaf->values + left_leaf->num_keys,
+		       right_leaf->values,
+		       sizeof(BPlusTreeValue) * right_leaf->num_keys);
+		left_leaf->num_keys += right_leaf->num_keys;
+
+		left_leaf->next = right_leaf->next;
+
+		if (right_leaf->next != NULL) {
+			right_leaf->next->prev = left_leaf;
+		}
+
+		allocator_free(tree->allocator, right_leaf,
+		               sizeof(BPlusTreeLeaf));
+	} else {
+		left = parent->children[index];
+		right = parent->children[index + 1];
+
+		/* The separator comes down from the parent, between the
+		 * keys of the two branches. */
+
+		left->keys[left->num_keys] = parent->keys[index];
+		memcpy(left->keys + left->num_keys + 1, right->keys,
+		       sizeof(BPlusTreeKey) * right->num_keys);
+		memcpy(left->children + left->num_keys + 1, right->children,
+		       sizeof(void *) * (right->num_keys + 1));
+		left->num_keys += right->num_keys + 1;
+
+		allocator_free(tree->allocator, right,
+		               sizeof(BPlusTreeBranch));
+	}
+
+	bplus_tree_branch_remove(parent, index);
+}
+
+/* Move one entry from the end of parent->children[index - 1] to the
+ * start of parent->children[index]. */
+
+static void bplus_tree_shift_right(BPlusTreeBranch *parent,
+                                   unsigned int index, unsigned int level)
+{
+	BPlusTreeLeaf *left_leaf, *leaf;
+	BPlusTreeBranch *left, *branch;
+
+	if (level == 0) {
+		left_leaf = parent->children[index - 1];
+		leaf = parent->children[index];
+
+		memmove(leaf->keys + 1, leaf->keys,
+		        sizeof(BPlusTreeKey) * leaf->num_keys);
+		memmove(leaf->values + 1, leaf->values,
+		        sizeof(BPlusTreeValue) * leaf->num_keys);
+
+		--left_leaf->num_keys;
+		leaf->keys[0] = left_leaf->keys[left_leaf->num_keys];
+		leaf->values[0] = left_leaf->values[left_leaf->num_keys];
+		++leaf->num_keys;
+
+		parent->keys[index - 1] = leaf->keys[0];
+	} else {
+		left = parent->children[index - 1];
+		branch = parent->children[index];
+
+		memmove(branch->keys + 1, branch->keys,
+		        sizeof(BPlusTreeKey) * branch->num_keys);
+		memmove(branch->children + 1, branch->children,
+		        sizeof(void *) * (branch->num_keys + 1));
+
+		/* Rotate through the parent's separator. */
+
+		branch->keys[0] = parent->keys[index - 1];
+		branch->children[0] = left->children[left->num_keys];
+		++branch->num_keys;
+
+		--left->num_keys;
+		parent->keys[index - 1] = left->keys[left->num_keys];
+	}
+}
+
+/* Move one entry from the start of parent->children[index + 1] to the
+ * end of parent->children[index]. */
+
+static void bplus_tree_shift_left(BPlusTreeBranch *parent,
+                                  unsigned int index, unsigned int level)
+{
+	BPlusTreeLeaf *leaf, *right_leaf;
+	BPlusTreeBranch *branch, *right;
+
+	if (level == 0) {
+		leaf = parent->children[index];
+		right_leaf = parent->children[index + 1];
+
+		leaf->keys[leaf->num_keys] = right_leaf->keys[0];
+		leaf->values[leaf->num_keys] = right_leaf->values[0];
+		++leaf->num_keys;
+
+		--right_leaf->num_keys;
+		memmove(right_leaf->keys, right_leaf->keys + 1,
+		        sizeof(BPlusTreeKey) * right_leaf->num_keys);
+		memmove(right_leaf->values, right_leaf->values + 1,
+		        sizeof(BPlusTreeValue) * right_leaf->num_keys);
+
+		parent->keys[index] = right_leaf->keys[0];
+	} else {
+		branch = parent->children[index];
+		right = parent->children[index + 1];
+
+		/* Rotate through the parent's separator. */
+
+		branch->keys[branch->num_keys] = parent->keys[index];
+		branch->children[branch->num_keys + 1] = right->children[0];
+		++branch->num_keys;
+
+		parent->keys[index] = right->keys[0];
+
+		--right->num_keys;
+		memmove(right->keys, right->keys + 1,
+		        sizeof(BPlusTreeKey) * right->num_keys);
+		memmove(right->children, right->children + 1,
+		        sizeof(void *) * (right->num_keys + 1));
+	}
+}
+
+/* The node at parent->children[index], on the given level, has one
+ * key fewer than the minimum.  Borrow a key from a sibling if one has
+ * any to spare, otherwise merge with a sibling. */
+
+static void bplus_tree_rebalance(BPlusTree *tree, BPlusTreeBranch *parent,
+                                 unsigned int index, unsigned int level)
+{
+	unsigned int min_keys;
+
+	if (level == 0) {
+		min_keys = BPLUS_TREE_MIN_LEAF_KEYS;
+	} else {
+		min_keys = BPLUS_TREE_MIN_BRANCH_KEYS;
+	}
+
+	if (index > 0
+	 && bplus_tree_node_num_keys(parent->children[index - 1], level)
+	    > min_keys) {
+		bplus_tree_shift_right(parent, index, level);
+	} else if (index < parent->num_keys
+	        && bplus_tree_node_num_keys(parent->children[index + 1],
+	                                    level) > min_keys) {
+		bplus_tree_shift_left(parent, index, level);
+	} else if (index > 0) {
+		bplus_tree_merge_children(tree, parent, index - 1, level);
+	} else {
+		bplus_tree_merge_children(tree, parent, index, level);
+	}
+}
+
+/* Remove a key from the subtree rooted at the given node, returning
+ * non-zero if it was found.  Nodes below are rebalanced as needed;
+ * the node itself may be left with too few keys, to be fixed by its
+ * parent.  If the key removed was the first in its leaf, it may still
+ * be used as a separator above, and it is returned through
+ * 'removed' so that the separator can be replaced. */
+
+static int bplus_tree_remove_subtree(BPlusTree *tree, void *node,
+                                     unsigned int level, BPlusTreeKey key,
+                                     BPlusTreeKey *removed)
+{
+	BPlusTreeBranch *branch;
+	BPlusTreeLeaf *leaf;
+	unsigned int index;
+	unsigned int min_keys;
+
+	if (level == 0) {
+		leaf = node;
+		index = bplus_tree_search(tree, leaf->keys, leaf->num_keys,
+		                          key, 1);
+
+		if (index >= leaf->num_keys
+		 || tree->compare_func(leaf->keys[index], key) != 0) {
+			return 0;
+		}
+
+		if (index == 0) {
+			*removed = leaf->keys[0];
+		}
+
+		--leaf->num_keys;
+		memmove(leaf->keys + index, leaf->keys + index + 1,
+		        sizeof(BPlusTreeKey) * (leaf->num_keys - index));
+		memmove(leaf->values + index, leaf->values + index + 1,
+		        sizeof(BPlusTreeValue) * (leaf->num_keys - index));
+
+		return 1;
+	}
+
+	branch = node;
+	index = bplus_tree_search(tree, branch->keys, branch->num_keys,
+	                          key, 0);
+
+	if (!bplus_tree_remove_subtree(tree, branch->children[index],
+	                               level - 1, key, removed)) {
+		return 0;
+	}
+
+	if (level - 1 == 0) {
+		min_keys = BPLUS_TREE_MIN_LEAF_KEYS;
+	} else {
+		min_keys = BPLUS_TREE_MIN_BRANCH_KEYS;
+	}
+
+	if (bplus_tree_node_num_keys(branch->children[index], level - 1)
+	    < min_keys) {
+		bplus_tree_rebalance(tree, branch, index, level - 1);
+	}
+
+	return 1;
+}
+
+/* After the first key of a leaf has been removed, find the separator
+ * that still holds it, if any, and replace it with the smallest key
+ * now in the subtree to its right.  Borrowing and merging move
+ * separators but never copy them, so there is at most one, and it is
+ * on the search path for the removed key. */
+
+static void bplus_tree_replace_separator(BPlusTree *tree,
+                                         BPlusTreeKey old_key)
+{
+	BPlusTreeBranch *branch;
+	void *node;
+	unsigned int level;
+	unsigned int index;
+
+	node = tree->root;
+
+	for (level = tree->height; level > 0; --level) {
+		branch = node;
+		index = bplus_tree_search(tree, branch->keys, branch->num_keys,
+		                          old_key, 0);
+
+		if (index > 0 && branch->keys[index - 1] == old_key) {
+
+			/* The smallest key is the first in the leftmost
+			 * leaf of the subtree. */
+
+			for (node = branch->children[index]; level > 1; --level) {
+				node = ((BPlusTreeBranch *) node)->children[0];
+			}
+
+			branch->keys[index - 1] = ((BPlusTreeLeaf *) node)->keys[0];
+			return;
+		}
+
+		node = branch->children[index];
+	}
+}
+
+int bplus_tree_remove(BPlusTree *tree, BPlusTreeKey key)
+{
+	BPlusTreeBranch *branch;
+	BPlusTreeKey removed;
+
+	removed = NULL;
+
+	if (tree->root == NULL
+	 || !bplus_tree_remove_subtree(tree, tree->root, tree->height, key,
+	                               &removed)) {
+		return 0;
+	}
+
+	--tree->num_entries;
+
+	/* The root is allowed to have fewer keys than other nodes, but
+	 * an empty root is removed.  The tree shrinks in height this way
+	 * only. */
+
+	if (tree->height == 0) {
+		if (((BPlusTreeLeaf *) tree->root)->num_keys == 0) {
+			allocator_free(tree->allocator, tree->root,
+			               sizeof(BPlusTreeLeaf));
+			tree->root = NULL;
+		}
+	} else {
+		branch = tree->root;
+
+		if (branch->num_keys == 0) {
+			tree->root = branch->children[0];
+			--tree->height;
+			allocator_free(tree->allocator, branch,
+			               sizeof(BPlusTreeBranch));
+		}
+	}
+
+	/* The removed key is still valid here, so it can be compared
+	 * against while searching for its separator. */
+
+	if (removed != NULL) {
+		bplus_tree_replace_separator(tree, removed);
+	}
+
+	return 1;
+}
+
+BPlusTreeValue bplus_tree_lookup(BPlusTree *tree, BPlusTreeKey key)
+{
+	BPlusTreeLeaf *leaf;
+	unsigned int index;
+
+	if (tree->root == NULL) {
+		return BPLUS_TREE_NULL;
+	}
+
+	leaf = bplus_tree_find_leaf(tree, key);
+	index = bplus_tree_search(tree, leaf->keys, leaf->num_keys, key, 1);
+
+	if (index < leaf->num_keys
+	 && tree->compare_func(leaf->keys[index], key) == 0) {
+		return leaf->values[index];
+	} else {
+		return BPLUS_TREE_NULL;
+	}
+}
+
+BPlusTreeKey *bplus_tree_to_array(BPlusTree *tree)
+{
+	BPlusTreeIterator iter;
+	BPlusTreeKey *array;
+	unsigned int index;
+
+	array = malloc(sizeof(BPlusTreeKey) * tree->num_entries);
+
+	if (array == NULL) {
+		return NULL;
+	}
+
+	index = 0;
+	bplus_tree_iterate(tree, &iter);
+
+	while (bplus_tree_iter_has_more(&iter)) {
+		array[index] = bplus_tree_iter_next(&iter).key;
+		++index;
+	}
+
+	return array;
+}
+
+unsigned int bplus_tree_num_entries(BPlusTree *tree)
+{
+	return tree->num_entries;
+}
+
+void bplus_tree_iterate(BPlusTree *tree, BPlusTreeIterator *iter)
+{
+	void *node;
+	unsigned int level;
+
+	/* Start from the leftmost leaf. */
+
+	node = tree->root;
+
+	if (node != NULL) {
+		for (level = tree->height; level > 0; --level) {
+			node = ((BPlusTreeBranch *) node)->children[0];
+		}
+	}
+
+	iter->leaf = node;
+	iter->index = 0;
+}
+
+void bplus_tree_iterate_from(BPlusTree *tree, BPlusTreeKey key,
+                             BPlusTreeIterator *iter)
+{
+	BPlusTreeLeaf *leaf;
+	unsigned int index;
+
+	if (tree->root == NULL) {
+		iter->leaf = NULL;
+		iter->index = 0;
+		return;
+	}
+
+	leaf = bplus_tree_find_leaf(tree, key);
+	index = bplus_tree_search(tree, leaf->keys, leaf->num_keys, key, 1);
+
+	/* If every key in the leaf is smaller, start from the next. */
+
+	if (index == leaf->num_keys) {
+		leaf = leaf->next;
+		index = 0;
+	}
+
+	iter->leaf = leaf;
+	iter->index = index;
+}
+
+int bplus_tree_iter_has_more(BPlusTreeIterator *iter)
+{
+	return iter->leaf != NULL;
+}
+
+BPlusTreePair bplus_tree_iter_next(BPlusTreeIterator *iter)
+{
+	BPlusTreePair pair = { BPLUS_TREE_NULL, BPLUS_TREE_NULL };
+
+	if (iter->leaf == NULL) {
+		return pair;
+	}
+
+	pair.key = iter->leaf->keys[iter->index];
+	pair.value = iter->leaf->values[iter->index];
+
+	/* Advance, moving to the next leaf at the end of this one.
+	 * Leaves are never empty. */
+
+	++iter->index;
+
+	if (iter->index >= iter->leaf->num_keys) {
+		iter->leaf = iter->leaf->next;
+		iter->index = 0;
+	}
+
+	return pair;
+}
+
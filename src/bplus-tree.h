@@ -0,0 +1,271 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file bplus-tree.h
+ *
+ * @brief B+ tree
+ *
+ * A B+ tree is a balanced search tree which stores a mapping of keys
+ * to values, ordered by key.  Unlike a binary tree such as the
+ * @link avl-tree.h AVL tree @endlink, each node of a B+ tree holds
+ * many keys, stored next to each other in memory.  The tree is
+ * therefore much shallower, and a search touches far fewer cache lines.
+ * All key-value pairs are held in the leaves, which are linked
+ * together so that the whole tree can be scanned in order.
+ *
+ * To create a new B+ tree, use @ref bplus_tree_new.  To destroy a
+ * B+ tree, use @ref bplus_tree_free.
+ *
+ * To insert a key-value pair into a B+ tree, use @ref bplus_tree_insert.
+ * To remove an entry, use @ref bplus_tree_remove.
+ *
+ * To search a B+ tree, use @ref bplus_tree_lookup.
+ *
+ * To visit entries in order, use @ref bplus_tree_iterate or
+ * @ref bplus_tree_iterate_from to initialise a @ref BPlusTreeIterator,
+ * and @ref bplus_tree_iter_next and @ref bplus_tree_iter_has_more to
+ * step through the entries.
+ */
+
+#ifndef ALGORITHM_BPLUS_TREE_H
+#define ALGORITHM_BPLUS_TREE_H
+
+#include "allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A B+ tree.
+ *
+ * @see bplus_tree_new
+ */
+
+typedef struct _BPlusTree BPlusTree;
+
+/**
+ * A key for a @ref BPlusTree.
+ */
+
+typedef void *BPlusTreeKey;
+
+/**
+ * A value stored in a @ref BPlusTree.
+ */
+
+typedef void *BPlusTreeValue;
+
+/**
+ * A null @ref BPlusTreeValue.
+ */
+
+#define BPLUS_TREE_NULL ((void *) 0)
+
+/**
+ * A leaf node of a B+ tree.
+ */
+
+typedef struct _BPlusTreeLeaf BPlusTreeLeaf;
+
+/**
+ * A key-value pair, returned by @ref bplus_tree_iter_next.
+ */
+
+typedef struct _BPlusTreePair {
+	BPlusTreeKey key;
+	BPlusTreeValue value;
+} BPlusTreePair;
+
+/**
+ * Structure used to iterate over the entries of a B+ tree in order.
+ */
+
+typedef struct _BPlusTreeIterator BPlusTreeIterator;
+
+/**
+ * Definition of a @ref BPlusTreeIterator.
+ */
+
+struct _BPlusTreeIterator {
+	BPlusTreeLeaf *leaf;
+	unsigned int index;
+};
+
+/**
+ * Type of function used to compare keys in a B+ tree.
+ *
+ * @param value1           The first key.
+ * @param value2           The second key.
+ * @return                 A negative number if value1 should be sorted
+ *                         before value2, a positive number if value2 should
+ *                         be sorted before value1, zero if the two keys
+ *                         are equal.
+ */
+
+typedef int (*BPlusTreeCompareFunc)(BPlusTreeKey value1,
+                                    BPlusTreeKey value2);
+
+/**
+ * Create a new B+ tree.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @return                A new B+ tree, or NULL if it was not possible
+ *                        to allocate the memory.
+ */
+
+BPlusTree *bplus_tree_new(BPlusTreeCompareFunc compare_func);
+
+/**
+ * Create a new B+ tree, using a custom allocator for its nodes.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @param allocator       The allocator to use, or NULL to use malloc().
+ * @return                A new B+ tree, or NULL if it was not possible
+ *                        to allocate the memory.
+ */
+
+BPlusTree *bplus_tree_new_with_allocator(BPlusTreeCompareFunc compare_func,
+                                         Allocator *allocator);
+
+/**
+ * Destroy a B+ tree.
+ *
+ * @param tree            The tree to destroy.
+ */
+
+void bplus_tree_free(BPlusTree *tree);
+
+/**
+ * Insert a key-value pair into a B+ tree.  If the key is already
+ * present in the tree, its value is replaced.
+ *
+ * @param tree            The tree.
+ * @param key             The key to insert.
+ * @param value           The value to insert.
+ * @return                Non-zero if the key-value pair was inserted,
+ *                        or zero if it was not possible to allocate
+ *                        memory.  The contents of the tree are
+ *                        unchanged if the insert fails.
+ */
+
+int bplus_tree_insert(BPlusTree *tree, BPlusTreeKey key,
+                      BPlusTreeValue value);
+
+/**
+ * Remove an entry from a B+ tree, specifying the key of the entry to
+ * remove.
+ *
+ * @param tree            The tree.
+ * @param key             The key of the entry to remove.
+ * @return                Zero (false) if no entry with the specified key
+ *                        was found in the tree, non-zero (true) if an
+ *                        entry with the specified key was removed.
+ */
+
+int bplus_tree_remove(BPlusTree *tree, BPlusTreeKey key);
+
+/**
+ * Search a B+ tree for the value corresponding to a particular key.
+ *
+ * @param tree            The B+ tree to search.
+ * @param key             The key to search for.
+ * @return                The value associated with the given key, or
+ *                        @ref BPLUS_TREE_NULL if no entry with the given
+ *                        key is found.
+ */
+
+BPlusTreeValue bplus_tree_lookup(BPlusTree *tree, BPlusTreeKey key);
+
+/**
+ * Convert the keys in a B+ tree into a C array.  This allows the tree
+ * to be used as an ordered set.
+ *
+ * @param tree            The tree.
+ * @return                A newly allocated C array containing all the keys
+ *                        in the tree, in order, or NULL if it was not
+ *                        possible to allocate the memory.  The length of
+ *                        the array is equal to the number of entries in
+ *                        the tree (see @ref bplus_tree_num_entries).
+ */
+
+BPlusTreeKey *bplus_tree_to_array(BPlusTree *tree);
+
+/**
+ * Retrieve the number of entries in the tree.
+ *
+ * @param tree            The tree.
+ * @return                The number of key-value pairs stored in the tree.
+ */
+
+unsigned int bplus_tree_num_entries(BPlusTree *tree);
+
+/**
+ * Initialise a @ref BPlusTreeIterator to iterate over the entries in a
+ * tree, in the order of their keys.  No memory is allocated.  Any change
+ * to the tree invalidates the iterator.
+ *
+ * @param tree            The tree.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void bplus_tree_iterate(BPlusTree *tree, BPlusTreeIterator *iter);
+
+/**
+ * Initialise a @ref BPlusTreeIterator to iterate over the entries in a
+ * tree, starting from the first entry with a key greater than or equal
+ * to a given key.
+ *
+ * @param tree            The tree.
+ * @param key             The key to start from.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void bplus_tree_iterate_from(BPlusTree *tree, BPlusTreeKey key,
+                             BPlusTreeIterator *iter);
+
+/**
+ * Determine if there are more entries to iterate over.
+ *
+ * @param iter            The iterator.
+ * @return                Zero if there are no more entries, non-zero if
+ *                        there are more entries to read.
+ */
+
+int bplus_tree_iter_has_more(BPlusTreeIterator *iter);
+
+/**
+ * Using an iterator, retrieve the next key-value pair in the tree.
+ *
+ * @param iter            The iterator.
+ * @return                The next key-value pair.  If there are no more
+ *                        entries, both the key and value are
+ *                        @ref BPLUS_TREE_NULL.
+ */
+
+BPlusTreePair bplus_tree_iter_next(BPlusTreeIterator *iter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_BPLUS_TREE_H */
+
@@ -0,0 +1,254 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "concurrent-queue.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+#if defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+#define CONCURRENT_QUEUE_HAVE_ATOMICS
+#define CONCURRENT_QUEUE_LOAD_RELAXED(ptr) \
+	__atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define CONCURRENT_QUEUE_LOAD_ACQUIRE(ptr) \
+	__atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define CONCURRENT_QUEUE_STORE_RELAXED(ptr, value) \
+	__atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+#define CONCURRENT_QUEUE_STORE_RELEASE(ptr, value) \
+	__atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define CONCURRENT_QUEUE_CAS(ptr, expected, value) \
+	__atomic_compare_exchange_n((ptr), (expected), (value), 1, \
+	                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+/* Queues cannot be created, so these are never used */
+#define CONCURRENT_QUEUE_LOAD_RELAXED(ptr) (*(ptr))
+#define CONCURRENT_QUEUE_LOAD_ACQUIRE(ptr) (*(ptr))
+#define CONCURRENT_QUEUE_STORE_RELAXED(ptr, value) (*(ptr) = (value))
+#define CONCURRENT_QUEUE_STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#define CONCURRENT_QUEUE_CAS(ptr, expected, value) 0
+#endif
+
+/* Padding used to keep the fields written by producers and consumers on
+ * separate cache lines */
+
+#define CONCURRENT_QUEUE_CACHE_LINE 64
+
+/* A slot in the queue.  The sequence number of the slot at position pos
+ * is pos when the slot is empty and ready to be written, and pos + 1
+ * once a value has been written to it and it is ready to be read.  When
+ * the value is read, the sequence number is advanced to the position
+ * the slot will next be written at, pos + capacity. */
+
+typedef struct {
+	size_t sequence;
+	QueueValue data;
+} ConcurrentQueueSlot;
+
+struct _ConcurrentQueue {
+	ConcurrentQueueSlot *slots;
+	size_t mask;
+	unsigned int flags;
+	char pad1[CONCURRENT_QUEUE_CACHE_LINE];
+	size_t tail;
+	char pad2[CONCURRENT_QUEUE_CACHE_LINE];
+	size_t head;
+	char pad3[CONCURRENT_QUEUE_CACHE_LINE];
+};
+
+ConcurrentQueue *concurrent_queue_new(unsigned int capacity)
+{
+	return concurrent_queue_new_full(capacity, 0);
+}
+
+ConcurrentQueue *concurrent_queue_new_full(unsigned int capacity,
+                                           unsigned int flags)
+{
+	ConcurrentQueue *queue;
+	unsigned int size;
+	unsigned int i;
+
+#ifndef CONCURRENT_QUEUE_HAVE_ATOMICS
+	return NULL;
+#endif
+
+	/* Round the capacity up to a power of two.  At least two slots are
+	 * needed to tell a full slot from an empty one. */
+
+	size = 2;
+
+	while (size < capacity) {
+		if (size > (~0U) / 2) {
+			return NULL;
+		}
+
+		size *= 2;
+	}
+
+	if (size > (~(size_t) 0) / sizeof(ConcurrentQueueSlot)) {
+		return NULL;
+	}
+
+	queue = (ConcurrentQueue *) malloc(sizeof(ConcurrentQueue));
+
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	queue->slots = (ConcurrentQueueSlot *)
+	               malloc(size * sizeof(ConcurrentQueueSlot));
+
+	if (queue->slots == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	for (i=0; i<size; ++i) {
+		queue->slots[i].sequence = i;
+		queue->slots[i].data = QUEUE_NULL;
+	}
+
+	queue->mask = size - 1;
+	queue->flags = flags;
+	queue->head = 0;
+	queue->tail = 0;
+
+	return queue;
+}
+
+void concurrent_queue_free(ConcurrentQueue *queue)
+{
+	free(queue->slots);
+	free(queue);
+}
+
+int concurrent_queue_push(ConcurrentQueue *queue, QueueValue data)
+{
+	ConcurrentQueueSlot *slot;
+	size_t pos;
+	size_t sequence;
+	ptrdiff_t diff;
+
+	pos = CONCURRENT_QUEUE_LOAD_RELAXED(&queue->tail);
+
+	for (;;) {
+		slot = &queue->slots[pos & queue->mask];
+		sequence = CONCURRENT_QUEUE_LOAD_ACQUIRE(&slot->sequence);
+		diff = (ptrdiff_t) (sequence - pos);
+
+		if (diff == 0) {
+
+			/* The slot is empty; claim it by advancing the tail.
+			 * A single producer does not need to check that no
+			 * other thread has claimed it first. */
+
+			if ((queue->flags
+			     & CONCURRENT_QUEUE_SINGLE_PRODUCER) != 0) {
+				CONCURRENT_QUEUE_STORE_RELAXED(&queue->tail,
+				                               pos + 1);
+				break;
+			} else if (CONCURRENT_QUEUE_CAS(&queue->tail, &pos,
+			                                pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+
+			/* The slot still holds the value written one lap
+			 * ago: the queue is full */
+
+			return 0;
+		} else {
+
+			/* Another producer has claimed this slot */
+
+			pos = CONCURRENT_QUEUE_LOAD_RELAXED(&queue->tail);
+		}
+	}
+
+	/* Store the value, then publish it to consumers */
+
+	slot->data = data;
+	CONCURRENT_QUEUE_STORE_RELEASE(&slot->sequence, pos + 1);
+
+	return 1;
+}
+
+QueueValue concurrent_queue_pop(ConcurrentQueue *queue)
+{
+	ConcurrentQueueSlot *slot;
+	QueueValue result;
+	size_t pos;
+	size_t sequence;
+	ptrdiff_t diff;
+
+	pos = CONCURRENT_QUEUE_LOAD_RELAXED(&queue->head);
+
+	for (;;) {
+		slot = &queue->slots[pos & queue->mask];
+		sequence = CONCURRENT_QUEUE_LOAD_ACQUIRE(&slot->sequence);
+		diff = (ptrdiff_t) (sequence - (pos + 1));
+
+		if (diff == 0) {
+
+			/* The slot holds a value; claim it by advancing
+			 * the head */
+
+			if ((queue->flags
+			     & CONCURRENT_QUEUE_SINGLE_CONSUMER) != 0) {
+				CONCURRENT_QUEUE_STORE_RELAXED(&queue->head,
+				                               pos + 1);
+				break;
+			} else if (CONCURRENT_QUEUE_CAS(&queue->head, &pos,
+			                                pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+
+			/* No value has been written to the slot yet: the
+			 * queue is empty */
+
+			return QUEUE_NULL;
+		} else {
+
+			/* Another consumer has claimed this slot */
+
+			pos = CONCURRENT_QUEUE_LOAD_RELAXED(&queue->head);
+		}
+	}
+
+	/* Read the value, then hand the slot back to producers for the
+	 * next lap around the queue */
+
+	result = slot->data;
+	CONCURRENT_QUEUE_STORE_RELEASE(&slot->sequence, pos + queue->mask + 1);
+
+	return result;
+}
+
+unsigned int concurrent_queue_capacity(ConcurrentQueue *queue)
+{
+	return (unsigned int) (queue->mask + 1);
+}
+
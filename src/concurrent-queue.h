@@ -0,0 +1,153 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file concurrent-queue.h
+ *
+ * @brief Bounded lock-free queue which can be shared between threads.
+ *
+ * A concurrent queue is a first-in, first-out queue of a fixed capacity
+ * which can be used by several threads at once without locking.  Any
+ * number of threads can add values to the queue while any number of
+ * threads remove them.
+ *
+ * Values are stored in a circular array.  Each slot in the array has a
+ * sequence number which records whether it is ready to be written to or
+ * read from, so that threads only contend on the index at their own end
+ * of the queue.  If it is known that only one thread adds values, or
+ * only one thread removes values, the queue can be created with the
+ * @ref CONCURRENT_QUEUE_SINGLE_PRODUCER or
+ * @ref CONCURRENT_QUEUE_SINGLE_CONSUMER flags, which avoid atomic
+ * read-modify-write operations at that end.
+ *
+ * To create a concurrent queue, use @ref concurrent_queue_new or
+ * @ref concurrent_queue_new_full.  To destroy a concurrent queue, use
+ * @ref concurrent_queue_free.
+ *
+ * To add a value to the queue, use @ref concurrent_queue_push.  To
+ * remove a value from the queue, use @ref concurrent_queue_pop.
+ */
+
+#ifndef ALGORITHM_CONCURRENT_QUEUE_H
+#define ALGORITHM_CONCURRENT_QUEUE_H
+
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A concurrent queue structure.
+ */
+
+typedef struct _ConcurrentQueue ConcurrentQueue;
+
+/**
+ * Flags that can be passed to @ref concurrent_queue_new_full.
+ */
+
+typedef enum {
+	/**
+	 * Only one thread at a time will add values to the queue.
+	 */
+	CONCURRENT_QUEUE_SINGLE_PRODUCER = 1 << 0,
+
+	/**
+	 * Only one thread at a time will remove values from the queue.
+	 */
+	CONCURRENT_QUEUE_SINGLE_CONSUMER = 1 << 1
+} ConcurrentQueueFlags;
+
+/**
+ * Create a new concurrent queue which can be used by any number of
+ * threads.
+ *
+ * @param capacity   The maximum number of values that can be stored in
+ *                   the queue.  This is rounded up to a power of two.
+ * @return           A new queue, or NULL if it was not possible to
+ *                   allocate the new queue, or if the compiler does not
+ *                   support atomic operations.
+ */
+
+ConcurrentQueue *concurrent_queue_new(unsigned int capacity);
+
+/**
+ * Create a new concurrent queue, specifying flags to control its
+ * behavior.
+ *
+ * @param capacity   The maximum number of values that can be stored in
+ *                   the queue.  This is rounded up to a power of two.
+ * @param flags      Bitwise OR of @ref ConcurrentQueueFlags values, or
+ *                   zero for a queue which can be used by any number of
+ *                   threads.
+ * @return           A new queue, or NULL if it was not possible to
+ *                   allocate the new queue, or if the compiler does not
+ *                   support atomic operations.
+ */
+
+ConcurrentQueue *concurrent_queue_new_full(unsigned int capacity,
+                                           unsigned int flags);
+
+/**
+ * Destroy a concurrent queue.  No other threads may be using the queue.
+ *
+ * @param queue      The queue to destroy.
+ */
+
+void concurrent_queue_free(ConcurrentQueue *queue);
+
+/**
+ * Add a value to the tail of a concurrent queue.
+ *
+ * @param queue      The queue.
+ * @param data       The value to add.
+ * @return           Non-zero if the value was added successfully, or zero
+ *                   if the queue is full.
+ */
+
+int concurrent_queue_push(ConcurrentQueue *queue, QueueValue data);
+
+/**
+ * Remove a value from the head of a concurrent queue.
+ *
+ * @param queue      The queue.
+ * @return           Value that was at the head of the queue, or
+ *                   @ref QUEUE_NULL if the queue is empty.
+ */
+
+QueueValue concurrent_queue_pop(ConcurrentQueue *queue);
+
+/**
+ * Find the maximum number of values that can be stored in a concurrent
+ * queue.
+ *
+ * @param queue      The queue.
+ * @return           The capacity of the queue.
+ */
+
+unsigned int concurrent_queue_capacity(ConcurrentQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_CONCURRENT_QUEUE_H */
+
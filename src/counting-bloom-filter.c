@@ -0,0 +1,269 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "counting-bloom-filter.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* Counters are packed two to a byte: even indexes in the low four bits,
+ * odd indexes in the high four bits. */
+
+#define COUNTING_BLOOM_FILTER_MAX_COUNT 15
+#define COUNTING_BLOOM_FILTER_MAX_FUNCTIONS 64
+
+struct _CountingBloomFilter {
+	CountingBloomFilterHashFunc hash_func;
+	unsigned char *table;
+	unsigned int table_size;
+	unsigned int num_functions;
+};
+
+CountingBloomFilter *counting_bloom_filter_new(unsigned int table_size,
+                                  CountingBloomFilterHashFunc hash_func,
+                                  unsigned int num_functions)
+{
+	CountingBloomFilter *filter;
+
+	if (num_functions > COUNTING_BLOOM_FILTER_MAX_FUNCTIONS) {
+		return NULL;
+	}
+
+	filter = malloc(sizeof(CountingBloomFilter));
+
+	if (filter == NULL) {
+		return NULL;
+	}
+
+	/* Allocate table, each entry is four bits.  When allocating we
+	 * must round the length up to the nearest byte. */
+
+	filter->table = calloc((table_size + 1) / 2, 1);
+
+	if (filter->table == NULL) {
+		free(filter);
+		return NULL;
+	}
+
+	filter->hash_func = hash_func;
+	filter->num_functions = num_functions;
+	filter->table_size = table_size;
+
+	return filter;
+}
+
+void counting_bloom_filter_free(CountingBloomFilter *filter)
+{
+	free(filter->table);
+	free(filter);
+}
+
+static unsigned int counting_bloom_filter_get(CountingBloomFilter *filter,
+                                              unsigned int index)
+{
+	return (filter->table[index / 2] >> ((index % 2) * 4)) & 0xf;
+}
+
+static void counting_bloom_filter_set(CountingBloomFilter *filter,
+                                      unsigned int index,
+                                      unsigned int count)
+{
+	unsigned int shift;
+
+	shift = (index % 2) * 4;
+
+	filter->table[index / 2] = (unsigned char)
+	    ((filter->table[index / 2] & ~(0xfU << shift)) | (count << shift));
+}
+
+/* Find the counters for a value.  The indexes are generated from the
+ * hash by double hashing: index i is h1 + i * h2, where h2 is derived
+ * from the hash by mixing its bits. */
+
+static void counting_bloom_filter_indexes(CountingBloomFilter *filter,
+                                          CountingBloomFilterValue value,
+                                          unsigned int *indexes)
+{
+	unsigned int h1, h2;
+	unsigned int i;
+
+	h1 = filter->hash_func(value);
+	h2 = ((h1 >> 17) | (h1 << 15)) * 0x85ebca6bU;
+	h2 = (h2 ^ (h2 >> 16)) | 1;
+
+	for (i=0; i<filter->num_functions; ++i) {
+		indexes[i] = (h1 + i * h2) % filter->table_size;
+	}
+}
+
+void counting_bloom_filter_insert(CountingBloomFilter *filter,
+                                  CountingBloomFilterValue value)
+{
+	unsigned int indexes[COUNTING_BLOOM_FILTER_MAX_FUNCTIONS];
+	unsigned int count;
+	unsigned int i;
+
+	counting_bloom_filter_indexes(filter, value, indexes);
+
+	for (i=0; i<filter->num_functions; ++i) {
+		count = counting_bloom_filter_get(filter, indexes[i]);
+
+		/* Saturated counters stay at the maximum */
+
+		if (count < COUNTING_BLOOM_FILTER_MAX_COUNT) {
+			counting_bloom_filter_set(filter, indexes[i], count + 1);
+		}
+	}
+}
+
+int counting_bloom_filter_remove(CountingBloomFilter *filter,
+                                 CountingBloomFilterValue value)
+{
+	unsigned int indexes[COUNTING_BLOOM_FILTER_MAX_FUNCTIONS];
+	unsigned int count;
+	unsigned int i;
+
+	counting_bloom_filter_indexes(filter, value, indexes);
+
+	/* If any counter is zero, the value is not in the filter.  Check
+	 * this first, so that the filter is not left half-updated. */
+
+	for (i=0; i<filter->num_functions; ++i) {
+		if (counting_bloom_filter_get(filter, indexes[i]) == 0) {
+			return 0;
+		}
+	}
+
+	/* A saturated counter may have been incremented more times than
+	 * it can record, so it is never decremented.  The same counter
+	 * may appear more than once in the indexes, so it can reach zero
+	 * part way through; it must not go any lower. */
+
+	for (i=0; i<filter->num_functions; ++i) {
+		count = counting_bloom_filter_get(filter, indexes[i]);
+
+		if (count > 0 && count < COUNTING_BLOOM_FILTER_MAX_COUNT) {
+			counting_bloom_filter_set(filter, indexes[i], count - 1);
+		}
+	}
+
+	return 1;
+}
+
+int counting_bloom_filter_query(CountingBloomFilter *filter,
+                                CountingBloomFilterValue value)
+{
+	unsigned int indexes[COUNTING_BLOOM_FILTER_MAX_FUNCTIONS];
+	unsigned int i;
+
+	counting_bloom_filter_indexes(filter, value, indexes);
+
+	for (i=0; i<filter->num_functions; ++i) {
+		if (counting_bloom_filter_get(filter, indexes[i]) == 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void counting_bloom_filter_read(CountingBloomFilter *filter,
+                                unsigned char *array)
+{
+	memcpy(array, filter->table, (filter->table_size + 1) / 2);
+}
+
+void counting_bloom_filter_load(CountingBloomFilter *filter,
+                                unsigned char *array)
+{
+	memcpy(filter->table, array, (filter->table_size + 1) / 2);
+}
+
+/* Create a new filter with counters combined from two filters, either
+ * the saturating sum (for a union) or the minimum (for an intersection)
+ * of each pair of counters. */
+
+static CountingBloomFilter *counting_bloom_filter_combine(
+                                    CountingBloomFilter *filter1,
+                                    CountingBloomFilter *filter2,
+                                    int intersection)
+{
+	CountingBloomFilter *result;
+	unsigned int count1, count2;
+	unsigned int count;
+	unsigned int i;
+
+	/* To perform this operation, both filters must be created with
+	 * the same values. */
+
+	if (filter1->table_size != filter2->table_size
+	 || filter1->num_functions != filter2->num_functions
+	 || filter1->hash_func != filter2->hash_func) {
+		return NULL;
+	}
+
+	result = counting_bloom_filter_new(filter1->table_size,
+	                                   filter1->hash_func,
+	                                   filter1->num_functions);
+
+	if (result == NULL) {
+		return NULL;
+	}
+
+	for (i=0; i<filter1->table_size; ++i) {
+		count1 = counting_bloom_filter_get(filter1, i);
+		count2 = counting_bloom_filter_get(filter2, i);
+
+		if (intersection) {
+			count = count1 < count2 ? count1 : count2;
+		} else {
+			count = count1 + count2;
+
+			if (count > COUNTING_BLOOM_FILTER_MAX_COUNT) {
+				count = COUNTING_BLOOM_FILTER_MAX_COUNT;
+			}
+		}
+
+		counting_bloom_filter_set(result, i, count);
+	}
+
+	return result;
+}
+
+CountingBloomFilter *counting_bloom_filter_union(
+                             CountingBloomFilter *filter1,
+                             CountingBloomFilter *filter2)
+{
+	return counting_bloom_filter_combine(filter1, filter2, 0);
+}
+
+CountingBloomFilter *counting_bloom_filter_intersection(
+                             CountingBloomFilter *filter1,
+                             CountingBloomFilter *filter2)
+{
+	return counting_bloom_filter_combine(filter1, filter2, 1);
+}
+
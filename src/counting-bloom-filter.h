@@ -0,0 +1,217 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file counting-bloom-filter.h
+ *
+ * @brief Counting bloom filter
+ *
+ * A counting bloom filter is a variant of a bloom filter (see
+ * @ref bloom-filter.h) which stores a small counter in place of each
+ * bit, so that values can be removed from the filter as well as
+ * inserted.  Each counter is four bits.  A counter which reaches its
+ * maximum value is never decremented again, so removing values never
+ * causes false negatives, although it may leave some false positives.
+ *
+ * To create a counting bloom filter, use @ref counting_bloom_filter_new.
+ * To destroy a counting bloom filter, use @ref counting_bloom_filter_free.
+ *
+ * To insert a value into a counting bloom filter, use
+ * @ref counting_bloom_filter_insert.  To remove a value, use
+ * @ref counting_bloom_filter_remove.
+ *
+ * To query whether a value is part of the set, use
+ * @ref counting_bloom_filter_query.
+ */
+
+#ifndef ALGORITHM_COUNTING_BLOOM_FILTER_H
+#define ALGORITHM_COUNTING_BLOOM_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A counting bloom filter structure.
+ */
+
+typedef struct _CountingBloomFilter CountingBloomFilter;
+
+/**
+ * A value stored in a @ref CountingBloomFilter.
+ */
+
+typedef void *CountingBloomFilterValue;
+
+/**
+ * Hash function used to generate hash values for values inserted into a
+ * counting bloom filter.
+ *
+ * @param data   The value to generate a hash value for.
+ * @return       The hash value.
+ */
+
+typedef unsigned int (*CountingBloomFilterHashFunc)(
+                             CountingBloomFilterValue data);
+
+/**
+ * Create a new counting bloom filter.
+ *
+ * @param table_size       The number of counters in the filter.  The
+ *                         greater the table size, the more elements can
+ *                         be stored, and the lesser the chance of false
+ *                         positives.  Each counter takes four bits.
+ * @param hash_func        Hash function to use on values stored in the
+ *                         filter.
+ * @param num_functions    Number of counters to update for each element
+ *                         on insertion.  The maximum number of functions
+ *                         is 64.
+ * @return                 A new counting bloom filter, or NULL if it
+ *                         was not possible to allocate the new filter.
+ */
+
+CountingBloomFilter *counting_bloom_filter_new(unsigned int table_size,
+                                  CountingBloomFilterHashFunc hash_func,
+                                  unsigned int num_functions);
+
+/**
+ * Destroy a counting bloom filter.
+ *
+ * @param filter           The counting bloom filter to destroy.
+ */
+
+void counting_bloom_filter_free(CountingBloomFilter *filter);
+
+/**
+ * Insert a value into a counting bloom filter.  A value may be inserted
+ * more than once, and must then be removed the same number of times.
+ *
+ * @param filter               The counting bloom filter.
+ * @param value                The value to insert.
+ */
+
+void counting_bloom_filter_insert(CountingBloomFilter *filter,
+                                  CountingBloomFilterValue value);
+
+/**
+ * Remove a value from a counting bloom filter.  Only values which have
+ * been inserted should be removed: removing other values may cause
+ * false negatives for values which share counters with them.
+ *
+ * @param filter               The counting bloom filter.
+ * @param value                The value to remove.
+ * @return                     Non-zero if the value was removed, or zero
+ *                             if it was definitely not in the filter,
+ *                             in which case the filter is unchanged.
+ */
+
+int counting_bloom_filter_remove(CountingBloomFilter *filter,
+                                 CountingBloomFilterValue value);
+
+/**
+ * Query a counting bloom filter for a particular value.
+ *
+ * @param filter               The counting bloom filter.
+ * @param value                The value to look up.
+ * @return                     Zero if the value is definitely not in
+ *                             the filter.  Non-zero indicates that it
+ *                             either may or may not be in the filter.
+ */
+
+int counting_bloom_filter_query(CountingBloomFilter *filter,
+                                CountingBloomFilterValue value);
+
+/**
+ * Read the contents of a counting bloom filter into an array.
+ *
+ * @param filter               The counting bloom filter.
+ * @param array                Pointer to the array to read into.  This
+ *                             should be (table_size + 1) / 2 bytes in
+ *                             length.
+ */
+
+void counting_bloom_filter_read(CountingBloomFilter *filter,
+                                unsigned char *array);
+
+/**
+ * Load the contents of a counting bloom filter from an array.
+ * The data loaded should be the output read from
+ * @ref counting_bloom_filter_read, from a filter created using the same
+ * arguments used to create the original filter.
+ *
+ * @param filter               The counting bloom filter.
+ * @param array                Pointer to the array to load from.  This
+ *                             should be (table_size + 1) / 2 bytes in
+ *                             length.
+ */
+
+void counting_bloom_filter_load(CountingBloomFilter *filter,
+                                unsigned char *array);
+
+/**
+ * Find the union of two counting bloom filters.  Each counter in the
+ * result is the sum of the counters in the original filters, so values
+ * are present in the result if they are present in either filter, and
+ * can be removed as many times as they were inserted into both.
+ *
+ * Both of the original filters must have been created using the
+ * same parameters to @ref counting_bloom_filter_new.
+ *
+ * @param filter1              The first filter.
+ * @param filter2              The second filter.
+ * @return                     A new filter which is a union of the
+ *                             two filters, or NULL if it was not possible
+ *                             to allocate memory for the new filter, or
+ *                             if the two filters specified were created
+ *                             with different parameters.
+ */
+
+CountingBloomFilter *counting_bloom_filter_union(
+                             CountingBloomFilter *filter1,
+                             CountingBloomFilter *filter2);
+
+/**
+ * Find the intersection of two counting bloom filters.  Each counter in
+ * the result is the smaller of the counters in the original filters, so
+ * values are only ever present in the result if they are present in
+ * both of the original filters.
+ *
+ * Both of the original filters must have been created using the
+ * same parameters to @ref counting_bloom_filter_new.
+ *
+ * @param filter1              The first filter.
+ * @param filter2              The second filter.
+ * @return                     A new filter which is an intersection of the
+ *                             two filters, or NULL if it was not possible
+ *                             to allocate memory for the new filter, or
+ *                             if the two filters specified were created
+ *                             with different parameters.
+ */
+
+CountingBloomFilter *counting_bloom_filter_intersection(
+                             CountingBloomFilter *filter1,
+                             CountingBloomFilter *filter2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_COUNTING_BLOOM_FILTER_H */
+
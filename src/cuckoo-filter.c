@@ -0,0 +1,444 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "cuckoo-filter.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* Number of fingerprints in each bucket */
+
+#define CUCKOO_FILTER_BUCKET_SIZE 4
+
+/* Maximum number of fingerprints to move when inserting */
+
+#define CUCKOO_FILTER_MAX_KICKS 500
+
+/* A zero fingerprint marks an empty slot. */
+
+struct _CuckooFilter {
+	CuckooFilterHashFunc hash_func;
+	uint16_t *table;
+	unsigned int num_buckets;
+	unsigned int num_entries;
+	uint32_t random_state;
+
+	/* When no room can be found for a fingerprint, it is kept here,
+	 * and further insertions fail until it can be put back. */
+
+	int has_victim;
+	unsigned int victim_bucket;
+	uint16_t victim;
+};
+
+CuckooFilter *cuckoo_filter_new(unsigned int capacity,
+                                CuckooFilterHashFunc hash_func)
+{
+	CuckooFilter *filter;
+	unsigned int num_buckets;
+
+	/* The number of slots in the table must fit in an unsigned int
+	 * once rounded up, so the largest capacity is 2^31. */
+
+	if (capacity > UINT_MAX / 2 + 1) {
+		return NULL;
+	}
+
+	/* The number of buckets is a power of two, so that the alternate
+	 * bucket can be found by XOR. */
+
+	num_buckets = 1;
+
+	while (num_buckets * CUCKOO_FILTER_BUCKET_SIZE < capacity) {
+		num_buckets <<= 1;
+	}
+
+	filter = malloc(sizeof(CuckooFilter));
+
+	if (filter == NULL) {
+		return NULL;
+	}
+
+	filter->table = calloc(num_buckets * CUCKOO_FILTER_BUCKET_SIZE,
+	                       sizeof(uint16_t));
+
+	if (filter->table == NULL) {
+		free(filter);
+		return NULL;
+	}
+
+	filter->hash_func = hash_func;
+	filter->num_buckets = num_buckets;
+	filter->num_entries = 0;
+	filter->random_state = 0x9e3779b9;
+	filter->has_victim = 0;
+
+	return filter;
+}
+
+void cuckoo_filter_free(CuckooFilter *filter)
+{
+	free(filter->table);
+	free(filter);
+}
+
+/* Find the bucket and fingerprint for a value */
+
+static unsigned int cuckoo_filter_hash(CuckooFilter *filter,
+                                       CuckooFilterValue value,
+                                       uint16_t *fingerprint)
+{
+	uint64_t hash;
+
+	hash = filter->hash_func(value);
+
+	*fingerprint = (uint16_t) (hash >> 32);
+
+	if (*fingerprint == 0) {
+		*fingerprint = 1;
+	}
+
+	return (unsigned int) hash & (filter->num_buckets - 1);
+}
+
+/* Find the other bucket for a fingerprint.  This depends only on the
+ * fingerprint and the current bucket, so that fingerprints can be moved
+ * without knowing the values they came from. */
+
+static unsigned int cuckoo_filter_alt_bucket(CuckooFilter *filter,
+                                             unsigned int bucket,
+                                             uint16_t fingerprint)
+{
+	return (bucket ^ (fingerprint * 0x5bd1e995U))
+	     & (filter->num_buckets - 1);
+}
+
+static int cuckoo_filter_bucket_add(CuckooFilter *filter, unsigned int bucket,
+                                    uint16_t fingerprint)
+{
+	uint16_t *slots;
+	unsigned int i;
+
+	slots = filter->table + bucket * CUCKOO_FILTER_BUCKET_SIZE;
+
+	for (i=0; i<CUCKOO_FILTER_BUCKET_SIZE; ++i) {
+		if (slots[i] == 0) {
+			slots[i] = fingerprint;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int cuckoo_filter_bucket_find(CuckooFilter *filter,
+                                     unsigned int bucket,
+                                     uint16_t fingerprint)
+{
+	uint16_t *slots;
+	unsigned int i;
+
+	slots = filter->table + bucket * CUCKOO_FILTER_BUCKET_SIZE;
+
+	for (i=0; i<CUCKOO_FILTER_BUCKET_SIZE; ++i) {
+		if (slots[i] == fingerprint) {
+			return (int) i;
+		}
+	}
+
+	return -1;
+}
+
+static uint32_t cuckoo_filter_random(CuckooFilter *filter)
+{
+	uint32_t x;
+
+	x = filter->random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	filter->random_state = x;
+
+	return x;
+}
+
+/* Add a fingerprint to one of its buckets, moving other fingerprints to
+ * their alternate buckets if both are full.  If no room is found, the
+ * last fingerprint displaced is kept as the victim.  This must only be
+ * called when there is no victim. */
+
+static void cuckoo_filter_add(CuckooFilter *filter, unsigned int bucket,
+                              uint16_t fingerprint)
+{
+	uint16_t *slot;
+	uint16_t tmp;
+	unsigned int alt_bucket;
+	unsigned int i;
+
+	alt_bucket = cuckoo_filter_alt_bucket(filter, bucket, fingerprint);
+
+	if (cuckoo_filter_bucket_add(filter, bucket, fingerprint)
+	 || cuckoo_filter_bucket_add(filter, alt_bucket, fingerprint)) {
+		return;
+	}
+
+	/* Both buckets are full.  Repeatedly swap with a fingerprint in a
+	 * random slot, and try to put that fingerprint in its other
+	 * bucket. */
+
+	if (cuckoo_filter_random(filter) & 1) {
+		bucket = alt_bucket;
+	}
+
+	for (i=0; i<CUCKOO_FILTER_MAX_KICKS; ++i) {
+		slot = filter->table + bucket * CUCKOO_FILTER_BUCKET_SIZE
+		     + cuckoo_filter_random(filter) % CUCKOO_FILTER_BUCKET_SIZE;
+
+		tmp = *slot;
+		*slot = fingerprint;
+		fingerprint = tmp;
+
+		bucket = cuckoo_filter_alt_bucket(filter, bucket, fingerprint);
+
+		if (cuckoo_filter_bucket_add(filter, bucket, fingerprint)) {
+			return;
+		}
+	}
+
+	filter->has_victim = 1;
+	filter->victim_bucket = bucket;
+	filter->victim = fingerprint;
+}
+
+int cuckoo_filter_insert(CuckooFilter *filter, CuckooFilterValue value)
+{
+	unsigned int bucket;
+	uint16_t fingerprint;
+
+	/* The filter is full while there is a victim */
+
+	if (filter->has_victim) {
+		return 0;
+	}
+
+	bucket = cuckoo_filter_hash(filter, value, &fingerprint);
+	cuckoo_filter_add(filter, bucket, fingerprint);
+	++filter->num_entries;
+
+	return 1;
+}
+
+static int cuckoo_filter_victim_matches(CuckooFilter *filter,
+                                        unsigned int bucket,
+                                        unsigned int alt_bucket,
+                                        uint16_t fingerprint)
+{
+	return filter->has_victim
+	    && filter->victim == fingerprint
+	    && (filter->victim_bucket == bucket
+	     || filter->victim_bucket == alt_bucket);
+}
+
+int cuckoo_filter_remove(CuckooFilter *filter, CuckooFilterValue value)
+{
+	unsigned int bucket;
+	unsigned int alt_bucket;
+	uint16_t fingerprint;
+	int slot;
+
+	bucket = cuckoo_filter_hash(filter, value, &fingerprint);
+	alt_bucket = cuckoo_filter_alt_bucket(filter, bucket, fingerprint);
+
+	if (cuckoo_filter_victim_matches(filter, bucket, alt_bucket,
+	                                 fingerprint)) {
+		filter->has_victim = 0;
+		--filter->num_entries;
+		return 1;
+	}
+
+	slot = cuckoo_filter_bucket_find(filter, bucket, fingerprint);
+
+	if (slot < 0) {
+		bucket = alt_bucket;
+		slot = cuckoo_filter_bucket_find(filter, bucket, fingerprint);
+	}
+
+	if (slot < 0) {
+		return 0;
+	}
+
+	filter->table[bucket * CUCKOO_FILTER_BUCKET_SIZE
+	              + (unsigned int) slot] = 0;
+	--filter->num_entries;
+
+	/* There is now room to put the victim back */
+
+	if (filter->has_victim) {
+		filter->has_victim = 0;
+		cuckoo_filter_add(filter, filter->victim_bucket,
+		                  filter->victim);
+	}
+
+	return 1;
+}
+
+int cuckoo_filter_query(CuckooFilter *filter, CuckooFilterValue value)
+{
+	unsigned int bucket;
+	unsigned int alt_bucket;
+	uint16_t fingerprint;
+
+	bucket = cuckoo_filter_hash(filter, value, &fingerprint);
+	alt_bucket = cuckoo_filter_alt_bucket(filter, bucket, fingerprint);
+
+	return cuckoo_filter_bucket_find(filter, bucket, fingerprint) >= 0
+	    || cuckoo_filter_bucket_find(filter, alt_bucket, fingerprint) >= 0
+	    || cuckoo_filter_victim_matches(filter, bucket, alt_bucket,
+	                                    fingerprint);
+}
+
+unsigned int cuckoo_filter_num_entries(CuckooFilter *filter)
+{
+	return filter->num_entries;
+}
+
+/* Add all of the fingerprints in one filter to another, optionally only
+ * those which are also present in a third filter.  Returns zero if the
+ * destination filter became full. */
+
+static int cuckoo_filter_add_all(CuckooFilter *dest, CuckooFilter *src,
+                                 CuckooFilter *other)
+{
+	unsigned int alt_bucket;
+	unsigned int bucket;
+	unsigned int i;
+	uint16_t fingerprint;
+
+	for (i=0; i<src->num_buckets * CUCKOO_FILTER_BUCKET_SIZE + 1; ++i) {
+
+		/* After the table, include the victim */
+
+		if (i < src->num_buckets * CUCKOO_FILTER_BUCKET_SIZE) {
+			bucket = i / CUCKOO_FILTER_BUCKET_SIZE;
+			fingerprint = src->table[i];
+		} else if (src->has_victim) {
+			bucket = src->victim_bucket;
+			fingerprint = src->victim;
+		} else {
+			break;
+		}
+
+		if (fingerprint == 0) {
+			continue;
+		}
+
+		if (other != NULL) {
+			alt_bucket = cuckoo_filter_alt_bucket(other, bucket,
+			                                      fingerprint);
+
+			if (cuckoo_filter_bucket_find(other, bucket,
+			                              fingerprint) < 0
+			 && cuckoo_filter_bucket_find(other, alt_bucket,
+			                              fingerprint) < 0
+			 && !cuckoo_filter_victim_matches(other, bucket,
+			                                  alt_bucket,
+			                                  fingerprint)) {
+				continue;
+			}
+		}
+
+		if (dest->has_victim) {
+			return 0;
+		}
+
+		cuckoo_filter_add(dest, bucket, fingerprint);
+		++dest->num_entries;
+	}
+
+	return 1;
+}
+
+CuckooFilter *cuckoo_filter_union(CuckooFilter *filter1,
+                                  CuckooFilter *filter2)
+{
+	CuckooFilter *result;
+
+	/* To perform this operation, both filters must be created with
+	 * the same values. */
+
+	if (filter1->num_buckets != filter2->num_buckets
+	 || filter1->hash_func != filter2->hash_func) {
+		return NULL;
+	}
+
+	result = cuckoo_filter_new(filter1->num_buckets
+	                           * CUCKOO_FILTER_BUCKET_SIZE,
+	                           filter1->hash_func);
+
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (!cuckoo_filter_add_all(result, filter1, NULL)
+	 || !cuckoo_filter_add_all(result, filter2, NULL)) {
+		cuckoo_filter_free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+CuckooFilter *cuckoo_filter_intersection(CuckooFilter *filter1,
+                                         CuckooFilter *filter2)
+{
+	CuckooFilter *result;
+
+	/* To perform this operation, both filters must be created with
+	 * the same values. */
+
+	if (filter1->num_buckets != filter2->num_buckets
+	 || filter1->hash_func != filter2->hash_func) {
+		return NULL;
+	}
+
+	result = cuckoo_filter_new(filter1->num_buckets
+	                           * CUCKOO_FILTER_BUCKET_SIZE,
+	                           filter1->hash_func);
+
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (!cuckoo_filter_add_all(result, filter1, filter2)) {
+		cuckoo_filter_free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
@@ -0,0 +1,200 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file cuckoo-filter.h
+ *
+ * @brief Cuckoo filter
+ *
+ * A cuckoo filter is a space efficient data structure that can be used
+ * to test whether a given element is part of a set, like a bloom filter
+ * (see @ref bloom-filter.h), but which also supports removing elements.
+ * Lookups will occasionally generate false positives, but never false
+ * negatives.
+ *
+ * A short fingerprint of each value is stored in one of two buckets
+ * determined by its hash; when both are full, existing fingerprints are
+ * moved to their alternate buckets to make room, as in cuckoo hashing.
+ * Each bucket holds four 16-bit fingerprints.
+ *
+ * To create a cuckoo filter, use @ref cuckoo_filter_new.  To destroy a
+ * cuckoo filter, use @ref cuckoo_filter_free.
+ *
+ * To insert a value into a cuckoo filter, use @ref cuckoo_filter_insert.
+ * To remove a value, use @ref cuckoo_filter_remove.
+ *
+ * To query whether a value is part of the set, use
+ * @ref cuckoo_filter_query.
+ */
+
+#ifndef ALGORITHM_CUCKOO_FILTER_H
+#define ALGORITHM_CUCKOO_FILTER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A cuckoo filter structure.
+ */
+
+typedef struct _CuckooFilter CuckooFilter;
+
+/**
+ * A value stored in a @ref CuckooFilter.
+ */
+
+typedef void *CuckooFilterValue;
+
+/**
+ * Hash function used to generate hash values for values inserted into a
+ * cuckoo filter.  The lower 32 bits of the hash select a bucket, and
+ * the upper 32 bits give the fingerprint, so all bits of the hash should
+ * be well distributed.
+ *
+ * @param data   The value to generate a hash value for.
+ * @return       The hash value.
+ */
+
+typedef uint64_t (*CuckooFilterHashFunc)(CuckooFilterValue data);
+
+/**
+ * Create a new cuckoo filter.
+ *
+ * @param capacity         The number of values the filter should be
+ *                         able to hold.  This is rounded up to four
+ *                         times a power of two.  Filters can usually be
+ *                         filled to about 95% of their capacity before
+ *                         an insertion fails.  The largest capacity
+ *                         is 2^31.
+ * @param hash_func        Hash function to use on values stored in the
+ *                         filter.
+ * @return                 A new cuckoo filter, or NULL if the capacity
+ *                         is too large or it was not possible to
+ *                         allocate the new filter.
+ */
+
+CuckooFilter *cuckoo_filter_new(unsigned int capacity,
+                                CuckooFilterHashFunc hash_func);
+
+/**
+ * Destroy a cuckoo filter.
+ *
+ * @param filter           The cuckoo filter to destroy.
+ */
+
+void cuckoo_filter_free(CuckooFilter *filter);
+
+/**
+ * Insert a value into a cuckoo filter.  A value may be inserted more
+ * than once, and must then be removed the same number of times.
+ *
+ * @param filter           The cuckoo filter.
+ * @param value            The value to insert.
+ * @return                 Non-zero if the value was inserted, or zero if
+ *                         the filter is full.
+ */
+
+int cuckoo_filter_insert(CuckooFilter *filter, CuckooFilterValue value);
+
+/**
+ * Remove a value from a cuckoo filter.  Only values which have been
+ * inserted should be removed: removing another value with the same
+ * fingerprint as an inserted value would remove that value instead.
+ *
+ * @param filter           The cuckoo filter.
+ * @param value            The value to remove.
+ * @return                 Non-zero if the value was removed, or zero if
+ *                         it was not in the filter.
+ */
+
+int cuckoo_filter_remove(CuckooFilter *filter, CuckooFilterValue value);
+
+/**
+ * Query a cuckoo filter for a particular value.
+ *
+ * @param filter           The cuckoo filter.
+ * @param value            The value to look up.
+ * @return                 Zero if the value is definitely not in the
+ *                         filter.  Non-zero indicates that it either may
+ *                         or may not be in the filter.
+ */
+
+int cuckoo_filter_query(CuckooFilter *filter, CuckooFilterValue value);
+
+/**
+ * Find the number of values stored in a cuckoo filter.
+ *
+ * @param filter           The cuckoo filter.
+ * @return                 The number of values in the filter.
+ */
+
+unsigned int cuckoo_filter_num_entries(CuckooFilter *filter);
+
+/**
+ * Find the union of two cuckoo filters.  Values are present in the
+ * resulting filter if they are present in either of the original
+ * filters.
+ *
+ * Both of the original filters must have been created using the
+ * same parameters to @ref cuckoo_filter_new.
+ *
+ * @param filter1          The first filter.
+ * @param filter2          The second filter.
+ * @return                 A new filter which is a union of the two
+ *                         filters, or NULL if it was not possible to
+ *                         allocate memory for the new filter, if the
+ *                         values of both filters do not fit in a single
+ *                         filter, or if the two filters specified were
+ *                         created with different parameters.
+ */
+
+CuckooFilter *cuckoo_filter_union(CuckooFilter *filter1,
+                                  CuckooFilter *filter2);
+
+/**
+ * Find the intersection of two cuckoo filters.  Values are only ever
+ * present in the resulting filter if they are present in both of the
+ * original filters.
+ *
+ * Both of the original filters must have been created using the
+ * same parameters to @ref cuckoo_filter_new.
+ *
+ * @param filter1          The first filter.
+ * @param filter2          The second filter.
+ * @return                 A new filter which is an intersection of the
+ *                         two filters, or NULL if it was not possible to
+ *                         allocate memory for the new filter, if the
+ *                         values did not fit in the new filter (which is
+ *                         very unlikely), or if the two filters specified
+ *                         were created with different parameters.
+ */
+
+CuckooFilter *cuckoo_filter_intersection(CuckooFilter *filter1,
+                                         CuckooFilter *filter2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_CUCKOO_FILTER_H */
+
@@ -22,6 +22,12 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "hash-table.h"
 
@@ -31,9 +37,13 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
+/* The hash field is only present if HASH_TABLE_CACHE_HASHES is set;
+ * otherwise entries are allocated without it. */
+
 struct _HashTableEntry {
 	HashTablePair pair;
 	HashTableEntry *next;
+	unsigned int hash;
 };
 
 struct _HashTable {
@@ -45,6 +55,15 @@ struct _HashTable {
 	HashTableValueFreeFunc value_free_func;
 	unsigned int entries;
 	unsigned int prime_index;
+	unsigned int flags;
+	unsigned char *ctrl;
+	HashTablePair *slots;
+	unsigned int *hashes;
+	unsigned int deleted;
+	HashTableEntry **old_table;
+	unsigned int old_table_size;
+	unsigned int resize_index;
+	Allocator *allocator;
 };
 
 /* This is a set of good hash table prime numbers, from:
@@ -62,6 +81,14 @@ static const unsigned int hash_table_primes[] = {
 static const unsigned int hash_table_num_primes
 	= sizeof(hash_table_primes) / sizeof(int);
 
+/* Number of chains moved from the old table on each insert when resizing
+ * incrementally.  The table is enlarged when it becomes 1/3 full, and
+ * the new table is roughly twice the size of the old one, so moving
+ * more than three chains per insert ensures that each resize completes
+ * before the next one is needed. */
+
+#define HASH_TABLE_RESIZE_STEP 8
+
 /* Internal function used to allocate the table on hash table creation
  * and when enlarging the table */
 
@@ -90,14 +117,11 @@ static int hash_table_allocate_table(HashTable *hash_table)
 	return hash_table->table != NULL;
 }
 
-/* Free an entry, calling the free functions if there are any registered */
+/* Call the free functions for a key/value pair, if there are any
+ * registered */
 
-static void hash_table_free_entry(HashTable *hash_table, HashTableEntry *entry)
+static void hash_table_free_pair(HashTable *hash_table, HashTablePair *pair)
 {
-	HashTablePair *pair;
-
-	pair = &(entry->pair);
-
 	/* If there is a function registered for freeing keys, use it to free
 	 * the key */
 
@@ -110,16 +134,484 @@ static void hash_table_free_entry(HashTable *hash_table, HashTableEntry *entry)
 	if (hash_table->value_free_func != NULL) {
 		hash_table->value_free_func(pair->value);
 	}
+}
+
+/* Get the size of the entries in a chained table.  Space for the hash
+ * is only allocated if it is being cached. */
+
+static size_t hash_table_entry_size(HashTable *hash_table)
+{
+	if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0) {
+		return sizeof(HashTableEntry);
+	} else {
+		return offsetof(HashTableEntry, hash);
+	}
+}
+
+/* Free an entry, calling the free functions if there are any registered */
+
+static void hash_table_free_entry(HashTable *hash_table, HashTableEntry *entry)
+{
+	hash_table_free_pair(hash_table, &(entry->pair));
 
 	/* Free the data structure */
 
-	free(entry);
+	allocator_free(hash_table->allocator, entry,
+	               hash_table_entry_size(hash_table));
+}
+
+/* Test if a chained entry has the specified key.  If hashes are cached,
+ * the equal function is only called if the hashes match. */
+
+static int hash_table_entry_has_key(HashTable *hash_table,
+                                    HashTableEntry *entry,
+                                    HashTableKey key,
+                                    unsigned int hash)
+{
+	if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0
+	 && entry->hash != hash) {
+		return 0;
+	}
+
+	return hash_table->equal_func(key, entry->pair.key) != 0;
+}
+
+/* Open addressing implementation.
+ *
+ * Entries are stored in a flat array of slots whose size is always a
+ * power of two.  A parallel array holds a control byte for each slot,
+ * which is either EMPTY, DELETED (a tombstone left behind by a removal)
+ * or, if the slot is in use, seven bits taken from the hash of its key.
+ * Slots are probed in aligned groups of 16, so that all control bytes
+ * in a group can be compared against the hash at once; the user's
+ * equal function is only called when the control byte matches. */
+
+#define HASH_TABLE_GROUP_WIDTH    16
+#define HASH_TABLE_MIN_CAPACITY   16
+#define HASH_TABLE_CTRL_EMPTY     0x80
+#define HASH_TABLE_CTRL_DELETED   0xfe
+
+/* Scramble the result of the user's hash function.  Simple hash
+ * functions such as int_hash do not distribute well over a power of
+ * two sized table, so multiply by a large odd constant and take the
+ * upper bits (Fibonacci hashing). */
+
+static unsigned int hash_table_oa_mix(unsigned int hash)
+{
+	uint64_t result;
+
+	result = (uint64_t) hash * UINT64_C(0x9e3779b97f4a7c15);
+
+	return (unsigned int) (result >> 32);
+}
+
+/* Get a bitmask of the slots in a group whose control byte has the
+ * given value. */
+
+static unsigned int hash_table_group_match(const unsigned char *group,
+                                           unsigned char value)
+{
+#ifdef __SSE2__
+	__m128i ctrl;
+
+	ctrl = _mm_loadu_si128((const __m128i *) group);
+
+	return (unsigned int) _mm_movemask_epi8(
+	    _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) value)));
+#else
+	unsigned int result;
+	unsigned int i;
+
+	result = 0;
+
+	for (i=0; i<HASH_TABLE_GROUP_WIDTH; ++i) {
+		if (group[i] == value) {
+			result |= 1U << i;
+		}
+	}
+
+	return result;
+#endif
+}
+
+/* Get a bitmask of the slots in a group that are not in use (either
+ * empty or deleted).  Both values have the top bit set, while the
+ * control byte of a full slot never does. */
+
+static unsigned int hash_table_group_match_free(const unsigned char *group)
+{
+#ifdef __SSE2__
+	return (unsigned int) _mm_movemask_epi8(
+	    _mm_loadu_si128((const __m128i *) group));
+#else
+	unsigned int result;
+	unsigned int i;
+
+	result = 0;
+
+	for (i=0; i<HASH_TABLE_GROUP_WIDTH; ++i) {
+		if ((group[i] & 0x80) != 0) {
+			result |= 1U << i;
+		}
+	}
+
+	return result;
+#endif
+}
+
+/* Find the index of the lowest set bit in a non-zero mask */
+
+static unsigned int hash_table_first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return (unsigned int) __builtin_ctz(mask);
+#else
+	unsigned int result;
+
+	result = 0;
+
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		++result;
+	}
+
+	return result;
+#endif
+}
+
+/* Allocate the slot and control byte arrays (and the array of cached
+ * hashes, if enabled) for an open addressing table.  These are all
+ * stored in a single block. */
+
+static int hash_table_oa_allocate_table(HashTable *hash_table,
+                                        unsigned int capacity)
+{
+	HashTablePair *slots;
+	size_t slot_size;
+
+	slot_size = sizeof(HashTablePair) + 1;
+
+	if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0) {
+		slot_size += sizeof(unsigned int);
+	}
+
+	slots = malloc(capacity * slot_size);
+
+	if (slots == NULL) {
+		return 0;
+	}
+
+	hash_table->slots = slots;
+
+	if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0) {
+		hash_table->hashes = (unsigned int *) (slots + capacity);
+		hash_table->ctrl = (unsigned char *) (hash_table->hashes
+		                                      + capacity);
+	} else {
+		hash_table->ctrl = (unsigned char *) (slots + capacity);
+	}
+
+	hash_table->table_size = capacity;
+	hash_table->deleted = 0;
+
+	memset(hash_table->ctrl, HASH_TABLE_CTRL_EMPTY, capacity);
+
+	return 1;
+}
+
+/* Search for a key in an open addressing table.  Returns the index of
+ * the slot containing the key, or the table size if it is not found.
+ *
+ * Groups are probed using a triangular sequence, which visits every
+ * group when the number of groups is a power of two.  The search ends
+ * at the first group containing an empty slot: removals only ever
+ * leave an empty slot behind in a group that already contained one,
+ * so no key can have been placed beyond such a group. */
+
+static unsigned int hash_table_oa_find(HashTable *hash_table,
+                                       HashTableKey key,
+                                       unsigned int hash)
+{
+	const unsigned char *ctrl;
+	unsigned int num_groups;
+	unsigned int group;
+	unsigned int step;
+	unsigned int mask;
+	unsigned int index;
+
+	num_groups = hash_table->table_size / HASH_TABLE_GROUP_WIDTH;
+	group = (hash >> 7) & (num_groups - 1);
+
+	for (step=1; step<=num_groups; ++step) {
+		ctrl = hash_table->ctrl + group * HASH_TABLE_GROUP_WIDTH;
+
+		/* Check all slots with a matching control byte */
+
+		mask = hash_table_group_match(ctrl,
+		                              (unsigned char) (hash & 0x7f));
+
+		while (mask != 0) {
+			index = group * HASH_TABLE_GROUP_WIDTH
+			      + hash_table_first_bit(mask);
+			mask &= mask - 1;
+
+			if (hash_table->hashes != NULL
+			 && hash_table->hashes[index] != hash) {
+				continue;
+			}
+
+			if (hash_table->equal_func(key,
+			                           hash_table->slots[index].key)) {
+				return index;
+			}
+		}
+
+		/* An empty slot means the key is not in the table */
+
+		if (hash_table_group_match(ctrl, HASH_TABLE_CTRL_EMPTY) != 0) {
+			break;
+		}
+
+		group = (group + step) & (num_groups - 1);
+	}
+
+	return hash_table->table_size;
+}
+
+/* Find a free slot in which to store a new entry with the given hash. */
+
+static unsigned int hash_table_oa_find_free(HashTable *hash_table,
+                                            unsigned int hash)
+{
+	unsigned int num_groups;
+	unsigned int group;
+	unsigned int step;
+	unsigned int mask;
+
+	num_groups = hash_table->table_size / HASH_TABLE_GROUP_WIDTH;
+	group = (hash >> 7) & (num_groups - 1);
+
+	/* The load factor is limited, so there is always a free slot */
+
+	for (step=1;; ++step) {
+		mask = hash_table_group_match_free(
+		    hash_table->ctrl + group * HASH_TABLE_GROUP_WIDTH);
+
+		if (mask != 0) {
+			return group * HASH_TABLE_GROUP_WIDTH
+			     + hash_table_first_bit(mask);
+		}
+
+		group = (group + step) & (num_groups - 1);
+	}
+}
+
+/* Rebuild an open addressing table.  The table doubles in size if it
+ * is more than half full of live entries; otherwise it is rebuilt at
+ * the same size to clear out deleted slots. */
+
+static int hash_table_oa_resize(HashTable *hash_table)
+{
+	HashTablePair *old_slots;
+	unsigned char *old_ctrl;
+	unsigned int *old_hashes;
+	unsigned int old_table_size;
+	unsigned int new_table_size;
+	unsigned int hash;
+	unsigned int index;
+	unsigned int i;
+
+	old_slots = hash_table->slots;
+	old_ctrl = hash_table->ctrl;
+	old_hashes = hash_table->hashes;
+	old_table_size = hash_table->table_size;
+
+	new_table_size = old_table_size;
+
+	if (hash_table->entries >= old_table_size / 16 * 7) {
+		new_table_size *= 2;
+
+		if (new_table_size < old_table_size) {
+			return 0;
+		}
+	}
+
+	/* On failure, the existing table is left untouched */
+
+	if (!hash_table_oa_allocate_table(hash_table, new_table_size)) {
+		return 0;
+	}
+
+	/* Copy all entries into the new table */
+
+	for (i=0; i<old_table_size; ++i) {
+		if ((old_ctrl[i] & 0x80) != 0) {
+			continue;
+		}
+
+		if (old_hashes != NULL) {
+			hash = old_hashes[i];
+			index = hash_table_oa_find_free(hash_table, hash);
+			hash_table->hashes[index] = hash;
+		} else {
+			hash = hash_table_oa_mix(
+			    hash_table->hash_func(old_slots[i].key));
+			index = hash_table_oa_find_free(hash_table, hash);
+		}
+
+		hash_table->ctrl[index] = (unsigned char) (hash & 0x7f);
+		hash_table->slots[index] = old_slots[i];
+	}
+
+	free(old_slots);
+
+	return 1;
+}
+
+static int hash_table_oa_insert(HashTable *hash_table, HashTableKey key,
+                                HashTableValue value)
+{
+	HashTablePair *pair;
+	unsigned int hash;
+	unsigned int index;
+
+	hash = hash_table_oa_mix(hash_table->hash_func(key));
+
+	/* If there is an existing entry with the same key, overwrite it */
+
+	index = hash_table_oa_find(hash_table, key, hash);
+
+	if (index < hash_table->table_size) {
+		pair = &hash_table->slots[index];
+
+		if (hash_table->value_free_func != NULL) {
+			hash_table->value_free_func(pair->value);
+		}
+		if (hash_table->key_free_func != NULL) {
+			hash_table->key_free_func(pair->key);
+		}
+
+		pair->key = key;
+		pair->value = value;
+
+		return 1;
+	}
+
+	/* Limit the load factor (including deleted slots) to 7/8 */
+
+	if (hash_table->entries + hash_table->deleted + 1
+	    > hash_table->table_size / 8 * 7) {
+		if (!hash_table_oa_resize(hash_table)) {
+			return 0;
+		}
+	}
+
+	/* Store in a free slot */
+
+	index = hash_table_oa_find_free(hash_table, hash);
+
+	if (hash_table->ctrl[index] == HASH_TABLE_CTRL_DELETED) {
+		--hash_table->deleted;
+	}
+
+	hash_table->ctrl[index] = (unsigned char) (hash & 0x7f);
+	hash_table->slots[index].key = key;
+	hash_table->slots[index].value = value;
+
+	if (hash_table->hashes != NULL) {
+		hash_table->hashes[index] = hash;
+	}
+
+	++hash_table->entries;
+
+	return 1;
+}
+
+static HashTableValue hash_table_oa_lookup(HashTable *hash_table,
+                                           HashTableKey key)
+{
+	unsigned int hash;
+	unsigned int index;
+
+	hash = hash_table_oa_mix(hash_table->hash_func(key));
+	index = hash_table_oa_find(hash_table, key, hash);
+
+	if (index < hash_table->table_size) {
+		return hash_table->slots[index].value;
+	}
+
+	return HASH_TABLE_NULL;
+}
+
+static int hash_table_oa_remove(HashTable *hash_table, HashTableKey key)
+{
+	unsigned char *group;
+	unsigned int hash;
+	unsigned int index;
+
+	hash = hash_table_oa_mix(hash_table->hash_func(key));
+	index = hash_table_oa_find(hash_table, key, hash);
+
+	if (index >= hash_table->table_size) {
+		return 0;
+	}
+
+	hash_table_free_pair(hash_table, &hash_table->slots[index]);
+
+	/* If the group already contains an empty slot, no search can
+	 * have continued past it and the slot can be marked as empty.
+	 * Otherwise, a tombstone must be left so that searches for keys
+	 * stored further along the probe sequence still find them. */
+
+	group = hash_table->ctrl
+	      + (index & ~(unsigned int) (HASH_TABLE_GROUP_WIDTH - 1));
+
+	if (hash_table_group_match(group, HASH_TABLE_CTRL_EMPTY) != 0) {
+		hash_table->ctrl[index] = HASH_TABLE_CTRL_EMPTY;
+	} else {
+		hash_table->ctrl[index] = HASH_TABLE_CTRL_DELETED;
+		++hash_table->deleted;
+	}
+
+	--hash_table->entries;
+
+	return 1;
+}
+
+/* Find the next slot in use, starting from the given index. */
+
+static unsigned int hash_table_oa_next_slot(HashTable *hash_table,
+                                            unsigned int index)
+{
+	while (index < hash_table->table_size
+	    && (hash_table->ctrl[index] & 0x80) != 0) {
+		++index;
+	}
+
+	return index;
 }
 
 HashTable *hash_table_new(HashTableHashFunc hash_func,
                           HashTableEqualFunc equal_func)
+{
+	return hash_table_new_full(hash_func, equal_func, 0);
+}
+
+HashTable *hash_table_new_full(HashTableHashFunc hash_func,
+                               HashTableEqualFunc equal_func,
+                               unsigned int flags)
+{
+	return hash_table_new_with_allocator(hash_func, equal_func,
+	                                     flags, NULL);
+}
+
+HashTable *hash_table_new_with_allocator(HashTableHashFunc hash_func,
+                                         HashTableEqualFunc equal_func,
+                                         unsigned int flags,
+                                         Allocator *allocator)
 {
 	HashTable *hash_table;
+	int success;
 
 	/* Allocate a new hash table structure */
 
@@ -135,10 +627,27 @@ HashTable *hash_table_new(HashTableHashFunc hash_func,
 	hash_table->value_free_func = NULL;
 	hash_table->entries = 0;
 	hash_table->prime_index = 0;
+	hash_table->flags = flags;
+	hash_table->table = NULL;
+	hash_table->ctrl = NULL;
+	hash_table->slots = NULL;
+	hash_table->hashes = NULL;
+	hash_table->deleted = 0;
+	hash_table->old_table = NULL;
+	hash_table->old_table_size = 0;
+	hash_table->resize_index = 0;
+	hash_table->allocator = allocator;
 
 	/* Allocate the table */
 
-	if (!hash_table_allocate_table(hash_table)) {
+	if ((flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		success = hash_table_oa_allocate_table(hash_table,
+		                                       HASH_TABLE_MIN_CAPACITY);
+	} else {
+		success = hash_table_allocate_table(hash_table);
+	}
+
+	if (!success) {
 		free(hash_table);
 
 		return NULL;
@@ -147,22 +656,58 @@ HashTable *hash_table_new(HashTableHashFunc hash_func,
 	return hash_table;
 }
 
-void hash_table_free(HashTable *hash_table)
+/* Free all entries in a table of chains */
+
+static void hash_table_free_chains(HashTable *hash_table,
+                                   HashTableEntry **table,
+                                   unsigned int table_size)
 {
 	HashTableEntry *rover;
 	HashTableEntry *next;
 	unsigned int i;
 
-	/* Free all entries in all chains */
-
-	for (i=0; i<hash_table->table_size; ++i) {
-		rover = hash_table->table[i];
+	for (i=0; i<table_size; ++i) {
+		rover = table[i];
 		while (rover != NULL) {
 			next = rover->next;
 			hash_table_free_entry(hash_table, rover);
 			rover = next;
 		}
 	}
+}
+
+void hash_table_free(HashTable *hash_table)
+{
+	unsigned int i;
+
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+
+		/* Free all entries in the slot array */
+
+		for (i=0; i<hash_table->table_size; ++i) {
+			if ((hash_table->ctrl[i] & 0x80) == 0) {
+				hash_table_free_pair(hash_table,
+				                     &hash_table->slots[i]);
+			}
+		}
+
+		free(hash_table->slots);
+		free(hash_table);
+
+		return;
+	}
+
+	/* Free all entries in all chains, including those not yet moved
+	 * out of the old table if a resize is in progress */
+
+	hash_table_free_chains(hash_table, hash_table->table,
+	                       hash_table->table_size);
+
+	if (hash_table->old_table != NULL) {
+		hash_table_free_chains(hash_table, hash_table->old_table,
+		                       hash_table->old_table_size);
+		free(hash_table->old_table);
+	}
 
 	/* Free the table */
 
@@ -181,18 +726,76 @@ void hash_table_register_free_functions(HashTable *hash_table,
 	hash_table->value_free_func = value_free_func;
 }
 
+/* Link all entries from a chain into the (new) table */
+
+static void hash_table_move_chain(HashTable *hash_table, HashTableEntry *rover)
+{
+	HashTableEntry *next;
+	unsigned int index;
+
+	while (rover != NULL) {
+		next = rover->next;
+
+		/* Find the index into the new table.  If the hash
+		 * was cached, there is no need to generate it again. */
+
+		if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0) {
+			index = rover->hash % hash_table->table_size;
+		} else {
+			index = hash_table->hash_func(rover->pair.key)
+			      % hash_table->table_size;
+		}
+
+		/* Link this entry into the chain */
+
+		rover->next = hash_table->table[index];
+		hash_table->table[index] = rover;
+
+		/* Advance to next in the chain */
+
+		rover = next;
+	}
+}
+
+/* When resizing incrementally, move up to count chains from the old
+ * table into the new table.  The old table is freed once it is empty. */
+
+static void hash_table_resize_step(HashTable *hash_table, unsigned int count)
+{
+	unsigned int index;
+
+	while (count > 0
+	    && hash_table->resize_index < hash_table->old_table_size) {
+		index = hash_table->resize_index;
+
+		hash_table_move_chain(hash_table, hash_table->old_table[index]);
+		hash_table->old_table[index] = NULL;
+
+		++hash_table->resize_index;
+		--count;
+	}
+
+	if (hash_table->resize_index >= hash_table->old_table_size) {
+		free(hash_table->old_table);
+		hash_table->old_table = NULL;
+		hash_table->old_table_size = 0;
+	}
+}
 
 static int hash_table_enlarge(HashTable *hash_table)
 {
 	HashTableEntry **old_table;
 	unsigned int old_table_size;
 	unsigned int old_prime_index;
-	HashTableEntry *rover;
-	HashTablePair *pair;
-	HashTableEntry *next;
-	unsigned int index;
 	unsigned int i;
 
+	/* If an incremental resize is still in progress, it must be
+	 * completed before starting another one */
+
+	if (hash_table->old_table != NULL) {
+		hash_table_resize_step(hash_table, hash_table->old_table_size);
+	}
+
 	/* Store a copy of the old table */
 
 	old_table = hash_table->table;
@@ -214,48 +817,90 @@ static int hash_table_enlarge(HashTable *hash_table)
 		return 0;
 	}
 
-	/* Link all entries from all chains into the new table */
+	/* With incremental resizing, keep the old table around and move
+	 * its entries across a few chains at a time on later inserts */
 
-	for (i=0; i<old_table_size; ++i) {
-		rover = old_table[i];
+	if ((hash_table->flags & HASH_TABLE_INCREMENTAL_RESIZE) != 0) {
+		hash_table->old_table = old_table;
+		hash_table->old_table_size = old_table_size;
+		hash_table->resize_index = 0;
 
-		while (rover != NULL) {
-			next = rover->next;
+		return 1;
+	}
 
-			/* Fetch rover HashTablePair */
+	/* Link all entries from all chains into the new table */
+
+	for (i=0; i<old_table_size; ++i) {
+		hash_table_move_chain(hash_table, old_table[i]);
+	}
 
-			pair = &(rover->pair);
+	/* Free the old table */
 
-			/* Find the index into the new table */
+	free(old_table);
 
-			index = hash_table->hash_func(pair->key) % hash_table->table_size;
+	return 1;
+}
 
-			/* Link this entry into the chain */
+/* Find the entry for a key.  Returns a pointer to the link which points
+ * at the entry (ie. the entry in the table, or the "next" pointer of the
+ * previous entry in the chain), which allows the entry to be unlinked,
+ * or NULL if the key is not in the hash table.  If an incremental
+ * resize is in progress, the entry may be in either table. */
 
-			rover->next = hash_table->table[index];
-			hash_table->table[index] = rover;
+static HashTableEntry **hash_table_find_entry(HashTable *hash_table,
+                                              HashTableKey key,
+                                              unsigned int hash)
+{
+	HashTableEntry **rover;
+	unsigned int index;
 
-			/* Advance to next in the chain */
+	index = hash % hash_table->table_size;
+	rover = &hash_table->table[index];
 
-			rover = next;
+	while (*rover != NULL) {
+		if (hash_table_entry_has_key(hash_table, *rover, key, hash)) {
+			return rover;
 		}
+
+		rover = &((*rover)->next);
 	}
 
-	/* Free the old table */
+	if (hash_table->old_table != NULL) {
+		index = hash % hash_table->old_table_size;
+		rover = &hash_table->old_table[index];
 
-	free(old_table);
+		while (*rover != NULL) {
+			if (hash_table_entry_has_key(hash_table, *rover,
+			                             key, hash)) {
+				return rover;
+			}
 
-	return 1;
+			rover = &((*rover)->next);
+		}
+	}
+
+	return NULL;
 }
 
 int hash_table_insert(HashTable *hash_table, HashTableKey key,
                       HashTableValue value)
 {
-	HashTableEntry *rover;
+	HashTableEntry **rover;
 	HashTablePair *pair;
 	HashTableEntry *newentry;
+	unsigned int hash;
 	unsigned int index;
 
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		return hash_table_oa_insert(hash_table, key, value);
+	}
+
+	/* Continue any incremental resize in progress */
+
+	if (hash_table->old_table != NULL) {
+		hash_table_resize_step(hash_table, HASH_TABLE_RESIZE_STEP);
+	}
+
 	/* If there are too many items in the table with respect to the table
 	 * size, the number of hash collisions increases and performance
 	 * decreases. Enlarge the table size to prevent this happening */
@@ -272,53 +917,44 @@ int hash_table_insert(HashTable *hash_table, HashTableKey key,
 		}
 	}
 
-	/* Generate the hash of the key and hence the index into the table */
-
-	index = hash_table->hash_func(key) % hash_table->table_size;
-
-	/* Traverse the chain at this location and look for an existing
-	 * entry with the same key */
-
-	rover = hash_table->table[index];
-
-	while (rover != NULL) {
-
-		/* Fetch rover's HashTablePair entry */
+	/* Generate the hash of the key and look for an existing entry
+	 * with the same key */
 
-		pair = &(rover->pair);
+	hash = hash_table->hash_func(key);
+	rover = hash_table_find_entry(hash_table, key, hash);
 
-		if (hash_table->equal_func(pair->key, key) != 0) {
+	if (rover != NULL) {
 
-			/* Same key: overwrite this entry with new data */
+		/* Same key: overwrite this entry with new data */
 
-			/* If there is a value free function, free the old data
-			 * before adding in the new data */
+		pair = &((*rover)->pair);
 
-			if (hash_table->value_free_func != NULL) {
-				hash_table->value_free_func(pair->value);
-			}
+		/* If there is a value free function, free the old data
+		 * before adding in the new data */
 
-			/* Same with the key: use the new key value and free
-			 * the old one */
+		if (hash_table->value_free_func != NULL) {
+			hash_table->value_free_func(pair->value);
+		}
 
-			if (hash_table->key_free_func != NULL) {
-				hash_table->key_free_func(pair->key);
-			}
+		/* Same with the key: use the new key value and free
+		 * the old one */
 
-			pair->key = key;
-			pair->value = value;
+		if (hash_table->key_free_func != NULL) {
+			hash_table->key_free_func(pair->key);
+		}
 
-			/* Finished */
+		pair->key = key;
+		pair->value = value;
 
-			return 1;
-		}
+		/* Finished */
 
-		rover = rover->next;
+		return 1;
 	}
 
-	/* Not in the hash table yet.  Create a new entry */
+	/* Not in the hash table yet.  Create a new entry. */
 
-	newentry = (HashTableEntry *) malloc(sizeof(HashTableEntry));
+	newentry = (HashTableEntry *) allocator_alloc(
+	    hash_table->allocator, hash_table_entry_size(hash_table));
 
 	if (newentry == NULL) {
 		return 0;
@@ -327,7 +963,13 @@ int hash_table_insert(HashTable *hash_table, HashTableKey key,
 	newentry->pair.key = key;
 	newentry->pair.value = value;
 
-	/* Link into the list */
+	if ((hash_table->flags & HASH_TABLE_CACHE_HASHES) != 0) {
+		newentry->hash = hash;
+	}
+
+	/* Link into the list.  New entries always go into the new table. */
+
+	index = hash % hash_table->table_size;
 
 	newentry->next = hash_table->table[index];
 	hash_table->table[index] = newentry;
@@ -343,30 +985,22 @@ int hash_table_insert(HashTable *hash_table, HashTableKey key,
 
 HashTableValue hash_table_lookup(HashTable *hash_table, HashTableKey key)
 {
-	HashTableEntry *rover;
-	HashTablePair *pair;
-	unsigned int index;
-
-	/* Generate the hash of the key and hence the index into the table */
-
-	index = hash_table->hash_func(key) % hash_table->table_size;
-
-	/* Walk the chain at this index until the corresponding entry is
-	 * found */
+	HashTableEntry **rover;
 
-	rover = hash_table->table[index];
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		return hash_table_oa_lookup(hash_table, key);
+	}
 
-	while (rover != NULL) {
-		pair = &(rover->pair);
+	/* Generate the hash of the key and search for the entry */
 
-		if (hash_table->equal_func(key, pair->key) != 0) {
+	rover = hash_table_find_entry(hash_table, key,
+	                              hash_table->hash_func(key));
 
-			/* Found the entry.  Return the data. */
+	if (rover != NULL) {
 
-			return pair->value;
-		}
+		/* Found the entry.  Return the data. */
 
-		rover = rover->next;
+		return (*rover)->pair.value;
 	}
 
 	/* Not found */
@@ -378,55 +1012,37 @@ int hash_table_remove(HashTable *hash_table, HashTableKey key)
 {
 	HashTableEntry **rover;
 	HashTableEntry *entry;
-	HashTablePair *pair;
-	unsigned int index;
-	int result;
-
-	/* Generate the hash of the key and hence the index into the table */
-
-	index = hash_table->hash_func(key) % hash_table->table_size;
-
-	/* Rover points at the pointer which points at the current entry
-	 * in the chain being inspected.  ie. the entry in the table, or
-	 * the "next" pointer of the previous entry in the chain.  This
-	 * allows us to unlink the entry when we find it. */
-
-	result = 0;
-	rover = &hash_table->table[index];
-
-	while (*rover != NULL) {
-
-		pair = &((*rover)->pair);
 
-		if (hash_table->equal_func(key, pair->key) != 0) {
-
-			/* This is the entry to remove */
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		return hash_table_oa_remove(hash_table, key);
+	}
 
-			entry = *rover;
+	/* Generate the hash of the key and search for the entry */
 
-			/* Unlink from the list */
+	rover = hash_table_find_entry(hash_table, key,
+	                              hash_table->hash_func(key));
 
-			*rover = entry->next;
+	if (rover == NULL) {
+		return 0;
+	}
 
-			/* Destroy the entry structure */
+	/* This is the entry to remove */
 
-			hash_table_free_entry(hash_table, entry);
+	entry = *rover;
 
-			/* Track count of entries */
+	/* Unlink from the list */
 
-			--hash_table->entries;
+	*rover = entry->next;
 
-			result = 1;
+	/* Destroy the entry structure */
 
-			break;
-		}
+	hash_table_free_entry(hash_table, entry);
 
-		/* Advance to the next entry */
+	/* Track count of entries */
 
-		rover = &((*rover)->next);
-	}
+	--hash_table->entries;
 
-	return result;
+	return 1;
 }
 
 unsigned int hash_table_num_entries(HashTable *hash_table)
@@ -434,8 +1050,23 @@ unsigned int hash_table_num_entries(HashTable *hash_table)
 	return hash_table->entries;
 }
 
+/* Get the head of a chain, for iteration.  Chain numbers beyond the end
+ * of the table refer to the old table, if an incremental resize is in
+ * progress. */
+
+static HashTableEntry *hash_table_chain(HashTable *hash_table,
+                                        unsigned int chain)
+{
+	if (chain < hash_table->table_size) {
+		return hash_table->table[chain];
+	} else {
+		return hash_table->old_table[chain - hash_table->table_size];
+	}
+}
+
 void hash_table_iterate(HashTable *hash_table, HashTableIterator *iterator)
 {
+	unsigned int num_chains;
 	unsigned int chain;
 
 	iterator->hash_table = hash_table;
@@ -444,12 +1075,22 @@ void hash_table_iterate(HashTable *hash_table, HashTableIterator *iterator)
 
 	iterator->next_entry = NULL;
 
+	/* With open addressing, next_chain holds the index of the next
+	 * slot in use. */
+
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		iterator->next_chain = hash_table_oa_next_slot(hash_table, 0);
+		return;
+	}
+
 	/* Find the first entry */
 
-	for (chain=0; chain<hash_table->table_size; ++chain) {
+	num_chains = hash_table->table_size + hash_table->old_table_size;
+
+	for (chain=0; chain<num_chains; ++chain) {
 
-		if (hash_table->table[chain] != NULL) {
-			iterator->next_entry = hash_table->table[chain];
+		if (hash_table_chain(hash_table, chain) != NULL) {
+			iterator->next_entry = hash_table_chain(hash_table, chain);
 			iterator->next_chain = chain;
 			break;
 		}
@@ -458,6 +1099,14 @@ void hash_table_iterate(HashTable *hash_table, HashTableIterator *iterator)
 
 int hash_table_iter_has_more(HashTableIterator *iterator)
 {
+	HashTable *hash_table;
+
+	hash_table = iterator->hash_table;
+
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		return iterator->next_chain < hash_table->table_size;
+	}
+
 	return iterator->next_entry != NULL;
 }
 
@@ -466,10 +1115,23 @@ HashTablePair hash_table_iter_next(HashTableIterator *iterator)
 	HashTableEntry *current_entry;
 	HashTable *hash_table;
 	HashTablePair pair = {NULL, NULL};
+	unsigned int num_chains;
 	unsigned int chain;
 
 	hash_table = iterator->hash_table;
 
+	if ((hash_table->flags & HASH_TABLE_OPEN_ADDRESSING) != 0) {
+		if (iterator->next_chain >= hash_table->table_size) {
+			return pair;
+		}
+
+		pair = hash_table->slots[iterator->next_chain];
+		iterator->next_chain = hash_table_oa_next_slot(
+		    hash_table, iterator->next_chain + 1);
+
+		return pair;
+	}
+
 	if (iterator->next_entry == NULL) {
 		return pair;
 	}
@@ -492,17 +1154,19 @@ HashTablePair hash_table_iter_next(HashTableIterator *iterator)
 		/* None left in this chain, so advance to the next chain */
 
 		chain = iterator->next_chain + 1;
+		num_chains = hash_table->table_size + hash_table->old_table_size;
 
 		/* Default value if no next chain found */
 
 		iterator->next_entry = NULL;
 
-		while (chain < hash_table->table_size) {
+		while (chain < num_chains) {
 
 			/* Is there anything in this chain? */
 
-			if (hash_table->table[chain] != NULL) {
-				iterator->next_entry = hash_table->table[chain];
+			if (hash_table_chain(hash_table, chain) != NULL) {
+				iterator->next_entry
+				    = hash_table_chain(hash_table, chain);
 				break;
 			}
 
@@ -516,4 +1180,3 @@ HashTablePair hash_table_iter_next(HashTableIterator *iterator)
 
 	return pair;
 }
-
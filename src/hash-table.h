@@ -30,6 +30,12 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * To create a hash table, use @ref hash_table_new.  To destroy a
  * hash table, use @ref hash_table_free.
  *
+ * By default, a hash table resolves collisions by chaining entries
+ * into linked lists.  An alternative open addressing implementation,
+ * which stores entries in a single flat array and avoids an allocation
+ * for every entry, can be selected by passing
+ * @ref HASH_TABLE_OPEN_ADDRESSING to @ref hash_table_new_full.
+ *
  * To insert a value into a hash table, use @ref hash_table_insert.
  *
  * To remove a value from a hash table, use @ref hash_table_remove.
@@ -45,6 +51,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #ifndef ALGORITHM_HASH_TABLE_H
 #define ALGORITHM_HASH_TABLE_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -138,6 +146,42 @@ typedef void (*HashTableKeyFreeFunc)(HashTableKey value);
 
 typedef void (*HashTableValueFreeFunc)(HashTableValue value);
 
+/**
+ * Flags that can be passed to @ref hash_table_new_full to select
+ * the implementation used by a hash table.
+ */
+
+typedef enum {
+
+	/** Use open addressing rather than separate chaining.  Entries
+	 *  are stored in a flat array with a power of two size, and
+	 *  a separate array of control bytes is used to probe groups
+	 *  of 16 entries at a time (using SSE2 where available). */
+
+	HASH_TABLE_OPEN_ADDRESSING = 1 << 0,
+
+	/** Store the hash of each key alongside the entry.  When looking
+	 *  up a key, the equal function is only called for entries with
+	 *  a matching hash, and the hash function is never called again
+	 *  for keys already in the table when it is resized.  This costs
+	 *  extra memory per entry, but is worthwhile when the hash and
+	 *  equal functions are expensive (for example, with string
+	 *  keys). */
+
+	HASH_TABLE_CACHE_HASHES = 1 << 1,
+
+	/** Resize the table incrementally.  When the table is enlarged,
+	 *  the old table is kept and entries are moved into the new
+	 *  table a few chains at a time on each subsequent insert,
+	 *  rather than all at once.  This bounds the time taken by any
+	 *  single insert, regardless of the size of the table.  Only
+	 *  applies to chained tables; it has no effect when combined
+	 *  with @ref HASH_TABLE_OPEN_ADDRESSING. */
+
+	HASH_TABLE_INCREMENTAL_RESIZE = 1 << 2
+
+} HashTableFlags;
+
 /**
  * Create a new hash table.
  *
@@ -153,6 +197,48 @@ typedef void (*HashTableValueFreeFunc)(HashTableValue value);
 HashTable *hash_table_new(HashTableHashFunc hash_func,
                           HashTableEqualFunc equal_func);
 
+/**
+ * Create a new hash table, specifying flags to control the
+ * implementation used.
+ *
+ * @param hash_func            Function used to generate hash keys for the
+ *                             keys used in the table.
+ * @param equal_func           Function used to test keys used in the table
+ *                             for equality.
+ * @param flags                Bitwise OR of @ref HashTableFlags values,
+ *                             or zero for the default behavior.
+ * @return                     A new hash table structure, or NULL if it
+ *                             was not possible to allocate the new hash
+ *                             table.
+ */
+
+HashTable *hash_table_new_full(HashTableHashFunc hash_func,
+                               HashTableEqualFunc equal_func,
+                               unsigned int flags);
+
+/**
+ * Create a new hash table, using a custom allocator for its entries.
+ * Open addressing tables store their entries in a single array and
+ * do not use the allocator.
+ *
+ * @param hash_func            Function used to generate hash keys for the
+ *                             keys used in the table.
+ * @param equal_func           Function used to test keys used in the table
+ *                             for equality.
+ * @param flags                Bitwise OR of @ref HashTableFlags values,
+ *                             or zero for the default behavior.
+ * @param allocator            The allocator to use, or NULL to use
+ *                             malloc().
+ * @return                     A new hash table structure, or NULL if it
+ *                             was not possible to allocate the new hash
+ *                             table.
+ */
+
+HashTable *hash_table_new_with_allocator(HashTableHashFunc hash_func,
+                                         HashTableEqualFunc equal_func,
+                                         unsigned int flags,
+                                         Allocator *allocator);
+
 /**
  * Destroy a hash table.
  *
@@ -29,18 +29,27 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <libcalg/hash-pointer.h>
 #include <libcalg/hash-string.h>
 
+#include <libcalg/allocator.h>
+#include <libcalg/slab-allocator.h>
+
 #include <libcalg/arraylist.h>
 #include <libcalg/avl-tree.h>
 #include <libcalg/binary-heap.h>
 #include <libcalg/binomial-heap.h>
 #include <libcalg/bloom-filter.h>
+#include <libcalg/bplus-tree.h>
+#include <libcalg/concurrent-queue.h>
+#include <libcalg/counting-bloom-filter.h>
+#include <libcalg/cuckoo-filter.h>
 #include <libcalg/hash-table.h>
 #include <libcalg/list.h>
+#include <libcalg/pairing-heap.h>
 #include <libcalg/queue.h>
 #include <libcalg/rb-tree.h>
 #include <libcalg/set.h>
 #include <libcalg/slist.h>
 #include <libcalg/trie.h>
+#include <libcalg/work-stealing-deque.h>
 #include <libcalg/sortedarray.h>
 
 #endif /* #ifndef LIBCALG_H */
@@ -366,112 +366,102 @@ unsigned int list_remove_data(ListEntry **list, ListEqualFunc callback,
 	return entries_removed;
 }
 
-/* Function used internally for sorting.  Returns the last entry in the
- * new sorted list */
+/* Lists are sorted using a bottom-up merge sort.  On each pass, the
+ * list is treated as a sequence of sorted runs of a given size, which
+ * are merged together in pairs; the run size doubles every pass until
+ * a single run remains.  Entries are relinked in place, so no extra
+ * memory is needed and nothing recurses.  When values compare equal,
+ * the entry from the earlier run is taken first, so the sort is
+ * stable.  The prev links are rebuilt as entries are appended to
+ * the merged list. */
 
-static ListEntry *list_sort_internal(ListEntry **list,
-                                     ListCompareFunc compare_func)
+void list_sort(ListEntry **list, ListCompareFunc compare_func)
 {
-	ListEntry *pivot;
-	ListEntry *rover;
-	ListEntry *less_list, *more_list;
-	ListEntry *less_list_end, *more_list_end;
-
-	if (list == NULL || compare_func == NULL) {
-		return NULL;
-	}
-
-	/* If there are less than two entries in this list, it is
-	 * already sorted */
+	ListEntry *left, *right;
+	ListEntry *entry;
+	ListEntry *tail;
+	unsigned int run_size;
+	unsigned int left_size, right_size;
+	unsigned int num_merges;
+	unsigned int i;
+	int take_left;
 
-	if (*list == NULL || (*list)->next == NULL) {
-		return *list;
+	if (list == NULL || compare_func == NULL || *list == NULL) {
+		return;
 	}
 
-	/* The first entry is the pivot */
+	for (run_size = 1; ; run_size *= 2) {
 
-	pivot = *list;
+		left = *list;
+		tail = NULL;
+		num_merges = 0;
 
-	/* Iterate over the list, starting from the second entry.  Sort
-	 * all entries into the less and more lists based on comparisons
-	 * with the pivot */
+		while (left != NULL) {
 
-	less_list = NULL;
-	more_list = NULL;
-	rover = (*list)->next;
+			++num_merges;
 
-	while (rover != NULL) {
-		ListEntry *next = rover->next;
-
-		if (compare_func(rover->data, pivot->data) < 0) {
+			/* Find the start of the right hand run */
 
-			/* Place this in the less list */
+			right = left;
+			left_size = 0;
 
-			rover->prev = NULL;
-			rover->next = less_list;
-			if (less_list != NULL) {
-				less_list->prev = rover;
+			for (i=0; i<run_size && right != NULL; ++i) {
+				++left_size;
+				right = right->next;
 			}
-			less_list = rover;
-
-		} else {
-
-			/* Place this in the more list */
 
-			rover->prev = NULL;
-			rover->next = more_list;
-			if (more_list != NULL) {
-				more_list->prev = rover;
+			right_size = run_size;
+
+			/* Merge the two runs onto the tail of the list */
+
+			while (left_size > 0
+			    || (right_size > 0 && right != NULL)) {
+
+				if (left_size == 0) {
+					take_left = 0;
+				} else if (right_size == 0 || right == NULL) {
+					take_left = 1;
+				} else {
+					take_left = compare_func(right->data,
+					                         left->data) >= 0;
+				}
+
+				if (take_left) {
+					entry = left;
+					left = left->next;
+					--left_size;
+				} else {
+					entry = right;
+					right = right->next;
+					--right_size;
+				}
+
+				if (tail == NULL) {
+					*list = entry;
+				} else {
+					tail->next = entry;
+				}
+
+				entry->prev = tail;
+				tail = entry;
 			}
-			more_list = rover;
-		}
-
-		rover = next;
-	}
 
-	/* Sort the sublists recursively */
+			/* Continue from the entry following the right run */
 
-	less_list_end = list_sort_internal(&less_list, compare_func);
-	more_list_end = list_sort_internal(&more_list, compare_func);
-
-	/* Create the new list starting from the less list */
-
-	*list = less_list;
-
-	/* Append the pivot to the end of the less list.  If the less list
-	 * was empty, start from the pivot */
-
-	if (less_list == NULL) {
-		pivot->prev = NULL;
-		*list = pivot;
-	} else {
-		pivot->prev = less_list_end;
-		less_list_end->next = pivot;
-	}
+			left = right;
+		}
 
-	/* Append the more list after the pivot */
+		tail->next = NULL;
 
-	pivot->next = more_list;
-	if (more_list != NULL) {
-		more_list->prev = pivot;
-	}
+		/* Once a pass makes only a single merge, the whole list is
+		 * one sorted run */
 
-	/* Work out what the last entry in the list is.  If the more list was
-	 * empty, the pivot was the last entry.  Otherwise, the end of the
-	 * more list is the end of the total list. */
-
-	if (more_list == NULL) {
-		return pivot;
-	} else {
-		return more_list_end;
+		if (num_merges <= 1) {
+			break;
+		}
 	}
 }
 
-void list_sort(ListEntry **list, ListCompareFunc compare_func)
-{
-	list_sort_internal(list, compare_func);
-}
-
 ListEntry *list_find_data(ListEntry *list,
                           ListEqualFunc callback,
                           ListValue data)
@@ -256,6 +256,10 @@ unsigned int list_remove_data(ListEntry **list, ListEqualFunc callback,
 /**
  * Sort a list.
  *
+ * A merge sort is used, so the sort is stable (entries with values that
+ * compare equal keep their original order) and takes O(n log n) time
+ * without using any extra memory.
+ *
  * @param list          Pointer to the list to sort.
  * @param compare_func  Function used to compare values in the list.
  */
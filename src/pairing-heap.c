@@ -0,0 +1,334 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+
+#include "pairing-heap.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* Each value is stored in a node, which also serves as its handle.  The
+ * children of a node are stored in a doubly linked list.  prev points to
+ * the previous sibling, or to the parent for the first child. */
+
+typedef struct _PairingHeapHandle PairingHeapNode;
+
+struct _PairingHeapHandle {
+	PairingHeapValue value;
+	PairingHeapNode *child;
+	PairingHeapNode *sibling;
+	PairingHeapNode *prev;
+};
+
+struct _PairingHeap {
+	PairingHeapType heap_type;
+	PairingHeapCompareFunc compare_func;
+	unsigned int num_values;
+	PairingHeapNode *root;
+};
+
+static int pairing_heap_cmp(PairingHeap *heap,
+                            PairingHeapValue data1,
+                            PairingHeapValue data2)
+{
+	if (heap->heap_type == PAIRING_HEAP_TYPE_MIN) {
+		return heap->compare_func(data1, data2);
+	} else {
+		return -(heap->compare_func(data1, data2));
+	}
+}
+
+/* Link two trees, making the one with the greater root the first child
+ * of the other.  Returns the new root.  Either tree may be NULL. */
+
+static PairingHeapNode *pairing_heap_link(PairingHeap *heap,
+                                          PairingHeapNode *node1,
+                                          PairingHeapNode *node2)
+{
+	PairingHeapNode *tmp;
+
+	if (node1 == NULL) {
+		return node2;
+	} else if (node2 == NULL) {
+		return node1;
+	}
+
+	/* Order node1 and node2 so that node1 has the smallest value */
+
+	if (pairing_heap_cmp(heap, node2->value, node1->value) < 0) {
+		tmp = node1;
+		node1 = node2;
+		node2 = tmp;
+	}
+
+	/* Add node2 to the start of node1's children */
+
+	node2->sibling = node1->child;
+	node2->prev = node1;
+
+	if (node1->child != NULL) {
+		node1->child->prev = node2;
+	}
+
+	node1->child = node2;
+
+	return node1;
+}
+
+/* Combine a list of sibling trees into one tree, using the two-pass
+ * method: link the trees in pairs from left to right, then link the
+ * pairs from right to left.  Returns the new root. */
+
+static PairingHeapNode *pairing_heap_combine(PairingHeap *heap,
+                                             PairingHeapNode *first)
+{
+	PairingHeapNode *pairs;
+	PairingHeapNode *node1;
+	PairingHeapNode *node2;
+	PairingHeapNode *next;
+	PairingHeapNode *result;
+
+	/* First pass: link pairs of trees, building a list of the results
+	 * in reverse order */
+
+	pairs = NULL;
+
+	while (first != NULL) {
+		node1 = first;
+		node2 = first->sibling;
+
+		if (node2 == NULL) {
+			next = NULL;
+		} else {
+			next = node2->sibling;
+			node2->sibling = NULL;
+		}
+
+		node1->sibling = NULL;
+
+		result = pairing_heap_link(heap, node1, node2);
+		result->sibling = pairs;
+		pairs = result;
+
+		first = next;
+	}
+
+	/* Second pass: link the pairs from right to left */
+
+	result = NULL;
+
+	while (pairs != NULL) {
+		next = pairs->sibling;
+		pairs->sibling = NULL;
+		result = pairing_heap_link(heap, result, pairs);
+		pairs = next;
+	}
+
+	if (result != NULL) {
+		result->prev = NULL;
+	}
+
+	return result;
+}
+
+/* Remove a tree which is not the root from its parent */
+
+static void pairing_heap_cut(PairingHeapNode *node)
+{
+	if (node->prev->child == node) {
+		node->prev->child = node->sibling;
+	} else {
+		node->prev->sibling = node->sibling;
+	}
+
+	if (node->sibling != NULL) {
+		node->sibling->prev = node->prev;
+	}
+
+	node->sibling = NULL;
+	node->prev = NULL;
+}
+
+PairingHeap *pairing_heap_new(PairingHeapType heap_type,
+                              PairingHeapCompareFunc compare_func)
+{
+	PairingHeap *heap;
+
+	heap = malloc(sizeof(PairingHeap));
+
+	if (heap == NULL) {
+		return NULL;
+	}
+
+	heap->heap_type = heap_type;
+	heap->compare_func = compare_func;
+	heap->num_values = 0;
+	heap->root = NULL;
+
+	return heap;
+}
+
+void pairing_heap_free(PairingHeap *heap)
+{
+	PairingHeapNode *node;
+	PairingHeapNode *last;
+	PairingHeapNode *next;
+
+	/* Free the nodes in order, without recursing.  The children of each
+	 * node are moved into the list after it before it is freed. */
+
+	node = heap->root;
+
+	while (node != NULL) {
+		if (node->child != NULL) {
+			last = node->child;
+
+			while (last->sibling != NULL) {
+				last = last->sibling;
+			}
+
+			last->sibling = node->sibling;
+			node->sibling = node->child;
+		}
+
+		next = node->sibling;
+		free(node);
+		node = next;
+	}
+
+	free(heap);
+}
+
+PairingHeapHandle *pairing_heap_insert_handle(PairingHeap *heap,
+                                              PairingHeapValue value)
+{
+	PairingHeapNode *node;
+
+	node = malloc(sizeof(PairingHeapNode));
+
+	if (node == NULL) {
+		return NULL;
+	}
+
+	node->value = value;
+	node->child = NULL;
+	node->sibling = NULL;
+	node->prev = NULL;
+
+	heap->root = pairing_heap_link(heap, heap->root, node);
+	++heap->num_values;
+
+	return node;
+}
+
+int pairing_heap_insert(PairingHeap *heap, PairingHeapValue value)
+{
+	return pairing_heap_insert_handle(heap, value) != NULL;
+}
+
+PairingHeapValue pairing_heap_pop(PairingHeap *heap)
+{
+	if (heap->root == NULL) {
+		return PAIRING_HEAP_NULL;
+	}
+
+	return pairing_heap_remove(heap, heap->root);
+}
+
+void pairing_heap_decrease_key(PairingHeap *heap, PairingHeapHandle *handle,
+                               PairingHeapValue value)
+{
+	handle->value = value;
+
+	/* The value can stay where it is if it is the root.  Otherwise,
+	 * move its tree to the top of the heap. */
+
+	if (handle != heap->root) {
+		pairing_heap_cut(handle);
+		heap->root = pairing_heap_link(heap, heap->root, handle);
+	}
+}
+
+void pairing_heap_update(PairingHeap *heap, PairingHeapHandle *handle,
+                         PairingHeapValue value)
+{
+	PairingHeapNode *children;
+
+	/* Remove the node from the heap, leaving its children */
+
+	if (handle == heap->root) {
+		heap->root = NULL;
+	} else {
+		pairing_heap_cut(handle);
+	}
+
+	children = pairing_heap_combine(heap, handle->child);
+	handle->child = NULL;
+
+	/* Put the node and its children back */
+
+	handle->value = value;
+	heap->root = pairing_heap_link(heap, heap->root, children);
+	heap->root = pairing_heap_link(heap, heap->root, handle);
+}
+
+PairingHeapValue pairing_heap_remove(PairingHeap *heap,
+                                     PairingHeapHandle *handle)
+{
+	PairingHeapValue result;
+	PairingHeapNode *children;
+
+	result = handle->value;
+
+	/* Unlink the node, and replace it with its children */
+
+	children = pairing_heap_combine(heap, handle->child);
+
+	if (handle == heap->root) {
+		heap->root = children;
+	} else {
+		pairing_heap_cut(handle);
+		heap->root = pairing_heap_link(heap, heap->root, children);
+	}
+
+	free(handle);
+	--heap->num_values;
+
+	return result;
+}
+
+void pairing_heap_merge(PairingHeap *heap, PairingHeap *other)
+{
+	heap->root = pairing_heap_link(heap, heap->root, other->root);
+	heap->num_values += other->num_values;
+
+	other->root = NULL;
+	other->num_values = 0;
+}
+
+unsigned int pairing_heap_num_entries(PairingHeap *heap)
+{
+	return heap->num_values;
+}
+
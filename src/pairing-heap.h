@@ -0,0 +1,234 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file pairing-heap.h
+ *
+ * @brief Pairing heap.
+ *
+ * A pairing heap is a heap data structure implemented using a
+ * multi-way tree.  In a heap, values are ordered by priority.
+ *
+ * Inserting values and merging two heaps take constant time, and
+ * removing the first value takes logarithmic amortized time.  The
+ * priority of a value can be changed cheaply, which makes pairing heaps
+ * a good choice for algorithms such as Dijkstra's shortest path.
+ *
+ * To create a pairing heap, use @ref pairing_heap_new.  To destroy a
+ * pairing heap, use @ref pairing_heap_free.
+ *
+ * To insert a value into a pairing heap, use @ref pairing_heap_insert.
+ *
+ * To remove the first value from a pairing heap, use @ref pairing_heap_pop.
+ *
+ * To move all the values from one pairing heap into another, use
+ * @ref pairing_heap_merge.
+ *
+ * To change the priority of a value or to remove it from the heap, it
+ * must be inserted using @ref pairing_heap_insert_handle, which returns
+ * a handle to the value.  The priority can then be changed using
+ * @ref pairing_heap_decrease_key or @ref pairing_heap_update, and the
+ * value removed using @ref pairing_heap_remove.
+ */
+
+#ifndef ALGORITHM_PAIRING_HEAP_H
+#define ALGORITHM_PAIRING_HEAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Heap type.  If a heap is a min heap (@ref PAIRING_HEAP_TYPE_MIN), the
+ * values with the lowest priority are stored at the top of the heap and
+ * will be the first returned.  If a heap is a max heap
+ * (@ref PAIRING_HEAP_TYPE_MAX), the values with the greatest priority
+ * are stored at the top of the heap.
+ */
+
+typedef enum {
+	/** A minimum heap. */
+
+	PAIRING_HEAP_TYPE_MIN,
+
+	/** A maximum heap. */
+
+	PAIRING_HEAP_TYPE_MAX
+} PairingHeapType;
+
+/**
+ * A value stored in a @ref PairingHeap.
+ */
+
+typedef void *PairingHeapValue;
+
+/**
+ * A null @ref PairingHeapValue.
+ */
+
+#define PAIRING_HEAP_NULL ((void *) 0)
+
+/**
+ * Type of function used to compare values in a pairing heap.
+ *
+ * @param value1           The first value.
+ * @param value2           The second value.
+ * @return                 A negative number if value1 is less than value2,
+ *                         a positive number if value1 is greater than value2,
+ *                         zero if the two are equal.
+ */
+
+typedef int (*PairingHeapCompareFunc)(PairingHeapValue value1,
+                                      PairingHeapValue value2);
+
+/**
+ * A pairing heap data structure.
+ */
+
+typedef struct _PairingHeap PairingHeap;
+
+/**
+ * A handle to a value in a @ref PairingHeap, which can be used to change
+ * its priority or to remove it.  A handle is valid until its value is
+ * removed from the heap, including after the heap is merged into another
+ * heap.
+ */
+
+typedef struct _PairingHeapHandle PairingHeapHandle;
+
+/**
+ * Create a new @ref PairingHeap.
+ *
+ * @param heap_type        The type of heap: min heap or max heap.
+ * @param compare_func     Pointer to a function used to compare the priority
+ *                         of values in the heap.
+ * @return                 A new pairing heap, or NULL if it was not possible
+ *                         to allocate the memory.
+ */
+
+PairingHeap *pairing_heap_new(PairingHeapType heap_type,
+                              PairingHeapCompareFunc compare_func);
+
+/**
+ * Destroy a pairing heap.
+ *
+ * @param heap             The heap to destroy.
+ */
+
+void pairing_heap_free(PairingHeap *heap);
+
+/**
+ * Insert a value into a pairing heap.
+ *
+ * @param heap             The heap to insert into.
+ * @param value            The value to insert.
+ * @return                 Non-zero if the entry was added, or zero if it
+ *                         was not possible to allocate memory for the new
+ *                         entry.
+ */
+
+int pairing_heap_insert(PairingHeap *heap, PairingHeapValue value);
+
+/**
+ * Insert a value into a pairing heap, returning a handle to it.
+ *
+ * @param heap             The heap to insert into.
+ * @param value            The value to insert.
+ * @return                 A handle to the new entry, or NULL if it was not
+ *                         possible to allocate memory for the new entry.
+ */
+
+PairingHeapHandle *pairing_heap_insert_handle(PairingHeap *heap,
+                                              PairingHeapValue value);
+
+/**
+ * Remove the first value from a pairing heap.
+ *
+ * @param heap             The heap.
+ * @return                 The first value in the heap, or
+ *                         @ref PAIRING_HEAP_NULL if the heap is empty.
+ */
+
+PairingHeapValue pairing_heap_pop(PairingHeap *heap);
+
+/**
+ * Replace a value in a pairing heap with one which is at least as near
+ * to the top of the heap: a value of lower or equal priority for a min
+ * heap, or of greater or equal priority for a max heap.  If the priority
+ * of the value was changed directly, the same value can be passed again.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void pairing_heap_decrease_key(PairingHeap *heap, PairingHeapHandle *handle,
+                               PairingHeapValue value);
+
+/**
+ * Replace a value in a pairing heap with one of any priority.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to replace.
+ * @param value            The new value.
+ */
+
+void pairing_heap_update(PairingHeap *heap, PairingHeapHandle *handle,
+                         PairingHeapValue value);
+
+/**
+ * Remove a value from a pairing heap.  The handle is no longer valid
+ * afterwards.
+ *
+ * @param heap             The heap.
+ * @param handle           Handle to the value to remove.
+ * @return                 The value that was removed.
+ */
+
+PairingHeapValue pairing_heap_remove(PairingHeap *heap,
+                                     PairingHeapHandle *handle);
+
+/**
+ * Move all the values from one pairing heap into another, in constant
+ * time.  Both heaps must be of the same type and use the same compare
+ * function.  Afterwards, the other heap is empty; handles to its values
+ * can be used with the heap they were moved to.
+ *
+ * @param heap             The heap to add the values to.
+ * @param other            The heap to take the values from.
+ */
+
+void pairing_heap_merge(PairingHeap *heap, PairingHeap *other);
+
+/**
+ * Find the number of values stored in a pairing heap.
+ *
+ * @param heap             The heap.
+ * @return                 The number of values in the heap.
+ */
+
+unsigned int pairing_heap_num_entries(PairingHeap *heap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_PAIRING_HEAP_H */
+
@@ -19,6 +19,7 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "queue.h"
 
@@ -28,22 +29,34 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
-/* A double-ended queue */
+/* A double-ended queue, stored in a circular buffer.
+ *
+ * The buffer is divided into fixed-size chunks, and a circular array
+ * (the map) holds pointers to the chunks.  Values are stored in a
+ * contiguous range of slots, starting from the head and wrapping around
+ * the end of the buffer.  Chunks are only allocated while they hold
+ * values, and one spare chunk is kept, so that a queue which stays
+ * about the same size does not allocate any memory.  When the buffer is
+ * full, only the map is enlarged: existing chunks are not copied. */
 
-typedef struct _QueueEntry QueueEntry;
-
-struct _QueueEntry {
-	QueueValue data;
-	QueueEntry *prev;
-	QueueEntry *next;
-};
+#define QUEUE_CHUNK_SIZE 64
+#define QUEUE_INITIAL_MAP_SIZE 4
 
 struct _Queue {
-	QueueEntry *head;
-	QueueEntry *tail;
+	QueueValue **map;
+	unsigned int map_size;
+	unsigned int head;
+	unsigned int length;
+	QueueValue *spare_chunk;
+	Allocator *allocator;
 };
 
 Queue *queue_new(void)
+{
+	return queue_new_with_allocator(NULL);
+}
+
+Queue *queue_new_with_allocator(Allocator *allocator)
 {
 	Queue *queue;
 
@@ -53,99 +66,222 @@ Queue *queue_new(void)
 		return NULL;
 	}
 
-	queue->head = NULL;
-	queue->tail = NULL;
+	queue->map = calloc(QUEUE_INITIAL_MAP_SIZE, sizeof(QueueValue *));
+
+	if (queue->map == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	queue->map_size = QUEUE_INITIAL_MAP_SIZE;
+	queue->head = 0;
+	queue->length = 0;
+	queue->spare_chunk = NULL;
+	queue->allocator = allocator;
 
 	return queue;
 }
 
+static void queue_free_chunk(Queue *queue, QueueValue *chunk)
+{
+	allocator_free(queue->allocator, chunk,
+	               QUEUE_CHUNK_SIZE * sizeof(QueueValue));
+}
+
 void queue_free(Queue *queue)
 {
-	/* Empty the queue */
+	unsigned int i;
+
+	/* Free all chunks */
+
+	for (i=0; i<queue->map_size; ++i) {
+		if (queue->map[i] != NULL) {
+			queue_free_chunk(queue, queue->map[i]);
+		}
+	}
 
-	while (!queue_is_empty(queue)) {
-		queue_pop_head(queue);
+	if (queue->spare_chunk != NULL) {
+		queue_free_chunk(queue, queue->spare_chunk);
 	}
 
 	/* Free back the queue */
 
+	free(queue->map);
 	free(queue);
 }
 
-int queue_push_head(Queue *queue, QueueValue data)
+static unsigned int queue_capacity(Queue *queue)
 {
-	QueueEntry *new_entry;
+	return queue->map_size * QUEUE_CHUNK_SIZE;
+}
 
-	/* Create the new entry and fill in the fields in the structure */
+/* Get a pointer to the value stored in a slot of the buffer */
 
-	new_entry = malloc(sizeof(QueueEntry));
+static QueueValue *queue_slot(Queue *queue, unsigned int slot)
+{
+	return &queue->map[slot / QUEUE_CHUNK_SIZE][slot % QUEUE_CHUNK_SIZE];
+}
 
-	if (new_entry == NULL) {
-		return 0;
+/* Make sure that the chunk containing a slot is allocated.  Returns zero
+ * if it was not possible to allocate memory for the chunk. */
+
+static int queue_use_slot(Queue *queue, unsigned int slot)
+{
+	QueueValue **chunk;
+
+	chunk = &queue->map[slot / QUEUE_CHUNK_SIZE];
+
+	if (*chunk != NULL) {
+		return 1;
 	}
 
-	new_entry->data = data;
-	new_entry->prev = NULL;
-	new_entry->next = queue->head;
+	if (queue->spare_chunk != NULL) {
+		*chunk = queue->spare_chunk;
+		queue->spare_chunk = NULL;
+	} else {
+		*chunk = allocator_alloc(queue->allocator,
+		                         QUEUE_CHUNK_SIZE * sizeof(QueueValue));
+	}
 
-	/* Insert into the queue */
+	return *chunk != NULL;
+}
 
-	if (queue->head == NULL) {
+/* Free the chunk containing a slot from which a value has just been
+ * removed, unless it still holds other values. */
 
-		/* If the queue was previously empty, both the head and
-		 * tail must be pointed at the new entry */
+static void queue_release_slot(Queue *queue, unsigned int slot)
+{
+	unsigned int chunk;
+	unsigned int first_chunk;
+	unsigned int num_chunks;
 
-		queue->head = new_entry;
-		queue->tail = new_entry;
+	chunk = slot / QUEUE_CHUNK_SIZE;
 
+	/* Find the range of chunks in use */
+
+	if (queue->length > 0) {
+		first_chunk = queue->head / QUEUE_CHUNK_SIZE;
+		num_chunks = (queue->head % QUEUE_CHUNK_SIZE + queue->length
+		              + QUEUE_CHUNK_SIZE - 1) / QUEUE_CHUNK_SIZE;
+
+		if (num_chunks >= queue->map_size
+		 || ((chunk - first_chunk) & (queue->map_size - 1))
+		    < num_chunks) {
+			return;
+		}
+	}
+
+	if (queue->spare_chunk == NULL) {
+		queue->spare_chunk = queue->map[chunk];
 	} else {
+		queue_free_chunk(queue, queue->map[chunk]);
+	}
 
-		/* First entry in the list must have prev pointed back to this
-		 * new entry */
+	queue->map[chunk] = NULL;
+}
+
+/* Double the size of a full buffer.  The map is rearranged so that the
+ * chunk containing the head is first.  If the head is part way through
+ * its chunk, the start of that chunk holds the values at the tail, which
+ * are moved to a new chunk at the end. */
+
+static int queue_enlarge(Queue *queue)
+{
+	QueueValue **new_map;
+	QueueValue *tail_chunk;
+	unsigned int head_chunk;
+	unsigned int offset;
+	unsigned int i;
+
+	new_map = calloc(queue->map_size * 2, sizeof(QueueValue *));
 
-		queue->head->prev = new_entry;
+	if (new_map == NULL) {
+		return 0;
+	}
 
-		/* Only the head must be pointed at the new entry */
+	head_chunk = queue->head / QUEUE_CHUNK_SIZE;
+	offset = queue->head % QUEUE_CHUNK_SIZE;
+	tail_chunk = NULL;
+
+	if (offset != 0) {
+		if (queue->spare_chunk != NULL) {
+			tail_chunk = queue->spare_chunk;
+			queue->spare_chunk = NULL;
+		} else {
+			tail_chunk = allocator_alloc(queue->allocator,
+			                             QUEUE_CHUNK_SIZE
+			                             * sizeof(QueueValue));
+
+			if (tail_chunk == NULL) {
+				free(new_map);
+				return 0;
+			}
+		}
+
+		memcpy(tail_chunk, queue->map[head_chunk],
+		       offset * sizeof(QueueValue));
+	}
 
-		queue->head = new_entry;
+	for (i=0; i<queue->map_size; ++i) {
+		new_map[i] = queue->map[(head_chunk + i)
+		                        & (queue->map_size - 1)];
 	}
 
+	new_map[queue->map_size] = tail_chunk;
+
+	free(queue->map);
+	queue->map = new_map;
+	queue->map_size *= 2;
+	queue->head = offset;
+
 	return 1;
 }
 
-QueueValue queue_pop_head(Queue *queue)
+int queue_push_head(Queue *queue, QueueValue data)
 {
-	QueueEntry *entry;
-	QueueValue result;
+	unsigned int slot;
 
-	/* Check the queue is not empty */
+	/* Enlarge the buffer if it is full */
 
-	if (queue_is_empty(queue)) {
-		return QUEUE_NULL;
+	if (queue->length == queue_capacity(queue) && !queue_enlarge(queue)) {
+		return 0;
 	}
 
-	/* Unlink the first entry from the head of the queue */
+	/* The new head is in the slot before the current head */
 
-	entry = queue->head;
-	queue->head = entry->next;
-	result = entry->data;
+	slot = (queue->head - 1) & (queue_capacity(queue) - 1);
 
-	if (queue->head == NULL) {
+	if (!queue_use_slot(queue, slot)) {
+		return 0;
+	}
 
-		/* If doing this has unlinked the last entry in the queue, set
-		 * tail to NULL as well. */
+	*queue_slot(queue, slot) = data;
+	queue->head = slot;
+	++queue->length;
 
-		queue->tail = NULL;
-	} else {
+	return 1;
+}
+
+QueueValue queue_pop_head(Queue *queue)
+{
+	QueueValue result;
+	unsigned int slot;
 
-		/* The new first in the queue has no previous entry */
+	/* Check the queue is not empty */
 
-		queue->head->prev = NULL;
+	if (queue_is_empty(queue)) {
+		return QUEUE_NULL;
 	}
 
-	/* Free back the queue entry structure */
+	/* Remove the value at the head of the queue */
+
+	slot = queue->head;
+	result = *queue_slot(queue, slot);
+
+	queue->head = (slot + 1) & (queue_capacity(queue) - 1);
+	--queue->length;
 
-	free(entry);
+	queue_release_slot(queue, slot);
 
 	return result;
 }
@@ -155,55 +291,38 @@ QueueValue queue_peek_head(Queue *queue)
 	if (queue_is_empty(queue)) {
 		return QUEUE_NULL;
 	} else {
-		return queue->head->data;
+		return *queue_slot(queue, queue->head);
 	}
 }
 
 int queue_push_tail(Queue *queue, QueueValue data)
 {
-	QueueEntry *new_entry;
+	unsigned int slot;
 
-	/* Create the new entry and fill in the fields in the structure */
+	/* Enlarge the buffer if it is full */
 
-	new_entry = malloc(sizeof(QueueEntry));
-
-	if (new_entry == NULL) {
+	if (queue->length == queue_capacity(queue) && !queue_enlarge(queue)) {
 		return 0;
 	}
 
-	new_entry->data = data;
-	new_entry->prev = queue->tail;
-	new_entry->next = NULL;
-
-	/* Insert into the queue tail */
-
-	if (queue->tail == NULL) {
+	/* The new tail is in the slot after the current tail */
 
-		/* If the queue was previously empty, both the head and
-		 * tail must be pointed at the new entry */
-
-		queue->head = new_entry;
-		queue->tail = new_entry;
-
-	} else {
+	slot = (queue->head + queue->length) & (queue_capacity(queue) - 1);
 
-		/* The current entry at the tail must have next pointed to this
-		 * new entry */
-
-		queue->tail->next = new_entry;
-
-		/* Only the tail must be pointed at the new entry */
-
-		queue->tail = new_entry;
+	if (!queue_use_slot(queue, slot)) {
+		return 0;
 	}
 
+	*queue_slot(queue, slot) = data;
+	++queue->length;
+
 	return 1;
 }
 
 QueueValue queue_pop_tail(Queue *queue)
 {
-	QueueEntry *entry;
 	QueueValue result;
+	unsigned int slot;
 
 	/* Check the queue is not empty */
 
@@ -211,44 +330,35 @@ QueueValue queue_pop_tail(Queue *queue)
 		return QUEUE_NULL;
 	}
 
-	/* Unlink the first entry from the tail of the queue */
+	/* Remove the value at the tail of the queue */
 
-	entry = queue->tail;
-	queue->tail = entry->prev;
-	result = entry->data;
+	slot = (queue->head + queue->length - 1)
+	     & (queue_capacity(queue) - 1);
+	result = *queue_slot(queue, slot);
 
-	if (queue->tail == NULL) {
+	--queue->length;
 
-		/* If doing this has unlinked the last entry in the queue, set
-		 * head to NULL as well. */
-
-		queue->head = NULL;
-
-	} else {
-
-		/* The new entry at the tail has no next entry. */
-
-		queue->tail->next = NULL;
-	}
-
-	/* Free back the queue entry structure */
-
-	free(entry);
+	queue_release_slot(queue, slot);
 
 	return result;
 }
 
 QueueValue queue_peek_tail(Queue *queue)
 {
+	unsigned int slot;
+
 	if (queue_is_empty(queue)) {
 		return QUEUE_NULL;
 	} else {
-		return queue->tail->data;
+		slot = (queue->head + queue->length - 1)
+		     & (queue_capacity(queue) - 1);
+
+		return *queue_slot(queue, slot);
 	}
 }
 
 int queue_is_empty(Queue *queue)
 {
-	return queue->head == NULL;
+	return queue->length == 0;
 }
 
@@ -36,11 +36,18 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * and @ref queue_pop_tail.  To examine the ends without removing values
  * from the queue, use @ref queue_peek_head and @ref queue_peek_tail.
  *
+ * Values are stored in a circular buffer made up of fixed-size chunks,
+ * so adding and removing values does not allocate memory for each value.
+ * Once a queue has reached its working size, adding and removing values
+ * does not allocate memory at all.
+ *
  */
 
 #ifndef ALGORITHM_QUEUE_H
 #define ALGORITHM_QUEUE_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -72,6 +79,17 @@ typedef void *QueueValue;
 
 Queue *queue_new(void);
 
+/**
+ * Create a new double-ended queue, using a custom allocator for its
+ * entries.
+ *
+ * @param allocator  The allocator to use, or NULL to use malloc().
+ * @return           A new queue, or NULL if it was not possible to allocate
+ *                   the memory.
+ */
+
+Queue *queue_new_with_allocator(Allocator *allocator);
+
 /**
  * Destroy a queue.
  *
@@ -20,6 +20,7 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "rb-tree.h"
 
@@ -29,8 +30,16 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
+/* If built with TREE_ROTATION_COUNTING defined, the number of rotations
+ * performed is counted.  This is used by the tree benchmark. */
+
+#ifdef TREE_ROTATION_COUNTING
+unsigned long rb_tree_rotation_count = 0;
+#endif
+
 struct _RBTreeNode {
 	RBTreeNodeColor color;
+	unsigned int size;
 	RBTreeKey key;
 	RBTreeValue value;
 	RBTreeNode *parent;
@@ -41,6 +50,14 @@ struct _RBTree {
 	RBTreeNode *root_node;
 	RBTreeCompareFunc compare_func;
 	int num_nodes;
+	Allocator *allocator;
+
+	/* Nodes created by rb_tree_new_from_sorted, allocated in a single
+	 * block.  They are not freed individually; the whole block is
+	 * freed with the tree. */
+
+	RBTreeNode *node_block;
+	unsigned int node_block_length;
 };
 
 static RBTreeNodeSide rb_tree_node_side(RBTreeNode *node)
@@ -66,6 +83,17 @@ RBTreeNode *rb_tree_node_uncle(RBTreeNode *node)
 	return rb_tree_node_sibling(node->parent);
 }
 
+/* Find the number of nodes in a subtree. */
+
+static unsigned int rb_tree_subtree_size(RBTreeNode *node)
+{
+	if (node == NULL) {
+		return 0;
+	} else {
+		return node->size;
+	}
+}
+
 /* Replace node1 with node2 at its parent. */
 
 static void rb_tree_node_replace(RBTree *tree, RBTreeNode *node1,
@@ -116,6 +144,10 @@ static RBTreeNode *rb_tree_rotate(RBTree *tree, RBTreeNode *node,
 {
 	RBTreeNode *new_root;
 
+#ifdef TREE_ROTATION_COUNTING
+	++rb_tree_rotation_count;
+#endif
+
 	/* The child of this node will take its place:
 	   for a left rotation, it is the right child, and vice versa. */
 
@@ -138,11 +170,25 @@ static RBTreeNode *rb_tree_rotate(RBTree *tree, RBTreeNode *node,
 		node->children[1-direction]->parent = node;
 	}
 
+	/* Update subtree sizes.  The new root covers the same nodes that
+	 * the old root did. */
+
+	new_root->size = node->size;
+	node->size = rb_tree_subtree_size(node->children[RB_TREE_NODE_LEFT])
+	           + rb_tree_subtree_size(node->children[RB_TREE_NODE_RIGHT])
+	           + 1;
+
 	return new_root;
 }
 
 
 RBTree *rb_tree_new(RBTreeCompareFunc compare_func)
+{
+	return rb_tree_new_with_allocator(compare_func, NULL);
+}
+
+RBTree *rb_tree_new_with_allocator(RBTreeCompareFunc compare_func,
+                                   Allocator *allocator)
 {
 	RBTree *new_tree;
 
@@ -155,21 +201,36 @@ RBTree *rb_tree_new(RBTreeCompareFunc compare_func)
 	new_tree->root_node = NULL;
 	new_tree->num_nodes = 0;
 	new_tree->compare_func = compare_func;
+	new_tree->allocator = allocator;
+	new_tree->node_block = NULL;
+	new_tree->node_block_length = 0;
 
 	return new_tree;
 }
 
-static void rb_tree_free_subtree(RBTreeNode *node)
+/* Free a node, unless it is part of the tree's node block. */
+
+static void rb_tree_free_node(RBTree *tree, RBTreeNode *node)
+{
+	if ((uintptr_t) node - (uintptr_t) tree->node_block
+	    < sizeof(RBTreeNode) * tree->node_block_length) {
+		return;
+	}
+
+	allocator_free(tree->allocator, node, sizeof(RBTreeNode));
+}
+
+static void rb_tree_free_subtree(RBTree *tree, RBTreeNode *node)
 {
 	if (node != NULL) {
 		/* Recurse to subnodes */
 
-		rb_tree_free_subtree(node->children[RB_TREE_NODE_LEFT]);
-		rb_tree_free_subtree(node->children[RB_TREE_NODE_RIGHT]);
+		rb_tree_free_subtree(tree, node->children[RB_TREE_NODE_LEFT]);
+		rb_tree_free_subtree(tree, node->children[RB_TREE_NODE_RIGHT]);
 
 		/* Free this node */
 
-		free(node);
+		rb_tree_free_node(tree, node);
 	}
 }
 
@@ -177,7 +238,8 @@ void rb_tree_free(RBTree *tree)
 {
 	/* Free all nodes in the tree */
 
-	rb_tree_free_subtree(tree->root_node);
+	rb_tree_free_subtree(tree, tree->root_node);
+	free(tree->node_block);
 
 	/* Free back the main tree structure */
 
@@ -338,6 +400,112 @@ void rb_tree_insert_case5(RBTree *tree, RBTreeNode *node)
 	grandparent->color = RB_TREE_NODE_RED;
 }
 
+/* Link an array of nodes, in key order, into a perfectly balanced
+ * subtree: the middle node is the root, and the nodes either side of
+ * it form its subtrees.  Every level above red_depth is full, so those
+ * nodes are coloured black; nodes on the partly-filled level below
+ * them are red. */
+
+static RBTreeNode *rb_tree_build_subtree(RBTreeNode *nodes,
+                                         unsigned int length,
+                                         RBTreeNode *parent,
+                                         unsigned int depth,
+                                         unsigned int red_depth)
+{
+	RBTreeNode *node;
+	unsigned int middle;
+
+	if (length == 0) {
+		return NULL;
+	}
+
+	middle = length / 2;
+	node = &nodes[middle];
+
+	node->parent = parent;
+	node->size = length;
+
+	if (depth == red_depth) {
+		node->color = RB_TREE_NODE_RED;
+	} else {
+		node->color = RB_TREE_NODE_BLACK;
+	}
+
+	node->children[RB_TREE_NODE_LEFT]
+	    = rb_tree_build_subtree(nodes, middle, node,
+	                            depth + 1, red_depth);
+	node->children[RB_TREE_NODE_RIGHT]
+	    = rb_tree_build_subtree(nodes + middle + 1, length - middle - 1,
+	                            node, depth + 1, red_depth);
+
+	return node;
+}
+
+RBTree *rb_tree_new_from_sorted(RBTreeCompareFunc compare_func,
+                                RBTreeKey *keys, RBTreeValue *values,
+                                unsigned int length)
+{
+	RBTree *new_tree;
+	unsigned int red_depth;
+	unsigned int i;
+
+	/* The keys must be in strictly increasing order. */
+
+	for (i=1; i<length; ++i) {
+		if (compare_func(keys[i - 1], keys[i]) >= 0) {
+			return NULL;
+		}
+	}
+
+	new_tree = rb_tree_new(compare_func);
+
+	if (new_tree == NULL) {
+		return NULL;
+	}
+
+	if (length == 0) {
+		return new_tree;
+	}
+
+	/* Allocate all nodes at once, in key order. */
+
+	new_tree->node_block = malloc(sizeof(RBTreeNode) * length);
+
+	if (new_tree->node_block == NULL) {
+		free(new_tree);
+		return NULL;
+	}
+
+	new_tree->node_block_length = length;
+
+	for (i=0; i<length; ++i) {
+		new_tree->node_block[i].key = keys[i];
+
+		if (values != NULL) {
+			new_tree->node_block[i].value = values[i];
+		} else {
+			new_tree->node_block[i].value = RB_TREE_NULL;
+		}
+	}
+
+	/* Find the number of full levels, by following the smaller
+	 * subtree down from the root.  Nodes on the level below are
+	 * red. */
+
+	red_depth = 0;
+
+	for (i=length; i>0; i=(i - 1) / 2) {
+		++red_depth;
+	}
+
+	new_tree->root_node = rb_tree_build_subtree(new_tree->node_block,
+	                                            length, NULL,
+	                                            0, red_depth);
+	new_tree->num_nodes = (int) length;
+
+	return new_tree;
+}
+
 RBTreeNode *rb_tree_insert(RBTree *tree, RBTreeKey key, RBTreeValue value)
 {
 	RBTreeNode *node;
@@ -347,7 +515,7 @@ RBTreeNode *rb_tree_insert(RBTree *tree, RBTreeKey key, RBTreeValue value)
 
 	/* Allocate a new node */
 
-	node = malloc(sizeof(RBTreeNode));
+	node = allocator_alloc(tree->allocator, sizeof(RBTreeNode));
 
 	if (node == NULL) {
 		return NULL;
@@ -358,6 +526,7 @@ RBTreeNode *rb_tree_insert(RBTree *tree, RBTreeKey key, RBTreeValue value)
 	node->key = key;
 	node->value = value;
 	node->color = RB_TREE_NODE_RED;
+	node->size = 1;
 	node->children[RB_TREE_NODE_LEFT] = NULL;
 	node->children[RB_TREE_NODE_RIGHT] = NULL;
 
@@ -368,13 +537,14 @@ RBTreeNode *rb_tree_insert(RBTree *tree, RBTreeKey key, RBTreeValue value)
 
 	while (*rover != NULL) {
 
-		/* Update parent */
+		/* Update parent.  The new node will be in its subtree. */
 
 		parent = *rover;
+		++parent->size;
 
 		/* Choose which path to go down, left or right child */
 
-		if (tree->compare_func(value, (*rover)->value) < 0) {
+		if (tree->compare_func(key, (*rover)->key) < 0) {
 			side = RB_TREE_NODE_LEFT;
 		} else {
 			side = RB_TREE_NODE_RIGHT;
@@ -443,9 +613,200 @@ RBTreeValue rb_tree_lookup(RBTree *tree, RBTreeKey key)
 	}
 }
 
+/* Restore the tree conditions after a black node has been removed.
+ * The subtree at parent->children[side] (which may be empty) now has a
+ * black height one less than its sibling.  At most three rotations
+ * are performed; otherwise the deficit is pushed up the tree by
+ * recoloring. */
+
+static void rb_tree_remove_fixup(RBTree *tree, RBTreeNode *parent,
+                                 RBTreeNodeSide side)
+{
+	RBTreeNode *node;
+	RBTreeNode *sibling;
+	RBTreeNode *near_nephew;
+	RBTreeNode *far_nephew;
+
+	while (parent != NULL) {
+
+		/* The sibling cannot be empty, as its subtree has a black
+		 * height of at least one. */
+
+		sibling = parent->children[1-side];
+
+		/* Case 1: The sibling is red.  Rotate at the parent so that
+		 * the sibling takes its place, and recolor.  The node now has
+		 * a black sibling, and the parent is red, so one of the
+		 * cases below will finish the job. */
+
+		if (sibling->color == RB_TREE_NODE_RED) {
+			sibling->color = RB_TREE_NODE_BLACK;
+			parent->color = RB_TREE_NODE_RED;
+			rb_tree_rotate(tree, parent, side);
+			sibling = parent->children[1-side];
+		}
+
+		near_nephew = sibling->children[side];
+		far_nephew = sibling->children[1-side];
+
+		/* Case 2: The sibling and both of its children are black.
+		 * Repaint the sibling red, so that both sides are short by
+		 * one.  If the parent is red, repainting it black fixes the
+		 * tree; otherwise continue from the parent. */
+
+		if ((near_nephew == NULL
+		     || near_nephew->color == RB_TREE_NODE_BLACK)
+		 && (far_nephew == NULL
+		     || far_nephew->color == RB_TREE_NODE_BLACK)) {
+
+			sibling->color = RB_TREE_NODE_RED;
+
+			if (parent->color == RB_TREE_NODE_RED) {
+				parent->color = RB_TREE_NODE_BLACK;
+				return;
+			}
+
+			node = parent;
+			parent = node->parent;
+
+			if (parent != NULL) {
+				side = rb_tree_node_side(node);
+			}
+
+			continue;
+		}
+
+		/* Case 3: The near child of the sibling is red, but the far
+		 * child is black.  Rotate at the sibling so that the red
+		 * child is on the far side, for case 4. */
+
+		if (far_nephew == NULL
+		 || far_nephew->color == RB_TREE_NODE_BLACK) {
+			near_nephew->color = RB_TREE_NODE_BLACK;
+			sibling->color = RB_TREE_NODE_RED;
+			rb_tree_rotate(tree, sibling, 1-side);
+			far_nephew = sibling;
+			sibling = parent->children[1-side];
+		}
+
+		/* Case 4: The far child of the sibling is red.  Rotate at the
+		 * parent, so that the sibling takes its place with its color,
+		 * and both of the sibling's new children are black.  This
+		 * adds a black node to the short side. */
+
+		sibling->color = parent->color;
+		parent->color = RB_TREE_NODE_BLACK;
+		far_nephew->color = RB_TREE_NODE_BLACK;
+		rb_tree_rotate(tree, parent, side);
+
+		return;
+	}
+
+	/* The deficit has reached the root, which shortens every path
+	 * equally. */
+}
+
 void rb_tree_remove_node(RBTree *tree, RBTreeNode *node)
 {
-	/* TODO */
+	RBTreeNode *successor;
+	RBTreeNode *rover;
+	RBTreeNode *child;
+	RBTreeNode *parent;
+	RBTreeNodeColor removed_color;
+	RBTreeNodeSide side;
+
+	if (node->children[RB_TREE_NODE_LEFT] != NULL
+	 && node->children[RB_TREE_NODE_RIGHT] != NULL) {
+
+		/* The node has two children.  It is replaced by its in-order
+		 * successor, the smallest node in its right subtree, which
+		 * takes on the node's color.  Nodes are relinked rather than
+		 * having their contents swapped, as callers may hold
+		 * pointers to them.  The successor has no left child; the
+		 * tree is repaired from the point where it was removed. */
+
+		successor = node->children[RB_TREE_NODE_RIGHT];
+
+		while (successor->children[RB_TREE_NODE_LEFT] != NULL) {
+			successor = successor->children[RB_TREE_NODE_LEFT];
+		}
+
+		child = successor->children[RB_TREE_NODE_RIGHT];
+		removed_color = successor->color;
+
+		if (successor->parent == node) {
+			parent = successor;
+			side = RB_TREE_NODE_RIGHT;
+		} else {
+			parent = successor->parent;
+			side = RB_TREE_NODE_LEFT;
+
+			parent->children[RB_TREE_NODE_LEFT] = child;
+
+			if (child != NULL) {
+				child->parent = parent;
+			}
+
+			successor->children[RB_TREE_NODE_RIGHT]
+			    = node->children[RB_TREE_NODE_RIGHT];
+			successor->children[RB_TREE_NODE_RIGHT]->parent
+			    = successor;
+		}
+
+		successor->children[RB_TREE_NODE_LEFT]
+		    = node->children[RB_TREE_NODE_LEFT];
+		successor->children[RB_TREE_NODE_LEFT]->parent = successor;
+		successor->color = node->color;
+		successor->size = node->size;
+
+		rb_tree_node_replace(tree, node, successor);
+
+	} else {
+
+		/* The node has at most one child, which takes its place. */
+
+		if (node->children[RB_TREE_NODE_LEFT] != NULL) {
+			child = node->children[RB_TREE_NODE_LEFT];
+		} else {
+			child = node->children[RB_TREE_NODE_RIGHT];
+		}
+
+		removed_color = node->color;
+		parent = node->parent;
+		side = RB_TREE_NODE_LEFT;
+
+		if (parent != NULL) {
+			side = rb_tree_node_side(node);
+		}
+
+		rb_tree_node_replace(tree, node, child);
+	}
+
+	/* Every node above the point where the tree was changed has one
+	 * fewer node in its subtree. */
+
+	for (rover = parent; rover != NULL; rover = rover->parent) {
+		--rover->size;
+	}
+
+	/* Removing a red node does not affect the black height of any
+	 * path.  If a black node was removed and its replacement is red,
+	 * repainting it black restores the balance.  Otherwise, the
+	 * tree must be rebalanced. */
+
+	if (removed_color == RB_TREE_NODE_BLACK) {
+		if (child != NULL && child->color == RB_TREE_NODE_RED) {
+			child->color = RB_TREE_NODE_BLACK;
+		} else {
+			rb_tree_remove_fixup(tree, parent, side);
+		}
+	}
+
+	/* Free the node */
+
+	rb_tree_free_node(tree, node);
+
+	--tree->num_nodes;
 }
 
 int rb_tree_remove(RBTree *tree, RBTreeKey key)
@@ -494,6 +855,239 @@ RBTreeNode *rb_tree_node_parent(RBTreeNode *node)
 	return node->parent;
 }
 
+RBTreeNodeColor rb_tree_node_color(RBTreeNode *node)
+{
+	return node->color;
+}
+
+/* Search for the first node with a key greater than the given key,
+ * or if 'inclusive' is non-zero, greater than or equal to it. */
+
+static RBTreeNode *rb_tree_bound(RBTree *tree, RBTreeKey key, int inclusive)
+{
+	RBTreeNode *node;
+	RBTreeNode *result;
+	int diff;
+
+	node = tree->root_node;
+	result = NULL;
+
+	while (node != NULL) {
+		diff = tree->compare_func(key, node->key);
+
+		if (diff < 0 || (diff == 0 && inclusive)) {
+
+			/* This node is a candidate; look for an earlier one
+			 * in the left subtree. */
+
+			result = node;
+			node = node->children[RB_TREE_NODE_LEFT];
+		} else {
+			node = node->children[RB_TREE_NODE_RIGHT];
+		}
+	}
+
+	return result;
+}
+
+RBTreeNode *rb_tree_lower_bound(RBTree *tree, RBTreeKey key)
+{
+	return rb_tree_bound(tree, key, 1);
+}
+
+RBTreeNode *rb_tree_upper_bound(RBTree *tree, RBTreeKey key)
+{
+	return rb_tree_bound(tree, key, 0);
+}
+
+/* Find the next node in the given direction: for RIGHT, the in-order
+ * successor; for LEFT, the predecessor. */
+
+static RBTreeNode *rb_tree_node_step(RBTreeNode *node, RBTreeNodeSide side)
+{
+	RBTreeNode *result;
+
+	/* If there is a subtree on this side, the result is its nearest
+	 * node: the furthest node in the opposite direction. */
+
+	if (node->children[side] != NULL) {
+		result = node->children[side];
+
+		while (result->children[1-side] != NULL) {
+			result = result->children[1-side];
+		}
+
+		return result;
+	}
+
+	/* Otherwise, go up until we arrive at a parent from the opposite
+	 * side. */
+
+	while (node->parent != NULL
+	    && node->parent->children[side] == node) {
+		node = node->parent;
+	}
+
+	return node->parent;
+}
+
+RBTreeNode *rb_tree_node_next(RBTreeNode *node)
+{
+	return rb_tree_node_step(node, RB_TREE_NODE_RIGHT);
+}
+
+RBTreeNode *rb_tree_node_prev(RBTreeNode *node)
+{
+	return rb_tree_node_step(node, RB_TREE_NODE_LEFT);
+}
+
+void rb_tree_iterate(RBTree *tree, RBTreeIterator *iter)
+{
+	RBTreeNode *node;
+
+	/* Start from the leftmost node. */
+
+	node = tree->root_node;
+
+	if (node != NULL) {
+		while (node->children[RB_TREE_NODE_LEFT] != NULL) {
+			node = node->children[RB_TREE_NODE_LEFT];
+		}
+	}
+
+	iter->next_node = node;
+}
+
+void rb_tree_iterate_from(RBTree *tree, RBTreeKey key, RBTreeIterator *iter)
+{
+	iter->next_node = rb_tree_lower_bound(tree, key);
+}
+
+int rb_tree_iter_has_more(RBTreeIterator *iter)
+{
+	return iter->next_node != NULL;
+}
+
+RBTreeNode *rb_tree_iter_next(RBTreeIterator *iter)
+{
+	RBTreeNode *result;
+
+	result = iter->next_node;
+
+	/* Find the following node now, so that the caller can remove
+	 * the node being returned. */
+
+	if (result != NULL) {
+		iter->next_node = rb_tree_node_next(result);
+	}
+
+	return result;
+}
+
+unsigned int rb_tree_range_foreach(RBTree *tree,
+                                   RBTreeKey low, RBTreeKey high,
+                                   RBTreeRangeFunc callback,
+                                   void *user_data)
+{
+	RBTreeNode *node;
+	RBTreeNode *next;
+	unsigned int count;
+
+	count = 0;
+	node = rb_tree_lower_bound(tree, low);
+
+	while (node != NULL && tree->compare_func(node->key, high) <= 0) {
+
+		/* Find the next node before invoking the callback, in case
+		 * the callback removes this one. */
+
+		next = rb_tree_node_next(node);
+
+		callback(node, user_data);
+		++count;
+
+		node = next;
+	}
+
+	return count;
+}
+
+RBTreeNode *rb_tree_select(RBTree *tree, unsigned int index)
+{
+	RBTreeNode *node;
+	unsigned int left_size;
+
+	node = tree->root_node;
+
+	/* Use the subtree sizes to decide which way to go at each node. */
+
+	while (node != NULL) {
+		left_size = rb_tree_subtree_size(
+		                node->children[RB_TREE_NODE_LEFT]);
+
+		if (index < left_size) {
+			node = node->children[RB_TREE_NODE_LEFT];
+		} else if (index == left_size) {
+			return node;
+		} else {
+			index -= left_size + 1;
+			node = node->children[RB_TREE_NODE_RIGHT];
+		}
+	}
+
+	/* Index is out of range. */
+
+	return NULL;
+}
+
+/* Count the nodes with keys less than the given key, or if 'inclusive'
+ * is non-zero, less than or equal to it. */
+
+static unsigned int rb_tree_count_below(RBTree *tree, RBTreeKey key,
+                                        int inclusive)
+{
+	RBTreeNode *node;
+	unsigned int result;
+	int diff;
+
+	node = tree->root_node;
+	result = 0;
+
+	while (node != NULL) {
+		diff = tree->compare_func(key, node->key);
+
+		if (diff < 0 || (diff == 0 && !inclusive)) {
+			node = node->children[RB_TREE_NODE_LEFT];
+		} else {
+
+			/* This node and its whole left subtree are below
+			 * the key. */
+
+			result += rb_tree_subtree_size(
+			              node->children[RB_TREE_NODE_LEFT]) + 1;
+			node = node->children[RB_TREE_NODE_RIGHT];
+		}
+	}
+
+	return result;
+}
+
+unsigned int rb_tree_rank(RBTree *tree, RBTreeKey key)
+{
+	return rb_tree_count_below(tree, key, 0);
+}
+
+unsigned int rb_tree_count_range(RBTree *tree, RBTreeKey low,
+                                 RBTreeKey high)
+{
+	if (tree->compare_func(low, high) > 0) {
+		return 0;
+	}
+
+	return rb_tree_count_below(tree, high, 1)
+	     - rb_tree_count_below(tree, low, 0);
+}
+
 RBTreeValue *rb_tree_to_array(RBTree *tree)
 {
 	/* TODO */
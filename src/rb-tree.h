@@ -35,7 +35,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * as a set of keys which is always ordered.
  *
  * To create a new red-black tree, use @ref rb_tree_new.  To destroy
- * a red-black tree, use @ref rb_tree_free.
+ * a red-black tree, use @ref rb_tree_free.  To build a tree from
+ * entries that are already sorted, use @ref rb_tree_new_from_sorted.
  *
  * To insert a new key-value pair into a red-black tree, use
  * @ref rb_tree_insert.  To remove an entry from a
@@ -44,10 +45,25 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * To search a red-black tree, use @ref rb_tree_lookup or
  * @ref rb_tree_lookup_node.
  *
+ * To visit nodes in order, use @ref rb_tree_iterate or
+ * @ref rb_tree_iterate_from to initialise a @ref RBTreeIterator, and
+ * @ref rb_tree_iter_next and @ref rb_tree_iter_has_more to step through
+ * the nodes.  @ref rb_tree_lower_bound, @ref rb_tree_upper_bound,
+ * @ref rb_tree_node_next and @ref rb_tree_node_prev find neighbouring
+ * nodes, and @ref rb_tree_range_foreach visits all nodes with keys in a
+ * range.
+ *
+ * Each node records the size of its subtree, so that the tree can
+ * answer order statistic queries in O(log n) time: use
+ * @ref rb_tree_select to find the n-th entry, @ref rb_tree_rank to
+ * find the position of a key, and @ref rb_tree_count_range to count
+ * the entries between two keys.
+ *
  * Tree nodes can be queried using the
  * @ref rb_tree_node_left_child,
  * @ref rb_tree_node_right_child,
  * @ref rb_tree_node_parent,
+ * @ref rb_tree_node_color,
  * @ref rb_tree_node_key and
  * @ref rb_tree_node_value functions.
  */
@@ -55,6 +71,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #ifndef ALGORITHM_RB_TREE_H
 #define ALGORITHM_RB_TREE_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -110,6 +128,31 @@ typedef struct _RBTreeNode RBTreeNode;
 
 typedef int (*RBTreeCompareFunc)(RBTreeValue data1, RBTreeValue data2);
 
+/**
+ * Structure used to iterate over the nodes of a red-black tree in order.
+ */
+
+typedef struct _RBTreeIterator RBTreeIterator;
+
+/**
+ * Definition of a @ref RBTreeIterator.
+ */
+
+struct _RBTreeIterator {
+	RBTreeNode *next_node;
+};
+
+/**
+ * Callback function invoked for each node by
+ * @ref rb_tree_range_foreach.
+ *
+ * @param node             The tree node.
+ * @param user_data        The user data pointer passed to
+ *                         @ref rb_tree_range_foreach.
+ */
+
+typedef void (*RBTreeRangeFunc)(RBTreeNode *node, void *user_data);
+
 /**
  * Each node in a red-black tree is either red or black.
  */
@@ -138,6 +181,40 @@ typedef enum {
 
 RBTree *rb_tree_new(RBTreeCompareFunc compare_func);
 
+/**
+ * Create a new red-black tree, using a custom allocator for its nodes.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @param allocator       The allocator to use, or NULL to use malloc().
+ * @return                A new red-black tree, or NULL if it was not possible
+ *                        to allocate the memory.
+ */
+
+RBTree *rb_tree_new_with_allocator(RBTreeCompareFunc compare_func,
+                                   Allocator *allocator);
+
+/**
+ * Create a new red-black tree from arrays of keys and values already
+ * sorted by key.  This builds a perfectly balanced tree in linear time,
+ * which is much faster than inserting the entries one at a time.  The
+ * nodes are allocated as a single block using malloc(); nodes added to
+ * the tree later are allocated individually.
+ *
+ * @param compare_func    Function to use when comparing keys in the tree.
+ * @param keys            The keys, in strictly increasing order according
+ *                        to compare_func.
+ * @param values          The value for each key, or NULL to give every
+ *                        key the value @ref RB_TREE_NULL.
+ * @param length          The number of keys.
+ * @return                A new red-black tree, or NULL if the keys are
+ *                        not in strictly increasing order or it was not
+ *                        possible to allocate the memory.
+ */
+
+RBTree *rb_tree_new_from_sorted(RBTreeCompareFunc compare_func,
+                                RBTreeKey *keys, RBTreeValue *values,
+                                unsigned int length);
+
 /**
  * Destroy a red-black tree.
  *
@@ -257,6 +334,17 @@ RBTreeNode *rb_tree_node_child(RBTreeNode *node, RBTreeNodeSide side);
 
 RBTreeNode *rb_tree_node_parent(RBTreeNode *node);
 
+/**
+ * Find the color of a given tree node.
+ *
+ * @param node            The tree node.
+ * @return                The color of the node, either
+ *                        @ref RB_TREE_NODE_RED or
+ *                        @ref RB_TREE_NODE_BLACK.
+ */
+
+RBTreeNodeColor rb_tree_node_color(RBTreeNode *node);
+
 /**
  * Find the height of a subtree.
  *
@@ -266,6 +354,163 @@ RBTreeNode *rb_tree_node_parent(RBTreeNode *node);
 
 int rb_tree_subtree_height(RBTreeNode *node);
 
+/**
+ * Find the node at a given position in the tree, in the order of the
+ * keys.  This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param index           The position of the node, counting from zero
+ *                        for the node with the smallest key.
+ * @return                The node at the given position, or NULL if the
+ *                        index is not less than the number of entries
+ *                        in the tree.
+ */
+
+RBTreeNode *rb_tree_select(RBTree *tree, unsigned int index);
+
+/**
+ * Find the rank of a key in the tree: the number of entries with keys
+ * less than the given key.  If the key is in the tree, this is the
+ * index of its first node as used by @ref rb_tree_select.  This takes
+ * O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key.  It does not need to be in the tree.
+ * @return                The number of entries with keys less than the
+ *                        given key.
+ */
+
+unsigned int rb_tree_rank(RBTree *tree, RBTreeKey key);
+
+/**
+ * Count the entries in the tree with keys in a given range.  This
+ * takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param low             The lower bound of the range.
+ * @param high            The upper bound of the range.
+ * @return                The number of entries with keys greater than or
+ *                        equal to low, and less than or equal to high.
+ */
+
+unsigned int rb_tree_count_range(RBTree *tree, RBTreeKey low,
+                                 RBTreeKey high);
+
+/**
+ * Find the first node in the tree with a key greater than or equal to
+ * a given key.  This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key to search for.
+ * @return                The first node with a key not less than the
+ *                        given key, or NULL if there is no such node.
+ */
+
+RBTreeNode *rb_tree_lower_bound(RBTree *tree, RBTreeKey key);
+
+/**
+ * Find the first node in the tree with a key greater than a given key.
+ * This takes O(log n) time.
+ *
+ * @param tree            The tree.
+ * @param key             The key to search for.
+ * @return                The first node with a key greater than the
+ *                        given key, or NULL if there is no such node.
+ */
+
+RBTreeNode *rb_tree_upper_bound(RBTree *tree, RBTreeKey key);
+
+/**
+ * Find the node following a given node, in the order of the keys.
+ * This takes O(log n) time in the worst case, but O(1) time on
+ * average when stepping through the whole tree.
+ *
+ * @param node            The tree node.
+ * @return                The next node in the tree, or NULL if this is
+ *                        the last node.
+ */
+
+RBTreeNode *rb_tree_node_next(RBTreeNode *node);
+
+/**
+ * Find the node preceding a given node, in the order of the keys.
+ * This takes O(log n) time in the worst case, but O(1) time on
+ * average when stepping through the whole tree.
+ *
+ * @param node            The tree node.
+ * @return                The previous node in the tree, or NULL if this
+ *                        is the first node.
+ */
+
+RBTreeNode *rb_tree_node_prev(RBTreeNode *node);
+
+/**
+ * Initialise a @ref RBTreeIterator to iterate over the nodes in a tree,
+ * in the order of their keys.  No memory is allocated.  The node most
+ * recently returned by @ref rb_tree_iter_next may be removed from the
+ * tree while iterating; any other change to the tree invalidates the
+ * iterator.
+ *
+ * @param tree            The tree.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void rb_tree_iterate(RBTree *tree, RBTreeIterator *iter);
+
+/**
+ * Initialise a @ref RBTreeIterator to iterate over the nodes in a tree,
+ * starting from the first node with a key greater than or equal to a
+ * given key (see @ref rb_tree_lower_bound).
+ *
+ * @param tree            The tree.
+ * @param key             The key to start from.
+ * @param iter            Pointer to an iterator structure to initialise.
+ */
+
+void rb_tree_iterate_from(RBTree *tree, RBTreeKey key, RBTreeIterator *iter);
+
+/**
+ * Determine if there are more nodes to iterate over.
+ *
+ * @param iter            The iterator.
+ * @return                Zero if there are no more nodes, non-zero if
+ *                        there are more nodes to read.
+ */
+
+int rb_tree_iter_has_more(RBTreeIterator *iter);
+
+/**
+ * Using an iterator, retrieve the next node in the tree.
+ *
+ * @param iter            The iterator.
+ * @return                The next node, or NULL if there are no more
+ *                        nodes.
+ */
+
+RBTreeNode *rb_tree_iter_next(RBTreeIterator *iter);
+
+/**
+ * Invoke a callback function for every node in the tree with a key in
+ * a given range, in the order of the keys.  This takes O(log n + k)
+ * time, where k is the number of nodes in the range.  The callback may
+ * remove the node it is passed from the tree, but must not otherwise
+ * modify the tree.
+ *
+ * @param tree            The tree.
+ * @param low             The lower bound of the range.
+ * @param high            The upper bound of the range.
+ * @param callback        Function to invoke for each node with a key
+ *                        greater than or equal to low, and less than or
+ *                        equal to high.
+ * @param user_data       Extra data to pass to the callback function.
+ * @return                The number of nodes visited.
+ */
+
+unsigned int rb_tree_range_foreach(RBTree *tree,
+                                   RBTreeKey low, RBTreeKey high,
+                                   RBTreeRangeFunc callback,
+                                   void *user_data);
+
 /**
  * Convert the keys in a red-black tree into a C array.  This allows
  * the tree to be used as an ordered set.
@@ -43,6 +43,11 @@ struct _Set {
 	SetHashFunc hash_func;
 	SetEqualFunc equal_func;
 	SetFreeFunc free_func;
+	unsigned int flags;
+	SetEntry **old_table;
+	unsigned int old_table_size;
+	unsigned int resize_index;
+	Allocator *allocator;
 };
 
 /* This is a set of good hash table prime numbers, from:
@@ -59,6 +64,12 @@ static const unsigned int set_primes[] = {
 
 static const unsigned int set_num_primes = sizeof(set_primes) / sizeof(int);
 
+/* Number of chains moved from the old table on each insert when resizing
+ * incrementally.  This must be more than three, so that each resize is
+ * complete before the set is 1/3 full again. */
+
+#define SET_RESIZE_STEP 8
+
 static int set_allocate_table(Set *set)
 {
 	/* Determine the table size based on the current prime index.
@@ -90,10 +101,22 @@ static void set_free_entry(Set *set, SetEntry *entry)
 
 	/* Free the entry structure */
 
-	free(entry);
+	allocator_free(set->allocator, entry, sizeof(SetEntry));
 }
 
 Set *set_new(SetHashFunc hash_func, SetEqualFunc equal_func)
+{
+	return set_new_full(hash_func, equal_func, 0);
+}
+
+Set *set_new_full(SetHashFunc hash_func, SetEqualFunc equal_func,
+                  unsigned int flags)
+{
+	return set_new_with_allocator(hash_func, equal_func, flags, NULL);
+}
+
+Set *set_new_with_allocator(SetHashFunc hash_func, SetEqualFunc equal_func,
+                            unsigned int flags, Allocator *allocator)
 {
 	Set *new_set;
 
@@ -110,6 +133,11 @@ Set *set_new(SetHashFunc hash_func, SetEqualFunc equal_func)
 	new_set->entries = 0;
 	new_set->prime_index = 0;
 	new_set->free_func = NULL;
+	new_set->flags = flags;
+	new_set->old_table = NULL;
+	new_set->old_table_size = 0;
+	new_set->resize_index = 0;
+	new_set->allocator = allocator;
 
 	/* Allocate the table */
 
@@ -121,16 +149,17 @@ Set *set_new(SetHashFunc hash_func, SetEqualFunc equal_func)
 	return new_set;
 }
 
-void set_free(Set *set)
+/* Free all entries in a table of chains */
+
+static void set_free_chains(Set *set, SetEntry **table,
+                            unsigned int table_size)
 {
 	SetEntry *rover;
 	SetEntry *next;
 	unsigned int i;
 
-	/* Free all entries in all chains */
-
-	for (i=0; i<set->table_size; ++i) {
-		rover = set->table[i];
+	for (i=0; i<table_size; ++i) {
+		rover = table[i];
 
 		while (rover != NULL) {
 			next = rover->next;
@@ -144,6 +173,19 @@ void set_free(Set *set)
 			rover = next;
 		}
 	}
+}
+
+void set_free(Set *set)
+{
+	/* Free all entries in all chains, including those not yet moved
+	 * out of the old table if a resize is in progress */
+
+	set_free_chains(set, set->table, set->table_size);
+
+	if (set->old_table != NULL) {
+		set_free_chains(set, set->old_table, set->old_table_size);
+		free(set->old_table);
+	}
 
 	/* Free the table */
 
@@ -159,16 +201,67 @@ void set_register_free_function(Set *set, SetFreeFunc free_func)
 	set->free_func = free_func;
 }
 
-static int set_enlarge(Set *set)
+/* Hook all entries from a chain into the (new) table */
+
+static void set_move_chain(Set *set, SetEntry *rover)
 {
-	SetEntry *rover;
 	SetEntry *next;
+	unsigned int index;
+
+	while (rover != NULL) {
+
+		next = rover->next;
+
+		/* Hook this entry into the new table */
+
+		index = set->hash_func(rover->data) % set->table_size;
+		rover->next = set->table[index];
+		set->table[index] = rover;
+
+		/* Advance to the next entry in the chain */
+
+		rover = next;
+	}
+}
+
+/* When resizing incrementally, move up to count chains from the old
+ * table into the new table.  The old table is freed once it is empty. */
+
+static void set_resize_step(Set *set, unsigned int count)
+{
+	unsigned int index;
+
+	while (count > 0 && set->resize_index < set->old_table_size) {
+		index = set->resize_index;
+
+		set_move_chain(set, set->old_table[index]);
+		set->old_table[index] = NULL;
+
+		++set->resize_index;
+		--count;
+	}
+
+	if (set->resize_index >= set->old_table_size) {
+		free(set->old_table);
+		set->old_table = NULL;
+		set->old_table_size = 0;
+	}
+}
+
+static int set_enlarge(Set *set)
+{
 	SetEntry **old_table;
 	unsigned int old_table_size;
 	unsigned int old_prime_index;
-	unsigned int index;
 	unsigned int i;
 
+	/* If an incremental resize is still in progress, it must be
+	 * completed before starting another one */
+
+	if (set->old_table != NULL) {
+		set_resize_step(set, set->old_table_size);
+	}
+
 	/* Store the old table */
 
 	old_table = set->table;
@@ -189,46 +282,79 @@ static int set_enlarge(Set *set)
 		return 0;
 	}
 
+	/* With incremental resizing, keep the old table around and move
+	 * its entries across a few chains at a time on later inserts */
+
+	if ((set->flags & SET_INCREMENTAL_RESIZE) != 0) {
+		set->old_table = old_table;
+		set->old_table_size = old_table_size;
+		set->resize_index = 0;
+
+		return 1;
+	}
+
 	/* Iterate through all entries in the old table and add them
 	 * to the new one */
 
 	for (i=0; i<old_table_size; ++i) {
+		set_move_chain(set, old_table[i]);
+	}
 
-		/* Walk along this chain */
+	/* Free back the old table */
 
-		rover = old_table[i];
+	free(old_table);
 
-		while (rover != NULL) {
+	/* Resized successfully */
 
-			next = rover->next;
+	return 1;
+}
 
-			/* Hook this entry into the new table */
+/* Find the entry for a value.  Returns a pointer to the link which points
+ * at the entry, which allows the entry to be unlinked, or NULL if the
+ * value is not in the set.  If an incremental resize is in progress,
+ * the entry may be in either table. */
 
-			index = set->hash_func(rover->data) % set->table_size;
-			rover->next = set->table[index];
-			set->table[index] = rover;
+static SetEntry **set_find_entry(Set *set, SetValue data, unsigned int hash)
+{
+	SetEntry **rover;
 
-			/* Advance to the next entry in the chain */
+	rover = &set->table[hash % set->table_size];
 
-			rover = next;
+	while (*rover != NULL) {
+		if (set->equal_func(data, (*rover)->data) != 0) {
+			return rover;
 		}
+
+		rover = &((*rover)->next);
 	}
 
-	/* Free back the old table */
+	if (set->old_table != NULL) {
+		rover = &set->old_table[hash % set->old_table_size];
 
-	free(old_table);
+		while (*rover != NULL) {
+			if (set->equal_func(data, (*rover)->data) != 0) {
+				return rover;
+			}
 
-	/* Resized successfully */
+			rover = &((*rover)->next);
+		}
+	}
 
-	return 1;
+	return NULL;
 }
 
 int set_insert(Set *set, SetValue data)
 {
 	SetEntry *newentry;
-	SetEntry *rover;
+	unsigned int hash;
 	unsigned int index;
 
+	/* Continue any incremental resize in progress */
+
+	if (set->old_table != NULL) {
+		set_resize_step(set, SET_RESIZE_STEP);
+	}
+
 	/* The hash table becomes less efficient as the number of entries
 	 * increases. Check if the percentage used becomes large. */
 
@@ -242,33 +368,24 @@ int set_insert(Set *set, SetValue data)
 		}
 	}
 
-	/* Use the hash of the data to determine an index to insert into the
-	 * table at. */
-
-	index = set->hash_func(data) % set->table_size;
-
-	/* Walk along this chain and attempt to determine if this data has
-	 * already been added to the table */
+	/* Use the hash of the data to determine if this data has already
+	 * been added to the table */
 
-	rover = set->table[index];
+	hash = set->hash_func(data);
 
-	while (rover != NULL) {
-
-		if (set->equal_func(data, rover->data) != 0) {
+	if (set_find_entry(set, data, hash) != NULL) {
 
-			/* This data is already in the set */
-
-			return 0;
-		}
+		/* This data is already in the set */
 
-		rover = rover->next;
+		return 0;
 	}
 
 	/* Not in the set.  We must add a new entry. */
 
 	/* Make a new entry for this data */
 
-	newentry = (SetEntry *) malloc(sizeof(SetEntry));
+	newentry = (SetEntry *) allocator_alloc(set->allocator,
+	                                        sizeof(SetEntry));
 
 	if (newentry == NULL) {
 		return 0;
@@ -276,7 +393,9 @@ int set_insert(Set *set, SetValue data)
 
 	newentry->data = data;
 
-	/* Link into chain */
+	/* Link into chain.  New entries always go into the new table. */
+
+	index = hash % set->table_size;
 
 	newentry->next = set->table[index];
 	set->table[index] = newentry;
@@ -294,77 +413,42 @@ int set_remove(Set *set, SetValue data)
 {
 	SetEntry **rover;
 	SetEntry *entry;
-	unsigned int index;
 
 	/* Look up the data by its hash key */
 
-	index = set->hash_func(data) % set->table_size;
-
-	/* Search this chain, until the corresponding entry is found */
-
-	rover = &set->table[index];
-
-	while (*rover != NULL) {
-		if (set->equal_func(data, (*rover)->data) != 0) {
-
-			/* Found the entry */
+	rover = set_find_entry(set, data, set->hash_func(data));
 
-			entry = *rover;
+	if (rover == NULL) {
 
-			/* Unlink from the linked list */
+		/* Not found in set */
 
-			*rover = entry->next;
+		return 0;
+	}
 
-			/* Update counter */
+	/* Found the entry */
 
-			--set->entries;
+	entry = *rover;
 
-			/* Free the entry and return */
+	/* Unlink from the linked list */
 
-			set_free_entry(set, entry);
+	*rover = entry->next;
 
-			return 1;
-		}
+	/* Update counter */
 
-		/* Advance to the next entry */
+	--set->entries;
 
-		rover = &((*rover)->next);
-	}
+	/* Free the entry and return */
 
-	/* Not found in set */
+	set_free_entry(set, entry);
 
-	return 0;
+	return 1;
 }
 
 int set_query(Set *set, SetValue data)
 {
-	SetEntry *rover;
-	unsigned int index;
-
 	/* Look up the data by its hash key */
 
-	index = set->hash_func(data) % set->table_size;
-
-	/* Search this chain, until the corresponding entry is found */
-
-	rover = set->table[index];
-
-	while (rover != NULL) {
-		if (set->equal_func(data, rover->data) != 0) {
-
-			/* Found the entry */
-
-			return 1;
-		}
-
-		/* Advance to the next entry in the chain */
-
-		rover = rover->next;
-	}
-
-	/* Not found */
-
-	return 0;
+	return set_find_entry(set, data, set->hash_func(data)) != NULL;
 }
 
 unsigned int set_num_entries(Set *set)
@@ -372,10 +456,24 @@ unsigned int set_num_entries(Set *set)
 	return set->entries;
 }
 
+/* Get the head of a chain, for iteration.  Chain numbers beyond the end
+ * of the table refer to the old table, if an incremental resize is in
+ * progress. */
+
+static SetEntry *set_chain(Set *set, unsigned int chain)
+{
+	if (chain < set->table_size) {
+		return set->table[chain];
+	} else {
+		return set->old_table[chain - set->table_size];
+	}
+}
+
 SetValue *set_to_array(Set *set)
 {
 	SetValue *array;
 	int array_counter;
+	unsigned int num_chains;
 	unsigned int i;
 	SetEntry *rover;
 
@@ -391,9 +489,11 @@ SetValue *set_to_array(Set *set)
 
 	/* Iterate over all entries in all chains */
 
-	for (i=0; i<set->table_size; ++i) {
+	num_chains = set->table_size + set->old_table_size;
 
-		rover = set->table[i];
+	for (i=0; i<num_chains; ++i) {
+
+		rover = set_chain(set, i);
 
 		while (rover != NULL) {
 
@@ -417,7 +517,8 @@ Set *set_union(Set *set1, Set *set2)
 	Set *new_set;
 	SetValue value;
 
-	new_set = set_new(set1->hash_func, set1->equal_func);
+	new_set = set_new_with_allocator(set1->hash_func, set1->equal_func,
+	                                 set1->flags, set1->allocator);
 
 	if (new_set == NULL) {
 		return NULL;
@@ -477,7 +578,8 @@ Set *set_intersection(Set *set1, Set *set2)
 	SetIterator iterator;
 	SetValue value;
 
-	new_set = set_new(set1->hash_func, set2->equal_func);
+	new_set = set_new_with_allocator(set1->hash_func, set2->equal_func,
+	                                 set1->flags, set1->allocator);
 
 	if (new_set == NULL) {
 		return NULL;
@@ -514,6 +616,7 @@ Set *set_intersection(Set *set1, Set *set2)
 
 void set_iterate(Set *set, SetIterator *iter)
 {
+	unsigned int num_chains;
 	unsigned int chain;
 
 	iter->set = set;
@@ -521,12 +624,14 @@ void set_iterate(Set *set, SetIterator *iter)
 
 	/* Find the first entry */
 
-	for (chain = 0; chain < set->table_size; ++chain) {
+	num_chains = set->table_size + set->old_table_size;
+
+	for (chain = 0; chain < num_chains; ++chain) {
 
 		/* There is a value at the start of this chain */
 
-		if (set->table[chain] != NULL) {
-			iter->next_entry = set->table[chain];
+		if (set_chain(set, chain) != NULL) {
+			iter->next_entry = set_chain(set, chain);
 			break;
 		}
 	}
@@ -539,6 +644,7 @@ SetValue set_iter_next(SetIterator *iterator)
 	Set *set;
 	SetValue result;
 	SetEntry *current_entry;
+	unsigned int num_chains;
 	unsigned int chain;
 
 	set = iterator->set;
@@ -571,16 +677,17 @@ SetValue set_iter_next(SetIterator *iterator)
 		/* No more entries in this chain.  Search the next chain */
 
 		chain = iterator->next_chain + 1;
+		num_chains = set->table_size + set->old_table_size;
 
-		while (chain < set->table_size) {
+		while (chain < num_chains) {
 
 			/* Is there a chain at this table entry? */
 
-			if (set->table[chain] != NULL) {
+			if (set_chain(set, chain) != NULL) {
 
 				/* Valid chain found! */
 
-				iterator->next_entry = set->table[chain];
+				iterator->next_entry = set_chain(set, chain);
 
 				break;
 			}
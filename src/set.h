@@ -27,7 +27,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * the set.
  *
  * To create a new set, use @ref set_new.  To destroy a set, use
- * @ref set_free.
+ * @ref set_free.  A set that is resized incrementally can be created
+ * using @ref set_new_full.
  *
  * To add a value to a set, use @ref set_insert.  To remove a value
  * from a set, use @ref set_remove.
@@ -47,6 +48,8 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #ifndef ALGORITHM_SET_H
 #define ALGORITHM_SET_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -114,6 +117,22 @@ typedef int (*SetEqualFunc)(SetValue value1, SetValue value2);
 
 typedef void (*SetFreeFunc)(SetValue value);
 
+/**
+ * Flags that can be passed to @ref set_new_full.
+ */
+
+typedef enum {
+
+	/** Resize the set incrementally.  When the set is enlarged, the
+	 *  old table is kept and values are moved into the new table a
+	 *  few chains at a time on each subsequent insert, rather than
+	 *  all at once.  This bounds the time taken by any single
+	 *  insert, regardless of the size of the set. */
+
+	SET_INCREMENTAL_RESIZE = 1 << 0
+
+} SetFlags;
+
 /**
  * Create a new set.
  *
@@ -126,6 +145,37 @@ typedef void (*SetFreeFunc)(SetValue value);
 
 Set *set_new(SetHashFunc hash_func, SetEqualFunc equal_func);
 
+/**
+ * Create a new set, specifying flags to control its behavior.
+ *
+ * @param hash_func     Hash function used on values in the set.
+ * @param equal_func    Compares two values in the set to determine
+ *                      if they are equal.
+ * @param flags         Bitwise OR of @ref SetFlags values, or zero for
+ *                      the default behavior.
+ * @return              A new set, or NULL if it was not possible to
+ *                      allocate the memory for the set.
+ */
+
+Set *set_new_full(SetHashFunc hash_func, SetEqualFunc equal_func,
+                  unsigned int flags);
+
+/**
+ * Create a new set, using a custom allocator for its entries.
+ *
+ * @param hash_func     Hash function used on values in the set.
+ * @param equal_func    Compares two values in the set to determine
+ *                      if they are equal.
+ * @param flags         Bitwise OR of @ref SetFlags values, or zero for
+ *                      the default behavior.
+ * @param allocator     The allocator to use, or NULL to use malloc().
+ * @return              A new set, or NULL if it was not possible to
+ *                      allocate the memory for the set.
+ */
+
+Set *set_new_with_allocator(SetHashFunc hash_func, SetEqualFunc equal_func,
+                            unsigned int flags, Allocator *allocator);
+
 /**
  * Destroy a set.
  *
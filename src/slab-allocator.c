@@ -0,0 +1,286 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+
+#include "slab-allocator.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* Slabs start small and double in size as more are needed, up to a
+ * maximum number of objects per slab. */
+
+#define SLAB_MIN_OBJECTS 16
+#define SLAB_MAX_OBJECTS 4096
+
+typedef struct _Slab Slab;
+
+/* Header at the start of each slab; the objects follow it.  The padding
+ * keeps the objects aligned in the same way as slab_allocator_round_size. */
+
+struct _Slab {
+	Slab *next;
+	void *padding;
+};
+
+typedef struct _SlabLargeBlock SlabLargeBlock;
+
+/* Header at the start of each block too large for the pool.  These are
+ * allocated individually with malloc(), but kept in a list so that any
+ * not freed back are freed with the slab allocator.  The header is the
+ * same size as the slab header, so the block stays aligned. */
+
+struct _SlabLargeBlock {
+	SlabLargeBlock *prev;
+	SlabLargeBlock *next;
+};
+
+struct _SlabAllocator {
+	Allocator allocator;
+	size_t object_size;
+	size_t slab_objects;
+	Slab *slabs;
+	char *next_object;
+	char *end;
+	void *free_list;
+	SlabLargeBlock *large_blocks;
+};
+
+/* Round an object size up so that every object is suitably aligned
+ * and large enough to hold a free list pointer. */
+
+static size_t slab_allocator_round_size(size_t size)
+{
+	size_t align;
+
+	align = sizeof(void *) * 2;
+
+	return (size + align - 1) / align * align;
+}
+
+static int slab_allocator_new_slab(SlabAllocator *slab_allocator)
+{
+	Slab *slab;
+
+	slab = malloc(sizeof(Slab) + slab_allocator->object_size
+	                             * slab_allocator->slab_objects);
+
+	if (slab == NULL) {
+		return 0;
+	}
+
+	/* Add to the list of slabs */
+
+	slab->next = slab_allocator->slabs;
+	slab_allocator->slabs = slab;
+
+	slab_allocator->next_object = (char *) (slab + 1);
+	slab_allocator->end = slab_allocator->next_object
+	                    + slab_allocator->object_size
+	                    * slab_allocator->slab_objects;
+
+	/* The next slab is twice as big */
+
+	if (slab_allocator->slab_objects < SLAB_MAX_OBJECTS) {
+		slab_allocator->slab_objects *= 2;
+	}
+
+	return 1;
+}
+
+static void *slab_allocator_alloc_large(SlabAllocator *slab_allocator,
+                                        size_t size)
+{
+	SlabLargeBlock *block;
+
+	if (size > (size_t) -1 - sizeof(SlabLargeBlock)) {
+		return NULL;
+	}
+
+	block = malloc(sizeof(SlabLargeBlock) + size);
+
+	if (block == NULL) {
+		return NULL;
+	}
+
+	/* Add to the list of large blocks */
+
+	block->prev = NULL;
+	block->next = slab_allocator->large_blocks;
+
+	if (block->next != NULL) {
+		block->next->prev = block;
+	}
+
+	slab_allocator->large_blocks = block;
+
+	return block + 1;
+}
+
+static void slab_allocator_free_large(SlabAllocator *slab_allocator,
+                                      void *ptr)
+{
+	SlabLargeBlock *block;
+
+	block = (SlabLargeBlock *) ptr - 1;
+
+	/* Unlink from the list of large blocks */
+
+	if (block->prev != NULL) {
+		block->prev->next = block->next;
+	} else {
+		slab_allocator->large_blocks = block->next;
+	}
+
+	if (block->next != NULL) {
+		block->next->prev = block->prev;
+	}
+
+	free(block);
+}
+
+static void *slab_allocator_alloc(void *user_data, size_t size)
+{
+	SlabAllocator *slab_allocator;
+	void *result;
+
+	slab_allocator = user_data;
+
+	/* The first allocation determines the object size if it has not
+	 * been set already */
+
+	if (slab_allocator->object_size == 0) {
+		slab_allocator->object_size = slab_allocator_round_size(size);
+	}
+
+	/* Large blocks do not come from the pool */
+
+	if (size > slab_allocator->object_size) {
+		return slab_allocator_alloc_large(slab_allocator, size);
+	}
+
+	/* Reuse a previously freed object if possible */
+
+	if (slab_allocator->free_list != NULL) {
+		result = slab_allocator->free_list;
+		slab_allocator->free_list = *((void **) result);
+
+		return result;
+	}
+
+	/* Otherwise, take the next object from the current slab */
+
+	if (slab_allocator->next_object == slab_allocator->end) {
+		if (!slab_allocator_new_slab(slab_allocator)) {
+			return NULL;
+		}
+	}
+
+	result = slab_allocator->next_object;
+	slab_allocator->next_object += slab_allocator->object_size;
+
+	return result;
+}
+
+static void slab_allocator_free_object(void *user_data, void *ptr,
+                                       size_t size)
+{
+	SlabAllocator *slab_allocator;
+
+	slab_allocator = user_data;
+
+	if (size > slab_allocator->object_size) {
+		slab_allocator_free_large(slab_allocator, ptr);
+		return;
+	}
+
+	/* Add to the free list */
+
+	*((void **) ptr) = slab_allocator->free_list;
+	slab_allocator->free_list = ptr;
+}
+
+SlabAllocator *slab_allocator_new(size_t object_size)
+{
+	SlabAllocator *slab_allocator;
+
+	slab_allocator = (SlabAllocator *) malloc(sizeof(SlabAllocator));
+
+	if (slab_allocator == NULL) {
+		return NULL;
+	}
+
+	slab_allocator->allocator.alloc_func = slab_allocator_alloc;
+	slab_allocator->allocator.free_func = slab_allocator_free_object;
+	slab_allocator->allocator.user_data = slab_allocator;
+
+	if (object_size > 0) {
+		object_size = slab_allocator_round_size(object_size);
+	}
+
+	slab_allocator->object_size = object_size;
+	slab_allocator->slab_objects = SLAB_MIN_OBJECTS;
+	slab_allocator->slabs = NULL;
+	slab_allocator->next_object = NULL;
+	slab_allocator->end = NULL;
+	slab_allocator->free_list = NULL;
+	slab_allocator->large_blocks = NULL;
+
+	return slab_allocator;
+}
+
+void slab_allocator_free(SlabAllocator *slab_allocator)
+{
+	Slab *slab;
+	Slab *next;
+	SlabLargeBlock *block;
+	SlabLargeBlock *next_block;
+
+	/* Free all slabs */
+
+	slab = slab_allocator->slabs;
+
+	while (slab != NULL) {
+		next = slab->next;
+		free(slab);
+		slab = next;
+	}
+
+	/* Free any large blocks still allocated */
+
+	block = slab_allocator->large_blocks;
+
+	while (block != NULL) {
+		next_block = block->next;
+		free(block);
+		block = next_block;
+	}
+
+	free(slab_allocator);
+}
+
+Allocator *slab_allocator_get_allocator(SlabAllocator *slab_allocator)
+{
+	return &slab_allocator->allocator;
+}
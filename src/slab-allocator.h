@@ -0,0 +1,100 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file slab-allocator.h
+ *
+ * @brief Fixed-size pool allocator.
+ *
+ * A slab allocator hands out fixed-size blocks of memory carved from
+ * larger slabs, and keeps freed blocks on a free list for reuse.  It
+ * can be used as the @ref Allocator for a data structure, so that its
+ * nodes are pooled together rather than allocated individually with
+ * malloc().  Because each data structure can have its own pool, this
+ * also avoids contention on the system allocator between threads.
+ * A slab allocator is not itself thread safe: it should only be used
+ * by data structures accessed from a single thread at a time.
+ *
+ * Requests for blocks larger than the object size of the pool are
+ * passed through to malloc().  These blocks are still owned by the
+ * slab allocator, and any not freed back individually are freed with
+ * it.
+ *
+ * To create a slab allocator, use @ref slab_allocator_new.  The
+ * @ref Allocator structure to pass to a data structure is obtained
+ * using @ref slab_allocator_get_allocator.  To destroy a slab
+ * allocator, use @ref slab_allocator_free; this frees all slabs at
+ * once, so it must only be called once all data structures using the
+ * allocator have been freed.
+ */
+
+#ifndef ALGORITHM_SLAB_ALLOCATOR_H
+#define ALGORITHM_SLAB_ALLOCATOR_H
+
+#include "allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A slab allocator.
+ */
+
+typedef struct _SlabAllocator SlabAllocator;
+
+/**
+ * Create a new slab allocator.
+ *
+ * @param object_size    Size of the blocks allocated from the pool, in
+ *                       bytes.  If zero, the size of the first block
+ *                       requested is used; this is convenient when the
+ *                       size of the nodes of a data structure is not
+ *                       known.
+ * @return               A new slab allocator, or NULL if it was not
+ *                       possible to allocate the memory.
+ */
+
+SlabAllocator *slab_allocator_new(size_t object_size);
+
+/**
+ * Destroy a slab allocator, freeing back all memory allocated from it.
+ *
+ * @param slab_allocator The slab allocator.
+ */
+
+void slab_allocator_free(SlabAllocator *slab_allocator);
+
+/**
+ * Get the @ref Allocator structure for a slab allocator, to pass to
+ * the constructor of a data structure.
+ *
+ * @param slab_allocator The slab allocator.
+ * @return               Pointer to an allocator structure, valid for
+ *                       the lifetime of the slab allocator.
+ */
+
+Allocator *slab_allocator_get_allocator(SlabAllocator *slab_allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_SLAB_ALLOCATOR_H */
@@ -318,96 +318,100 @@ unsigned int slist_remove_data(SListEntry **list, SListEqualFunc callback,
 	return entries_removed;
 }
 
-/* Function used internally for sorting.  Returns the last entry in the
- * new sorted list */
+/* Lists are sorted using a bottom-up merge sort.  On each pass, the
+ * list is treated as a sequence of sorted runs of a given size, which
+ * are merged together in pairs; the run size doubles every pass until
+ * a single run remains.  Entries are relinked in place, so no extra
+ * memory is needed and nothing recurses.  When values compare equal,
+ * the entry from the earlier run is taken first, so the sort is
+ * stable. */
 
-static SListEntry *slist_sort_internal(SListEntry **list,
-                                       SListCompareFunc compare_func)
+void slist_sort(SListEntry **list, SListCompareFunc compare_func)
 {
-	SListEntry *pivot;
-	SListEntry *rover;
-	SListEntry *less_list, *more_list;
-	SListEntry *less_list_end, *more_list_end;
-
-	/* If there are less than two entries in this list, it is
-	 * already sorted */
+	SListEntry *left, *right;
+	SListEntry *entry;
+	SListEntry *tail;
+	unsigned int run_size;
+	unsigned int left_size, right_size;
+	unsigned int num_merges;
+	unsigned int i;
+	int take_left;
 
-	if (*list == NULL || (*list)->next == NULL) {
-		return *list;
+	if (*list == NULL) {
+		return;
 	}
 
-	/* The first entry is the pivot */
+	for (run_size = 1; ; run_size *= 2) {
 
-	pivot = *list;
+		left = *list;
+		tail = NULL;
+		num_merges = 0;
 
-	/* Iterate over the list, starting from the second entry.  Sort
-	 * all entries into the less and more lists based on comparisons
-	 * with the pivot */
+		while (left != NULL) {
 
-	less_list = NULL;
-	more_list = NULL;
-	rover = (*list)->next;
+			++num_merges;
 
-	while (rover != NULL) {
-		SListEntry *next = rover->next;
-
-		if (compare_func(rover->data, pivot->data) < 0) {
-
-			/* Place this in the less list */
-
-			rover->next = less_list;
-			less_list = rover;
-
-		} else {
+			/* Find the start of the right hand run */
 
-			/* Place this in the more list */
+			right = left;
+			left_size = 0;
 
-			rover->next = more_list;
-			more_list = rover;
+			for (i=0; i<run_size && right != NULL; ++i) {
+				++left_size;
+				right = right->next;
+			}
 
-		}
+			right_size = run_size;
 
-		rover = next;
-	}
+			/* Merge the two runs onto the tail of the list */
 
-	/* Sort the sublists recursively */
+			while (left_size > 0
+			    || (right_size > 0 && right != NULL)) {
 
-	less_list_end = slist_sort_internal(&less_list, compare_func);
-	more_list_end = slist_sort_internal(&more_list, compare_func);
+				if (left_size == 0) {
+					take_left = 0;
+				} else if (right_size == 0 || right == NULL) {
+					take_left = 1;
+				} else {
+					take_left = compare_func(right->data,
+					                         left->data) >= 0;
+				}
 
-	/* Create the new list starting from the less list */
+				if (take_left) {
+					entry = left;
+					left = left->next;
+					--left_size;
+				} else {
+					entry = right;
+					right = right->next;
+					--right_size;
+				}
 
-	*list = less_list;
+				if (tail == NULL) {
+					*list = entry;
+				} else {
+					tail->next = entry;
+				}
 
-	/* Append the pivot to the end of the less list.  If the less list
-	 * was empty, start from the pivot */
+				tail = entry;
+			}
 
-	if (less_list == NULL) {
-		*list = pivot;
-	} else {
-		less_list_end->next = pivot;
-	}
+			/* Continue from the entry following the right run */
 
-	/* Append the more list after the pivot */
+			left = right;
+		}
 
-	pivot->next = more_list;
+		tail->next = NULL;
 
-	/* Work out what the last entry in the list is.  If the more list was
-	 * empty, the pivot was the last entry.  Otherwise, the end of the
-	 * more list is the end of the total list. */
+		/* Once a pass makes only a single merge, the whole list is
+		 * one sorted run */
 
-	if (more_list == NULL) {
-		return pivot;
-	} else {
-		return more_list_end;
+		if (num_merges <= 1) {
+			break;
+		}
 	}
 }
 
-void slist_sort(SListEntry **list, SListCompareFunc compare_func)
-{
-	slist_sort_internal(list, compare_func);
-}
-
 SListEntry *slist_find_data(SListEntry *list,
                             SListEqualFunc callback,
                             SListValue data)
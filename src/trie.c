@@ -20,8 +20,26 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 /* Trie: fast mapping of strings to values */
 
+/* The trie is implemented as an adaptive radix tree, as described in
+ * "The Adaptive Radix Tree: ARTful Indexing for Main-Memory Databases"
+ * (Leis, Kemper and Neumann, 2013).
+ *
+ * Rather than every node holding an array of 256 pointers, inner nodes
+ * come in four sizes, holding up to 4, 16, 48 or 256 children, and are
+ * replaced with a larger or smaller node as children are added and
+ * removed.  Chains of nodes with only one child are collapsed into a
+ * prefix stored in the node below them (path compression).  Each key
+ * is stored in full in a leaf, along with its value.  A key may also be
+ * a prefix of other keys, so an inner node can have a leaf for the key
+ * which ends at that node, as well as its children. */
+
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "trie.h"
 
@@ -31,19 +49,640 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "alloc-testing.h"
 #endif
 
+/* Maximum number of prefix bytes stored in a node.  Longer prefixes are
+ * skipped over when searching, and the key is checked against the full
+ * key stored in the leaf at the end of the search instead. */
+
+#define TRIE_MAX_PREFIX 9
+
+typedef enum {
+	TRIE_NODE_LEAF,
+	TRIE_NODE_4,
+	TRIE_NODE_16,
+	TRIE_NODE_48,
+	TRIE_NODE_256
+} TrieNodeType;
+
 typedef struct _TrieNode TrieNode;
 
+/* Header common to all inner nodes.  The first field of a leaf is also
+ * its type, so a TrieNode pointer can point to either, and the type is
+ * determined using trie_node_type().  num_leaves is the number of keys
+ * stored below the node, including its own leaf, so that keys with a
+ * prefix can be counted without visiting them. */
+
 struct _TrieNode {
-	TrieValue data;
-	unsigned int use_count;
-	TrieNode *next[256];
+	unsigned char type;
+	unsigned char prefix[TRIE_MAX_PREFIX];
+	unsigned short num_children;
+	unsigned int prefix_length;
+	unsigned int num_leaves;
+	TrieNode *leaf;
 };
 
+typedef struct _TrieLeaf {
+	unsigned char type;
+	unsigned int key_length;
+	TrieValue value;
+	unsigned char key[];
+} TrieLeaf;
+
+/* Node4 and Node16 keep their keys sorted.  Node48 maps each byte to
+ * one of its child slots (plus one, so that zero means no child); and
+ * Node256 is indexed directly. */
+
+typedef struct _TrieNode4 {
+	TrieNode header;
+	unsigned char keys[4];
+	TrieNode *children[4];
+} TrieNode4;
+
+typedef struct _TrieNode16 {
+	TrieNode header;
+	unsigned char keys[16];
+	TrieNode *children[16];
+} TrieNode16;
+
+typedef struct _TrieNode48 {
+	TrieNode header;
+	unsigned char index[256];
+	TrieNode *children[48];
+} TrieNode48;
+
+typedef struct _TrieNode256 {
+	TrieNode header;
+	TrieNode *children[256];
+} TrieNode256;
+
 struct _Trie {
 	TrieNode *root_node;
+	unsigned int num_entries;
+	Allocator *allocator;
 };
 
+static unsigned int trie_node_type(TrieNode *node)
+{
+	return *((unsigned char *) node);
+}
+
+static size_t trie_node_size(TrieNode *node)
+{
+	switch (trie_node_type(node)) {
+		case TRIE_NODE_4:
+			return sizeof(TrieNode4);
+		case TRIE_NODE_16:
+			return sizeof(TrieNode16);
+		case TRIE_NODE_48:
+			return sizeof(TrieNode48);
+		case TRIE_NODE_256:
+			return sizeof(TrieNode256);
+		default:
+			return offsetof(TrieLeaf, key)
+			     + ((TrieLeaf *) node)->key_length + 1;
+	}
+}
+
+/* Allocate a new inner node, with all fields initialised to zero */
+
+static TrieNode *trie_new_node(Trie *trie, TrieNodeType type)
+{
+	TrieNode *node;
+	size_t size;
+
+	switch (type) {
+		case TRIE_NODE_4:
+			size = sizeof(TrieNode4);
+			break;
+		case TRIE_NODE_16:
+			size = sizeof(TrieNode16);
+			break;
+		case TRIE_NODE_48:
+			size = sizeof(TrieNode48);
+			break;
+		default:
+			size = sizeof(TrieNode256);
+			break;
+	}
+
+	node = allocator_alloc(trie->allocator, size);
+
+	if (node != NULL) {
+		memset(node, 0, size);
+		node->type = (unsigned char) type;
+	}
+
+	return node;
+}
+
+static TrieLeaf *trie_new_leaf(Trie *trie, unsigned char *key,
+                               unsigned int key_length, TrieValue value)
+{
+	TrieLeaf *leaf;
+
+	/* Keys are stored with a terminating NUL so that string keys can
+	 * be returned from iterators. */
+
+	leaf = allocator_alloc(trie->allocator,
+	                       offsetof(TrieLeaf, key) + key_length + 1);
+
+	if (leaf == NULL) {
+		return NULL;
+	}
+
+	leaf->type = TRIE_NODE_LEAF;
+	leaf->key_length = key_length;
+	leaf->value = value;
+	memcpy(leaf->key, key, key_length);
+	leaf->key[key_length] = '\0';
+
+	return leaf;
+}
+
+static void trie_free_node(Trie *trie, TrieNode *node)
+{
+	allocator_free(trie->allocator, node, trie_node_size(node));
+}
+
+static int trie_leaf_matches(TrieLeaf *leaf, unsigned char *key,
+                             unsigned int key_length)
+{
+	return leaf->key_length == key_length
+	    && memcmp(leaf->key, key, key_length) == 0;
+}
+
+/* Find the index of the lowest set bit in a non-zero mask */
+
+static unsigned int trie_first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return (unsigned int) __builtin_ctz(mask);
+#else
+	unsigned int result;
+
+	result = 0;
+
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		++result;
+	}
+
+	return result;
+#endif
+}
+
+/* Find the child of a node for the given byte.  Returns a pointer to
+ * the pointer to the child within the node, or NULL if there is no
+ * child for that byte. */
+
+static TrieNode **trie_find_child(TrieNode *node, unsigned char c)
+{
+	TrieNode4 *node4;
+	TrieNode16 *node16;
+	TrieNode48 *node48;
+	TrieNode256 *node256;
+	unsigned int mask;
+	unsigned int i;
+
+	switch (node->type) {
+		case TRIE_NODE_4:
+			node4 = (TrieNode4 *) node;
+
+			for (i=0; i<node->num_children; ++i) {
+				if (node4->keys[i] == c) {
+					return &node4->children[i];
+				}
+			}
+			break;
+
+		case TRIE_NODE_16:
+			node16 = (TrieNode16 *) node;
+
+			/* Compare against all 16 keys at once */
+#ifdef __SSE2__
+			mask = (unsigned int) _mm_movemask_epi8(
+			    _mm_cmpeq_epi8(
+			        _mm_set1_epi8((char) c),
+			        _mm_loadu_si128((__m128i *) node16->keys)));
+#else
+			mask = 0;
+
+			for (i=0; i<16; ++i) {
+				if (node16->keys[i] == c) {
+					mask |= 1U << i;
+				}
+			}
+#endif
+			mask &= (1U << node->num_children) - 1;
+
+			if (mask != 0) {
+				return &node16->children[trie_first_bit(mask)];
+			}
+			break;
+
+		case TRIE_NODE_48:
+			node48 = (TrieNode48 *) node;
+
+			if (node48->index[c] != 0) {
+				return &node48->children[node48->index[c] - 1];
+			}
+			break;
+
+		case TRIE_NODE_256:
+			node256 = (TrieNode256 *) node;
+
+			if (node256->children[c] != NULL) {
+				return &node256->children[c];
+			}
+			break;
+	}
+
+	return NULL;
+}
+
+/* Find the first child of a node, in key order, with a key byte of at
+ * least start.  The key byte is stored in *c.  Returns NULL if there
+ * are no more children. */
+
+static TrieNode *trie_next_child(TrieNode *node, unsigned int start,
+                                 unsigned char *c)
+{
+	TrieNode4 *node4;
+	TrieNode16 *node16;
+	TrieNode48 *node48;
+	TrieNode256 *node256;
+	unsigned char *keys;
+	TrieNode **children;
+	unsigned int i;
+
+	switch (node->type) {
+		case TRIE_NODE_4:
+		case TRIE_NODE_16:
+			if (node->type == TRIE_NODE_4) {
+				node4 = (TrieNode4 *) node;
+				keys = node4->keys;
+				children = node4->children;
+			} else {
+				node16 = (TrieNode16 *) node;
+				keys = node16->keys;
+				children = node16->children;
+			}
+
+			for (i=0; i<node->num_children; ++i) {
+				if (keys[i] >= start) {
+					*c = keys[i];
+					return children[i];
+				}
+			}
+			break;
+
+		case TRIE_NODE_48:
+			node48 = (TrieNode48 *) node;
+
+			for (i=start; i<256; ++i) {
+				if (node48->index[i] != 0) {
+					*c = (unsigned char) i;
+					return node48->children[node48->index[i] - 1];
+				}
+			}
+			break;
+
+		case TRIE_NODE_256:
+			node256 = (TrieNode256 *) node;
+
+			for (i=start; i<256; ++i) {
+				if (node256->children[i] != NULL) {
+					*c = (unsigned char) i;
+					return node256->children[i];
+				}
+			}
+			break;
+	}
+
+	return NULL;
+}
+
+/* Test if a node has room for another child */
+
+static int trie_node_is_full(TrieNode *node)
+{
+	switch (node->type) {
+		case TRIE_NODE_4:
+			return node->num_children >= 4;
+		case TRIE_NODE_16:
+			return node->num_children >= 16;
+		case TRIE_NODE_48:
+			return node->num_children >= 48;
+		default:
+			return 0;
+	}
+}
+
+/* Add a child to a node, which must have room for it */
+
+static void trie_insert_child(TrieNode *node, unsigned char c,
+                              TrieNode *child)
+{
+	TrieNode4 *node4;
+	TrieNode16 *node16;
+	TrieNode48 *node48;
+	TrieNode256 *node256;
+	unsigned char *keys;
+	TrieNode **children;
+	unsigned int i;
+
+	switch (node->type) {
+		case TRIE_NODE_4:
+		case TRIE_NODE_16:
+			if (node->type == TRIE_NODE_4) {
+				node4 = (TrieNode4 *) node;
+				keys = node4->keys;
+				children = node4->children;
+			} else {
+				node16 = (TrieNode16 *) node;
+				keys = node16->keys;
+				children = node16->children;
+			}
+
+			/* Keep the keys in sorted order */
+
+			for (i=0; i<node->num_children; ++i) {
+				if (keys[i] > c) {
+					break;
+				}
+			}
+
+			memmove(keys + i + 1, keys + i,
+			        node->num_children - i);
+			memmove(children + i + 1, children + i,
+			        (node->num_children - i) * sizeof(TrieNode *));
+
+			keys[i] = c;
+			children[i] = child;
+			break;
+
+		case TRIE_NODE_48:
+			node48 = (TrieNode48 *) node;
+
+			/* Find a free slot */
+
+			for (i=0; node48->children[i] != NULL; ++i);
+
+			node48->children[i] = child;
+			node48->index[c] = (unsigned char) (i + 1);
+			break;
+
+		case TRIE_NODE_256:
+			node256 = (TrieNode256 *) node;
+			node256->children[c] = child;
+			break;
+	}
+
+	++node->num_children;
+}
+
+static void trie_remove_child(TrieNode *node, unsigned char c)
+{
+	TrieNode4 *node4;
+	TrieNode16 *node16;
+	TrieNode48 *node48;
+	TrieNode256 *node256;
+	unsigned char *keys;
+	TrieNode **children;
+	unsigned int i;
+
+	switch (node->type) {
+		case TRIE_NODE_4:
+		case TRIE_NODE_16:
+			if (node->type == TRIE_NODE_4) {
+				node4 = (TrieNode4 *) node;
+				keys = node4->keys;
+				children = node4->children;
+			} else {
+				node16 = (TrieNode16 *) node;
+				keys = node16->keys;
+				children = node16->children;
+			}
+
+			for (i=0; keys[i] != c; ++i);
+
+			memmove(keys + i, keys + i + 1,
+			        node->num_children - i - 1U);
+			memmove(children + i, children + i + 1,
+			        (node->num_children - i - 1U)
+			        * sizeof(TrieNode *));
+			break;
+
+		case TRIE_NODE_48:
+			node48 = (TrieNode48 *) node;
+			node48->children[node48->index[c] - 1] = NULL;
+			node48->index[c] = 0;
+			break;
+
+		case TRIE_NODE_256:
+			node256 = (TrieNode256 *) node;
+			node256->children[c] = NULL;
+			break;
+	}
+
+	--node->num_children;
+}
+
+/* Replace a node with a node of a different size, containing the same
+ * children.  Returns the new node, or NULL if it could not be allocated,
+ * in which case the old node is left unchanged. */
+
+static TrieNode *trie_resize_node(Trie *trie, TrieNode *node,
+                                  TrieNodeType type)
+{
+	TrieNode *new_node;
+	TrieNode *child;
+	unsigned int start;
+	unsigned char c;
+
+	new_node = trie_new_node(trie, type);
+
+	if (new_node == NULL) {
+		return NULL;
+	}
+
+	memcpy(new_node->prefix, node->prefix, TRIE_MAX_PREFIX);
+	new_node->prefix_length = node->prefix_length;
+	new_node->num_leaves = node->num_leaves;
+	new_node->leaf = node->leaf;
+
+	/* Copy all children across */
+
+	start = 0;
+
+	while (start < 256
+	    && (child = trie_next_child(node, start, &c)) != NULL) {
+		trie_insert_child(new_node, c, child);
+		start = c + 1U;
+	}
+
+	trie_free_node(trie, node);
+
+	return new_node;
+}
+
+/* Add a child to the node pointed to by ref, replacing it with a larger
+ * node if it is full.  Returns zero if it was not possible to allocate
+ * the larger node. */
+
+static int trie_add_child(Trie *trie, TrieNode **ref, unsigned char c,
+                          TrieNode *child)
+{
+	TrieNode *node;
+
+	node = *ref;
+
+	if (trie_node_is_full(node)) {
+		node = trie_resize_node(trie, node,
+		                        (TrieNodeType) (node->type + 1));
+
+		if (node == NULL) {
+			return 0;
+		}
+
+		*ref = node;
+	}
+
+	trie_insert_child(node, c, child);
+
+	return 1;
+}
+
+/* Find the first leaf below a node, in key order: the leaf of a node
+ * precedes all of its children. */
+
+static TrieLeaf *trie_first_leaf(TrieNode *node)
+{
+	unsigned char c;
+
+	while (trie_node_type(node) != TRIE_NODE_LEAF) {
+		if (node->leaf != NULL) {
+			node = node->leaf;
+		} else {
+			node = trie_next_child(node, 0, &c);
+		}
+	}
+
+	return (TrieLeaf *) node;
+}
+
+/* Get the full prefix of a node at the given depth.  All leaves below a
+ * node have the node's full prefix, so bytes that are not stored in the
+ * node are read from a leaf. */
+
+static unsigned char *trie_prefix_bytes(TrieNode *node, unsigned int depth)
+{
+	if (node->prefix_length <= TRIE_MAX_PREFIX) {
+		return node->prefix;
+	} else {
+		return trie_first_leaf(node)->key + depth;
+	}
+}
+
+static void trie_set_prefix(TrieNode *node, unsigned char *prefix,
+                            unsigned int prefix_length)
+{
+	node->prefix_length = prefix_length;
+
+	if (prefix_length > TRIE_MAX_PREFIX) {
+		prefix_length = TRIE_MAX_PREFIX;
+	}
+
+	memcpy(node->prefix, prefix, prefix_length);
+}
+
+/* Check the stored part of a node's prefix against a key, starting at
+ * the given depth in the key. */
+
+static int trie_check_prefix(TrieNode *node, unsigned char *key,
+                             unsigned int key_length, unsigned int depth)
+{
+	unsigned int length;
+
+	if (key_length - depth < node->prefix_length) {
+		return 0;
+	}
+
+	length = node->prefix_length;
+
+	if (length > TRIE_MAX_PREFIX) {
+		length = TRIE_MAX_PREFIX;
+	}
+
+	return memcmp(node->prefix, key + depth, length) == 0;
+}
+
+/* Find the number of bytes of a node's prefix that match the key,
+ * starting at the given depth in the key. */
+
+static unsigned int trie_prefix_mismatch(TrieNode *node, unsigned char *key,
+                                         unsigned int key_length,
+                                         unsigned int depth)
+{
+	unsigned char *prefix;
+	unsigned int limit;
+	unsigned int i;
+
+	prefix = trie_prefix_bytes(node, depth);
+	limit = node->prefix_length;
+
+	if (limit > key_length - depth) {
+		limit = key_length - depth;
+	}
+
+	for (i=0; i<limit; ++i) {
+		if (prefix[i] != key[depth + i]) {
+			return i;
+		}
+	}
+
+	return limit;
+}
+
+/* Remove the first count + 1 bytes of a node's prefix, where the node is
+ * at the given depth.  Returns the byte at position count, which is the
+ * byte by which the node will be found in a new parent node. */
+
+static unsigned char trie_shorten_prefix(TrieNode *node, unsigned int depth,
+                                         unsigned int count)
+{
+	unsigned char *prefix;
+	unsigned char result;
+
+	prefix = trie_prefix_bytes(node, depth);
+	result = prefix[count];
+
+	/* The stored prefix may overlap, so move rather than copy */
+
+	node->prefix_length -= count + 1;
+	memmove(node->prefix, prefix + count + 1,
+	        node->prefix_length < TRIE_MAX_PREFIX ?
+	        node->prefix_length : TRIE_MAX_PREFIX);
+
+	return result;
+}
+
+/* Add a leaf to a newly created node, at the given depth. */
+
+static void trie_add_leaf(TrieNode *node, TrieLeaf *leaf, unsigned int depth)
+{
+	if (leaf->key_length == depth) {
+		node->leaf = (TrieNode *) leaf;
+	} else {
+		trie_insert_child(node, leaf->key[depth], (TrieNode *) leaf);
+	}
+}
+
 Trie *trie_new(void)
+{
+	return trie_new_with_allocator(NULL);
+}
+
+Trie *trie_new_with_allocator(Allocator *allocator)
 {
 	Trie *new_trie;
 
@@ -54,13 +693,28 @@ Trie *trie_new(void)
 	}
 
 	new_trie->root_node = NULL;
+	new_trie->num_entries = 0;
+	new_trie->allocator = allocator;
 
 	return new_trie;
 }
 
+/* When freeing, nodes are kept on a list linked through the value of
+ * leaves and the leaf pointer of inner nodes.  The leaf of an inner
+ * node is therefore added to the list before the node itself. */
+
 static void trie_free_list_push(TrieNode **list, TrieNode *node)
 {
-	node->data = *list;
+	if (trie_node_type(node) == TRIE_NODE_LEAF) {
+		((TrieLeaf *) node)->value = *list;
+	} else {
+		if (node->leaf != NULL) {
+			trie_free_list_push(list, node->leaf);
+		}
+
+		node->leaf = *list;
+	}
+
 	*list = node;
 }
 
@@ -69,7 +723,12 @@ static TrieNode *trie_free_list_pop(TrieNode **list)
 	TrieNode *result;
 
 	result = *list;
-	*list = result->data;
+
+	if (trie_node_type(result) == TRIE_NODE_LEAF) {
+		*list = ((TrieLeaf *) result)->value;
+	} else {
+		*list = result->leaf;
+	}
 
 	return result;
 }
@@ -78,7 +737,9 @@ void trie_free(Trie *trie)
 {
 	TrieNode *free_list;
 	TrieNode *node;
-	int i;
+	TrieNode *child;
+	unsigned int start;
+	unsigned char c;
 
 	free_list = NULL;
 
@@ -97,15 +758,20 @@ void trie_free(Trie *trie)
 
 		/* Add all children of this node to the free list */
 
-		for (i=0; i<256; ++i) {
-			if (node->next[i] != NULL) {
-				trie_free_list_push(&free_list, node->next[i]);
+		if (trie_node_type(node) != TRIE_NODE_LEAF) {
+			start = 0;
+
+			while (start < 256
+			    && (child = trie_next_child(node, start, &c))
+			       != NULL) {
+				trie_free_list_push(&free_list, child);
+				start = c + 1U;
 			}
 		}
 
 		/* Free the node */
 
-		free(node);
+		trie_free_node(trie, node);
 	}
 
 	/* Free the trie */
@@ -113,118 +779,94 @@ void trie_free(Trie *trie)
 	free(trie);
 }
 
-static TrieNode *trie_find_end(Trie *trie, char *key)
+/* Search down the trie for the leaf containing a key */
+
+static TrieLeaf *trie_find_end(Trie *trie, unsigned char *key,
+                               unsigned int key_length)
 {
 	TrieNode *node;
-	char *p;
-
-	/* Search down the trie until the end of string is reached */
+	TrieNode **child;
+	unsigned int depth;
 
 	node = trie->root_node;
+	depth = 0;
 
-	for (p=key; *p != '\0'; ++p) {
+	while (node != NULL) {
 
-		if (node == NULL) {
-			/* Not found in the tree. Return. */
+		/* Reached a leaf?  Prefixes longer than TRIE_MAX_PREFIX are
+		 * not checked on the way down, so compare the whole key. */
 
-			return NULL;
+		if (trie_node_type(node) == TRIE_NODE_LEAF) {
+			if (trie_leaf_matches((TrieLeaf *) node,
+			                      key, key_length)) {
+				return (TrieLeaf *) node;
+			} else {
+				return NULL;
+			}
 		}
 
-		/* Jump to the next node */
+		/* Skip over the compressed prefix of this node */
 
-		node = node->next[(unsigned char) *p];
-	}
-
-	/* This key is present if the value at the last node is not NULL */
-
-	return node;
-}
+		if (!trie_check_prefix(node, key, key_length, depth)) {
+			return NULL;
+		}
 
-static TrieNode *trie_find_end_binary(Trie *trie, unsigned char *key,
-                                      int key_length)
-{
-	TrieNode *node;
-	int j;
-	int c;
+		depth += node->prefix_length;
 
-	/* Search down the trie until the end of string is reached */
+		/* If this is the end of the key, it may be stored at this
+		 * node.  Otherwise, jump to the next node. */
 
-	node = trie->root_node;
+		if (depth == key_length) {
+			node = node->leaf;
+		} else {
+			child = trie_find_child(node, key[depth]);
 
-	for (j=0; j<key_length; j++) {
+			if (child == NULL) {
+				return NULL;
+			}
 
-		if (node == NULL) {
-			/* Not found in the tree. Return. */
-			return NULL;
+			node = *child;
+			++depth;
 		}
-
-		c = (unsigned char) key[j];
-
-		/* Jump to the next node */
-
-		node = node->next[c];
 	}
 
-	/* This key is present if the value at the last node is not NULL */
-
-	return node;
+	return NULL;
 }
 
-/* Roll back an insert operation after a failed malloc() call. */
+/* Add to the leaf counts of the nodes on the path to a key, from the
+ * root down to but not including the node 'end', which must be on the
+ * path.  This undoes the counts when an insert or remove fails part
+ * way down. */
 
-static void trie_insert_rollback(Trie *trie, unsigned char *key)
+static void trie_count_path(Trie *trie, unsigned char *key, TrieNode *end,
+                            int delta)
 {
 	TrieNode *node;
-	TrieNode **prev_ptr;
-	TrieNode *next_node;
-	TrieNode **next_prev_ptr;
-	unsigned char *p;
-
-	/* Follow the chain along.  We know that we will never reach the
-	 * end of the string because trie_insert never got that far.  As a
-	 * result, it is not necessary to check for the end of string
-	 * delimiter (NUL) */
+	unsigned int depth;
 
 	node = trie->root_node;
-	prev_ptr = &trie->root_node;
-	p = key;
-
-	while (node != NULL) {
-
-		/* Find the next node now. We might free this node. */
+	depth = 0;
 
-		next_prev_ptr = &node->next[(unsigned char) *p];
-		next_node = *next_prev_ptr;
-		++p;
-
-		/* Decrease the use count and free the node if it
-		 * reaches zero. */
-
-		--node->use_count;
-
-		if (node->use_count == 0) {
-			free(node);
-
-			if (prev_ptr != NULL) {
-				*prev_ptr = NULL;
-			}
-
-			next_prev_ptr = NULL;
-		}
-
-		/* Update pointers */
-
-		node = next_node;
-		prev_ptr = next_prev_ptr;
+	while (node != end) {
+		node->num_leaves += (unsigned int) delta;
+		depth += node->prefix_length;
+		node = *trie_find_child(node, key[depth]);
+		++depth;
 	}
 }
 
-int trie_insert(Trie *trie, char *key, TrieValue value)
+static int trie_insert_key(Trie *trie, unsigned char *key,
+                           unsigned int key_length, TrieValue value)
 {
 	TrieNode **rover;
+	TrieNode **child;
 	TrieNode *node;
-	char *p;
-	int c;
+	TrieNode *new_node;
+	TrieLeaf *leaf;
+	TrieLeaf *other;
+	unsigned int depth;
+	unsigned int mismatch;
+	unsigned char c;
 
 	/* Cannot insert NULL values */
 
@@ -232,353 +874,639 @@ int trie_insert(Trie *trie, char *key, TrieValue value)
 		return 0;
 	}
 
-	/* Search to see if this is already in the tree */
+	/* Search to see if this is already in the tree.  If so, replace
+	 * the existing value and return success. */
 
-	node = trie_find_end(trie, key);
+	leaf = trie_find_end(trie, key, key_length);
 
-	/* Already in the tree? If so, replace the existing value and
-	 * return success. */
-
-	if (node != NULL && node->data != TRIE_NULL) {
-		node->data = value;
+	if (leaf != NULL) {
+		leaf->value = value;
 		return 1;
 	}
 
-	/* Search down the trie until we reach the end of string,
-	 * creating nodes as necessary */
+	/* Create the new leaf.  At most one further allocation is needed,
+	 * and all allocations are made before the tree is modified, so
+	 * that only the leaf counts of the nodes passed through need to
+	 * be undone if one fails. */
+
+	leaf = trie_new_leaf(trie, key, key_length, value);
+
+	if (leaf == NULL) {
+		return 0;
+	}
 
 	rover = &trie->root_node;
-	p = key;
+	depth = 0;
 
 	for (;;) {
-
 		node = *rover;
 
-		if (node == NULL) {
-
-			/* Node does not exist, so create it */
+		/* Empty trie */
 
-			node = (TrieNode *) calloc(1, sizeof(TrieNode));
+		if (node == NULL) {
+			*rover = (TrieNode *) leaf;
+			break;
+		}
 
-			if (node == NULL) {
+		/* Reached an existing leaf: replace it with a new node that
+		 * has the part common to both keys as its prefix. */
 
-				/* Allocation failed.  Go back and undo
-				 * what we have done so far. */
+		if (trie_node_type(node) == TRIE_NODE_LEAF) {
+			other = (TrieLeaf *) node;
 
-				trie_insert_rollback(trie,
-				                     (unsigned char *) key);
+			new_node = trie_new_node(trie, TRIE_NODE_4);
 
+			if (new_node == NULL) {
+				trie_count_path(trie, key, node, -1);
+				trie_free_node(trie, (TrieNode *) leaf);
 				return 0;
 			}
 
-			node->data = TRIE_NULL;
+			new_node->num_leaves = 2;
+
+			for (mismatch=0;
+			     depth + mismatch < key_length
+			  && depth + mismatch < other->key_length
+			  && key[depth + mismatch]
+			     == other->key[depth + mismatch];
+			     ++mismatch);
 
-			/* Link in to the trie */
+			trie_set_prefix(new_node, key + depth, mismatch);
+			trie_add_leaf(new_node, other, depth + mismatch);
+			trie_add_leaf(new_node, leaf, depth + mismatch);
 
-			*rover = node;
+			*rover = new_node;
+			break;
 		}
 
-		/* Increase the node use count */
+		/* If the key differs from the prefix of this node, split
+		 * the prefix: a new node is added above this one with the
+		 * matching part of the prefix. */
+
+		if (node->prefix_length > 0) {
+			mismatch = trie_prefix_mismatch(node, key,
+			                                key_length, depth);
 
-		++node->use_count;
+			if (mismatch < node->prefix_length) {
+				new_node = trie_new_node(trie, TRIE_NODE_4);
 
-		/* Current character */
+				if (new_node == NULL) {
+					trie_count_path(trie, key, node, -1);
+					trie_free_node(trie, (TrieNode *) leaf);
+					return 0;
+				}
 
-		c = (unsigned char) *p;
+				new_node->num_leaves = node->num_leaves + 1;
 
-		/* Reached the end of string?  If so, we're finished. */
+				trie_set_prefix(new_node, key + depth, mismatch);
+				c = trie_shorten_prefix(node, depth, mismatch);
+				trie_insert_child(new_node, c, node);
+				trie_add_leaf(new_node, leaf, depth + mismatch);
 
-		if (c == '\0') {
+				*rover = new_node;
+				break;
+			}
 
-			/* Set the data at the node we have reached */
+			depth += node->prefix_length;
+		}
 
-			node->data = value;
+		/* Reached the end of the key?  If so, it is stored at this
+		 * node. */
 
+		if (depth == key_length) {
+			node->leaf = (TrieNode *) leaf;
+			++node->num_leaves;
 			break;
 		}
 
-		/* Advance to the next node in the chain */
+		/* Advance to the next node, or add the leaf as a new child
+		 * if there is none. */
+
+		child = trie_find_child(node, key[depth]);
+
+		if (child != NULL) {
+			++node->num_leaves;
+			rover = child;
+			++depth;
+		} else {
+			if (!trie_add_child(trie, rover, key[depth],
+			                    (TrieNode *) leaf)) {
+				trie_count_path(trie, key, node, -1);
+				trie_free_node(trie, (TrieNode *) leaf);
+				return 0;
+			}
 
-		rover = &node->next[c];
-		++p;
+			++(*rover)->num_leaves;
+			break;
+		}
 	}
 
+	++trie->num_entries;
+
 	return 1;
 }
 
+int trie_insert(Trie *trie, char *key, TrieValue value)
+{
+	return trie_insert_key(trie, (unsigned char *) key,
+	                       (unsigned int) strlen(key), value);
+}
 
 int trie_insert_binary(Trie *trie, unsigned char *key, int key_length,
                        TrieValue value)
 {
-	TrieNode **rover;
-	TrieNode *node;
-	int p,c;
+	return trie_insert_key(trie, key, (unsigned int) key_length, value);
+}
 
-	/* Cannot insert NULL values */
+/* Tidy up after an entry has been removed from the node pointed to by
+ * ref.  A node left with a single child and no leaf is merged into its
+ * child, and a node left with only a leaf is replaced by the leaf.
+ * Otherwise, the node is replaced by a smaller node if it has become
+ * sparse (if this fails, the node is simply left as it is). */
 
-	if (value == TRIE_NULL) {
-		return 0;
+static void trie_node_removed(Trie *trie, TrieNode **ref)
+{
+	TrieNode *node;
+	TrieNode *child;
+	TrieNode *new_node;
+	unsigned char prefix[TRIE_MAX_PREFIX];
+	unsigned int length;
+	unsigned int n;
+	unsigned char c;
+
+	node = *ref;
+
+	if (node->num_children == 0) {
+		*ref = node->leaf;
+		trie_free_node(trie, node);
+		return;
 	}
 
-	/* Search to see if this is already in the tree */
+	if (node->num_children == 1 && node->leaf == NULL) {
+		child = trie_next_child(node, 0, &c);
 
-	node = trie_find_end_binary(trie, key, key_length);
+		/* The child inherits this node's prefix, followed by the
+		 * byte which led to it. */
 
-	/* Already in the tree? If so, replace the existing value and
-	 * return success. */
+		if (trie_node_type(child) != TRIE_NODE_LEAF) {
+			n = node->prefix_length;
 
-	if (node != NULL && node->data != TRIE_NULL) {
-		node->data = value;
-		return 1;
-	}
+			if (n > TRIE_MAX_PREFIX) {
+				n = TRIE_MAX_PREFIX;
+			}
 
-	/* Search down the trie until we reach the end of string,
-	 * creating nodes as necessary */
+			memcpy(prefix, node->prefix, n);
 
-	rover = &trie->root_node;
-	p = 0;
+			if (n < TRIE_MAX_PREFIX) {
+				prefix[n] = c;
+				++n;
+			}
 
-	for (;;) {
+			length = child->prefix_length;
 
-		node = *rover;
+			if (length > TRIE_MAX_PREFIX - n) {
+				length = TRIE_MAX_PREFIX - n;
+			}
 
-		if (node == NULL) {
+			memcpy(prefix + n, child->prefix, length);
+			memcpy(child->prefix, prefix, n + length);
+			child->prefix_length += node->prefix_length + 1;
+		}
 
-			/* Node does not exist, so create it */
+		*ref = child;
+		trie_free_node(trie, node);
+		return;
+	}
 
-			node = (TrieNode *) calloc(1, sizeof(TrieNode));
+	new_node = NULL;
 
-			if (node == NULL) {
+	if (node->type == TRIE_NODE_256 && node->num_children <= 37) {
+		new_node = trie_resize_node(trie, node, TRIE_NODE_48);
+	} else if (node->type == TRIE_NODE_48 && node->num_children <= 12) {
+		new_node = trie_resize_node(trie, node, TRIE_NODE_16);
+	} else if (node->type == TRIE_NODE_16 && node->num_children <= 3) {
+		new_node = trie_resize_node(trie, node, TRIE_NODE_4);
+	}
 
-				/* Allocation failed.  Go back and undo
-				 * what we have done so far. */
+	if (new_node != NULL) {
+		*ref = new_node;
+	}
+}
 
-				trie_insert_rollback(trie, key);
+static int trie_remove_key(Trie *trie, unsigned char *key,
+                           unsigned int key_length)
+{
+	TrieNode **rover;
+	TrieNode **child;
+	TrieNode *node;
+	TrieNode *leaf;
+	unsigned int depth;
+
+	rover = &trie->root_node;
+	depth = 0;
+
+	for (;;) {
+		node = *rover;
 
+		if (node == NULL) {
+			return 0;
+		}
+
+		/* A leaf is only reached here if it is the root node */
+
+		if (trie_node_type(node) == TRIE_NODE_LEAF) {
+			if (!trie_leaf_matches((TrieLeaf *) node,
+			                       key, key_length)) {
 				return 0;
 			}
 
-			node->data = TRIE_NULL;
+			*rover = NULL;
+			trie_free_node(trie, node);
+			break;
+		}
 
-			/* Link in to the trie */
+		/* The leaf counts of the nodes passed through so far are
+		 * restored if the key is not found. */
 
-			*rover = node;
+		if (!trie_check_prefix(node, key, key_length, depth)) {
+			trie_count_path(trie, key, node, 1);
+			return 0;
 		}
 
-		/* Increase the node use count */
+		depth += node->prefix_length;
 
-		++node->use_count;
+		/* Key ends at this node? */
 
-		/* Current character */
+		if (depth == key_length) {
+			leaf = node->leaf;
 
-		c = (unsigned char) key[p];
+			if (leaf == NULL
+			 || !trie_leaf_matches((TrieLeaf *) leaf,
+			                       key, key_length)) {
+				trie_count_path(trie, key, node, 1);
+				return 0;
+			}
 
-		/* Reached the end of string?  If so, we're finished. */
+			node->leaf = NULL;
+			--node->num_leaves;
+			trie_free_node(trie, leaf);
+			trie_node_removed(trie, rover);
+			break;
+		}
 
-		if (p == key_length) {
+		child = trie_find_child(node, key[depth]);
 
-			/* Set the data at the node we have reached */
+		if (child == NULL) {
+			trie_count_path(trie, key, node, 1);
+			return 0;
+		}
 
-			node->data = value;
+		/* If the child is a leaf, remove it from this node */
+
+		if (trie_node_type(*child) == TRIE_NODE_LEAF) {
+			leaf = *child;
+
+			if (!trie_leaf_matches((TrieLeaf *) leaf,
+			                       key, key_length)) {
+				trie_count_path(trie, key, node, 1);
+				return 0;
+			}
 
+			trie_remove_child(node, key[depth]);
+			--node->num_leaves;
+			trie_free_node(trie, leaf);
+			trie_node_removed(trie, rover);
 			break;
 		}
 
-		/* Advance to the next node in the chain */
-
-		rover = &node->next[c];
-		++p;
+		--node->num_leaves;
+		rover = child;
+		++depth;
 	}
 
+	--trie->num_entries;
+
+	/* Removed successfully */
+
 	return 1;
 }
 
 int trie_remove_binary(Trie *trie, unsigned char *key, int key_length)
 {
-	TrieNode *node;
-	TrieNode *next;
-	TrieNode **last_next_ptr;
-	int p, c;
+	return trie_remove_key(trie, key, (unsigned int) key_length);
+}
+
+int trie_remove(Trie *trie, char *key)
+{
+	return trie_remove_key(trie, (unsigned char *) key,
+	                       (unsigned int) strlen(key));
+}
 
-	/* Find the end node and remove the value */
+TrieValue trie_lookup(Trie *trie, char *key)
+{
+	TrieLeaf *leaf;
 
-	node = trie_find_end_binary(trie, key, key_length);
+	leaf = trie_find_end(trie, (unsigned char *) key,
+	                     (unsigned int) strlen(key));
 
-	if (node != NULL && node->data != TRIE_NULL) {
-		node->data = TRIE_NULL;
+	if (leaf != NULL) {
+		return leaf->value;
 	} else {
-		return 0;
+		return TRIE_NULL;
 	}
+}
 
-	/* Now traverse the tree again as before, decrementing the use
-	 * count of each node.  Free back nodes as necessary. */
+TrieValue trie_lookup_binary(Trie *trie, unsigned char *key, int key_length)
+{
+	TrieLeaf *leaf;
 
-	node = trie->root_node;
-	last_next_ptr = &trie->root_node;
-	p = 0;
+	leaf = trie_find_end(trie, key, (unsigned int) key_length);
 
-	for (;;) {
+	if (leaf != NULL) {
+		return leaf->value;
+	} else {
+		return TRIE_NULL;
+	}
+}
 
-		/* Find the next node */
-		c = (unsigned char) key[p];
-		next = node->next[c];
+unsigned int trie_num_entries(Trie *trie)
+{
+	return trie->num_entries;
+}
 
-		/* Free this node if necessary */
+/* Search down the trie for the node below which all keys start with the
+ * given prefix.  Unlike trie_find_end, the whole prefix of each node is
+ * checked, as the search does not end by comparing against a leaf. */
 
-		--node->use_count;
+static TrieNode *trie_find_prefix(Trie *trie, unsigned char *prefix,
+                                  unsigned int prefix_length)
+{
+	TrieNode *node;
+	TrieNode **child;
+	TrieLeaf *leaf;
+	unsigned int depth;
+	unsigned int mismatch;
 
-		if (node->use_count <= 0) {
-			free(node);
+	node = trie->root_node;
+	depth = 0;
+
+	while (node != NULL) {
 
-			/* Set the "next" pointer on the previous node to NULL,
-			 * to unlink the freed node from the tree.  This only
-			 * needs to be done once in a remove.  After the first
-			 * unlink, all further nodes are also going to be
-			 * free'd. */
+		if (trie_node_type(node) == TRIE_NODE_LEAF) {
+			leaf = (TrieLeaf *) node;
 
-			if (last_next_ptr != NULL) {
-				*last_next_ptr = NULL;
-				last_next_ptr = NULL;
+			if (leaf->key_length >= prefix_length
+			 && memcmp(leaf->key + depth, prefix + depth,
+			           prefix_length - depth) == 0) {
+				return node;
+			} else {
+				return NULL;
 			}
 		}
 
-		/* Go to the next character or finish */
-		if (p == key_length) {
-			break;
-		} else {
-			++p;
-		}
+		/* The prefix may end part way through the prefix of this
+		 * node, in which case the whole node matches. */
 
-		/* If necessary, save the location of the "next" pointer
-		 * so that it may be set to NULL on the next iteration if
-		 * the next node visited is freed. */
+		mismatch = trie_prefix_mismatch(node, prefix,
+		                                prefix_length, depth);
 
-		if (last_next_ptr != NULL) {
-			last_next_ptr = &node->next[c];
+		if (depth + mismatch == prefix_length) {
+			return node;
+		} else if (mismatch < node->prefix_length) {
+			return NULL;
 		}
 
-		/* Jump to the next node */
+		depth += node->prefix_length;
 
-		node = next;
-	}
+		child = trie_find_child(node, prefix[depth]);
 
-	/* Removed successfully */
+		if (child == NULL) {
+			return NULL;
+		}
 
-	return 1;
+		node = *child;
+		++depth;
+	}
+
+	return NULL;
 }
 
-int trie_remove(Trie *trie, char *key)
+/* Find the leaf following a leaf in key order */
+
+static TrieLeaf *trie_next_leaf(Trie *trie, TrieLeaf *leaf)
 {
 	TrieNode *node;
 	TrieNode *next;
-	TrieNode **last_next_ptr;
-	char *p;
-	int c;
+	TrieNode *sibling;
+	unsigned int depth;
+	unsigned char c;
 
-	/* Find the end node and remove the value */
+	/* Follow the path to the leaf, remembering the deepest node which
+	 * has a child following the path.  The leaf is in the trie, so
+	 * the prefixes along the path do not need to be checked. */
 
-	node = trie_find_end(trie, key);
+	node = trie->root_node;
+	depth = 0;
+	next = NULL;
 
-	if (node != NULL && node->data != TRIE_NULL) {
-		node->data = TRIE_NULL;
-	} else {
-		return 0;
+	while (trie_node_type(node) != TRIE_NODE_LEAF) {
+		depth += node->prefix_length;
+
+		/* If the leaf is stored at this node, all of the node's
+		 * children follow it. */
+
+		if (depth == leaf->key_length) {
+			sibling = trie_next_child(node, 0, &c);
+
+			if (sibling != NULL) {
+				next = sibling;
+			}
+
+			break;
+		}
+
+		c = leaf->key[depth];
+
+		if (c < 255) {
+			sibling = trie_next_child(node, c + 1U, &c);
+
+			if (sibling != NULL) {
+				next = sibling;
+			}
+		}
+
+		node = *trie_find_child(node, leaf->key[depth]);
+		++depth;
 	}
 
-	/* Now traverse the tree again as before, decrementing the use
-	 * count of each node.  Free back nodes as necessary. */
+	if (next == NULL) {
+		return NULL;
+	}
 
-	node = trie->root_node;
-	last_next_ptr = &trie->root_node;
-	p = key;
+	return trie_first_leaf(next);
+}
 
-	for (;;) {
+/* Count the leaves below a node */
 
-		/* Find the next node */
+static unsigned int trie_count_leaves(TrieNode *node)
+{
+	if (trie_node_type(node) == TRIE_NODE_LEAF) {
+		return 1;
+	} else {
+		return node->num_leaves;
+	}
+}
 
-		c = (unsigned char) *p;
-		next = node->next[c];
+static TrieValue trie_longest_prefix_key(Trie *trie, unsigned char *key,
+                                         unsigned int key_length)
+{
+	TrieNode *node;
+	TrieNode **child;
+	TrieLeaf *leaf;
+	TrieLeaf *result;
+	unsigned int depth;
 
-		/* Free this node if necessary */
+	node = trie->root_node;
+	depth = 0;
+	result = NULL;
 
-		--node->use_count;
+	/* Each key stored at a node along the path of the key is a prefix
+	 * of the key.  The deepest of these is the longest. */
 
-		if (node->use_count <= 0) {
-			free(node);
+	while (node != NULL) {
 
-			/* Set the "next" pointer on the previous node to NULL,
-			 * to unlink the freed node from the tree.  This only
-			 * needs to be done once in a remove.  After the first
-			 * unlink, all further nodes are also going to be
-			 * free'd. */
+		if (trie_node_type(node) == TRIE_NODE_LEAF) {
+			leaf = (TrieLeaf *) node;
 
-			if (last_next_ptr != NULL) {
-				*last_next_ptr = NULL;
-				last_next_ptr = NULL;
+			if (leaf->key_length <= key_length
+			 && memcmp(leaf->key + depth, key + depth,
+			           leaf->key_length - depth) == 0) {
+				result = leaf;
 			}
+
+			break;
+		}
+
+		if (trie_prefix_mismatch(node, key, key_length, depth)
+		    < node->prefix_length) {
+			break;
 		}
 
-		/* Go to the next character or finish */
+		depth += node->prefix_length;
 
-		if (c == '\0') {
+		if (node->leaf != NULL) {
+			result = (TrieLeaf *) node->leaf;
+		}
+
+		if (depth == key_length) {
 			break;
-		} else {
-			++p;
 		}
 
-		/* If necessary, save the location of the "next" pointer
-		 * so that it may be set to NULL on the next iteration if
-		 * the next node visited is freed. */
+		child = trie_find_child(node, key[depth]);
 
-		if (last_next_ptr != NULL) {
-			last_next_ptr = &node->next[c];
+		if (child == NULL) {
+			break;
 		}
 
-		/* Jump to the next node */
+		node = *child;
+		++depth;
+	}
 
-		node = next;
+	if (result != NULL) {
+		return result->value;
+	} else {
+		return TRIE_NULL;
 	}
+}
 
-	/* Removed successfully */
+TrieValue trie_longest_prefix(Trie *trie, char *key)
+{
+	return trie_longest_prefix_key(trie, (unsigned char *) key,
+	                               (unsigned int) strlen(key));
+}
 
-	return 1;
+TrieValue trie_longest_prefix_binary(Trie *trie, unsigned char *key,
+                                     int key_length)
+{
+	return trie_longest_prefix_key(trie, key, (unsigned int) key_length);
 }
 
-TrieValue trie_lookup(Trie *trie, char *key)
+unsigned int trie_prefix_count(Trie *trie, char *prefix)
+{
+	return trie_prefix_count_binary(trie, (unsigned char *) prefix,
+	                                (int) strlen(prefix));
+}
+
+unsigned int trie_prefix_count_binary(Trie *trie, unsigned char *prefix,
+                                      int prefix_length)
 {
 	TrieNode *node;
 
-	node = trie_find_end(trie, key);
+	node = trie_find_prefix(trie, prefix, (unsigned int) prefix_length);
 
-	if (node != NULL) {
-		return node->data;
-	} else {
-		return TRIE_NULL;
+	if (node == NULL) {
+		return 0;
 	}
+
+	return trie_count_leaves(node);
 }
 
-TrieValue trie_lookup_binary(Trie *trie, unsigned char *key, int key_length)
+void trie_iterate_prefix(Trie *trie, char *prefix, TrieIterator *iter)
+{
+	trie_iterate_prefix_binary(trie, (unsigned char *) prefix,
+	                           (int) strlen(prefix), iter);
+}
+
+void trie_iterate_prefix_binary(Trie *trie, unsigned char *prefix,
+                                int prefix_length, TrieIterator *iter)
 {
 	TrieNode *node;
 
-	node = trie_find_end_binary(trie, key, key_length);
+	iter->trie = trie;
+	iter->prefix_length = (unsigned int) prefix_length;
+
+	node = trie_find_prefix(trie, prefix, (unsigned int) prefix_length);
 
 	if (node != NULL) {
-		return node->data;
+		iter->next_leaf = trie_first_leaf(node);
 	} else {
-		return TRIE_NULL;
+		iter->next_leaf = NULL;
 	}
 }
 
-unsigned int trie_num_entries(Trie *trie)
+int trie_iter_has_more(TrieIterator *iter)
 {
-	/* To find the number of entries, simply look at the use count
-	 * of the root node. */
+	return iter->next_leaf != NULL;
+}
 
-	if (trie->root_node == NULL) {
-		return 0;
-	} else {
-		return trie->root_node->use_count;
+TriePair trie_iter_next(TrieIterator *iter)
+{
+	TriePair pair = { NULL, 0, TRIE_NULL };
+	TrieLeaf *leaf;
+	TrieLeaf *next;
+
+	leaf = iter->next_leaf;
+
+	if (leaf == NULL) {
+		return pair;
 	}
-}
 
+	pair.key = leaf->key;
+	pair.key_length = (int) leaf->key_length;
+	pair.value = leaf->value;
+
+	/* Advance to the next leaf.  Once past the last key with the
+	 * prefix, the next key no longer shares the prefix with this one. */
+
+	next = trie_next_leaf(iter->trie, leaf);
+
+	if (next != NULL
+	 && (next->key_length < iter->prefix_length
+	  || memcmp(next->key, leaf->key, iter->prefix_length) != 0)) {
+		next = NULL;
+	}
+
+	iter->next_leaf = next;
+
+	return pair;
+}
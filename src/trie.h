@@ -24,7 +24,10 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * @brief Fast string lookups
  *
  * A trie is a data structure which provides fast mappings from strings
- * to values.
+ * to values.  This trie is an adaptive radix tree: nodes are sized
+ * to the number of children they have, and chains of single-child nodes
+ * are compressed into a prefix, so that memory use is proportional to
+ * the number of keys rather than to their total length.
  *
  * To create a new trie, use @ref trie_new.  To destroy a trie,
  * use @ref trie_free.
@@ -35,11 +38,22 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  * To look up a value from its key, use @ref trie_lookup.
  *
  * To find the number of entries in a trie, use @ref trie_num_entries.
+ *
+ * To find the entry whose key is the longest prefix of a given key, use
+ * @ref trie_longest_prefix.  To count the keys which start with a given
+ * prefix, use @ref trie_prefix_count.
+ *
+ * To iterate over the entries with keys starting with a prefix, in
+ * lexicographic order of their keys, initialise a @ref TrieIterator
+ * with @ref trie_iterate_prefix and use @ref trie_iter_next and
+ * @ref trie_iter_has_more.  An empty prefix iterates over the whole trie.
  */
 
 #ifndef ALGORITHM_TRIE_H
 #define ALGORITHM_TRIE_H
 
+#include "allocator.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -56,6 +70,33 @@ typedef struct _Trie Trie;
 
 typedef void *TrieValue;
 
+/**
+ * Structure used to iterate over the entries in a trie.
+ */
+
+typedef struct _TrieIterator TrieIterator;
+
+/**
+ * Definition of a @ref TrieIterator.
+ */
+
+struct _TrieIterator {
+	Trie *trie;
+	void *next_leaf;
+	unsigned int prefix_length;
+};
+
+/**
+ * An entry returned by @ref trie_iter_next.  The key is also terminated
+ * by a NUL byte, so that string keys can be used directly.
+ */
+
+typedef struct _TriePair {
+	unsigned char *key;
+	int key_length;
+	TrieValue value;
+} TriePair;
+
 /**
  * A null @ref TrieValue.
  */
@@ -72,6 +113,17 @@ typedef void *TrieValue;
 
 Trie *trie_new(void);
 
+/**
+ * Create a new trie, using a custom allocator for its nodes.
+ *
+ * @param allocator          The allocator to use, or NULL to use malloc().
+ * @return                   Pointer to a new trie structure, or NULL if it
+ *                           was not possible to allocate memory for the
+ *                           new trie.
+ */
+
+Trie *trie_new_with_allocator(Allocator *allocator);
+
 /**
  * Destroy a trie.
  *
@@ -173,6 +225,116 @@ int trie_remove_binary(Trie *trie, unsigned char *key, int key_length);
 
 unsigned int trie_num_entries(Trie *trie);
 
+/**
+ * Find the entry whose key is the longest prefix of a key.
+ * The key is a NUL-terminated string; for binary strings, use
+ * @ref trie_longest_prefix_binary.
+ *
+ * @param trie               The trie.
+ * @param key                The key.
+ * @return                   The value of the entry with the longest key
+ *                           that is a prefix of the key (including the
+ *                           key itself), or @ref TRIE_NULL if no key in
+ *                           the trie is a prefix of the key.
+ */
+
+TrieValue trie_longest_prefix(Trie *trie, char *key);
+
+/**
+ * Find the entry whose key is the longest prefix of a key.
+ * The key is a sequence of bytes; for a key that is a NUL-terminated
+ * text string, use @ref trie_longest_prefix.
+ *
+ * @param trie               The trie.
+ * @param key                The key.
+ * @param key_length         The key length in bytes.
+ * @return                   The value of the entry with the longest key
+ *                           that is a prefix of the key (including the
+ *                           key itself), or @ref TRIE_NULL if no key in
+ *                           the trie is a prefix of the key.
+ */
+
+TrieValue trie_longest_prefix_binary(Trie *trie, unsigned char *key,
+                                     int key_length);
+
+/**
+ * Count the entries in a trie with keys that start with a prefix.
+ * The prefix is a NUL-terminated string; for binary strings, use
+ * @ref trie_prefix_count_binary.
+ *
+ * @param trie               The trie.
+ * @param prefix             The prefix.
+ * @return                   The number of keys starting with the prefix.
+ */
+
+unsigned int trie_prefix_count(Trie *trie, char *prefix);
+
+/**
+ * Count the entries in a trie with keys that start with a prefix.
+ * The prefix is a sequence of bytes; for a prefix that is a
+ * NUL-terminated text string, use @ref trie_prefix_count.
+ *
+ * @param trie               The trie.
+ * @param prefix             The prefix.
+ * @param prefix_length      The prefix length in bytes.
+ * @return                   The number of keys starting with the prefix.
+ */
+
+unsigned int trie_prefix_count_binary(Trie *trie, unsigned char *prefix,
+                                      int prefix_length);
+
+/**
+ * Initialise a @ref TrieIterator to iterate over the entries in a trie
+ * with keys that start with a prefix, in lexicographic order of their
+ * keys.  The prefix is a NUL-terminated string; for binary strings, use
+ * @ref trie_iterate_prefix_binary.  The iterator does not allocate
+ * memory, and is invalidated if the trie is modified.
+ *
+ * @param trie               The trie.
+ * @param prefix             The prefix.
+ * @param iter               Pointer to an iterator structure to
+ *                           initialise.
+ */
+
+void trie_iterate_prefix(Trie *trie, char *prefix, TrieIterator *iter);
+
+/**
+ * Initialise a @ref TrieIterator to iterate over the entries in a trie
+ * with keys that start with a prefix, in lexicographic order of their
+ * keys.  The prefix is a sequence of bytes; for a prefix that is a
+ * NUL-terminated text string, use @ref trie_iterate_prefix.
+ *
+ * @param trie               The trie.
+ * @param prefix             The prefix.
+ * @param prefix_length      The prefix length in bytes.
+ * @param iter               Pointer to an iterator structure to
+ *                           initialise.
+ */
+
+void trie_iterate_prefix_binary(Trie *trie, unsigned char *prefix,
+                                int prefix_length, TrieIterator *iter);
+
+/**
+ * Determine if there are more entries to iterate over.
+ *
+ * @param iter               The trie iterator.
+ * @return                   Zero if there are no more entries to iterate
+ *                           over, non-zero if there are more entries.
+ */
+
+int trie_iter_has_more(TrieIterator *iter);
+
+/**
+ * Using a trie iterator, retrieve the next entry.
+ *
+ * @param iter               The trie iterator.
+ * @return                   The next entry.  If there are no more
+ *                           entries, the key is NULL and the value is
+ *                           @ref TRIE_NULL.
+ */
+
+TriePair trie_iter_next(TrieIterator *iter);
+
 #ifdef __cplusplus
 }
 #endif
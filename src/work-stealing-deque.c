@@ -0,0 +1,275 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "work-stealing-deque.h"
+
+/* malloc() / free() testing */
+
+#ifdef ALLOC_TESTING
+#include "alloc-testing.h"
+#endif
+
+/* The deque follows "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (Le, Pop, Cohen and Zappa Nardelli, 2013).  top and bottom
+ * only ever increase, except that the owner temporarily decrements bottom
+ * while removing a value; the values in the deque are in the positions
+ * [top, bottom) of the array. */
+
+#if defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+#define WORK_STEALING_DEQUE_HAVE_ATOMICS
+#define WORK_STEALING_DEQUE_LOAD(ptr, order) \
+	__atomic_load_n((ptr), __ATOMIC_ ## order)
+#define WORK_STEALING_DEQUE_STORE(ptr, value, order) \
+	__atomic_store_n((ptr), (value), __ATOMIC_ ## order)
+#define WORK_STEALING_DEQUE_FENCE(order) \
+	__atomic_thread_fence(__ATOMIC_ ## order)
+#define WORK_STEALING_DEQUE_CAS(ptr, expected, value) \
+	__atomic_compare_exchange_n((ptr), (expected), (value), 0, \
+	                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+#else
+/* Deques cannot be created, so these are never used */
+#define WORK_STEALING_DEQUE_LOAD(ptr, order) (*(ptr))
+#define WORK_STEALING_DEQUE_STORE(ptr, value, order) (*(ptr) = (value))
+#define WORK_STEALING_DEQUE_FENCE(order)
+#define WORK_STEALING_DEQUE_CAS(ptr, expected, value) 0
+#endif
+
+#define WORK_STEALING_DEQUE_INITIAL_SIZE 64
+
+/* Padding used to keep top, which thieves write, on a separate cache
+ * line from the fields used by the owner */
+
+#define WORK_STEALING_DEQUE_CACHE_LINE 64
+
+typedef struct _WorkStealingDequeArray WorkStealingDequeArray;
+
+struct _WorkStealingDequeArray {
+	size_t mask;
+	WorkStealingDequeArray *prev;
+	QueueValue values[];
+};
+
+struct _WorkStealingDeque {
+	ptrdiff_t top;
+	char pad1[WORK_STEALING_DEQUE_CACHE_LINE];
+	ptrdiff_t bottom;
+	WorkStealingDequeArray *array;
+};
+
+static WorkStealingDequeArray *work_stealing_deque_new_array(size_t size)
+{
+	WorkStealingDequeArray *array;
+
+	array = malloc(offsetof(WorkStealingDequeArray, values)
+	               + size * sizeof(QueueValue));
+
+	if (array == NULL) {
+		return NULL;
+	}
+
+	array->mask = size - 1;
+	array->prev = NULL;
+
+	return array;
+}
+
+WorkStealingDeque *work_stealing_deque_new(void)
+{
+	WorkStealingDeque *deque;
+
+#ifndef WORK_STEALING_DEQUE_HAVE_ATOMICS
+	return NULL;
+#endif
+
+	deque = (WorkStealingDeque *) malloc(sizeof(WorkStealingDeque));
+
+	if (deque == NULL) {
+		return NULL;
+	}
+
+	deque->array
+	    = work_stealing_deque_new_array(WORK_STEALING_DEQUE_INITIAL_SIZE);
+
+	if (deque->array == NULL) {
+		free(deque);
+		return NULL;
+	}
+
+	deque->top = 0;
+	deque->bottom = 0;
+
+	return deque;
+}
+
+void work_stealing_deque_free(WorkStealingDeque *deque)
+{
+	WorkStealingDequeArray *array;
+	WorkStealingDequeArray *prev;
+
+	/* Free the current array and all arrays that it replaced */
+
+	array = deque->array;
+
+	while (array != NULL) {
+		prev = array->prev;
+		free(array);
+		array = prev;
+	}
+
+	free(deque);
+}
+
+/* Replace the array of a full deque with one twice the size.  The old
+ * array is not freed, as thieves may still be reading from it. */
+
+static WorkStealingDequeArray *work_stealing_deque_enlarge(
+                                    WorkStealingDeque *deque,
+                                    ptrdiff_t top, ptrdiff_t bottom)
+{
+	WorkStealingDequeArray *array;
+	WorkStealingDequeArray *new_array;
+	ptrdiff_t i;
+
+	array = deque->array;
+	new_array = work_stealing_deque_new_array((array->mask + 1) * 2);
+
+	if (new_array == NULL) {
+		return NULL;
+	}
+
+	for (i=top; i<bottom; ++i) {
+		new_array->values[(size_t) i & new_array->mask]
+		    = WORK_STEALING_DEQUE_LOAD(
+		          &array->values[(size_t) i & array->mask], RELAXED);
+	}
+
+	new_array->prev = array;
+
+	WORK_STEALING_DEQUE_STORE(&deque->array, new_array, RELEASE);
+
+	return new_array;
+}
+
+int work_stealing_deque_push(WorkStealingDeque *deque, QueueValue data)
+{
+	WorkStealingDequeArray *array;
+	ptrdiff_t bottom;
+	ptrdiff_t top;
+
+	bottom = WORK_STEALING_DEQUE_LOAD(&deque->bottom, RELAXED);
+	top = WORK_STEALING_DEQUE_LOAD(&deque->top, ACQUIRE);
+	array = WORK_STEALING_DEQUE_LOAD(&deque->array, RELAXED);
+
+	/* Enlarge the array if it is full */
+
+	if ((size_t) (bottom - top) > array->mask) {
+		array = work_stealing_deque_enlarge(deque, top, bottom);
+
+		if (array == NULL) {
+			return 0;
+		}
+	}
+
+	/* Store the value, then publish it to thieves */
+
+	WORK_STEALING_DEQUE_STORE(&array->values[(size_t) bottom & array->mask],
+	                          data, RELAXED);
+	WORK_STEALING_DEQUE_FENCE(RELEASE);
+	WORK_STEALING_DEQUE_STORE(&deque->bottom, bottom + 1, RELAXED);
+
+	return 1;
+}
+
+QueueValue work_stealing_deque_pop(WorkStealingDeque *deque)
+{
+	WorkStealingDequeArray *array;
+	QueueValue result;
+	ptrdiff_t bottom;
+	ptrdiff_t top;
+
+	/* Claim the value at the bottom before checking whether thieves
+	 * have taken it */
+
+	bottom = WORK_STEALING_DEQUE_LOAD(&deque->bottom, RELAXED) - 1;
+	array = WORK_STEALING_DEQUE_LOAD(&deque->array, RELAXED);
+	WORK_STEALING_DEQUE_STORE(&deque->bottom, bottom, RELAXED);
+	WORK_STEALING_DEQUE_FENCE(SEQ_CST);
+	top = WORK_STEALING_DEQUE_LOAD(&deque->top, RELAXED);
+
+	if (top > bottom) {
+
+		/* The deque is empty */
+
+		WORK_STEALING_DEQUE_STORE(&deque->bottom, bottom + 1, RELAXED);
+
+		return QUEUE_NULL;
+	}
+
+	result = WORK_STEALING_DEQUE_LOAD(
+	             &array->values[(size_t) bottom & array->mask], RELAXED);
+
+	if (top == bottom) {
+
+		/* This is the last value, which a thief may also be trying
+		 * to take.  Whoever advances top first gets it. */
+
+		if (!WORK_STEALING_DEQUE_CAS(&deque->top, &top, top + 1)) {
+			result = QUEUE_NULL;
+		}
+
+		WORK_STEALING_DEQUE_STORE(&deque->bottom, bottom + 1, RELAXED);
+	}
+
+	return result;
+}
+
+QueueValue work_stealing_deque_steal(WorkStealingDeque *deque)
+{
+	WorkStealingDequeArray *array;
+	QueueValue result;
+	ptrdiff_t bottom;
+	ptrdiff_t top;
+
+	for (;;) {
+		top = WORK_STEALING_DEQUE_LOAD(&deque->top, ACQUIRE);
+		WORK_STEALING_DEQUE_FENCE(SEQ_CST);
+		bottom = WORK_STEALING_DEQUE_LOAD(&deque->bottom, ACQUIRE);
+
+		if (top >= bottom) {
+			return QUEUE_NULL;
+		}
+
+		/* Read the value at the top, then try to claim it.  If
+		 * another thread took it first, try again with the next. */
+
+		array = WORK_STEALING_DEQUE_LOAD(&deque->array, ACQUIRE);
+		result = WORK_STEALING_DEQUE_LOAD(
+		             &array->values[(size_t) top & array->mask],
+		             RELAXED);
+
+		if (WORK_STEALING_DEQUE_CAS(&deque->top, &top, top + 1)) {
+			return result;
+		}
+	}
+}
+
@@ -0,0 +1,121 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+/**
+ * @file work-stealing-deque.h
+ *
+ * @brief Lock-free work-stealing deque.
+ *
+ * A work-stealing deque is a double-ended queue used to distribute tasks
+ * between threads.  Each deque has one owner thread, which adds and
+ * removes values at the bottom of the deque like a stack.  Any number
+ * of other threads can "steal" values from the top of the deque at the
+ * same time, taking the oldest values first.
+ *
+ * This is the Chase-Lev deque.  The owner adds and removes values
+ * without atomic read-modify-write operations, except when removing the
+ * last value, where it may have to race with a thief.  Values are stored
+ * in a circular array which is enlarged as needed; arrays that have been
+ * replaced are kept until the deque is freed, as thieves may still be
+ * reading from them.
+ *
+ * To create a work-stealing deque, use @ref work_stealing_deque_new.
+ * To destroy a work-stealing deque, use @ref work_stealing_deque_free.
+ *
+ * The owner thread adds values with @ref work_stealing_deque_push and
+ * removes them with @ref work_stealing_deque_pop.  Other threads remove
+ * values with @ref work_stealing_deque_steal.
+ */
+
+#ifndef ALGORITHM_WORK_STEALING_DEQUE_H
+#define ALGORITHM_WORK_STEALING_DEQUE_H
+
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A work-stealing deque structure.
+ */
+
+typedef struct _WorkStealingDeque WorkStealingDeque;
+
+/**
+ * Create a new work-stealing deque.
+ *
+ * @return           A new deque, or NULL if it was not possible to
+ *                   allocate the new deque, or if the compiler does not
+ *                   support atomic operations.
+ */
+
+WorkStealingDeque *work_stealing_deque_new(void);
+
+/**
+ * Destroy a work-stealing deque.  No other threads may be using the
+ * deque.
+ *
+ * @param deque      The deque to destroy.
+ */
+
+void work_stealing_deque_free(WorkStealingDeque *deque);
+
+/**
+ * Add a value to the bottom of a work-stealing deque.  This may only be
+ * called by the owner of the deque.
+ *
+ * @param deque      The deque.
+ * @param data       The value to add.
+ * @return           Non-zero if the value was added successfully, or zero
+ *                   if it was not possible to allocate the memory.
+ */
+
+int work_stealing_deque_push(WorkStealingDeque *deque, QueueValue data);
+
+/**
+ * Remove the value at the bottom of a work-stealing deque, which is the
+ * value most recently added.  This may only be called by the owner of
+ * the deque.
+ *
+ * @param deque      The deque.
+ * @return           Value that was at the bottom of the deque, or
+ *                   @ref QUEUE_NULL if the deque is empty.
+ */
+
+QueueValue work_stealing_deque_pop(WorkStealingDeque *deque);
+
+/**
+ * Remove the value at the top of a work-stealing deque, which is the
+ * oldest value.  This can be called by any thread.
+ *
+ * @param deque      The deque.
+ * @return           Value that was at the top of the deque, or
+ *                   @ref QUEUE_NULL if the deque is empty.
+ */
+
+QueueValue work_stealing_deque_steal(WorkStealingDeque *deque);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef ALGORITHM_WORK_STEALING_DEQUE_H */
+
@@ -429,6 +429,227 @@ void test_arraylist_sort(void)
 	arraylist_free(arraylist);
 }
 
+static unsigned int sort_compare_count;
+
+static int counting_int_compare(void *location1, void *location2)
+{
+	++sort_compare_count;
+
+	return int_compare(location1, location2);
+}
+
+/* Sort a large array with the given contents, checking that the result
+ * is ordered and that it is a permutation of the input. */
+
+static void check_large_sort(int *values, unsigned int num_values)
+{
+	ArrayList *arraylist;
+	unsigned int *counts;
+	unsigned int i;
+	int *value;
+
+	arraylist = arraylist_new(num_values);
+	counts = calloc(num_values, sizeof(unsigned int));
+
+	for (i=0; i<num_values; ++i) {
+		arraylist_append(arraylist, &values[i]);
+	}
+
+	sort_compare_count = 0;
+	arraylist_sort(arraylist, counting_int_compare);
+
+	assert(arraylist->length == num_values);
+
+	/* Values are sorted, and every original entry appears exactly
+	 * once */
+
+	for (i=0; i<num_values; ++i) {
+		value = (int *) arraylist->data[i];
+
+		if (i > 0) {
+			assert(*((int *) arraylist->data[i - 1]) <= *value);
+		}
+
+		++counts[value - values];
+	}
+
+	for (i=0; i<num_values; ++i) {
+		assert(counts[i] == 1);
+	}
+
+	free(counts);
+	arraylist_free(arraylist);
+}
+
+void test_arraylist_sort_large(void)
+{
+	unsigned int num_values = 10000;
+	int *values;
+	unsigned int i;
+
+	values = malloc(sizeof(int) * num_values);
+
+	/* Already sorted input is detected and finished in linear time */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = (int) i;
+	}
+
+	check_large_sort(values, num_values);
+	assert(sort_compare_count < num_values * 4);
+
+	/* Reverse sorted */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = (int) (num_values - i);
+	}
+
+	check_large_sort(values, num_values);
+	assert(sort_compare_count < num_values * 4);
+
+	/* All values equal */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = 42;
+	}
+
+	check_large_sort(values, num_values);
+	assert(sort_compare_count < num_values * 4);
+
+	/* Organ pipe: ascending, then descending */
+
+	for (i=0; i<num_values; ++i) {
+		if (i < num_values / 2) {
+			values[i] = (int) i;
+		} else {
+			values[i] = (int) (num_values - i);
+		}
+	}
+
+	check_large_sort(values, num_values);
+
+	/* Few distinct values */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = rand() % 4;
+	}
+
+	check_large_sort(values, num_values);
+
+	/* Random values */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = rand();
+	}
+
+	check_large_sort(values, num_values);
+
+	/* Sorted, with a few values out of place */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = (int) i;
+	}
+	for (i=0; i<10; ++i) {
+		values[(unsigned int) rand() % num_values] = rand() % (int) num_values;
+	}
+
+	check_large_sort(values, num_values);
+
+	free(values);
+}
+
+void test_arraylist_sort_parallel(void)
+{
+	unsigned int num_values = 200000;
+	unsigned int thread_counts[] = { 1, 2, 3, 4, 8, 0 };
+	ArrayList *expected;
+	ArrayList *arraylist;
+	int *values;
+	unsigned int i, t;
+
+	values = malloc(sizeof(int) * num_values);
+
+	/* Many duplicate values, so that the order of equal values is
+	 * tested as well */
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = rand() % 1000;
+	}
+
+	/* Sort the same input with different numbers of threads: the
+	 * results must be sorted and identical */
+
+	expected = NULL;
+
+	for (t=0; t<sizeof(thread_counts) / sizeof(*thread_counts); ++t) {
+		arraylist = arraylist_new(num_values);
+
+		for (i=0; i<num_values; ++i) {
+			arraylist_append(arraylist, &values[i]);
+		}
+
+		assert(arraylist_sort_parallel(arraylist, int_compare,
+		                               thread_counts[t]) != 0);
+
+		assert(arraylist->length == num_values);
+
+		for (i=1; i<num_values; ++i) {
+			assert(*((int *) arraylist->data[i - 1])
+			    <= *((int *) arraylist->data[i]));
+		}
+
+		if (expected == NULL) {
+			expected = arraylist;
+		} else {
+			for (i=0; i<num_values; ++i) {
+				assert(arraylist->data[i]
+				       == expected->data[i]);
+			}
+
+			arraylist_free(arraylist);
+		}
+	}
+
+	arraylist_free(expected);
+
+	/* Small lists are sorted sequentially */
+
+	arraylist = arraylist_new(0);
+
+	for (i=0; i<100; ++i) {
+		arraylist_append(arraylist, &values[i]);
+	}
+
+	assert(arraylist_sort_parallel(arraylist, int_compare, 4) != 0);
+
+	for (i=1; i<100; ++i) {
+		assert(*((int *) arraylist->data[i - 1])
+		    <= *((int *) arraylist->data[i]));
+	}
+
+	arraylist_free(arraylist);
+
+	/* Out of memory: the list is left untouched */
+
+	arraylist = arraylist_new(num_values);
+
+	for (i=0; i<num_values; ++i) {
+		arraylist_append(arraylist, &values[i]);
+	}
+
+	alloc_test_set_limit(0);
+	assert(arraylist_sort_parallel(arraylist, int_compare, 4) == 0);
+	alloc_test_set_limit(-1);
+
+	for (i=0; i<num_values; ++i) {
+		assert(arraylist->data[i] == &values[i]);
+	}
+
+	arraylist_free(arraylist);
+
+	free(values);
+}
+
 static UnitTestFunction tests[] = {
 	test_arraylist_new_free,
 	test_arraylist_append,
@@ -439,6 +660,8 @@ static UnitTestFunction tests[] = {
 	test_arraylist_index_of,
 	test_arraylist_clear,
 	test_arraylist_sort,
+	test_arraylist_sort_large,
+	test_arraylist_sort_parallel,
 	NULL
 };
 
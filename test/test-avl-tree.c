@@ -139,6 +139,31 @@ int validate_subtree(AVLTreeNode *node)
 	}
 }
 
+/* Check that the subtree sizes are consistent, by finding each node
+ * by its position and checking that its key has the same rank. */
+
+void validate_order_statistics(AVLTree *tree)
+{
+	AVLTreeNode *node;
+	unsigned int i;
+	unsigned int rank;
+	unsigned int num_entries;
+
+	num_entries = (unsigned int) avl_tree_num_entries(tree);
+
+	for (i=0; i<num_entries; ++i) {
+		node = avl_tree_select(tree, i);
+		assert(node != NULL);
+
+		rank = avl_tree_rank(tree, avl_tree_node_key(node));
+		assert(rank <= i);
+		assert(i < rank + avl_tree_count_range(tree, avl_tree_node_key(node),
+		                                  avl_tree_node_key(node)));
+	}
+
+	assert(avl_tree_select(tree, num_entries) == NULL);
+}
+
 void validate_tree(AVLTree *tree)
 {
 	AVLTreeNode *root_node;
@@ -153,6 +178,8 @@ void validate_tree(AVLTree *tree)
 
 	counter = -1;
 	validate_subtree(root_node);
+
+	validate_order_statistics(tree);
 }
 
 AVLTree *create_tree(void)
@@ -429,6 +456,296 @@ void test_avl_tree_to_array(void)
 	avl_tree_free(tree);
 }
 
+void test_avl_tree_select_rank(void)
+{
+	AVLTree *tree;
+	AVLTreeNode *node;
+	int i;
+	int low, high;
+
+	tree = create_tree();
+
+	/* Every key is found at its own position */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		node = avl_tree_select(tree, (unsigned int) i);
+		assert(*((int *) avl_tree_node_key(node)) == i);
+		assert(avl_tree_rank(tree, &i) == (unsigned int) i);
+	}
+
+	assert(avl_tree_select(tree, NUM_TEST_VALUES) == NULL);
+
+	/* Keys that are not in the tree */
+
+	i = -1;
+	assert(avl_tree_rank(tree, &i) == 0);
+	i = NUM_TEST_VALUES + 100;
+	assert(avl_tree_rank(tree, &i) == NUM_TEST_VALUES);
+
+	/* Ranges */
+
+	low = 10;
+	high = 19;
+	assert(avl_tree_count_range(tree, &low, &high) == 10);
+	assert(avl_tree_count_range(tree, &high, &low) == 0);
+	assert(avl_tree_count_range(tree, &low, &low) == 1);
+	low = -5;
+	high = 5;
+	assert(avl_tree_count_range(tree, &low, &high) == 6);
+	low = NUM_TEST_VALUES - 1;
+	high = NUM_TEST_VALUES + 5;
+	assert(avl_tree_count_range(tree, &low, &high) == 1);
+
+	/* Remove the even keys: the odd keys move down */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		avl_tree_remove(tree, &i);
+	}
+
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES / 2; ++i) {
+		node = avl_tree_select(tree, (unsigned int) i);
+		assert(*((int *) avl_tree_node_key(node)) == i * 2 + 1);
+	}
+
+	i = 500;
+	assert(avl_tree_rank(tree, &i) == 250);
+
+	low = 0;
+	high = 99;
+	assert(avl_tree_count_range(tree, &low, &high) == 50);
+
+	avl_tree_free(tree);
+}
+
+static void range_callback(AVLTreeNode *node, void *user_data)
+{
+	int *total = user_data;
+
+	*total += *((int *) avl_tree_node_key(node));
+}
+
+static void range_remove_callback(AVLTreeNode *node, void *user_data)
+{
+	avl_tree_remove_node((AVLTree *) user_data, node);
+}
+
+void test_avl_tree_iterate(void)
+{
+	AVLTree *tree;
+	AVLTreeIterator iter;
+	AVLTreeNode *node;
+	int i;
+	int low, high;
+	int total;
+
+	/* Empty tree */
+
+	tree = avl_tree_new((AVLTreeCompareFunc) int_compare);
+
+	avl_tree_iterate(tree, &iter);
+	assert(!avl_tree_iter_has_more(&iter));
+	assert(avl_tree_iter_next(&iter) == NULL);
+
+	i = 0;
+	assert(avl_tree_lower_bound(tree, &i) == NULL);
+	assert(avl_tree_upper_bound(tree, &i) == NULL);
+
+	avl_tree_free(tree);
+
+	/* Iterate over a full tree, in order */
+
+	tree = create_tree();
+
+	avl_tree_iterate(tree, &iter);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(avl_tree_iter_has_more(&iter));
+		node = avl_tree_iter_next(&iter);
+		assert(*((int *) avl_tree_node_key(node)) == i);
+	}
+
+	assert(!avl_tree_iter_has_more(&iter));
+
+	/* Walk backwards from the last node */
+
+	node = avl_tree_select(tree, NUM_TEST_VALUES - 1);
+
+	for (i=NUM_TEST_VALUES - 1; i>=0; --i) {
+		assert(*((int *) avl_tree_node_key(node)) == i);
+		node = avl_tree_node_prev(node);
+	}
+
+	assert(node == NULL);
+
+	/* Bounds */
+
+	for (i=0; i<NUM_TEST_VALUES - 1; ++i) {
+		node = avl_tree_lower_bound(tree, &i);
+		assert(*((int *) avl_tree_node_key(node)) == i);
+		node = avl_tree_upper_bound(tree, &i);
+		assert(*((int *) avl_tree_node_key(node)) == i + 1);
+	}
+
+	assert(avl_tree_upper_bound(tree, &i) == NULL);
+	i = -1;
+	assert(*((int *) avl_tree_node_key(avl_tree_lower_bound(tree, &i))) == 0);
+	i = NUM_TEST_VALUES;
+	assert(avl_tree_lower_bound(tree, &i) == NULL);
+
+	/* Start part way through */
+
+	i = 500;
+	avl_tree_iterate_from(tree, &i, &iter);
+
+	for (; i<NUM_TEST_VALUES; ++i) {
+		node = avl_tree_iter_next(&iter);
+		assert(*((int *) avl_tree_node_key(node)) == i);
+	}
+
+	assert(!avl_tree_iter_has_more(&iter));
+
+	/* Remove nodes while iterating */
+
+	avl_tree_iterate(tree, &iter);
+
+	while (avl_tree_iter_has_more(&iter)) {
+		node = avl_tree_iter_next(&iter);
+
+		if (*((int *) avl_tree_node_key(node)) % 2 == 0) {
+			avl_tree_remove_node(tree, node);
+		}
+	}
+
+	validate_tree(tree);
+	assert(avl_tree_num_entries(tree) == NUM_TEST_VALUES / 2);
+
+	/* Bounds for keys that are not in the tree */
+
+	i = 100;
+	node = avl_tree_lower_bound(tree, &i);
+	assert(*((int *) avl_tree_node_key(node)) == 101);
+	i = 101;
+	node = avl_tree_upper_bound(tree, &i);
+	assert(*((int *) avl_tree_node_key(node)) == 103);
+
+	/* Visit a range: the odd numbers from 101 to 199 */
+
+	low = 100;
+	high = 199;
+	total = 0;
+	assert(avl_tree_range_foreach(tree, &low, &high, range_callback,
+	                         &total) == 50);
+	assert(total == 7500);
+
+	assert(avl_tree_range_foreach(tree, &high, &low, range_callback,
+	                         &total) == 0);
+
+	/* Remove a range from within the callback */
+
+	assert(avl_tree_range_foreach(tree, &low, &high, range_remove_callback,
+	                         tree) == 50);
+	validate_tree(tree);
+	assert(avl_tree_count_range(tree, &low, &high) == 0);
+	assert(avl_tree_num_entries(tree) == NUM_TEST_VALUES / 2 - 50);
+
+	avl_tree_free(tree);
+}
+
+void test_avl_tree_new_from_sorted(void)
+{
+	AVLTree *tree;
+	AVLTreeKey keys[NUM_TEST_VALUES];
+	AVLTreeValue values[NUM_TEST_VALUES];
+	unsigned int length;
+	unsigned int i;
+	int value;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i * 2;
+		keys[i] = &test_array[i];
+		values[i] = &test_array[i];
+	}
+
+	/* Build trees of every size up to a few complete levels, to
+	 * cover both full and partly-filled bottom levels. */
+
+	for (length=0; length<=130; ++length) {
+		tree = avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+		                                keys, values, length);
+
+		assert(tree != NULL);
+		assert(avl_tree_num_entries(tree) == length);
+		validate_tree(tree);
+
+		for (i=0; i<length; ++i) {
+			assert(avl_tree_lookup(tree, keys[i]) == values[i]);
+		}
+
+		avl_tree_free(tree);
+	}
+
+	/* A large tree can be modified afterwards, mixing nodes from the
+	 * block with individually allocated ones. */
+
+	tree = avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+	                                keys, values, NUM_TEST_VALUES);
+	assert(tree != NULL);
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		value = (int) i * 2;
+		assert(avl_tree_remove(tree, &value) != 0);
+	}
+
+	validate_tree(tree);
+	assert(avl_tree_num_entries(tree) == NUM_TEST_VALUES / 2);
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		test_array[i] = (int) i * 2 + 1;
+		assert(avl_tree_insert(tree, &test_array[i],
+		                       &test_array[i]) != NULL);
+	}
+
+	validate_tree(tree);
+	assert(avl_tree_num_entries(tree) == NUM_TEST_VALUES);
+
+	avl_tree_free(tree);
+
+	/* Without values, every key maps to AVL_TREE_NULL */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i;
+	}
+
+	tree = avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+	                                keys, NULL, NUM_TEST_VALUES);
+	assert(tree != NULL);
+	assert(avl_tree_lookup_node(tree, keys[10]) != NULL);
+	assert(avl_tree_lookup(tree, keys[10]) == AVL_TREE_NULL);
+	avl_tree_free(tree);
+
+	/* Keys out of order, or repeated, are rejected */
+
+	keys[5] = keys[4];
+	assert(avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+	                                keys, values, 10) == NULL);
+	keys[5] = keys[3];
+	assert(avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+	                                keys, values, 10) == NULL);
+	keys[5] = &test_array[5];
+
+	/* Test out of memory scenario: the tree structure can be
+	 * allocated, but not the node block. */
+
+	alloc_test_set_limit(1);
+
+	tree = avl_tree_new_from_sorted((AVLTreeCompareFunc) int_compare,
+	                                keys, values, NUM_TEST_VALUES);
+	assert(tree == NULL);
+}
+
 static UnitTestFunction tests[] = {
 	test_avl_tree_new,
 	test_avl_tree_free,
@@ -438,6 +755,9 @@ static UnitTestFunction tests[] = {
 	test_avl_tree_remove,
 	test_avl_tree_to_array,
 	test_out_of_memory,
+	test_avl_tree_select_rank,
+	test_avl_tree_iterate,
+	test_avl_tree_new_from_sorted,
 	NULL
 };
 
@@ -130,6 +130,234 @@ void test_max_heap(void)
 	binary_heap_free(heap);
 }
 
+/* Test heaps with different numbers of children per node, adding and
+ * removing values in random order */
+
+static void check_heap_order(BinaryHeapType heap_type, unsigned int arity)
+{
+	BinaryHeap *heap;
+	int *val;
+	int last;
+	int i, j;
+
+	heap = binary_heap_new_with_arity(heap_type, int_compare, arity);
+	assert(heap != NULL);
+
+	srand(arity);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = rand() % 1000;
+	}
+
+	/* Interleave insertions and removals */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 10) {
+		for (j=i; j<i + 10; ++j) {
+			assert(binary_heap_insert(heap, &test_array[j]) != 0);
+		}
+
+		val = binary_heap_pop(heap);
+		assert(val != NULL);
+	}
+
+	assert(binary_heap_num_entries(heap) == NUM_TEST_VALUES * 9 / 10);
+
+	/* Values are removed in order */
+
+	last = heap_type == BINARY_HEAP_TYPE_MIN ? -1 : 1000;
+
+	while (binary_heap_num_entries(heap) > 0) {
+		val = binary_heap_pop(heap);
+
+		if (heap_type == BINARY_HEAP_TYPE_MIN) {
+			assert(*val >= last);
+		} else {
+			assert(*val <= last);
+		}
+
+		last = *val;
+	}
+
+	assert(binary_heap_pop(heap) == BINARY_HEAP_NULL);
+
+	binary_heap_free(heap);
+}
+
+void test_binary_heap_arity(void)
+{
+	unsigned int arities[] = { 2, 3, 4, 5, 8, 16 };
+	unsigned int i;
+
+	for (i=0; i<sizeof(arities) / sizeof(*arities); ++i) {
+		check_heap_order(BINARY_HEAP_TYPE_MIN, arities[i]);
+		check_heap_order(BINARY_HEAP_TYPE_MAX, arities[i]);
+	}
+
+	/* Each node must have at least two children */
+
+	assert(binary_heap_new_with_arity(BINARY_HEAP_TYPE_MIN,
+	                                  int_compare, 1) == NULL);
+	assert(binary_heap_new_with_arity(BINARY_HEAP_TYPE_MIN,
+	                                  int_compare, 0) == NULL);
+}
+
+/* Test changing the priority of values and removing them using handles */
+
+void test_binary_heap_handles(void)
+{
+	BinaryHeap *heap;
+	BinaryHeapHandle *handles[NUM_TEST_VALUES];
+	int *val;
+	int i;
+
+	heap = binary_heap_new(BINARY_HEAP_TYPE_MIN, int_compare);
+
+	/* Insert values with handles, and some without */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i + NUM_TEST_VALUES;
+
+		if (i % 10 == 0) {
+			handles[i] = NULL;
+			assert(binary_heap_insert(heap, &test_array[i]) != 0);
+		} else {
+			handles[i] = binary_heap_insert_handle(heap,
+			                                       &test_array[i]);
+			assert(handles[i] != NULL);
+		}
+	}
+
+	/* Decrease the priority of every other value, in reverse order */
+
+	for (i=NUM_TEST_VALUES - 1; i>=0; --i) {
+		if (handles[i] != NULL && i % 2 == 0) {
+			test_array[i] -= NUM_TEST_VALUES;
+			binary_heap_decrease_key(heap, handles[i],
+			                         &test_array[i]);
+		}
+	}
+
+	/* Move some values in both directions */
+
+	for (i=1; i<NUM_TEST_VALUES; i += 3) {
+		if (handles[i] != NULL) {
+			test_array[i] = NUM_TEST_VALUES * 3 - i;
+			binary_heap_update(heap, handles[i], &test_array[i]);
+		}
+	}
+
+	/* Remove some values */
+
+	for (i=5; i<NUM_TEST_VALUES; i += 7) {
+		if (handles[i] != NULL) {
+			assert(binary_heap_remove(heap, handles[i])
+			       == &test_array[i]);
+			test_array[i] = -1;
+		}
+	}
+
+	/* The remaining values are removed in order */
+
+	i = -1;
+
+	while (binary_heap_num_entries(heap) > 0) {
+		val = binary_heap_pop(heap);
+		assert(*val >= i);
+		i = *val;
+	}
+
+	/* Values with handles are freed with the heap */
+
+	for (i=0; i<100; ++i) {
+		assert(binary_heap_insert_handle(heap, &test_array[i]) != NULL);
+	}
+
+	binary_heap_free(heap);
+}
+
+/* Test creating a heap from an array, and removing several values */
+
+static int compare_values(const void *a, const void *b)
+{
+	return int_compare(*(BinaryHeapValue *) a, *(BinaryHeapValue *) b);
+}
+
+void test_binary_heap_new_from_array(void)
+{
+	BinaryHeap *heap;
+	BinaryHeapValue values[NUM_TEST_VALUES];
+	BinaryHeapValue sorted[NUM_TEST_VALUES];
+	BinaryHeapValue result[100];
+	unsigned int count;
+	int i, j;
+
+	srand(1234);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = rand() % 5000;
+		values[i] = &test_array[i];
+		sorted[i] = &test_array[i];
+	}
+
+	qsort(sorted, NUM_TEST_VALUES, sizeof(BinaryHeapValue), compare_values);
+
+	heap = binary_heap_new_from_array(BINARY_HEAP_TYPE_MIN, int_compare,
+	                                  values, NUM_TEST_VALUES);
+	assert(heap != NULL);
+	assert(binary_heap_num_entries(heap) == NUM_TEST_VALUES);
+
+	/* The array was copied */
+
+	values[0] = NULL;
+
+	/* Remove the values in batches */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 100) {
+		count = binary_heap_pop_n(heap, result, 100);
+		assert(count == 100);
+
+		for (j=0; j<100; ++j) {
+			assert(*((int *) result[j]) == *((int *) sorted[i + j]));
+		}
+	}
+
+	assert(binary_heap_pop_n(heap, result, 100) == 0);
+
+	/* The heap can be added to as normal */
+
+	for (i=0; i<10; ++i) {
+		assert(binary_heap_insert(heap, &test_array[i]) != 0);
+	}
+
+	assert(binary_heap_pop_n(heap, result, 100) == 10);
+
+	binary_heap_free(heap);
+
+	/* Small heaps */
+
+	for (count=0; count<5; ++count) {
+		heap = binary_heap_new_from_array(BINARY_HEAP_TYPE_MAX,
+		                                  int_compare, values + 1,
+		                                  count);
+		assert(binary_heap_num_entries(heap) == count);
+		assert(binary_heap_pop_n(heap, result, 100) == count);
+
+		for (j=1; j<(int) count; ++j) {
+			assert(*((int *) result[j - 1])
+			       >= *((int *) result[j]));
+		}
+
+		binary_heap_free(heap);
+	}
+
+	/* Test low memory scenario */
+
+	alloc_test_set_limit(1);
+	heap = binary_heap_new_from_array(BINARY_HEAP_TYPE_MIN, int_compare,
+	                                  values, NUM_TEST_VALUES);
+	assert(heap == NULL);
+}
+
 /* Test out of memory scenario when adding items */
 
 void test_out_of_memory(void)
@@ -170,6 +398,26 @@ void test_out_of_memory(void)
 
 	assert(binary_heap_num_entries(heap) == 0);
 
+	/* Adding a value with a handle needs memory for the handle */
+
+	assert(binary_heap_insert_handle(heap, &values[0]) == NULL);
+	alloc_test_set_limit(1);
+	assert(binary_heap_insert_handle(heap, &values[0]) == NULL);
+	alloc_test_set_limit(2);
+	assert(binary_heap_insert_handle(heap, &values[0]) != NULL);
+
+	/* A full heap with handles cannot be enlarged */
+
+	alloc_test_set_limit(-1);
+
+	for (i=1; i<16; ++i) {
+		assert(binary_heap_insert_handle(heap, &values[i]) != NULL);
+	}
+
+	alloc_test_set_limit(1);
+	assert(binary_heap_insert_handle(heap, &values[0]) == NULL);
+	assert(binary_heap_num_entries(heap) == 16);
+
 	binary_heap_free(heap);
 }
 
@@ -178,6 +426,9 @@ static UnitTestFunction tests[] = {
 	test_binary_heap_insert,
 	test_min_heap,
 	test_max_heap,
+	test_binary_heap_arity,
+	test_binary_heap_handles,
+	test_binary_heap_new_from_array,
 	test_out_of_memory,
 	NULL
 };
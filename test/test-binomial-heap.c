@@ -241,6 +241,218 @@ void test_pop_out_of_memory(void)
 	}
 }
 
+/* Test changing the priority of values and removing them using handles */
+
+void test_binomial_heap_handles(void)
+{
+	BinomialHeap *heap;
+	BinomialHeapHandle *handles[NUM_TEST_VALUES];
+	int *val;
+	int i;
+
+	heap = binomial_heap_new(BINOMIAL_HEAP_TYPE_MAX, int_compare);
+
+	/* Insert values with handles, and some without */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+
+		if (i % 10 == 0) {
+			handles[i] = NULL;
+			assert(binomial_heap_insert(heap,
+			                            &test_array[i]) != 0);
+		} else {
+			handles[i] = binomial_heap_insert_handle(heap,
+			                                         &test_array[i]);
+			assert(handles[i] != NULL);
+		}
+	}
+
+	/* Increase the priority of every other value */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		if (handles[i] != NULL) {
+			test_array[i] += NUM_TEST_VALUES;
+			binomial_heap_decrease_key(heap, handles[i],
+			                           &test_array[i]);
+		}
+	}
+
+	/* Move some values in both directions */
+
+	for (i=1; i<NUM_TEST_VALUES; i += 3) {
+		if (handles[i] != NULL) {
+			test_array[i] = NUM_TEST_VALUES * 3 - i * 2;
+			binomial_heap_update(heap, handles[i], &test_array[i]);
+		}
+	}
+
+	/* Remove some values */
+
+	for (i=5; i<NUM_TEST_VALUES; i += 7) {
+		if (handles[i] != NULL) {
+			assert(binomial_heap_remove(heap, handles[i])
+			       == &test_array[i]);
+			test_array[i] = -1;
+		}
+	}
+
+	/* The remaining values are removed in order */
+
+	i = NUM_TEST_VALUES * 3;
+
+	while (binomial_heap_num_entries(heap) > 0) {
+		val = binomial_heap_pop(heap);
+		assert(*val <= i);
+		i = *val;
+	}
+
+	/* Values with handles are freed with the heap */
+
+	for (i=0; i<100; ++i) {
+		assert(binomial_heap_insert_handle(heap,
+		                                   &test_array[i]) != NULL);
+	}
+
+	binomial_heap_free(heap);
+}
+
+/* Test out of memory when removing a value using its handle */
+
+void test_remove_out_of_memory(void)
+{
+	BinomialHeap *heap;
+	BinomialHeapHandle *handle;
+	int *value;
+	int failed;
+	int i;
+
+	/* Probe at increasing limit levels until the removal succeeds */
+
+	failed = 1;
+
+	for (i=0; failed; ++i) {
+		heap = generate_heap();
+
+		test_array[TEST_VALUE] = TEST_VALUE;
+		handle = binomial_heap_insert_handle(heap,
+		                                     &test_array[TEST_VALUE]);
+		assert(handle != NULL);
+
+		alloc_test_set_limit(i);
+		value = binomial_heap_remove(heap, handle);
+		alloc_test_set_limit(-1);
+
+		/* If the removal failed, the value can still be removed */
+
+		failed = value == NULL;
+
+		if (failed) {
+			assert(i < 100);
+			value = binomial_heap_remove(heap, handle);
+		}
+
+		assert(value == &test_array[TEST_VALUE]);
+
+		/* Check that the heap is unharmed */
+
+		verify_heap(heap);
+
+		binomial_heap_free(heap);
+	}
+
+	assert(i > 1);
+
+	/* Inserting with a handle fails if the handle cannot be allocated */
+
+	heap = generate_heap();
+
+	alloc_test_set_limit(0);
+	assert(binomial_heap_insert_handle(heap,
+	                                   &test_array[TEST_VALUE]) == NULL);
+	alloc_test_set_limit(-1);
+
+	verify_heap(heap);
+
+	binomial_heap_free(heap);
+}
+
+/* Test merging two heaps */
+
+void test_binomial_heap_merge(void)
+{
+	BinomialHeap *heap1;
+	BinomialHeap *heap2;
+	BinomialHeapHandle *handle;
+	int *val;
+	int i;
+
+	heap1 = binomial_heap_new(BINOMIAL_HEAP_TYPE_MIN, int_compare);
+	heap2 = binomial_heap_new(BINOMIAL_HEAP_TYPE_MIN, int_compare);
+
+	/* Even values in one heap, odd values in the other */
+
+	handle = NULL;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+
+		if (i % 2 == 0) {
+			assert(binomial_heap_insert(heap1,
+			                            &test_array[i]) != 0);
+		} else if (i == TEST_VALUE + 1) {
+			handle = binomial_heap_insert_handle(heap2,
+			                                     &test_array[i]);
+			assert(handle != NULL);
+		} else {
+			assert(binomial_heap_insert(heap2,
+			                            &test_array[i]) != 0);
+		}
+	}
+
+	/* Merging fails if there is no memory, leaving both heaps
+	 * unchanged */
+
+	alloc_test_set_limit(0);
+	assert(binomial_heap_merge(heap1, heap2) == 0);
+	alloc_test_set_limit(-1);
+
+	assert(binomial_heap_num_entries(heap1) == NUM_TEST_VALUES / 2);
+	assert(binomial_heap_num_entries(heap2) == NUM_TEST_VALUES / 2);
+
+	assert(binomial_heap_merge(heap1, heap2) != 0);
+
+	assert(binomial_heap_num_entries(heap1) == NUM_TEST_VALUES);
+	assert(binomial_heap_num_entries(heap2) == 0);
+	assert(binomial_heap_pop(heap2) == NULL);
+
+	/* Handles from the other heap can be used with the merged heap */
+
+	assert(binomial_heap_remove(heap1, handle)
+	       == &test_array[TEST_VALUE + 1]);
+
+	/* The values are removed in order */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		if (i == TEST_VALUE + 1) {
+			continue;
+		}
+
+		val = binomial_heap_pop(heap1);
+		assert(*val == i);
+	}
+
+	assert(binomial_heap_num_entries(heap1) == 0);
+
+	/* The emptied heap can still be used */
+
+	assert(binomial_heap_insert(heap2, &test_array[0]) != 0);
+	assert(binomial_heap_pop(heap2) == &test_array[0]);
+
+	binomial_heap_free(heap1);
+	binomial_heap_free(heap2);
+}
+
 static UnitTestFunction tests[] = {
 	test_binomial_heap_new_free,
 	test_binomial_heap_insert,
@@ -248,6 +460,9 @@ static UnitTestFunction tests[] = {
 	test_max_heap,
 	test_insert_out_of_memory,
 	test_pop_out_of_memory,
+	test_binomial_heap_handles,
+	test_remove_out_of_memory,
+	test_binomial_heap_merge,
 	NULL
 };
 
@@ -20,7 +20,10 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "alloc-testing.h"
 #include "framework.h"
@@ -249,6 +252,335 @@ void test_bloom_filter_mismatch(void)
 	bloom_filter_free(filter1);
 }
 
+/* 64-bit FNV-1a hash, with a final mix so that all bits of the result
+ * depend on the whole string. */
+
+static uint64_t string_hash64(void *string)
+{
+	unsigned char *p;
+	uint64_t result;
+
+	result = 0xcbf29ce484222325ULL;
+
+	for (p = string; *p != '\0'; ++p) {
+		result = (result ^ *p) * 0x100000001b3ULL;
+	}
+
+	result ^= result >> 33;
+	result *= 0xff51afd7ed558ccdULL;
+	result ^= result >> 33;
+
+	return result;
+}
+
+void test_bloom_filter_blocked(void)
+{
+	BloomFilter *filter;
+	BloomFilter *filter2;
+	BloomFilter *result;
+	unsigned char state[64];
+	char buf[20];
+	unsigned int i;
+
+	/* Out of memory */
+
+	alloc_test_set_limit(1);
+	filter = bloom_filter_new_blocked(512, string_hash64, 8);
+	assert(filter == NULL);
+	alloc_test_set_limit(-1);
+
+	/* Too many functions */
+
+	assert(bloom_filter_new_blocked(512, string_hash64, 65) == NULL);
+
+	/* The table is rounded up to one block */
+
+	filter = bloom_filter_new_blocked(100, string_hash64, 8);
+	assert(filter != NULL);
+
+	assert(bloom_filter_query(filter, "test 1") == 0);
+	assert(bloom_filter_query(filter, "test 2") == 0);
+
+	bloom_filter_insert(filter, "test 1");
+
+	assert(bloom_filter_query(filter, "test 1") != 0);
+	assert(bloom_filter_query(filter, "test 2") == 0);
+
+	/* Read and load */
+
+	bloom_filter_read(filter, state);
+
+	filter2 = bloom_filter_new_blocked(512, string_hash64, 8);
+	bloom_filter_load(filter2, state);
+	assert(bloom_filter_query(filter2, "test 1") != 0);
+
+	/* Union and intersection */
+
+	bloom_filter_insert(filter2, "test 2");
+
+	result = bloom_filter_union(filter, filter2);
+	assert(bloom_filter_query(result, "test 2") != 0);
+	bloom_filter_free(result);
+
+	result = bloom_filter_intersection(filter, filter2);
+	assert(bloom_filter_query(result, "test 1") != 0);
+	assert(bloom_filter_query(result, "test 2") == 0);
+	bloom_filter_free(result);
+
+	bloom_filter_free(filter2);
+
+	/* Cannot combine with a filter that is not blocked */
+
+	filter2 = bloom_filter_new(512, string_hash, 8);
+	assert(bloom_filter_union(filter, filter2) == NULL);
+	assert(bloom_filter_intersection(filter, filter2) == NULL);
+	bloom_filter_free(filter2);
+
+	bloom_filter_free(filter);
+
+	/* Many values across many blocks */
+
+	filter = bloom_filter_new_blocked(64 * 1024, string_hash64, 8);
+
+	for (i=0; i<4096; ++i) {
+		sprintf(buf, "%u", i);
+		bloom_filter_insert(filter, buf);
+	}
+
+	for (i=0; i<4096; ++i) {
+		sprintf(buf, "%u", i);
+		assert(bloom_filter_query(filter, buf) != 0);
+	}
+
+	bloom_filter_free(filter);
+}
+
+/* Compare the false positive rate of blocked and unblocked filters of
+ * the same size, with 16 bits per value. */
+
+static unsigned int count_false_positives(BloomFilter *filter)
+{
+	char buf[20];
+	unsigned int result;
+	unsigned int i;
+
+	for (i=0; i<4096; ++i) {
+		sprintf(buf, "value %u", i);
+		bloom_filter_insert(filter, buf);
+	}
+
+	result = 0;
+
+	for (i=0; i<100000; ++i) {
+		sprintf(buf, "other %u", i);
+
+		if (bloom_filter_query(filter, buf)) {
+			++result;
+		}
+	}
+
+	return result;
+}
+
+void test_bloom_filter_blocked_false_positives(void)
+{
+	BloomFilter *filter;
+	unsigned int blocked;
+	unsigned int unblocked;
+
+	filter = bloom_filter_new_blocked(64 * 1024, string_hash64, 8);
+	blocked = count_false_positives(filter);
+	bloom_filter_free(filter);
+
+	filter = bloom_filter_new(64 * 1024, string_hash, 8);
+	unblocked = count_false_positives(filter);
+	bloom_filter_free(filter);
+
+	assert(blocked < unblocked);
+}
+
+#define NUM_BATCH_VALUES 1000
+
+static void test_batch_filter(BloomFilter *filter)
+{
+	static char strings[NUM_BATCH_VALUES * 2][20];
+	BloomFilterValue values[NUM_BATCH_VALUES * 2];
+	unsigned char results[(NUM_BATCH_VALUES * 2 + 7) / 8];
+	int present;
+	unsigned int i;
+
+	for (i=0; i<NUM_BATCH_VALUES * 2; ++i) {
+		sprintf(strings[i], "value %u", i);
+		values[i] = strings[i];
+	}
+
+	/* Insert the first half of the values */
+
+	bloom_filter_insert_batch(filter, values, NUM_BATCH_VALUES);
+
+	/* The results of a batch query match the results of querying
+	 * each value separately. */
+
+	memset(results, 0xff, sizeof(results));
+	bloom_filter_query_batch(filter, values, NUM_BATCH_VALUES * 2, results);
+
+	for (i=0; i<NUM_BATCH_VALUES * 2; ++i) {
+		present = (results[i / 8] & (1 << (i % 8))) != 0;
+
+		assert(present == (bloom_filter_query(filter, values[i]) != 0));
+
+		if (i < NUM_BATCH_VALUES) {
+			assert(present);
+		}
+	}
+
+	/* Empty batches do nothing */
+
+	bloom_filter_insert_batch(filter, values, 0);
+	bloom_filter_query_batch(filter, values, 0, results);
+}
+
+void test_bloom_filter_batch(void)
+{
+	BloomFilter *filter;
+
+	filter = bloom_filter_new(16 * 1024, string_hash, 4);
+	test_batch_filter(filter);
+	bloom_filter_free(filter);
+
+	filter = bloom_filter_new_blocked(16 * 1024, string_hash64, 4);
+	test_batch_filter(filter);
+	bloom_filter_free(filter);
+}
+
+/* Several threads insert values into a shared filter at once, while
+ * another thread queries values that were inserted beforehand. */
+
+#define NUM_THREADS 4
+#define NUM_THREAD_VALUES 10000
+
+static BloomFilter *concurrent_filter;
+static char concurrent_values[NUM_THREADS + 1][NUM_THREAD_VALUES][20];
+
+static void *concurrent_insert_thread(void *arg)
+{
+	char (*values)[20] = arg;
+	unsigned int i;
+
+	for (i=0; i<NUM_THREAD_VALUES; ++i) {
+		bloom_filter_insert(concurrent_filter, values[i]);
+	}
+
+	return NULL;
+}
+
+static void *concurrent_query_thread(void *arg)
+{
+	char (*values)[20] = arg;
+	unsigned int i, j;
+
+	for (j=0; j<10; ++j) {
+		for (i=0; i<NUM_THREAD_VALUES; ++i) {
+			assert(bloom_filter_query(concurrent_filter,
+			                          values[i]) != 0);
+		}
+	}
+
+	return NULL;
+}
+
+static void test_concurrent_filter(BloomFilter *filter)
+{
+	pthread_t threads[NUM_THREADS + 1];
+	unsigned int i, j;
+
+	concurrent_filter = filter;
+
+	for (i=0; i<NUM_THREADS + 1; ++i) {
+		for (j=0; j<NUM_THREAD_VALUES; ++j) {
+			sprintf(concurrent_values[i][j], "%u-%u", i, j);
+		}
+	}
+
+	for (j=0; j<NUM_THREAD_VALUES; ++j) {
+		bloom_filter_insert(filter, concurrent_values[NUM_THREADS][j]);
+	}
+
+	for (i=0; i<NUM_THREADS; ++i) {
+		assert(pthread_create(&threads[i], NULL,
+		                      concurrent_insert_thread,
+		                      concurrent_values[i]) == 0);
+	}
+
+	assert(pthread_create(&threads[NUM_THREADS], NULL,
+	                      concurrent_query_thread,
+	                      concurrent_values[NUM_THREADS]) == 0);
+
+	for (i=0; i<NUM_THREADS + 1; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	/* No bits were lost */
+
+	for (i=0; i<NUM_THREADS + 1; ++i) {
+		for (j=0; j<NUM_THREAD_VALUES; ++j) {
+			assert(bloom_filter_query(filter,
+			                          concurrent_values[i][j]) != 0);
+		}
+	}
+}
+
+void test_bloom_filter_concurrent(void)
+{
+	BloomFilter *filter1;
+	BloomFilter *filter2;
+	unsigned char state1[128];
+	unsigned char state2[128];
+
+	filter1 = bloom_filter_new_full(256 * 1024, string_hash, 4,
+	                                BLOOM_FILTER_CONCURRENT);
+	test_concurrent_filter(filter1);
+	bloom_filter_free(filter1);
+
+	filter1 = bloom_filter_new_blocked_full(256 * 1024, string_hash64, 4,
+	                                        BLOOM_FILTER_CONCURRENT);
+	test_concurrent_filter(filter1);
+	bloom_filter_free(filter1);
+
+	/* Concurrent filters have the same table layout as other filters,
+	 * so they can be read, loaded and combined alike. */
+
+	filter1 = bloom_filter_new_full(1000, string_hash, 4,
+	                                BLOOM_FILTER_CONCURRENT);
+	filter2 = bloom_filter_new(1000, string_hash, 4);
+
+	bloom_filter_insert(filter1, "test 1");
+	bloom_filter_insert(filter1, "test 2");
+	bloom_filter_insert(filter2, "test 1");
+	bloom_filter_insert(filter2, "test 2");
+
+	bloom_filter_read(filter1, state1);
+	bloom_filter_read(filter2, state2);
+	assert(memcmp(state1, state2, (1000 + 7) / 8) == 0);
+
+	bloom_filter_free(filter2);
+
+	filter2 = bloom_filter_new_full(1000, string_hash, 4,
+	                                BLOOM_FILTER_CONCURRENT);
+	bloom_filter_load(filter2, state1);
+	assert(bloom_filter_query(filter2, "test 2") != 0);
+	bloom_filter_free(filter2);
+
+	bloom_filter_free(filter1);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(1);
+	filter1 = bloom_filter_new_full(1000, string_hash, 4,
+	                                BLOOM_FILTER_CONCURRENT);
+	assert(filter1 == NULL);
+}
+
 static UnitTestFunction tests[] = {
 	test_bloom_filter_new_free,
 	test_bloom_filter_insert_query,
@@ -256,6 +588,10 @@ static UnitTestFunction tests[] = {
 	test_bloom_filter_intersection,
 	test_bloom_filter_union,
 	test_bloom_filter_mismatch,
+	test_bloom_filter_blocked,
+	test_bloom_filter_blocked_false_positives,
+	test_bloom_filter_batch,
+	test_bloom_filter_concurrent,
 	NULL
 };
 
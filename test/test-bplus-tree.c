@@ -0,0 +1,548 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "bplus-tree.h"
+#include "compare-int.h"
+
+#define NUM_TEST_VALUES 10000
+
+int test_array[NUM_TEST_VALUES];
+
+/* Check that iterating over the tree visits the expected number of
+ * entries, in increasing order of key, and that each key maps to
+ * itself. */
+
+static void validate_tree(BPlusTree *tree)
+{
+	BPlusTreeIterator iter;
+	BPlusTreePair pair;
+	int *prev;
+	unsigned int count;
+
+	prev = NULL;
+	count = 0;
+
+	bplus_tree_iterate(tree, &iter);
+
+	while (bplus_tree_iter_has_more(&iter)) {
+		pair = bplus_tree_iter_next(&iter);
+
+		assert(pair.key != NULL);
+		assert(pair.value == pair.key);
+		assert(bplus_tree_lookup(tree, pair.key) == pair.value);
+
+		if (prev != NULL) {
+			assert(*prev < *((int *) pair.key));
+		}
+
+		prev = pair.key;
+		++count;
+	}
+
+	assert(count == bplus_tree_num_entries(tree));
+
+	pair = bplus_tree_iter_next(&iter);
+	assert(pair.key == BPLUS_TREE_NULL);
+	assert(pair.value == BPLUS_TREE_NULL);
+}
+
+static BPlusTree *create_tree(void)
+{
+	BPlusTree *tree;
+	int i;
+
+	/* Insert in a scattered order, so that splits happen all over
+	 * the tree rather than only at the right edge. */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+	}
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		int *key = &test_array[(i * 7919) % NUM_TEST_VALUES];
+		assert(bplus_tree_insert(tree, key, key) != 0);
+	}
+
+	return tree;
+}
+
+void test_bplus_tree_new(void)
+{
+	BPlusTree *tree;
+	BPlusTreeIterator iter;
+	int i = 0;
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	assert(tree != NULL);
+	assert(bplus_tree_num_entries(tree) == 0);
+	assert(bplus_tree_lookup(tree, &i) == NULL);
+	assert(bplus_tree_remove(tree, &i) == 0);
+
+	bplus_tree_iterate(tree, &iter);
+	assert(!bplus_tree_iter_has_more(&iter));
+	bplus_tree_iterate_from(tree, &i, &iter);
+	assert(!bplus_tree_iter_has_more(&iter));
+
+	bplus_tree_free(tree);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	assert(tree == NULL);
+}
+
+void test_bplus_tree_insert_lookup(void)
+{
+	BPlusTree *tree;
+	unsigned int i;
+	int other[NUM_TEST_VALUES];
+	int *value;
+
+	/* Insert in increasing order, checking all entries are still
+	 * present after each insert. */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i;
+		assert(bplus_tree_insert(tree, &test_array[i],
+		                         &test_array[i]) != 0);
+
+		assert(bplus_tree_num_entries(tree) == i + 1);
+
+		if (i % 1000 == 0) {
+			validate_tree(tree);
+		}
+	}
+
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		value = bplus_tree_lookup(tree, &i);
+		assert(value != NULL);
+		assert(*value == (int) i);
+	}
+
+	/* Check invalid values */
+
+	i = NUM_TEST_VALUES + 100;
+	assert(bplus_tree_lookup(tree, &i) == NULL);
+	i = (unsigned int) -1;
+	assert(bplus_tree_lookup(tree, &i) == NULL);
+
+	/* Inserting an existing key replaces its value */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		other[i] = (int) i;
+		assert(bplus_tree_insert(tree, &test_array[i], &other[i]) != 0);
+	}
+
+	assert(bplus_tree_num_entries(tree) == NUM_TEST_VALUES);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(bplus_tree_lookup(tree, &i) == &other[i]);
+	}
+
+	bplus_tree_free(tree);
+
+	/* Insert in decreasing order */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	for (i=NUM_TEST_VALUES; i>0; --i) {
+		assert(bplus_tree_insert(tree, &test_array[i - 1],
+		                         &test_array[i - 1]) != 0);
+	}
+
+	validate_tree(tree);
+	assert(bplus_tree_num_entries(tree) == NUM_TEST_VALUES);
+
+	bplus_tree_free(tree);
+}
+
+void test_bplus_tree_remove(void)
+{
+	BPlusTree *tree;
+	int i;
+	int x, y, z;
+	int value;
+	unsigned int expected_entries;
+
+	tree = create_tree();
+
+	/* Try removing invalid entries */
+
+	i = NUM_TEST_VALUES + 100;
+	assert(bplus_tree_remove(tree, &i) == 0);
+	i = -1;
+	assert(bplus_tree_remove(tree, &i) == 0);
+
+	/* Delete the nodes from the tree */
+
+	expected_entries = NUM_TEST_VALUES;
+
+	/* This looping arrangement causes nodes to be removed in a
+	 * randomish fashion from all over the tree. */
+
+	for (x=0; x<10; ++x) {
+		for (y=0; y<10; ++y) {
+			for (z=0; z<100; ++z) {
+				value = z * 100 + (9 - y) * 10 + x;
+				assert(bplus_tree_remove(tree, &value) != 0);
+				--expected_entries;
+				assert(bplus_tree_num_entries(tree)
+				       == expected_entries);
+				assert(bplus_tree_lookup(tree, &value) == NULL);
+			}
+
+			validate_tree(tree);
+		}
+	}
+
+	/* All entries removed, should be empty now */
+
+	assert(bplus_tree_num_entries(tree) == 0);
+
+	/* The tree can be refilled after being emptied */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(bplus_tree_insert(tree, &test_array[i],
+		                         &test_array[i]) != 0);
+	}
+
+	validate_tree(tree);
+
+	bplus_tree_free(tree);
+}
+
+void test_bplus_tree_remove_random(void)
+{
+	BPlusTree *tree;
+	int present[NUM_TEST_VALUES];
+	unsigned int expected_entries;
+	unsigned int i;
+	int key;
+
+	/* Perform a random mix of inserts and removes, checking the
+	 * result against a simple array of flags. */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i;
+		present[i] = 0;
+	}
+
+	srand(1234);
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+	expected_entries = 0;
+
+	for (i=0; i<200000; ++i) {
+		key = rand() % NUM_TEST_VALUES;
+
+		if (rand() % 2 == 0) {
+			assert(bplus_tree_insert(tree, &test_array[key],
+			                         &test_array[key]) != 0);
+
+			if (!present[key]) {
+				present[key] = 1;
+				++expected_entries;
+			}
+		} else {
+			assert(bplus_tree_remove(tree, &key) == present[key]);
+
+			if (present[key]) {
+				present[key] = 0;
+				--expected_entries;
+			}
+		}
+
+		assert(bplus_tree_num_entries(tree) == expected_entries);
+
+		if (i % 10000 == 0) {
+			validate_tree(tree);
+		}
+	}
+
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		key = (int) i;
+
+		if (present[i]) {
+			assert(bplus_tree_lookup(tree, &key) == &test_array[i]);
+		} else {
+			assert(bplus_tree_lookup(tree, &key) == NULL);
+		}
+	}
+
+	bplus_tree_free(tree);
+}
+
+void test_bplus_tree_remove_free_keys(void)
+{
+	BPlusTree *tree;
+	int *keys[NUM_TEST_VALUES];
+	unsigned int i, j;
+	unsigned int found;
+	int *tmp;
+	int key;
+
+	/* Keys owned by the caller may be freed as soon as they have
+	 * been removed, so the tree must not keep any references to
+	 * them, even as separators in the branches. */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = (int) i;
+		assert(bplus_tree_insert(tree, keys[i], keys[i]) != 0);
+	}
+
+	/* Shuffle, then remove and free the first 30% of the keys */
+
+	srand(5678);
+
+	for (i=NUM_TEST_VALUES - 1; i>0; --i) {
+		j = (unsigned int) rand() % (i + 1);
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+
+	for (i=0; i<NUM_TEST_VALUES * 3 / 10; ++i) {
+		key = *keys[i];
+		assert(bplus_tree_remove(tree, &key) != 0);
+		free(keys[i]);
+		keys[i] = NULL;
+
+		assert(bplus_tree_lookup(tree, &key) == NULL);
+	}
+
+	validate_tree(tree);
+
+	found = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		key = (int) i;
+
+		if (bplus_tree_lookup(tree, &key) != NULL) {
+			++found;
+		}
+	}
+
+	assert(found == bplus_tree_num_entries(tree));
+
+	for (i=NUM_TEST_VALUES * 3 / 10; i<NUM_TEST_VALUES; ++i) {
+		assert(bplus_tree_lookup(tree, keys[i]) == keys[i]);
+	}
+
+	/* Remove and free the rest */
+
+	for (i=NUM_TEST_VALUES * 3 / 10; i<NUM_TEST_VALUES; ++i) {
+		key = *keys[i];
+		assert(bplus_tree_remove(tree, &key) != 0);
+		free(keys[i]);
+	}
+
+	assert(bplus_tree_num_entries(tree) == 0);
+
+	bplus_tree_free(tree);
+}
+
+void test_bplus_tree_iterate(void)
+{
+	BPlusTree *tree;
+	BPlusTreeIterator iter;
+	BPlusTreePair pair;
+	int key;
+	int expected;
+
+	/* Create a tree containing only the even numbers */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	for (key=0; key<NUM_TEST_VALUES; ++key) {
+		test_array[key] = key;
+	}
+
+	for (key=0; key<NUM_TEST_VALUES; key += 2) {
+		bplus_tree_insert(tree, &test_array[key], &test_array[key]);
+	}
+
+	/* Iterate over the whole tree */
+
+	expected = 0;
+	bplus_tree_iterate(tree, &iter);
+
+	while (bplus_tree_iter_has_more(&iter)) {
+		pair = bplus_tree_iter_next(&iter);
+		assert(*((int *) pair.key) == expected);
+		assert(pair.value == &test_array[expected]);
+		expected += 2;
+	}
+
+	assert(expected == NUM_TEST_VALUES);
+
+	/* Iterate from every possible starting key, present or not */
+
+	for (key=-1; key<=NUM_TEST_VALUES; ++key) {
+		bplus_tree_iterate_from(tree, &key, &iter);
+
+		if (key < 0) {
+			expected = 0;
+		} else {
+			expected = (key + 1) / 2 * 2;
+		}
+
+		if (expected >= NUM_TEST_VALUES) {
+			assert(!bplus_tree_iter_has_more(&iter));
+			continue;
+		}
+
+		pair = bplus_tree_iter_next(&iter);
+		assert(*((int *) pair.key) == expected);
+
+		while (bplus_tree_iter_has_more(&iter)) {
+			pair = bplus_tree_iter_next(&iter);
+			expected += 2;
+			assert(*((int *) pair.key) == expected);
+		}
+
+		assert(expected == NUM_TEST_VALUES - 2);
+	}
+
+	bplus_tree_free(tree);
+}
+
+void test_bplus_tree_to_array(void)
+{
+	BPlusTree *tree;
+	int *entries[NUM_TEST_VALUES];
+	BPlusTreeKey *array;
+	unsigned int i;
+
+	tree = create_tree();
+
+	array = bplus_tree_to_array(tree);
+
+	assert(array != NULL);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		entries[i] = array[i];
+		assert(*entries[i] == (int) i);
+	}
+
+	free(array);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+
+	array = bplus_tree_to_array(tree);
+	assert(array == NULL);
+
+	bplus_tree_free(tree);
+}
+
+void test_out_of_memory(void)
+{
+	BPlusTree *tree;
+	int keys[NUM_TEST_VALUES];
+	unsigned int inserted;
+	int i;
+
+	/* The first insert into an empty tree needs a leaf */
+
+	tree = bplus_tree_new((BPlusTreeCompareFunc) int_compare);
+
+	alloc_test_set_limit(0);
+
+	i = 0;
+	assert(bplus_tree_insert(tree, &i, &i) == 0);
+	assert(bplus_tree_num_entries(tree) == 0);
+	assert(bplus_tree_lookup(tree, &i) == NULL);
+
+	bplus_tree_free(tree);
+
+	alloc_test_set_limit(-1);
+
+	/* Create a tree, then stop any more nodes from being allocated.
+	 * Inserts into leaves with room still succeed; inserts needing
+	 * a split fail, without changing the contents of the tree. */
+
+	tree = create_tree();
+
+	alloc_test_set_limit(0);
+
+	inserted = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		keys[i] = NUM_TEST_VALUES + i * 7919 % NUM_TEST_VALUES;
+
+		if (bplus_tree_insert(tree, &keys[i], &keys[i]) != 0) {
+			++inserted;
+			assert(bplus_tree_lookup(tree, &keys[i]) == &keys[i]);
+		} else {
+			assert(bplus_tree_lookup(tree, &keys[i]) == NULL);
+		}
+
+		assert(bplus_tree_num_entries(tree)
+		       == NUM_TEST_VALUES + inserted);
+	}
+
+	assert(inserted < NUM_TEST_VALUES);
+
+	validate_tree(tree);
+
+	bplus_tree_free(tree);
+}
+
+static UnitTestFunction tests[] = {
+	test_bplus_tree_new,
+	test_bplus_tree_insert_lookup,
+	test_bplus_tree_remove,
+	test_bplus_tree_remove_random,
+	test_bplus_tree_remove_free_keys,
+	test_bplus_tree_iterate,
+	test_bplus_tree_to_array,
+	test_out_of_memory,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+	return 0;
+}
+
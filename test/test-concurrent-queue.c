@@ -0,0 +1,273 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "concurrent-queue.h"
+
+#define NUM_THREADS 4
+#define NUM_THREAD_VALUES 20000
+
+int variable1, variable2, variable3, variable4;
+
+void test_concurrent_queue_new_free(void)
+{
+	ConcurrentQueue *queue;
+
+	/* Capacities are rounded up to a power of two */
+
+	queue = concurrent_queue_new(0);
+	assert(queue != NULL);
+	assert(concurrent_queue_capacity(queue) == 2);
+	concurrent_queue_free(queue);
+
+	queue = concurrent_queue_new(1000);
+	assert(queue != NULL);
+	assert(concurrent_queue_capacity(queue) == 1024);
+	concurrent_queue_free(queue);
+
+	queue = concurrent_queue_new_full(64, CONCURRENT_QUEUE_SINGLE_PRODUCER
+	                                    | CONCURRENT_QUEUE_SINGLE_CONSUMER);
+	assert(queue != NULL);
+	assert(concurrent_queue_capacity(queue) == 64);
+	concurrent_queue_free(queue);
+
+	/* Test allocation when there is no free memory */
+
+	alloc_test_set_limit(0);
+	queue = concurrent_queue_new(16);
+	assert(queue == NULL);
+
+	alloc_test_set_limit(1);
+	queue = concurrent_queue_new(16);
+	assert(queue == NULL);
+}
+
+void test_concurrent_queue_push_pop(void)
+{
+	ConcurrentQueue *queue;
+	int i;
+
+	queue = concurrent_queue_new(4);
+
+	/* Empty queue */
+
+	assert(concurrent_queue_pop(queue) == NULL);
+
+	/* Values are removed in the order they were added */
+
+	assert(concurrent_queue_push(queue, &variable1) != 0);
+	assert(concurrent_queue_push(queue, &variable2) != 0);
+	assert(concurrent_queue_push(queue, &variable3) != 0);
+	assert(concurrent_queue_push(queue, &variable4) != 0);
+
+	/* The queue is full */
+
+	assert(concurrent_queue_push(queue, &variable1) == 0);
+
+	assert(concurrent_queue_pop(queue) == &variable1);
+	assert(concurrent_queue_pop(queue) == &variable2);
+	assert(concurrent_queue_push(queue, &variable1) != 0);
+	assert(concurrent_queue_pop(queue) == &variable3);
+	assert(concurrent_queue_pop(queue) == &variable4);
+	assert(concurrent_queue_pop(queue) == &variable1);
+	assert(concurrent_queue_pop(queue) == NULL);
+
+	/* Go around the queue many times */
+
+	for (i=0; i<10000; ++i) {
+		assert(concurrent_queue_push(queue, &variable1) != 0);
+		assert(concurrent_queue_push(queue, &variable2) != 0);
+		assert(concurrent_queue_pop(queue) == &variable1);
+		assert(concurrent_queue_pop(queue) == &variable2);
+	}
+
+	assert(concurrent_queue_pop(queue) == NULL);
+
+	concurrent_queue_free(queue);
+}
+
+/* Test with several producer and consumer threads.  Each producer adds
+ * the addresses of its own values in order; each consumer checks that
+ * the values it receives from each producer are in order, and counts
+ * them.  Consumers stop when they receive the end marker. */
+
+static ConcurrentQueue *concurrent_queue;
+static int concurrent_values[NUM_THREADS][NUM_THREAD_VALUES];
+static unsigned int concurrent_received[NUM_THREADS][NUM_THREADS];
+static int end_marker;
+
+static void concurrent_push(QueueValue value)
+{
+	while (!concurrent_queue_push(concurrent_queue, value)) {
+		sched_yield();
+	}
+}
+
+static void *producer_thread(void *arg)
+{
+	int *values = arg;
+	unsigned int i;
+
+	for (i=0; i<NUM_THREAD_VALUES; ++i) {
+		concurrent_push(&values[i]);
+	}
+
+	return NULL;
+}
+
+static void *consumer_thread(void *arg)
+{
+	unsigned int *received = arg;
+	int *last[NUM_THREADS];
+	int *value;
+	unsigned int producer;
+
+	for (producer=0; producer<NUM_THREADS; ++producer) {
+		last[producer] = NULL;
+	}
+
+	for (;;) {
+		value = concurrent_queue_pop(concurrent_queue);
+
+		if (value == NULL) {
+			sched_yield();
+			continue;
+		} else if (value == &end_marker) {
+			break;
+		}
+
+		producer = (unsigned int) ((value - &concurrent_values[0][0])
+		                           / NUM_THREAD_VALUES);
+		assert(producer < NUM_THREADS);
+		assert(last[producer] == NULL || value > last[producer]);
+
+		last[producer] = value;
+		++received[producer];
+	}
+
+	return NULL;
+}
+
+static void run_concurrent_test(unsigned int capacity, unsigned int flags,
+                                unsigned int num_producers,
+                                unsigned int num_consumers)
+{
+	pthread_t producers[NUM_THREADS];
+	pthread_t consumers[NUM_THREADS];
+	unsigned int total;
+	unsigned int i, j;
+
+	concurrent_queue = concurrent_queue_new_full(capacity, flags);
+	assert(concurrent_queue != NULL);
+
+	for (i=0; i<NUM_THREADS; ++i) {
+		for (j=0; j<NUM_THREADS; ++j) {
+			concurrent_received[i][j] = 0;
+		}
+	}
+
+	for (i=0; i<num_consumers; ++i) {
+		assert(pthread_create(&consumers[i], NULL, consumer_thread,
+		                      concurrent_received[i]) == 0);
+	}
+
+	for (i=0; i<num_producers; ++i) {
+		assert(pthread_create(&producers[i], NULL, producer_thread,
+		                      concurrent_values[i]) == 0);
+	}
+
+	for (i=0; i<num_producers; ++i) {
+		pthread_join(producers[i], NULL);
+	}
+
+	for (i=0; i<num_consumers; ++i) {
+		concurrent_push(&end_marker);
+	}
+
+	for (i=0; i<num_consumers; ++i) {
+		pthread_join(consumers[i], NULL);
+	}
+
+	/* Every value was received exactly once */
+
+	for (j=0; j<num_producers; ++j) {
+		total = 0;
+
+		for (i=0; i<num_consumers; ++i) {
+			total += concurrent_received[i][j];
+		}
+
+		assert(total == NUM_THREAD_VALUES);
+	}
+
+	assert(concurrent_queue_pop(concurrent_queue) == NULL);
+
+	concurrent_queue_free(concurrent_queue);
+}
+
+void test_concurrent_queue_mpmc(void)
+{
+	run_concurrent_test(64, 0, NUM_THREADS, NUM_THREADS);
+
+	/* A small queue is full or empty most of the time */
+
+	run_concurrent_test(2, 0, NUM_THREADS, NUM_THREADS);
+}
+
+void test_concurrent_queue_spsc(void)
+{
+	run_concurrent_test(64, CONCURRENT_QUEUE_SINGLE_PRODUCER
+	                      | CONCURRENT_QUEUE_SINGLE_CONSUMER, 1, 1);
+	run_concurrent_test(2, CONCURRENT_QUEUE_SINGLE_PRODUCER
+	                     | CONCURRENT_QUEUE_SINGLE_CONSUMER, 1, 1);
+}
+
+void test_concurrent_queue_mpsc(void)
+{
+	run_concurrent_test(64, CONCURRENT_QUEUE_SINGLE_CONSUMER,
+	                    NUM_THREADS, 1);
+	run_concurrent_test(2, CONCURRENT_QUEUE_SINGLE_CONSUMER,
+	                    NUM_THREADS, 1);
+}
+
+static UnitTestFunction tests[] = {
+	test_concurrent_queue_new_free,
+	test_concurrent_queue_push_pop,
+	test_concurrent_queue_mpmc,
+	test_concurrent_queue_spsc,
+	test_concurrent_queue_mpsc,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
+
@@ -0,0 +1,291 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "counting-bloom-filter.h"
+#include "hash-string.h"
+
+void test_counting_bloom_filter_new_free(void)
+{
+	CountingBloomFilter *filter;
+
+	filter = counting_bloom_filter_new(128, string_hash, 1);
+	assert(filter != NULL);
+	counting_bloom_filter_free(filter);
+
+	filter = counting_bloom_filter_new(128, string_hash, 64);
+	assert(filter != NULL);
+	counting_bloom_filter_free(filter);
+
+	/* Test creation with too many functions */
+
+	filter = counting_bloom_filter_new(128, string_hash, 65);
+	assert(filter == NULL);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+	filter = counting_bloom_filter_new(128, string_hash, 1);
+	assert(filter == NULL);
+
+	alloc_test_set_limit(1);
+	filter = counting_bloom_filter_new(128, string_hash, 1);
+	assert(filter == NULL);
+}
+
+void test_counting_bloom_filter_insert_remove(void)
+{
+	CountingBloomFilter *filter;
+
+	filter = counting_bloom_filter_new(128, string_hash, 4);
+
+	assert(counting_bloom_filter_query(filter, "test 1") == 0);
+	assert(counting_bloom_filter_query(filter, "test 2") == 0);
+	assert(counting_bloom_filter_remove(filter, "test 1") == 0);
+
+	counting_bloom_filter_insert(filter, "test 1");
+	counting_bloom_filter_insert(filter, "test 2");
+
+	assert(counting_bloom_filter_query(filter, "test 1") != 0);
+	assert(counting_bloom_filter_query(filter, "test 2") != 0);
+
+	/* Removing one value leaves the other */
+
+	assert(counting_bloom_filter_remove(filter, "test 1") != 0);
+	assert(counting_bloom_filter_query(filter, "test 1") == 0);
+	assert(counting_bloom_filter_query(filter, "test 2") != 0);
+
+	/* A value inserted twice must be removed twice */
+
+	counting_bloom_filter_insert(filter, "test 2");
+	assert(counting_bloom_filter_remove(filter, "test 2") != 0);
+	assert(counting_bloom_filter_query(filter, "test 2") != 0);
+	assert(counting_bloom_filter_remove(filter, "test 2") != 0);
+	assert(counting_bloom_filter_query(filter, "test 2") == 0);
+
+	counting_bloom_filter_free(filter);
+}
+
+/* Insert and remove a sliding window of values */
+
+void test_counting_bloom_filter_window(void)
+{
+	CountingBloomFilter *filter;
+	char buf[20];
+	unsigned int i;
+
+	filter = counting_bloom_filter_new(16 * 1024, string_hash, 4);
+
+	for (i=0; i<10000; ++i) {
+		sprintf(buf, "%u", i);
+		counting_bloom_filter_insert(filter, buf);
+
+		if (i >= 500) {
+			sprintf(buf, "%u", i - 500);
+			assert(counting_bloom_filter_remove(filter, buf) != 0);
+		}
+	}
+
+	/* The last 500 values are all present */
+
+	for (i=9500; i<10000; ++i) {
+		sprintf(buf, "%u", i);
+		assert(counting_bloom_filter_query(filter, buf) != 0);
+	}
+
+	counting_bloom_filter_free(filter);
+}
+
+void test_counting_bloom_filter_saturation(void)
+{
+	CountingBloomFilter *filter;
+	unsigned int i;
+
+	/* Counters which overflow are never decremented, so values are
+	 * not lost */
+
+	filter = counting_bloom_filter_new(64, string_hash, 4);
+
+	for (i=0; i<20; ++i) {
+		counting_bloom_filter_insert(filter, "test 1");
+	}
+
+	counting_bloom_filter_insert(filter, "test 2");
+
+	for (i=0; i<20; ++i) {
+		counting_bloom_filter_remove(filter, "test 1");
+	}
+
+	assert(counting_bloom_filter_query(filter, "test 2") != 0);
+
+	counting_bloom_filter_free(filter);
+}
+
+static unsigned int uint_hash(void *value)
+{
+	return *((unsigned int *) value);
+}
+
+void test_counting_bloom_filter_repeated_index(void)
+{
+	CountingBloomFilter *filter;
+	unsigned char before[2], after[2];
+	unsigned int inserted, removed;
+	unsigned int i;
+
+	/* With three counters and four hash functions, every value maps
+	 * to some counter more than once.  Removing a value that was
+	 * never inserted must not make any counter underflow, however
+	 * its indexes overlap with those of the values in the filter. */
+
+	inserted = 0;
+
+	for (removed=1; removed<1000; ++removed) {
+		filter = counting_bloom_filter_new(3, uint_hash, 4);
+
+		counting_bloom_filter_insert(filter, &inserted);
+		counting_bloom_filter_read(filter, before);
+
+		for (i=0; i<8; ++i) {
+			counting_bloom_filter_remove(filter, &removed);
+		}
+
+		counting_bloom_filter_read(filter, after);
+
+		/* Counters only ever go down when removing */
+
+		assert((after[0] & 0xf) <= (before[0] & 0xf));
+		assert((after[0] >> 4) <= (before[0] >> 4));
+		assert((after[1] & 0xf) <= (before[1] & 0xf));
+
+		counting_bloom_filter_free(filter);
+	}
+}
+
+void test_counting_bloom_filter_read_load(void)
+{
+	CountingBloomFilter *filter1;
+	CountingBloomFilter *filter2;
+	unsigned char state[64];
+
+	filter1 = counting_bloom_filter_new(128, string_hash, 4);
+
+	counting_bloom_filter_insert(filter1, "test 1");
+	counting_bloom_filter_insert(filter1, "test 2");
+
+	counting_bloom_filter_read(filter1, state);
+
+	counting_bloom_filter_free(filter1);
+
+	filter2 = counting_bloom_filter_new(128, string_hash, 4);
+
+	counting_bloom_filter_load(filter2, state);
+
+	assert(counting_bloom_filter_query(filter2, "test 1") != 0);
+	assert(counting_bloom_filter_remove(filter2, "test 2") != 0);
+	assert(counting_bloom_filter_query(filter2, "test 2") == 0);
+
+	counting_bloom_filter_free(filter2);
+}
+
+void test_counting_bloom_filter_union_intersection(void)
+{
+	CountingBloomFilter *filter1;
+	CountingBloomFilter *filter2;
+	CountingBloomFilter *result;
+
+	filter1 = counting_bloom_filter_new(128, string_hash, 4);
+	filter2 = counting_bloom_filter_new(128, string_hash, 4);
+
+	counting_bloom_filter_insert(filter1, "test 1");
+	counting_bloom_filter_insert(filter1, "test 2");
+	counting_bloom_filter_insert(filter2, "test 1");
+
+	/* Union: counts are added, so test 1 must be removed twice */
+
+	result = counting_bloom_filter_union(filter1, filter2);
+
+	assert(counting_bloom_filter_query(result, "test 1") != 0);
+	assert(counting_bloom_filter_query(result, "test 2") != 0);
+	assert(counting_bloom_filter_remove(result, "test 1") != 0);
+	assert(counting_bloom_filter_query(result, "test 1") != 0);
+
+	counting_bloom_filter_free(result);
+
+	/* Intersection */
+
+	result = counting_bloom_filter_intersection(filter1, filter2);
+
+	assert(counting_bloom_filter_query(result, "test 1") != 0);
+	assert(counting_bloom_filter_query(result, "test 2") == 0);
+
+	counting_bloom_filter_free(result);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+	assert(counting_bloom_filter_union(filter1, filter2) == NULL);
+	assert(counting_bloom_filter_intersection(filter1, filter2) == NULL);
+	alloc_test_set_limit(-1);
+
+	counting_bloom_filter_free(filter2);
+
+	/* Mismatched filters */
+
+	filter2 = counting_bloom_filter_new(64, string_hash, 4);
+	assert(counting_bloom_filter_union(filter1, filter2) == NULL);
+	assert(counting_bloom_filter_intersection(filter1, filter2) == NULL);
+	counting_bloom_filter_free(filter2);
+
+	filter2 = counting_bloom_filter_new(128, string_nocase_hash, 4);
+	assert(counting_bloom_filter_union(filter1, filter2) == NULL);
+	counting_bloom_filter_free(filter2);
+
+	filter2 = counting_bloom_filter_new(128, string_hash, 8);
+	assert(counting_bloom_filter_intersection(filter1, filter2) == NULL);
+	counting_bloom_filter_free(filter2);
+
+	counting_bloom_filter_free(filter1);
+}
+
+static UnitTestFunction tests[] = {
+	test_counting_bloom_filter_new_free,
+	test_counting_bloom_filter_insert_remove,
+	test_counting_bloom_filter_window,
+	test_counting_bloom_filter_saturation,
+	test_counting_bloom_filter_repeated_index,
+	test_counting_bloom_filter_read_load,
+	test_counting_bloom_filter_union_intersection,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
+
@@ -31,17 +31,26 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <hash-pointer.h>
 #include <hash-string.h>
 
+#include <allocator.h>
+#include <slab-allocator.h>
+
 #include <arraylist.h>
 #include <avl-tree.h>
 #include <binary-heap.h>
 #include <binomial-heap.h>
 #include <bloom-filter.h>
+#include <bplus-tree.h>
+#include <concurrent-queue.h>
+#include <counting-bloom-filter.h>
+#include <cuckoo-filter.h>
 #include <hash-table.h>
 #include <list.h>
+#include <pairing-heap.h>
 #include <queue.h>
 #include <set.h>
 #include <slist.h>
 #include <trie.h>
+#include <work-stealing-deque.h>
 
 #include "framework.h"
 
@@ -123,6 +132,14 @@ static void test_avl_tree(void)
 	avl_tree_free(avl_tree);
 }
 
+static void test_bplus_tree(void)
+{
+	BPlusTree *bplus_tree;
+
+	bplus_tree = bplus_tree_new(string_compare);
+	bplus_tree_free(bplus_tree);
+}
+
 static void test_binary_heap(void)
 {
 	BinaryHeap *heap;
@@ -147,6 +164,30 @@ static void test_bloom_filter(void)
 	bloom_filter_free(filter);
 }
 
+static void test_concurrent_queue(void)
+{
+	ConcurrentQueue *queue;
+
+	queue = concurrent_queue_new(16);
+	concurrent_queue_free(queue);
+}
+
+static void test_counting_bloom_filter(void)
+{
+	CountingBloomFilter *filter;
+
+	filter = counting_bloom_filter_new(16, string_hash, 10);
+	counting_bloom_filter_free(filter);
+}
+
+static void test_cuckoo_filter(void)
+{
+	CuckooFilter *filter;
+
+	filter = cuckoo_filter_new(16, NULL);
+	cuckoo_filter_free(filter);
+}
+
 static void test_hash_table(void)
 {
 	HashTable *hash_table;
@@ -167,6 +208,14 @@ static void test_list(void)
 	list_free(list);
 }
 
+static void test_pairing_heap(void)
+{
+	PairingHeap *heap;
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+	pairing_heap_free(heap);
+}
+
 static void test_queue(void)
 {
 	Queue *queue;
@@ -203,6 +252,14 @@ static void test_trie(void)
 	trie_free(trie);
 }
 
+static void test_work_stealing_deque(void)
+{
+	WorkStealingDeque *deque;
+
+	deque = work_stealing_deque_new();
+	work_stealing_deque_free(deque);
+}
+
 static UnitTestFunction tests[] = {
 	test_compare_int,
 	test_compare_pointer,
@@ -215,12 +272,18 @@ static UnitTestFunction tests[] = {
 	test_binary_heap, 
 	test_binomial_heap,
 	test_bloom_filter,
+	test_bplus_tree,
+	test_concurrent_queue,
+	test_counting_bloom_filter,
+	test_cuckoo_filter,
 	test_hash_table,
 	test_list,
+	test_pairing_heap,
 	test_queue,
 	test_set,
 	test_slist,
 	test_trie,
+	test_work_stealing_deque,
 	NULL
 };
 
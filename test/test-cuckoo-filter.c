@@ -0,0 +1,312 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "cuckoo-filter.h"
+
+/* 64-bit FNV-1a hash, with a final mix so that all bits of the result
+ * depend on the whole string. */
+
+static uint64_t string_hash64(void *string)
+{
+	unsigned char *p;
+	uint64_t result;
+
+	result = 0xcbf29ce484222325ULL;
+
+	for (p = string; *p != '\0'; ++p) {
+		result = (result ^ *p) * 0x100000001b3ULL;
+	}
+
+	result ^= result >> 33;
+	result *= 0xff51afd7ed558ccdULL;
+	result ^= result >> 33;
+
+	return result;
+}
+
+static uint64_t other_hash64(void *string)
+{
+	return string_hash64(string) ^ 1;
+}
+
+void test_cuckoo_filter_new_free(void)
+{
+	CuckooFilter *filter;
+
+	filter = cuckoo_filter_new(128, string_hash64);
+	assert(filter != NULL);
+	assert(cuckoo_filter_num_entries(filter) == 0);
+	cuckoo_filter_free(filter);
+
+	/* Capacities too large for the table size to be represented */
+
+	filter = cuckoo_filter_new(0x80000001U, string_hash64);
+	assert(filter == NULL);
+	filter = cuckoo_filter_new(0xffffffffU, string_hash64);
+	assert(filter == NULL);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+	filter = cuckoo_filter_new(128, string_hash64);
+	assert(filter == NULL);
+
+	alloc_test_set_limit(1);
+	filter = cuckoo_filter_new(128, string_hash64);
+	assert(filter == NULL);
+}
+
+void test_cuckoo_filter_insert_remove(void)
+{
+	CuckooFilter *filter;
+
+	filter = cuckoo_filter_new(128, string_hash64);
+
+	assert(cuckoo_filter_query(filter, "test 1") == 0);
+	assert(cuckoo_filter_remove(filter, "test 1") == 0);
+
+	assert(cuckoo_filter_insert(filter, "test 1") != 0);
+	assert(cuckoo_filter_insert(filter, "test 2") != 0);
+	assert(cuckoo_filter_num_entries(filter) == 2);
+
+	assert(cuckoo_filter_query(filter, "test 1") != 0);
+	assert(cuckoo_filter_query(filter, "test 2") != 0);
+
+	assert(cuckoo_filter_remove(filter, "test 1") != 0);
+	assert(cuckoo_filter_query(filter, "test 1") == 0);
+	assert(cuckoo_filter_query(filter, "test 2") != 0);
+	assert(cuckoo_filter_num_entries(filter) == 1);
+
+	/* A value inserted twice must be removed twice */
+
+	assert(cuckoo_filter_insert(filter, "test 2") != 0);
+	assert(cuckoo_filter_remove(filter, "test 2") != 0);
+	assert(cuckoo_filter_query(filter, "test 2") != 0);
+	assert(cuckoo_filter_remove(filter, "test 2") != 0);
+	assert(cuckoo_filter_query(filter, "test 2") == 0);
+	assert(cuckoo_filter_num_entries(filter) == 0);
+
+	cuckoo_filter_free(filter);
+}
+
+/* Fill a filter until insertions fail */
+
+void test_cuckoo_filter_full(void)
+{
+	CuckooFilter *filter;
+	char buf[20];
+	unsigned int num_inserted;
+	unsigned int i;
+
+	filter = cuckoo_filter_new(4096, string_hash64);
+
+	for (i=0; ; ++i) {
+		sprintf(buf, "%u", i);
+
+		if (!cuckoo_filter_insert(filter, buf)) {
+			break;
+		}
+	}
+
+	num_inserted = i;
+
+	/* The table can be filled to a high load factor */
+
+	assert(num_inserted > 4096 * 9 / 10);
+	assert(num_inserted <= 4096 + 1);
+	assert(cuckoo_filter_num_entries(filter) == num_inserted);
+
+	/* There are no false negatives */
+
+	for (i=0; i<num_inserted; ++i) {
+		sprintf(buf, "%u", i);
+		assert(cuckoo_filter_query(filter, buf) != 0);
+	}
+
+	/* After removing values, there is room again */
+
+	for (i=0; i<num_inserted; i += 2) {
+		sprintf(buf, "%u", i);
+		assert(cuckoo_filter_remove(filter, buf) != 0);
+	}
+
+	for (i=1; i<num_inserted; i += 2) {
+		sprintf(buf, "%u", i);
+		assert(cuckoo_filter_query(filter, buf) != 0);
+	}
+
+	assert(cuckoo_filter_insert(filter, "test") != 0);
+
+	cuckoo_filter_free(filter);
+}
+
+/* Insert and remove a sliding window of values */
+
+void test_cuckoo_filter_window(void)
+{
+	CuckooFilter *filter;
+	char buf[20];
+	unsigned int false_positives;
+	unsigned int i;
+
+	filter = cuckoo_filter_new(1024, string_hash64);
+
+	for (i=0; i<10000; ++i) {
+		sprintf(buf, "%u", i);
+		assert(cuckoo_filter_insert(filter, buf) != 0);
+
+		if (i >= 500) {
+			sprintf(buf, "%u", i - 500);
+			assert(cuckoo_filter_remove(filter, buf) != 0);
+		}
+	}
+
+	assert(cuckoo_filter_num_entries(filter) == 500);
+
+	for (i=9500; i<10000; ++i) {
+		sprintf(buf, "%u", i);
+		assert(cuckoo_filter_query(filter, buf) != 0);
+	}
+
+	/* Removed values are (almost always) gone */
+
+	false_positives = 0;
+
+	for (i=0; i<9500; ++i) {
+		sprintf(buf, "%u", i);
+
+		if (cuckoo_filter_query(filter, buf)) {
+			++false_positives;
+		}
+	}
+
+	assert(false_positives < 10);
+
+	cuckoo_filter_free(filter);
+}
+
+void test_cuckoo_filter_union_intersection(void)
+{
+	CuckooFilter *filter1;
+	CuckooFilter *filter2;
+	CuckooFilter *result;
+
+	filter1 = cuckoo_filter_new(128, string_hash64);
+	filter2 = cuckoo_filter_new(128, string_hash64);
+
+	cuckoo_filter_insert(filter1, "test 1");
+	cuckoo_filter_insert(filter1, "test 2");
+	cuckoo_filter_insert(filter2, "test 1");
+	cuckoo_filter_insert(filter2, "test 3");
+
+	result = cuckoo_filter_union(filter1, filter2);
+
+	assert(cuckoo_filter_num_entries(result) == 4);
+	assert(cuckoo_filter_query(result, "test 1") != 0);
+	assert(cuckoo_filter_query(result, "test 2") != 0);
+	assert(cuckoo_filter_query(result, "test 3") != 0);
+	assert(cuckoo_filter_remove(result, "test 3") != 0);
+	assert(cuckoo_filter_query(result, "test 3") == 0);
+
+	cuckoo_filter_free(result);
+
+	result = cuckoo_filter_intersection(filter1, filter2);
+
+	assert(cuckoo_filter_num_entries(result) == 1);
+	assert(cuckoo_filter_query(result, "test 1") != 0);
+	assert(cuckoo_filter_query(result, "test 2") == 0);
+	assert(cuckoo_filter_query(result, "test 3") == 0);
+
+	cuckoo_filter_free(result);
+
+	/* Test out of memory scenario */
+
+	alloc_test_set_limit(0);
+	assert(cuckoo_filter_union(filter1, filter2) == NULL);
+	assert(cuckoo_filter_intersection(filter1, filter2) == NULL);
+	alloc_test_set_limit(-1);
+
+	cuckoo_filter_free(filter2);
+
+	/* Mismatched filters */
+
+	filter2 = cuckoo_filter_new(1024, string_hash64);
+	assert(cuckoo_filter_union(filter1, filter2) == NULL);
+	assert(cuckoo_filter_intersection(filter1, filter2) == NULL);
+	cuckoo_filter_free(filter2);
+
+	filter2 = cuckoo_filter_new(128, other_hash64);
+	assert(cuckoo_filter_union(filter1, filter2) == NULL);
+	assert(cuckoo_filter_intersection(filter1, filter2) == NULL);
+	cuckoo_filter_free(filter2);
+
+	cuckoo_filter_free(filter1);
+}
+
+void test_cuckoo_filter_union_full(void)
+{
+	CuckooFilter *filter1;
+	CuckooFilter *filter2;
+	char buf[20];
+	unsigned int i;
+
+	/* The union of two full filters does not fit */
+
+	filter1 = cuckoo_filter_new(256, string_hash64);
+	filter2 = cuckoo_filter_new(256, string_hash64);
+
+	for (i=0; i<200; ++i) {
+		sprintf(buf, "a%u", i);
+		assert(cuckoo_filter_insert(filter1, buf) != 0);
+		sprintf(buf, "b%u", i);
+		assert(cuckoo_filter_insert(filter2, buf) != 0);
+	}
+
+	assert(cuckoo_filter_union(filter1, filter2) == NULL);
+
+	cuckoo_filter_free(filter1);
+	cuckoo_filter_free(filter2);
+}
+
+static UnitTestFunction tests[] = {
+	test_cuckoo_filter_new_free,
+	test_cuckoo_filter_insert_remove,
+	test_cuckoo_filter_full,
+	test_cuckoo_filter_window,
+	test_cuckoo_filter_union_intersection,
+	test_cuckoo_filter_union_full,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
+
@@ -38,9 +38,10 @@ int value1 = 1, value2 = 2, value3 = 3, value4 = 4;
 int allocated_keys = 0;
 int allocated_values = 0;
 
-/* Generates a hash table for use in tests containing 10,000 entries */
+/* Generates a hash table for use in tests containing 10,000 entries,
+ * created with the specified flags */
 
-HashTable *generate_hash_table(void)
+HashTable *generate_hash_table_flags(unsigned int flags)
 {
 	HashTable *hash_table;
 	char buf[10];
@@ -52,7 +53,7 @@ HashTable *generate_hash_table(void)
 	 * will be collisions within the hash table (using integer values
 	 * with int_hash causes no collisions) */
 
-	hash_table = hash_table_new(string_hash, string_equal);
+	hash_table = hash_table_new_full(string_hash, string_equal, flags);
 
 	/* Insert lots of values */
 
@@ -71,6 +72,13 @@ HashTable *generate_hash_table(void)
 	return hash_table;
 }
 
+/* Generates a hash table for use in tests containing 10,000 entries */
+
+HashTable *generate_hash_table(void)
+{
+	return generate_hash_table_flags(0);
+}
+
 /* Basic allocate and free */
 
 void test_hash_table_new_free(void)
@@ -461,6 +469,343 @@ void test_hash_iterator_key_pair()
 	hash_table_free(hash_table);
 }
 
+/* Test the open addressing implementation */
+
+void test_hash_table_open_addressing(void)
+{
+	HashTable *hash_table;
+	HashTableIterator iterator;
+	HashTablePair pair;
+	char buf[10];
+	char *value;
+	int count;
+	int i;
+
+	hash_table = generate_hash_table_flags(HASH_TABLE_OPEN_ADDRESSING);
+
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		value = hash_table_lookup(hash_table, buf);
+
+		assert(strcmp(value, buf) == 0);
+	}
+
+	sprintf(buf, "%i", -1);
+	assert(hash_table_lookup(hash_table, buf) == NULL);
+	assert(hash_table_remove(hash_table, buf) == 0);
+
+	/* Insert overwrites existing entries with the same key */
+
+	sprintf(buf, "%i", 12345);
+	hash_table_insert(hash_table, buf, strdup("hello world"));
+	value = hash_table_lookup(hash_table, buf);
+	assert(strcmp(value, "hello world") == 0);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES + 1);
+	assert(hash_table_remove(hash_table, buf) != 0);
+
+	/* Remove every hundredth entry while iterating */
+
+	count = 0;
+
+	hash_table_iterate(hash_table, &iterator);
+
+	while (hash_table_iter_has_more(&iterator)) {
+		pair = hash_table_iter_next(&iterator);
+		value = pair.value;
+
+		assert(pair.key == pair.value);
+
+		if ((atoi(value) % 100) == 0) {
+			assert(hash_table_remove(hash_table, value) != 0);
+		}
+
+		++count;
+	}
+
+	assert(count == NUM_TEST_VALUES);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES - 100);
+
+	pair = hash_table_iter_next(&iterator);
+	assert(pair.value == HASH_TABLE_NULL);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+
+		if (i % 100 == 0) {
+			assert(hash_table_lookup(hash_table, buf) == NULL);
+		} else {
+			assert(hash_table_lookup(hash_table, buf) != NULL);
+		}
+	}
+
+	hash_table_free(hash_table);
+
+	/* Iterating over an empty table */
+
+	hash_table = hash_table_new_full(int_hash, int_equal,
+	                                 HASH_TABLE_OPEN_ADDRESSING);
+
+	hash_table_iterate(hash_table, &iterator);
+	assert(hash_table_iter_has_more(&iterator) == 0);
+
+	hash_table_free(hash_table);
+}
+
+/* Repeatedly insert and remove entries from an open addressing table,
+ * so that deleted slots are reused and cleaned up. */
+
+void test_hash_table_open_addressing_churn(void)
+{
+	HashTable *hash_table;
+	int *keys;
+	int i, j;
+
+	hash_table = hash_table_new_full(int_hash, int_equal,
+	                                 HASH_TABLE_OPEN_ADDRESSING);
+	hash_table_register_free_functions(hash_table, free_key, NULL);
+
+	allocated_keys = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		keys = new_key(i);
+		assert(hash_table_insert(hash_table, keys, &value1) != 0);
+
+		/* Keep a sliding window of 50 entries */
+
+		if (i >= 50) {
+			j = i - 50;
+			assert(hash_table_remove(hash_table, &j) != 0);
+		}
+	}
+
+	assert(hash_table_num_entries(hash_table) == 50);
+	assert(allocated_keys == 50);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		if (i < NUM_TEST_VALUES - 50) {
+			assert(hash_table_lookup(hash_table, &i) == NULL);
+		} else {
+			assert(hash_table_lookup(hash_table, &i) == &value1);
+		}
+	}
+
+	hash_table_free(hash_table);
+
+	assert(allocated_keys == 0);
+}
+
+/* Test for out of memory scenario with open addressing */
+
+void test_hash_table_open_addressing_out_of_memory(void)
+{
+	HashTable *hash_table;
+	int values[15];
+	unsigned int i;
+
+	alloc_test_set_limit(1);
+	hash_table = hash_table_new_full(int_hash, int_equal,
+	                                 HASH_TABLE_OPEN_ADDRESSING);
+	assert(hash_table == NULL);
+	assert(alloc_test_get_allocated() == 0);
+
+	alloc_test_set_limit(-1);
+
+	/* Entries are stored in the table itself, so no allocation is
+	 * needed until the table must grow.  The initial table has 16
+	 * slots and can be up to 7/8 full, so the 15th insert fails. */
+
+	hash_table = hash_table_new_full(int_hash, int_equal,
+	                                 HASH_TABLE_OPEN_ADDRESSING);
+
+	alloc_test_set_limit(0);
+
+	for (i=0; i<14; ++i) {
+		values[i] = (int) i;
+
+		assert(hash_table_insert(hash_table,
+		                         &values[i], &values[i]) != 0);
+		assert(hash_table_num_entries(hash_table) == i + 1);
+	}
+
+	values[14] = 14;
+
+	assert(hash_table_insert(hash_table, &values[14], &values[14]) == 0);
+	assert(hash_table_num_entries(hash_table) == 14);
+
+	for (i=0; i<14; ++i) {
+		assert(hash_table_lookup(hash_table, &values[i]) == &values[i]);
+	}
+
+	alloc_test_set_limit(-1);
+
+	assert(hash_table_insert(hash_table, &values[14], &values[14]) != 0);
+	assert(hash_table_num_entries(hash_table) == 15);
+
+	hash_table_free(hash_table);
+}
+
+/* Hash function that counts the number of times it is called */
+
+unsigned int hash_func_calls = 0;
+
+unsigned int counting_string_hash(void *value)
+{
+	++hash_func_calls;
+
+	return string_hash(value);
+}
+
+/* Check that with cached hashes, the hash function is only called once
+ * per insert and never during resizes. */
+
+void test_hash_table_cache_hashes_flags(unsigned int flags)
+{
+	HashTable *hash_table;
+	char buf[10];
+	char *value;
+	int i;
+
+	hash_table = hash_table_new_full(counting_string_hash, string_equal,
+	                                 flags | HASH_TABLE_CACHE_HASHES);
+	hash_table_register_free_functions(hash_table, NULL, free);
+
+	hash_func_calls = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		value = strdup(buf);
+
+		assert(hash_table_insert(hash_table, value, value) != 0);
+	}
+
+	assert(hash_func_calls == NUM_TEST_VALUES);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		value = hash_table_lookup(hash_table, buf);
+
+		assert(strcmp(value, buf) == 0);
+	}
+
+	sprintf(buf, "%i", -1);
+	assert(hash_table_lookup(hash_table, buf) == NULL);
+
+	/* Remove some entries */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		sprintf(buf, "%i", i);
+		assert(hash_table_remove(hash_table, buf) != 0);
+		assert(hash_table_remove(hash_table, buf) == 0);
+	}
+
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES / 2);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		value = hash_table_lookup(hash_table, buf);
+
+		assert((value != NULL) == (i % 2 != 0));
+	}
+
+	hash_table_free(hash_table);
+}
+
+void test_hash_table_cache_hashes(void)
+{
+	test_hash_table_cache_hashes_flags(0);
+	test_hash_table_cache_hashes_flags(HASH_TABLE_OPEN_ADDRESSING);
+}
+
+/* Test incremental resizing.  Entries must be found in either table
+ * while a resize is in progress, and no single insert should need to
+ * rehash more than a few chains' worth of entries. */
+
+void test_hash_table_incremental_resize_flags(unsigned int flags)
+{
+	HashTable *hash_table;
+	HashTableIterator iterator;
+	HashTablePair pair;
+	unsigned int max_calls;
+	char buf[10];
+	char *value;
+	int count;
+	int i, j;
+
+	hash_table = hash_table_new_full(counting_string_hash, string_equal,
+	                                 flags | HASH_TABLE_INCREMENTAL_RESIZE);
+	hash_table_register_free_functions(hash_table, NULL, free);
+
+	max_calls = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		value = strdup(buf);
+
+		hash_func_calls = 0;
+		assert(hash_table_insert(hash_table, value, value) != 0);
+
+		if (hash_func_calls > max_calls) {
+			max_calls = hash_func_calls;
+		}
+
+		/* Check a sample of the entries inserted so far */
+
+		for (j=i % 97; j<=i; j += 97) {
+			sprintf(buf, "%i", j);
+			value = hash_table_lookup(hash_table, buf);
+
+			assert(value != NULL && strcmp(value, buf) == 0);
+		}
+	}
+
+	assert(max_calls < 64);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES);
+
+	/* Overwrite an entry, which may still be in the old table */
+
+	sprintf(buf, "%i", 0);
+	value = strdup(buf);
+	hash_table_insert(hash_table, value, value);
+	assert(hash_table_lookup(hash_table, buf) == value);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES);
+
+	/* Iterate over both tables, removing every hundredth entry */
+
+	count = 0;
+
+	hash_table_iterate(hash_table, &iterator);
+
+	while (hash_table_iter_has_more(&iterator)) {
+		pair = hash_table_iter_next(&iterator);
+
+		if ((atoi(pair.key) % 100) == 0) {
+			assert(hash_table_remove(hash_table, pair.key) != 0);
+		}
+
+		++count;
+	}
+
+	assert(count == NUM_TEST_VALUES);
+	assert(hash_table_num_entries(hash_table) == NUM_TEST_VALUES - 100);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+		assert((hash_table_lookup(hash_table, buf) == NULL)
+		       == (i % 100 == 0));
+	}
+
+	hash_table_free(hash_table);
+}
+
+void test_hash_table_incremental_resize(void)
+{
+	test_hash_table_incremental_resize_flags(0);
+	test_hash_table_incremental_resize_flags(HASH_TABLE_CACHE_HASHES);
+}
+
 static UnitTestFunction tests[] = {
 	test_hash_table_new_free,
 	test_hash_table_insert_lookup,
@@ -470,6 +815,11 @@ static UnitTestFunction tests[] = {
 	test_hash_table_free_functions,
 	test_hash_table_out_of_memory,
 	test_hash_iterator_key_pair,
+	test_hash_table_open_addressing,
+	test_hash_table_open_addressing_churn,
+	test_hash_table_open_addressing_out_of_memory,
+	test_hash_table_cache_hashes,
+	test_hash_table_incremental_resize,
 	NULL
 };
 
@@ -366,6 +366,83 @@ void test_list_sort(void)
 	assert(list == NULL);
 }
 
+/* Compare values by their tens digit only, so that there are many
+ * values which compare equal */
+
+static int tens_compare(void *location1, void *location2)
+{
+	return (*((int *) location1) / 10) - (*((int *) location2) / 10);
+}
+
+void test_list_sort_stable(void)
+{
+	ListEntry *list;
+	ListEntry *rover;
+	int entries[] = { 31, 12, 35, 18, 3, 11, 37, 6, 14, 33, 1, 19 };
+	int sorted[]  = { 3, 6, 1, 12, 18, 11, 14, 19, 31, 35, 37, 33 };
+	unsigned int num_entries = sizeof(entries) / sizeof(int);
+	unsigned int num_values = 100000;
+	int *values;
+	unsigned int i;
+
+	list = NULL;
+
+	for (i=0; i<num_entries; ++i) {
+		list_append(&list, &entries[i]);
+	}
+
+	list_sort(&list, tens_compare);
+
+	/* Values with the same tens digit keep their original order */
+
+	for (i=0; i<num_entries; ++i) {
+		assert(*((int *) list_nth_data(list, i)) == sorted[i]);
+	}
+
+	list_free(list);
+
+	/* Sort a long list that is in reverse order */
+
+	values = malloc(sizeof(int) * num_values);
+	list = NULL;
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = (int) i;
+		list_prepend(&list, &values[i]);
+	}
+
+	list_sort(&list, int_compare);
+
+	assert(list_length(list) == num_values);
+
+	for (rover = list; list_next(rover) != NULL; rover = list_next(rover)) {
+		assert(*((int *) list_data(rover))
+		    < *((int *) list_data(list_next(rover))));
+	}
+
+	for (; rover != list; rover = list_prev(rover)) {
+		assert(list_next(list_prev(rover)) == rover);
+	}
+
+	/* Sort it again, now that it is already sorted */
+
+	list_sort(&list, int_compare);
+
+	assert(list_length(list) == num_values);
+
+	for (rover = list; list_next(rover) != NULL; rover = list_next(rover)) {
+		assert(*((int *) list_data(rover))
+		    < *((int *) list_data(list_next(rover))));
+	}
+
+	for (; rover != list; rover = list_prev(rover)) {
+		assert(list_next(list_prev(rover)) == rover);
+	}
+
+	list_free(list);
+	free(values);
+}
+
 void test_list_find_data(void)
 {
 	int entries[] = { 89, 23, 42, 16, 15, 4, 8, 99, 50, 30 };
@@ -558,6 +635,7 @@ static UnitTestFunction tests[] = {
 	test_list_remove_entry,
 	test_list_remove_data,
 	test_list_sort,
+	test_list_sort_stable,
 	test_list_find_data,
 	test_list_to_array,
 	test_list_iterate,
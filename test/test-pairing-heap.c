@@ -0,0 +1,293 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "pairing-heap.h"
+#include "compare-int.h"
+
+#define NUM_TEST_VALUES 10000
+
+int test_array[NUM_TEST_VALUES];
+
+void test_pairing_heap_new_free(void)
+{
+	PairingHeap *heap;
+	int i;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+		pairing_heap_free(heap);
+	}
+
+	/* Freeing a heap frees all values in it */
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+		assert(pairing_heap_insert(heap, &test_array[i]) != 0);
+	}
+
+	assert(pairing_heap_pop(heap) == &test_array[0]);
+
+	pairing_heap_free(heap);
+
+	/* Test for out of memory */
+
+	alloc_test_set_limit(0);
+
+	assert(pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare) == NULL);
+}
+
+void test_pairing_heap_insert(void)
+{
+	PairingHeap *heap;
+	int i;
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+		assert(pairing_heap_insert(heap, &test_array[i]) != 0);
+	}
+	assert(pairing_heap_num_entries(heap) == NUM_TEST_VALUES);
+
+	/* Test for out of memory */
+
+	alloc_test_set_limit(0);
+	assert(pairing_heap_insert(heap, &i) == 0);
+	assert(pairing_heap_insert_handle(heap, &i) == NULL);
+	assert(pairing_heap_num_entries(heap) == NUM_TEST_VALUES);
+
+	pairing_heap_free(heap);
+}
+
+void test_min_heap(void)
+{
+	PairingHeap *heap;
+	int *val;
+	int i;
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+
+	/* Push a load of values onto the heap, in a scrambled order */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (i * 7919) % NUM_TEST_VALUES;
+		assert(pairing_heap_insert(heap, &test_array[i]) != 0);
+	}
+
+	/* Pop values off the heap and check they are in order */
+
+	i = -1;
+	while (pairing_heap_num_entries(heap) > 0) {
+		val = (int *) pairing_heap_pop(heap);
+
+		assert(*val == i + 1);
+		i = *val;
+	}
+
+	/* Test pop on an empty heap */
+
+	val = (int *) pairing_heap_pop(heap);
+	assert(val == NULL);
+
+	pairing_heap_free(heap);
+}
+
+void test_max_heap(void)
+{
+	PairingHeap *heap;
+	int *val;
+	int i;
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MAX, int_compare);
+
+	/* Push a load of values onto the heap, in a scrambled order */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (i * 7919) % NUM_TEST_VALUES;
+		assert(pairing_heap_insert(heap, &test_array[i]) != 0);
+	}
+
+	/* Pop values off the heap and check they are in order */
+
+	i = NUM_TEST_VALUES;
+	while (pairing_heap_num_entries(heap) > 0) {
+		val = (int *) pairing_heap_pop(heap);
+
+		assert(*val == i - 1);
+		i = *val;
+	}
+
+	/* Test pop on an empty heap */
+
+	val = (int *) pairing_heap_pop(heap);
+	assert(val == NULL);
+
+	pairing_heap_free(heap);
+}
+
+/* Test changing the priority of values and removing them using handles */
+
+void test_pairing_heap_handles(void)
+{
+	PairingHeap *heap;
+	PairingHeapHandle *handles[NUM_TEST_VALUES];
+	int *val;
+	int i;
+
+	heap = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i + NUM_TEST_VALUES;
+		handles[i] = pairing_heap_insert_handle(heap, &test_array[i]);
+		assert(handles[i] != NULL);
+	}
+
+	/* Pop one value, so that the heap is not a flat list */
+
+	assert(pairing_heap_pop(heap) == &test_array[0]);
+
+	/* Decrease the priority of every other value, in reverse order */
+
+	for (i=NUM_TEST_VALUES - 2; i>0; i -= 2) {
+		test_array[i] -= NUM_TEST_VALUES;
+		pairing_heap_decrease_key(heap, handles[i], &test_array[i]);
+	}
+
+	/* Move some values in both directions */
+
+	for (i=1; i<NUM_TEST_VALUES; i += 3) {
+		test_array[i] = NUM_TEST_VALUES * 3 - i;
+		pairing_heap_update(heap, handles[i], &test_array[i]);
+	}
+
+	/* Remove some values */
+
+	for (i=5; i<NUM_TEST_VALUES; i += 7) {
+		assert(pairing_heap_remove(heap, handles[i])
+		       == &test_array[i]);
+		test_array[i] = -1;
+	}
+
+	/* The remaining values are removed in order */
+
+	i = -1;
+
+	while (pairing_heap_num_entries(heap) > 0) {
+		val = pairing_heap_pop(heap);
+		assert(*val >= i);
+		i = *val;
+	}
+
+	pairing_heap_free(heap);
+}
+
+void test_pairing_heap_merge(void)
+{
+	PairingHeap *heap1;
+	PairingHeap *heap2;
+	PairingHeapHandle *handle;
+	int *val;
+	int i;
+
+	heap1 = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+	heap2 = pairing_heap_new(PAIRING_HEAP_TYPE_MIN, int_compare);
+
+	/* Even values in one heap, odd values in the other */
+
+	handle = NULL;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i;
+
+		if (i % 2 == 0) {
+			assert(pairing_heap_insert(heap1, &test_array[i]) != 0);
+		} else if (i == NUM_TEST_VALUES / 2 + 1) {
+			handle = pairing_heap_insert_handle(heap2,
+			                                    &test_array[i]);
+			assert(handle != NULL);
+		} else {
+			assert(pairing_heap_insert(heap2, &test_array[i]) != 0);
+		}
+	}
+
+	pairing_heap_merge(heap1, heap2);
+
+	assert(pairing_heap_num_entries(heap1) == NUM_TEST_VALUES);
+	assert(pairing_heap_num_entries(heap2) == 0);
+	assert(pairing_heap_pop(heap2) == NULL);
+
+	/* Handles from the other heap can be used with the merged heap */
+
+	assert(pairing_heap_remove(heap1, handle)
+	       == &test_array[NUM_TEST_VALUES / 2 + 1]);
+
+	/* Merging an empty heap does nothing */
+
+	pairing_heap_merge(heap1, heap2);
+	assert(pairing_heap_num_entries(heap1) == NUM_TEST_VALUES - 1);
+
+	/* The values are removed in order */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		if (i == NUM_TEST_VALUES / 2 + 1) {
+			continue;
+		}
+
+		val = pairing_heap_pop(heap1);
+		assert(*val == i);
+	}
+
+	assert(pairing_heap_num_entries(heap1) == 0);
+
+	/* The emptied heap can still be used */
+
+	assert(pairing_heap_insert(heap2, &test_array[0]) != 0);
+	assert(pairing_heap_pop(heap2) == &test_array[0]);
+
+	pairing_heap_free(heap1);
+	pairing_heap_free(heap2);
+}
+
+static UnitTestFunction tests[] = {
+	test_pairing_heap_new_free,
+	test_pairing_heap_insert,
+	test_min_heap,
+	test_max_heap,
+	test_pairing_heap_handles,
+	test_pairing_heap_merge,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
+
@@ -315,6 +315,155 @@ void test_queue_is_empty(void)
 	queue_free(queue);
 }
 
+void test_queue_wraparound(void)
+{
+	Queue *queue;
+	int values[1000];
+	int head, tail;
+	int i, n;
+
+	for (i=0; i<1000; ++i) {
+		values[i] = i;
+	}
+
+	/* Add values to both ends so that the buffer wraps around, and
+	 * grows while the values are not stored from the start of the
+	 * buffer.  The queue holds values[head..tail-1] at all times. */
+
+	queue = queue_new();
+
+	head = 500;
+	tail = 500;
+
+	for (n=0; n<500; ++n) {
+		if (n % 3 == 0) {
+			assert(queue_push_tail(queue, &values[tail]) != 0);
+			++tail;
+		} else {
+			--head;
+			assert(queue_push_head(queue, &values[head]) != 0);
+		}
+
+		assert(queue_peek_head(queue) == &values[head]);
+		assert(queue_peek_tail(queue) == &values[tail - 1]);
+	}
+
+	/* Remove values from alternate ends */
+
+	while (head < tail) {
+		if (head % 2 == 0) {
+			assert(queue_pop_head(queue) == &values[head]);
+			++head;
+		} else {
+			--tail;
+			assert(queue_pop_tail(queue) == &values[tail]);
+		}
+	}
+
+	assert(queue_is_empty(queue));
+	assert(queue_pop_head(queue) == NULL);
+	assert(queue_pop_tail(queue) == NULL);
+
+	queue_free(queue);
+}
+
+void test_queue_steady_state(void)
+{
+	Queue *queue;
+	size_t allocated;
+	int i;
+
+	queue = queue_new();
+
+	/* Bring the queue up to its working size */
+
+	for (i=0; i<200; ++i) {
+		queue_push_tail(queue, &variable1);
+	}
+
+	for (i=0; i<200; ++i) {
+		queue_push_tail(queue, &variable2);
+		queue_pop_head(queue);
+	}
+
+	/* Cycling values through the queue does not allocate memory */
+
+	allocated = alloc_test_get_allocated();
+	alloc_test_set_limit(0);
+
+	for (i=0; i<10000; ++i) {
+		assert(queue_push_tail(queue, &variable3) != 0);
+		assert(queue_pop_head(queue) != NULL);
+		assert(queue_push_head(queue, &variable4) != 0);
+		assert(queue_pop_tail(queue) != NULL);
+	}
+
+	assert(alloc_test_get_allocated() == allocated);
+
+	alloc_test_set_limit(-1);
+
+	queue_free(queue);
+}
+
+void test_queue_out_of_memory(void)
+{
+	Queue *queue;
+	int i;
+
+	/* A new queue has space allocated for its first values */
+
+	queue = queue_new();
+
+	alloc_test_set_limit(0);
+
+	assert(queue_push_head(queue, &variable1) == 0);
+	assert(queue_push_tail(queue, &variable1) == 0);
+	assert(queue_is_empty(queue));
+
+	alloc_test_set_limit(-1);
+
+	/* Fill the queue so that the values wrap around the end of the
+	 * buffer */
+
+	for (i=0; i<100; ++i) {
+		assert(queue_push_head(queue, &variable1) != 0);
+	}
+
+	for (i=0; i<156; ++i) {
+		assert(queue_push_tail(queue, &variable2) != 0);
+	}
+
+	/* Failing to enlarge the buffer leaves the queue unchanged */
+
+	alloc_test_set_limit(0);
+
+	assert(queue_push_head(queue, &variable3) == 0);
+	assert(queue_push_tail(queue, &variable3) == 0);
+
+	alloc_test_set_limit(-1);
+
+	assert(queue_peek_head(queue) == &variable1);
+	assert(queue_peek_tail(queue) == &variable2);
+
+	/* The buffer can be enlarged once memory is available again */
+
+	assert(queue_push_tail(queue, &variable3) != 0);
+
+	for (i=0; i<100; ++i) {
+		assert(queue_pop_head(queue) == &variable1);
+	}
+
+	for (i=0; i<156; ++i) {
+		assert(queue_pop_head(queue) == &variable2);
+	}
+
+	assert(queue_pop_head(queue) == &variable3);
+
+	assert(queue_is_empty(queue));
+
+	queue_free(queue);
+}
+
 static UnitTestFunction tests[] = {
 	test_queue_new_free,
 	test_queue_push_head,
@@ -324,6 +473,9 @@ static UnitTestFunction tests[] = {
 	test_queue_pop_tail,
 	test_queue_peek_tail,
 	test_queue_is_empty,
+	test_queue_wraparound,
+	test_queue_steady_state,
+	test_queue_out_of_memory,
 	NULL
 };
 
@@ -79,8 +79,100 @@ int find_subtree_height(RBTreeNode *node)
 	}
 }
 
+/* Check the tree conditions for a subtree, returning its black
+ * height.  The number of nodes is added to *counter. */
+
+int validate_subtree(RBTreeNode *node, int *counter)
+{
+	RBTreeNode *left_node, *right_node;
+	int left_height, right_height;
+	int *key;
+
+	if (node == NULL) {
+		return 1;
+	}
+
+	left_node = rb_tree_node_child(node, RB_TREE_NODE_LEFT);
+	right_node = rb_tree_node_child(node, RB_TREE_NODE_RIGHT);
+	key = (int *) rb_tree_node_key(node);
+
+	/* Check parent pointers and key ordering */
+
+	if (left_node != NULL) {
+		assert(rb_tree_node_parent(left_node) == node);
+		assert(*((int *) rb_tree_node_key(left_node)) <= *key);
+	}
+	if (right_node != NULL) {
+		assert(rb_tree_node_parent(right_node) == node);
+		assert(*((int *) rb_tree_node_key(right_node)) >= *key);
+	}
+
+	/* Both children of a red node are black */
+
+	if (rb_tree_node_color(node) == RB_TREE_NODE_RED) {
+		assert(left_node == NULL
+		    || rb_tree_node_color(left_node) == RB_TREE_NODE_BLACK);
+		assert(right_node == NULL
+		    || rb_tree_node_color(right_node) == RB_TREE_NODE_BLACK);
+	}
+
+	/* Every path contains the same number of black nodes */
+
+	left_height = validate_subtree(left_node, counter);
+	right_height = validate_subtree(right_node, counter);
+	assert(left_height == right_height);
+
+	++*counter;
+
+	if (rb_tree_node_color(node) == RB_TREE_NODE_BLACK) {
+		return left_height + 1;
+	} else {
+		return left_height;
+	}
+}
+
+/* Check that the subtree sizes are consistent, by finding each node
+ * by its position and checking that its key has the same rank. */
+
+void validate_order_statistics(RBTree *tree)
+{
+	RBTreeNode *node;
+	unsigned int i;
+	unsigned int rank;
+	unsigned int num_entries;
+
+	num_entries = (unsigned int) rb_tree_num_entries(tree);
+
+	for (i=0; i<num_entries; ++i) {
+		node = rb_tree_select(tree, i);
+		assert(node != NULL);
+
+		rank = rb_tree_rank(tree, rb_tree_node_key(node));
+		assert(rank <= i);
+		assert(i < rank + rb_tree_count_range(tree, rb_tree_node_key(node),
+		                                  rb_tree_node_key(node)));
+	}
+
+	assert(rb_tree_select(tree, num_entries) == NULL);
+}
+
 void validate_tree(RBTree *tree)
 {
+	RBTreeNode *root_node;
+	int count = 0;
+
+	root_node = rb_tree_root_node(tree);
+
+	if (root_node != NULL) {
+		assert(rb_tree_node_parent(root_node) == NULL);
+		assert(rb_tree_node_color(root_node) == RB_TREE_NODE_BLACK);
+	}
+
+	validate_subtree(root_node, &count);
+
+	assert(count == rb_tree_num_entries(tree));
+
+	validate_order_statistics(tree);
 }
 
 RBTree *create_tree(void)
@@ -319,6 +411,67 @@ void test_rb_tree_remove(void)
 	rb_tree_free(tree);
 }
 
+void test_rb_tree_remove_random(void)
+{
+	RBTree *tree;
+	RBTreeNode *nodes[NUM_TEST_VALUES];
+	int present[NUM_TEST_VALUES];
+	int num_present;
+	int i, n;
+
+	tree = rb_tree_new((RBTreeCompareFunc) int_compare);
+	num_present = 0;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = i % 100;
+		present[i] = 0;
+	}
+
+	/* Insert and remove nodes at random, including duplicate keys.
+	 * Nodes are removed through the node pointers returned when they
+	 * were inserted, which must remain valid as the tree is
+	 * rebalanced. */
+
+	for (n=0; n<20000; ++n) {
+		i = rand() % NUM_TEST_VALUES;
+
+		if (present[i]) {
+			rb_tree_remove_node(tree, nodes[i]);
+			present[i] = 0;
+			--num_present;
+		} else {
+			nodes[i] = rb_tree_insert(tree, &test_array[i],
+			                          &test_array[i]);
+			assert(rb_tree_node_value(nodes[i]) == &test_array[i]);
+			present[i] = 1;
+			++num_present;
+		}
+
+		assert(rb_tree_num_entries(tree) == num_present);
+
+		if (n % 10 == 0) {
+			validate_tree(tree);
+		}
+	}
+
+	validate_tree(tree);
+
+	/* Remove everything that is left */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		if (present[i]) {
+			assert(rb_tree_remove(tree, &test_array[i]) != 0);
+			--num_present;
+			assert(rb_tree_num_entries(tree) == num_present);
+			validate_tree(tree);
+		}
+	}
+
+	assert(rb_tree_root_node(tree) == NULL);
+
+	rb_tree_free(tree);
+}
+
 void test_rb_tree_to_array(void)
 {
 	RBTree *tree;
@@ -359,15 +512,309 @@ void test_rb_tree_to_array(void)
 	rb_tree_free(tree);
 }
 
+void test_rb_tree_select_rank(void)
+{
+	RBTree *tree;
+	RBTreeNode *node;
+	int i;
+	int low, high;
+
+	tree = create_tree();
+
+	/* Every key is found at its own position */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		node = rb_tree_select(tree, (unsigned int) i);
+		assert(*((int *) rb_tree_node_key(node)) == i);
+		assert(rb_tree_rank(tree, &i) == (unsigned int) i);
+	}
+
+	assert(rb_tree_select(tree, NUM_TEST_VALUES) == NULL);
+
+	/* Keys that are not in the tree */
+
+	i = -1;
+	assert(rb_tree_rank(tree, &i) == 0);
+	i = NUM_TEST_VALUES + 100;
+	assert(rb_tree_rank(tree, &i) == NUM_TEST_VALUES);
+
+	/* Ranges */
+
+	low = 10;
+	high = 19;
+	assert(rb_tree_count_range(tree, &low, &high) == 10);
+	assert(rb_tree_count_range(tree, &high, &low) == 0);
+	assert(rb_tree_count_range(tree, &low, &low) == 1);
+	low = -5;
+	high = 5;
+	assert(rb_tree_count_range(tree, &low, &high) == 6);
+	low = NUM_TEST_VALUES - 1;
+	high = NUM_TEST_VALUES + 5;
+	assert(rb_tree_count_range(tree, &low, &high) == 1);
+
+	/* Remove the even keys: the odd keys move down */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		rb_tree_remove(tree, &i);
+	}
+
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES / 2; ++i) {
+		node = rb_tree_select(tree, (unsigned int) i);
+		assert(*((int *) rb_tree_node_key(node)) == i * 2 + 1);
+	}
+
+	i = 500;
+	assert(rb_tree_rank(tree, &i) == 250);
+
+	low = 0;
+	high = 99;
+	assert(rb_tree_count_range(tree, &low, &high) == 50);
+
+	rb_tree_free(tree);
+}
+
+static void range_callback(RBTreeNode *node, void *user_data)
+{
+	int *total = user_data;
+
+	*total += *((int *) rb_tree_node_key(node));
+}
+
+static void range_remove_callback(RBTreeNode *node, void *user_data)
+{
+	rb_tree_remove_node((RBTree *) user_data, node);
+}
+
+void test_rb_tree_iterate(void)
+{
+	RBTree *tree;
+	RBTreeIterator iter;
+	RBTreeNode *node;
+	int i;
+	int low, high;
+	int total;
+
+	/* Empty tree */
+
+	tree = rb_tree_new((RBTreeCompareFunc) int_compare);
+
+	rb_tree_iterate(tree, &iter);
+	assert(!rb_tree_iter_has_more(&iter));
+	assert(rb_tree_iter_next(&iter) == NULL);
+
+	i = 0;
+	assert(rb_tree_lower_bound(tree, &i) == NULL);
+	assert(rb_tree_upper_bound(tree, &i) == NULL);
+
+	rb_tree_free(tree);
+
+	/* Iterate over a full tree, in order */
+
+	tree = create_tree();
+
+	rb_tree_iterate(tree, &iter);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(rb_tree_iter_has_more(&iter));
+		node = rb_tree_iter_next(&iter);
+		assert(*((int *) rb_tree_node_key(node)) == i);
+	}
+
+	assert(!rb_tree_iter_has_more(&iter));
+
+	/* Walk backwards from the last node */
+
+	node = rb_tree_select(tree, NUM_TEST_VALUES - 1);
+
+	for (i=NUM_TEST_VALUES - 1; i>=0; --i) {
+		assert(*((int *) rb_tree_node_key(node)) == i);
+		node = rb_tree_node_prev(node);
+	}
+
+	assert(node == NULL);
+
+	/* Bounds */
+
+	for (i=0; i<NUM_TEST_VALUES - 1; ++i) {
+		node = rb_tree_lower_bound(tree, &i);
+		assert(*((int *) rb_tree_node_key(node)) == i);
+		node = rb_tree_upper_bound(tree, &i);
+		assert(*((int *) rb_tree_node_key(node)) == i + 1);
+	}
+
+	assert(rb_tree_upper_bound(tree, &i) == NULL);
+	i = -1;
+	assert(*((int *) rb_tree_node_key(rb_tree_lower_bound(tree, &i))) == 0);
+	i = NUM_TEST_VALUES;
+	assert(rb_tree_lower_bound(tree, &i) == NULL);
+
+	/* Start part way through */
+
+	i = 500;
+	rb_tree_iterate_from(tree, &i, &iter);
+
+	for (; i<NUM_TEST_VALUES; ++i) {
+		node = rb_tree_iter_next(&iter);
+		assert(*((int *) rb_tree_node_key(node)) == i);
+	}
+
+	assert(!rb_tree_iter_has_more(&iter));
+
+	/* Remove nodes while iterating */
+
+	rb_tree_iterate(tree, &iter);
+
+	while (rb_tree_iter_has_more(&iter)) {
+		node = rb_tree_iter_next(&iter);
+
+		if (*((int *) rb_tree_node_key(node)) % 2 == 0) {
+			rb_tree_remove_node(tree, node);
+		}
+	}
+
+	validate_tree(tree);
+	assert(rb_tree_num_entries(tree) == NUM_TEST_VALUES / 2);
+
+	/* Bounds for keys that are not in the tree */
+
+	i = 100;
+	node = rb_tree_lower_bound(tree, &i);
+	assert(*((int *) rb_tree_node_key(node)) == 101);
+	i = 101;
+	node = rb_tree_upper_bound(tree, &i);
+	assert(*((int *) rb_tree_node_key(node)) == 103);
+
+	/* Visit a range: the odd numbers from 101 to 199 */
+
+	low = 100;
+	high = 199;
+	total = 0;
+	assert(rb_tree_range_foreach(tree, &low, &high, range_callback,
+	                         &total) == 50);
+	assert(total == 7500);
+
+	assert(rb_tree_range_foreach(tree, &high, &low, range_callback,
+	                         &total) == 0);
+
+	/* Remove a range from within the callback */
+
+	assert(rb_tree_range_foreach(tree, &low, &high, range_remove_callback,
+	                         tree) == 50);
+	validate_tree(tree);
+	assert(rb_tree_count_range(tree, &low, &high) == 0);
+	assert(rb_tree_num_entries(tree) == NUM_TEST_VALUES / 2 - 50);
+
+	rb_tree_free(tree);
+}
+
+void test_rb_tree_new_from_sorted(void)
+{
+	RBTree *tree;
+	RBTreeKey keys[NUM_TEST_VALUES];
+	RBTreeValue values[NUM_TEST_VALUES];
+	unsigned int length;
+	unsigned int i;
+	int value;
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i * 2;
+		keys[i] = &test_array[i];
+		values[i] = &test_array[i];
+	}
+
+	/* Build trees of every size up to a few complete levels, to
+	 * cover both full and partly-filled bottom levels. */
+
+	for (length=0; length<=130; ++length) {
+		tree = rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+		                                keys, values, length);
+
+		assert(tree != NULL);
+		assert((unsigned int) rb_tree_num_entries(tree) == length);
+		validate_tree(tree);
+
+		for (i=0; i<length; ++i) {
+			assert(rb_tree_lookup(tree, keys[i]) == values[i]);
+		}
+
+		rb_tree_free(tree);
+	}
+
+	/* A large tree can be modified afterwards, mixing nodes from the
+	 * block with individually allocated ones. */
+
+	tree = rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+	                                keys, values, NUM_TEST_VALUES);
+	assert(tree != NULL);
+	validate_tree(tree);
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		value = (int) i * 2;
+		assert(rb_tree_remove(tree, &value) != 0);
+	}
+
+	validate_tree(tree);
+	assert(rb_tree_num_entries(tree) == NUM_TEST_VALUES / 2);
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		test_array[i] = (int) i * 2 + 1;
+		assert(rb_tree_insert(tree, &test_array[i],
+		                       &test_array[i]) != NULL);
+	}
+
+	validate_tree(tree);
+	assert(rb_tree_num_entries(tree) == NUM_TEST_VALUES);
+
+	rb_tree_free(tree);
+
+	/* Without values, every key maps to RB_TREE_NULL */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_array[i] = (int) i;
+	}
+
+	tree = rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+	                                keys, NULL, NUM_TEST_VALUES);
+	assert(tree != NULL);
+	assert(rb_tree_lookup_node(tree, keys[10]) != NULL);
+	assert(rb_tree_lookup(tree, keys[10]) == RB_TREE_NULL);
+	rb_tree_free(tree);
+
+	/* Keys out of order, or repeated, are rejected */
+
+	keys[5] = keys[4];
+	assert(rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+	                                keys, values, 10) == NULL);
+	keys[5] = keys[3];
+	assert(rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+	                                keys, values, 10) == NULL);
+	keys[5] = &test_array[5];
+
+	/* Test out of memory scenario: the tree structure can be
+	 * allocated, but not the node block. */
+
+	alloc_test_set_limit(1);
+
+	tree = rb_tree_new_from_sorted((RBTreeCompareFunc) int_compare,
+	                                keys, values, NUM_TEST_VALUES);
+	assert(tree == NULL);
+}
+
 static UnitTestFunction tests[] = {
 	test_rb_tree_new,
 	test_rb_tree_free,
 	test_rb_tree_child,
 	test_rb_tree_insert_lookup,
 	test_rb_tree_lookup,
-	/*test_rb_tree_remove,*/
+	test_rb_tree_remove,
+	test_rb_tree_remove_random,
 	/*test_rb_tree_to_array,*/
 	test_out_of_memory,
+	test_rb_tree_select_rank,
+	test_rb_tree_iterate,
+	test_rb_tree_new_from_sorted,
 	NULL
 };
 
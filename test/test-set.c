@@ -543,6 +543,92 @@ void test_set_out_of_memory(void)
 }
 
 
+/* Test incremental resizing: values must be found while a resize is in
+ * progress, and no single insert should rehash the whole set. */
+
+unsigned int hash_func_calls = 0;
+
+unsigned int counting_int_hash(void *value)
+{
+	++hash_func_calls;
+
+	return int_hash(value);
+}
+
+void test_set_incremental_resize(void)
+{
+	Set *set;
+	Set *set2;
+	SetIterator iterator;
+	SetValue *array;
+	unsigned int max_calls;
+	int values[10000];
+	int count;
+	int i, j;
+
+	set = set_new_full(counting_int_hash, int_equal,
+	                   SET_INCREMENTAL_RESIZE);
+
+	max_calls = 0;
+
+	for (i=0; i<10000; ++i) {
+		values[i] = i;
+
+		hash_func_calls = 0;
+		assert(set_insert(set, &values[i]) != 0);
+
+		if (hash_func_calls > max_calls) {
+			max_calls = hash_func_calls;
+		}
+
+		assert(set_insert(set, &values[i]) == 0);
+
+		for (j=i % 97; j<=i; j += 97) {
+			assert(set_query(set, &j) != 0);
+		}
+	}
+
+	assert(max_calls < 64);
+	assert(set_num_entries(set) == 10000);
+
+	/* Iterate, removing every hundredth value */
+
+	count = 0;
+
+	set_iterate(set, &iterator);
+
+	while (set_iter_has_more(&iterator)) {
+		i = *((int *) set_iter_next(&iterator));
+
+		if (i % 100 == 0) {
+			assert(set_remove(set, &values[i]) != 0);
+		}
+
+		++count;
+	}
+
+	assert(count == 10000);
+	assert(set_num_entries(set) == 9900);
+
+	for (i=0; i<10000; ++i) {
+		assert(set_query(set, &i) == (i % 100 != 0));
+	}
+
+	array = set_to_array(set);
+
+	for (i=0; i<9900; ++i) {
+		assert(*((int *) array[i]) % 100 != 0);
+	}
+
+	free(array);
+
+	set2 = set_union(set, set);
+	assert(set_num_entries(set2) == 9900);
+	set_free(set2);
+
+	set_free(set);
+}
+
 static UnitTestFunction tests[] = {
 	test_set_new_free,
 	test_set_insert,
@@ -555,6 +641,7 @@ static UnitTestFunction tests[] = {
 	test_set_to_array,
 	test_set_free_function,
 	test_set_out_of_memory,
+	test_set_incremental_resize,
 	NULL
 };
 
@@ -0,0 +1,277 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "allocator.h"
+#include "slab-allocator.h"
+#include "avl-tree.h"
+#include "rb-tree.h"
+#include "hash-table.h"
+#include "queue.h"
+#include "set.h"
+#include "trie.h"
+#include "compare-int.h"
+#include "hash-int.h"
+
+#define NUM_TEST_VALUES 1000
+
+int test_values[NUM_TEST_VALUES];
+
+/* Allocator which counts the number of blocks currently allocated */
+
+int counted_blocks = 0;
+
+void *counting_alloc(void *user_data, size_t size)
+{
+	assert(user_data == &counted_blocks);
+
+	++counted_blocks;
+
+	return malloc(size);
+}
+
+void counting_free(void *user_data, void *ptr, size_t size)
+{
+	assert(user_data == &counted_blocks);
+
+	--counted_blocks;
+
+	free(ptr);
+}
+
+Allocator counting_allocator = {
+	counting_alloc, counting_free, &counted_blocks
+};
+
+void test_slab_allocator_new_free(void)
+{
+	SlabAllocator *slab_allocator;
+	Allocator *allocator;
+	void *blocks[NUM_TEST_VALUES];
+	int i;
+
+	slab_allocator = slab_allocator_new(sizeof(int));
+	assert(slab_allocator != NULL);
+
+	allocator = slab_allocator_get_allocator(slab_allocator);
+
+	/* Allocate lots of blocks, and check they do not overlap */
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		blocks[i] = allocator_alloc(allocator, sizeof(int));
+		assert(blocks[i] != NULL);
+		*((int *) blocks[i]) = i;
+	}
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(*((int *) blocks[i]) == i);
+	}
+
+	/* Freed blocks are reused */
+
+	allocator_free(allocator, blocks[10], sizeof(int));
+	assert(allocator_alloc(allocator, sizeof(int)) == blocks[10]);
+
+	/* Large blocks are passed through to malloc() */
+
+	blocks[0] = allocator_alloc(allocator, 1000);
+	assert(blocks[0] != NULL);
+	allocator_free(allocator, blocks[0], 1000);
+
+	/* Large blocks which are not freed back are freed with the slab
+	 * allocator.  Free blocks from the middle and both ends of the
+	 * list of large blocks, and leave the rest. */
+
+	for (i=0; i<5; ++i) {
+		blocks[i] = allocator_alloc(allocator, 1000);
+		assert(blocks[i] != NULL);
+		memset(blocks[i], 0, 1000);
+	}
+
+	allocator_free(allocator, blocks[0], 1000);
+	allocator_free(allocator, blocks[2], 1000);
+	allocator_free(allocator, blocks[4], 1000);
+
+	/* Freeing the slab allocator frees all blocks */
+
+	slab_allocator_free(slab_allocator);
+
+	/* Test out of memory scenarios */
+
+	alloc_test_set_limit(0);
+	slab_allocator = slab_allocator_new(sizeof(int));
+	assert(slab_allocator == NULL);
+
+	alloc_test_set_limit(1);
+	slab_allocator = slab_allocator_new(sizeof(int));
+	assert(slab_allocator != NULL);
+	allocator = slab_allocator_get_allocator(slab_allocator);
+	assert(allocator_alloc(allocator, sizeof(int)) == NULL);
+	slab_allocator_free(slab_allocator);
+}
+
+void test_slab_allocator_arena(void)
+{
+	SlabAllocator *slab_allocator;
+	Allocator arena;
+	Queue *queue;
+	int i;
+
+	/* With no free function, nodes are never freed individually and
+	 * are all released when the slab allocator is freed. */
+
+	slab_allocator = slab_allocator_new(0);
+	arena = *slab_allocator_get_allocator(slab_allocator);
+	arena.free_func = NULL;
+
+	queue = queue_new_with_allocator(&arena);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		assert(queue_push_tail(queue, &test_values[i]) != 0);
+	}
+	for (i=0; i<NUM_TEST_VALUES / 2; ++i) {
+		assert(queue_pop_head(queue) == &test_values[i]);
+	}
+
+	queue_free(queue);
+
+	slab_allocator_free(slab_allocator);
+}
+
+void test_allocator_containers(Allocator *allocator)
+{
+	AVLTree *avl_tree;
+	RBTree *rb_tree;
+	HashTable *hash_table;
+	Queue *queue;
+	Set *set;
+	Trie *trie;
+	char buf[10];
+	int i;
+
+	avl_tree = avl_tree_new_with_allocator(int_compare, allocator);
+	rb_tree = rb_tree_new_with_allocator(int_compare, allocator);
+	hash_table = hash_table_new_with_allocator(int_hash, int_equal,
+	                                           0, allocator);
+	queue = queue_new_with_allocator(allocator);
+	set = set_new_with_allocator(int_hash, int_equal, 0, allocator);
+	trie = trie_new_with_allocator(allocator);
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		test_values[i] = i;
+		sprintf(buf, "%i", i);
+
+		assert(avl_tree_insert(avl_tree, &test_values[i],
+		                       &test_values[i]) != NULL);
+		assert(rb_tree_insert(rb_tree, &test_values[i],
+		                      &test_values[i]) != NULL);
+		assert(hash_table_insert(hash_table, &test_values[i],
+		                         &test_values[i]) != 0);
+		assert(queue_push_tail(queue, &test_values[i]) != 0);
+		assert(set_insert(set, &test_values[i]) != 0);
+		assert(trie_insert(trie, buf, &test_values[i]) != 0);
+	}
+
+	/* Remove half of the values */
+
+	for (i=0; i<NUM_TEST_VALUES; i += 2) {
+		sprintf(buf, "%i", i);
+
+		assert(avl_tree_remove(avl_tree, &i) != 0);
+		assert(hash_table_remove(hash_table, &i) != 0);
+		assert(queue_pop_head(queue) == &test_values[i / 2]);
+		assert(set_remove(set, &i) != 0);
+		assert(trie_remove(trie, buf) != 0);
+	}
+
+	for (i=0; i<NUM_TEST_VALUES; ++i) {
+		sprintf(buf, "%i", i);
+
+		if (i % 2 == 0) {
+			assert(avl_tree_lookup(avl_tree, &i) == NULL);
+			assert(hash_table_lookup(hash_table, &i) == NULL);
+			assert(set_query(set, &i) == 0);
+			assert(trie_lookup(trie, buf) == NULL);
+		} else {
+			assert(avl_tree_lookup(avl_tree, &i) == &test_values[i]);
+			assert(hash_table_lookup(hash_table, &i)
+			       == &test_values[i]);
+			assert(set_query(set, &i) != 0);
+			assert(trie_lookup(trie, buf) == &test_values[i]);
+		}
+
+		assert(rb_tree_lookup(rb_tree, &i) == &test_values[i]);
+	}
+
+	avl_tree_free(avl_tree);
+	rb_tree_free(rb_tree);
+	hash_table_free(hash_table);
+	queue_free(queue);
+	set_free(set);
+	trie_free(trie);
+}
+
+void test_allocator_custom(void)
+{
+	/* Every node allocated through the allocator must be freed
+	 * back through it */
+
+	counted_blocks = 0;
+
+	test_allocator_containers(&counting_allocator);
+
+	assert(counted_blocks == 0);
+}
+
+void test_allocator_slab(void)
+{
+	SlabAllocator *slab_allocator;
+
+	/* Large nodes (trie nodes) fall through to malloc() and so must
+	 * still be freed correctly */
+
+	slab_allocator = slab_allocator_new(0);
+
+	test_allocator_containers(slab_allocator_get_allocator(slab_allocator));
+
+	slab_allocator_free(slab_allocator);
+}
+
+static UnitTestFunction tests[] = {
+	test_slab_allocator_new_free,
+	test_slab_allocator_arena,
+	test_allocator_custom,
+	test_allocator_slab,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
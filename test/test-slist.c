@@ -322,6 +322,75 @@ void test_slist_sort(void)
 	assert(list == NULL);
 }
 
+/* Compare values by their tens digit only, so that there are many
+ * values which compare equal */
+
+static int tens_compare(void *location1, void *location2)
+{
+	return (*((int *) location1) / 10) - (*((int *) location2) / 10);
+}
+
+void test_slist_sort_stable(void)
+{
+	SListEntry *list;
+	SListEntry *rover;
+	int entries[] = { 31, 12, 35, 18, 3, 11, 37, 6, 14, 33, 1, 19 };
+	int sorted[]  = { 3, 6, 1, 12, 18, 11, 14, 19, 31, 35, 37, 33 };
+	unsigned int num_entries = sizeof(entries) / sizeof(int);
+	unsigned int num_values = 100000;
+	int *values;
+	unsigned int i;
+
+	list = NULL;
+
+	for (i=0; i<num_entries; ++i) {
+		slist_append(&list, &entries[i]);
+	}
+
+	slist_sort(&list, tens_compare);
+
+	/* Values with the same tens digit keep their original order */
+
+	for (i=0; i<num_entries; ++i) {
+		assert(*((int *) slist_nth_data(list, i)) == sorted[i]);
+	}
+
+	slist_free(list);
+
+	/* Sort a long list that is in reverse order */
+
+	values = malloc(sizeof(int) * num_values);
+	list = NULL;
+
+	for (i=0; i<num_values; ++i) {
+		values[i] = (int) i;
+		slist_prepend(&list, &values[i]);
+	}
+
+	slist_sort(&list, int_compare);
+
+	assert(slist_length(list) == num_values);
+
+	for (rover = list; slist_next(rover) != NULL; rover = slist_next(rover)) {
+		assert(*((int *) slist_data(rover))
+		    < *((int *) slist_data(slist_next(rover))));
+	}
+
+	/* Sort it again, now that it is already sorted */
+
+	slist_sort(&list, int_compare);
+
+	assert(slist_length(list) == num_values);
+
+	for (rover = list; slist_next(rover) != NULL; rover = slist_next(rover)) {
+		assert(*((int *) slist_data(rover))
+		    < *((int *) slist_data(slist_next(rover))));
+	}
+
+	slist_free(list);
+	free(values);
+}
+
 void test_slist_find_data(void)
 {
 	int entries[] = { 89, 23, 42, 16, 15, 4, 8, 99, 50, 30 };
@@ -524,6 +593,7 @@ static UnitTestFunction tests[] = {
 	test_slist_remove_entry,
 	test_slist_remove_data,
 	test_slist_sort,
+	test_slist_sort_stable,
 	test_slist_find_data,
 	test_slist_to_array,
 	test_slist_iterate,
@@ -129,8 +129,8 @@ void test_trie_insert(void)
 
 	/* Test rollback */
 
-	alloc_test_set_limit(5);
-	assert(trie_insert(trie, "hello world", "test value") == 0);
+	alloc_test_set_limit(1);
+	assert(trie_insert(trie, "99999", "test value") == 0);
 	assert(alloc_test_get_allocated() == allocated);
 	assert(trie_num_entries(trie) == entries);
 
@@ -336,7 +336,7 @@ void test_trie_insert_out_of_memory(void)
 
 	trie = generate_binary_trie();
 
-	alloc_test_set_limit(3);
+	alloc_test_set_limit(1);
 
 	assert(trie_insert_binary(trie,
 	                          bin_key4, sizeof(bin_key4),
@@ -377,6 +377,332 @@ void test_trie_remove_binary(void)
 	trie_free(trie);
 }
 
+/* Add and remove up to 256 children of a single node, so that it is
+ * grown through each of the node sizes and shrunk back again. */
+
+void test_trie_node_sizes(void)
+{
+	Trie *trie;
+	unsigned char key[3];
+	unsigned int entries;
+	unsigned int i, j;
+
+	trie = trie_new();
+	entries = 0;
+
+	key[0] = 'x';
+	key[1] = 'y';
+
+	assert(trie_insert_binary(trie, key, 2, &test_array[0]) != 0);
+	++entries;
+
+	for (i=0; i<256; ++i) {
+		key[2] = (unsigned char) ((i * 7) % 256);
+		test_array[i] = (int) i;
+		assert(trie_insert_binary(trie, key, 3, &test_array[i]) != 0);
+		++entries;
+		assert(trie_num_entries(trie) == entries);
+
+		for (j=0; j<=i; ++j) {
+			key[2] = (unsigned char) ((j * 7) % 256);
+			assert(trie_lookup_binary(trie, key, 3)
+			       == &test_array[j]);
+		}
+	}
+
+	assert(trie_lookup_binary(trie, key, 2) == &test_array[0]);
+
+	/* Remove the children again in a different order */
+
+	for (i=0; i<256; ++i) {
+		key[2] = (unsigned char) ((i * 13) % 256);
+		assert(trie_remove_binary(trie, key, 3) != 0);
+		assert(trie_lookup_binary(trie, key, 3) == NULL);
+		--entries;
+		assert(trie_num_entries(trie) == entries);
+
+		for (j=i+1; j<256; ++j) {
+			key[2] = (unsigned char) ((j * 13) % 256);
+			assert(trie_lookup_binary(trie, key, 3)
+			       == &test_array[(j * 13 * 183) % 256]);
+		}
+	}
+
+	assert(trie_lookup_binary(trie, key, 2) == &test_array[0]);
+	assert(trie_remove_binary(trie, key, 2) != 0);
+	assert(trie_num_entries(trie) == 0);
+
+	trie_free(trie);
+}
+
+/* Keys sharing prefixes longer than are stored in a single node */
+
+void test_trie_long_prefixes(void)
+{
+	Trie *trie;
+	char keys[5][40];
+	char buf[40];
+	unsigned int i;
+
+	trie = trie_new();
+
+	strcpy(keys[0], "abcdefghijklmnopqrstuvwxyz");
+	strcpy(keys[1], "abcdefghijklmnopqrstuvwxyz0123");
+	strcpy(keys[2], "abcdefghijklmnopqrstuvwXYZ");
+	strcpy(keys[3], "abcdefghijklmnoPQRSTUVWXYZ");
+	strcpy(keys[4], "abcdefghijklmnopqrst");
+
+	for (i=0; i<5; ++i) {
+		assert(trie_insert(trie, keys[i], keys[i]) != 0);
+	}
+
+	assert(trie_num_entries(trie) == 5);
+
+	for (i=0; i<5; ++i) {
+		assert(trie_lookup(trie, keys[i]) == keys[i]);
+	}
+
+	/* Keys which only differ after the first few bytes of a prefix */
+
+	assert(trie_lookup(trie, "abcdefghijklmnopqrstuvwxyZ") == NULL);
+	assert(trie_lookup(trie, "abcdefghijklmnopqrstuvwxyz012") == NULL);
+	assert(trie_lookup(trie, "abcdefghijklmnopqrsT") == NULL);
+	assert(trie_remove(trie, "abcdefghijklmnopqrstuvwxyZ") == 0);
+
+	/* Remove keys, so that nodes are merged back together */
+
+	for (i=0; i<5; ++i) {
+		assert(trie_remove(trie, keys[i]) != 0);
+		assert(trie_lookup(trie, keys[i]) == NULL);
+		assert(trie_num_entries(trie) == 4 - i);
+
+		strcpy(buf, keys[i]);
+		assert(trie_insert(trie, buf, keys[i]) != 0);
+		assert(trie_remove(trie, keys[i]) != 0);
+	}
+
+	trie_free(trie);
+}
+
+void test_trie_longest_prefix(void)
+{
+	Trie *trie;
+	unsigned char key[10];
+
+	trie = trie_new();
+
+	assert(trie_longest_prefix(trie, "abc") == NULL);
+
+	assert(trie_insert(trie, "10.", "a") != 0);
+	assert(trie_insert(trie, "10.1.", "b") != 0);
+	assert(trie_insert(trie, "10.1.2.", "c") != 0);
+	assert(trie_insert(trie, "10.1.2.3", "d") != 0);
+	assert(trie_insert(trie, "192.168.", "e") != 0);
+
+	assert(!strcmp(trie_longest_prefix(trie, "10.1.2.3"), "d"));
+	assert(!strcmp(trie_longest_prefix(trie, "10.1.2.4"), "c"));
+	assert(!strcmp(trie_longest_prefix(trie, "10.1.3.4"), "b"));
+	assert(!strcmp(trie_longest_prefix(trie, "10.2.3.4"), "a"));
+	assert(!strcmp(trie_longest_prefix(trie, "10.1.2.33"), "d"));
+	assert(!strcmp(trie_longest_prefix(trie, "192.168.0.1"), "e"));
+	assert(trie_longest_prefix(trie, "192.169.0.1") == NULL);
+	assert(trie_longest_prefix(trie, "10") == NULL);
+	assert(trie_longest_prefix(trie, "") == NULL);
+
+	/* The empty key is a prefix of everything */
+
+	assert(trie_insert(trie, "", "f") != 0);
+	assert(!strcmp(trie_longest_prefix(trie, "192.169.0.1"), "f"));
+	assert(!strcmp(trie_longest_prefix(trie, "10"), "f"));
+
+	trie_free(trie);
+
+	/* Binary keys */
+
+	trie = generate_binary_trie();
+
+	memcpy(key, bin_key2, sizeof(bin_key2));
+	key[sizeof(bin_key2)] = 0xff;
+
+	assert(!strcmp(trie_longest_prefix_binary(trie, key,
+	                                          sizeof(bin_key2) + 1),
+	               "goodbye world"));
+	assert(!strcmp(trie_longest_prefix_binary(trie, key,
+	                                          sizeof(bin_key)),
+	               "hello world"));
+	assert(trie_longest_prefix_binary(trie, key,
+	                                  sizeof(bin_key) - 1) == NULL);
+
+	trie_free(trie);
+}
+
+void test_trie_prefix_count(void)
+{
+	Trie *trie;
+	char *key;
+	unsigned int i;
+
+	trie = generate_trie();
+
+	assert(trie_prefix_count(trie, "") == NUM_TEST_VALUES);
+	assert(trie_prefix_count(trie, "1") == 1111);
+	assert(trie_prefix_count(trie, "12") == 111);
+	assert(trie_prefix_count(trie, "123") == 11);
+	assert(trie_prefix_count(trie, "1234") == 1);
+	assert(trie_prefix_count(trie, "12345") == 0);
+	assert(trie_prefix_count(trie, "x") == 0);
+
+	/* Counts are kept up to date as keys are removed, and are not
+	 * changed by removes or inserts which fail. */
+
+	assert(trie_remove(trie, "12345") == 0);
+	assert(trie_remove(trie, "123x") == 0);
+	assert(trie_remove(trie, "1x") == 0);
+
+	alloc_test_set_limit(0);
+	assert(trie_insert(trie, "123x", "x") == 0);
+	alloc_test_set_limit(1);
+	assert(trie_insert(trie, "12345", "x") == 0);
+	alloc_test_set_limit(-1);
+
+	assert(trie_prefix_count(trie, "1") == 1111);
+	assert(trie_prefix_count(trie, "12") == 111);
+	assert(trie_prefix_count(trie, "123") == 11);
+
+	for (i=1200; i<1300; ++i) {
+		assert(trie_remove(trie, test_strings[i]) != 0);
+	}
+
+	assert(trie_remove(trie, "12") != 0);
+
+	assert(trie_prefix_count(trie, "") == NUM_TEST_VALUES - 101);
+	assert(trie_prefix_count(trie, "1") == 1010);
+	assert(trie_prefix_count(trie, "12") == 10);
+	assert(trie_prefix_count(trie, "123") == 1);
+
+	trie_free(trie);
+
+	/* A long chain of nodes, each of which has a key ending below
+	 * it: the keys are "b", "ab", "aab", "aaab", ... */
+
+	trie = trie_new();
+	key = malloc(1002);
+
+	for (i=0; i<1000; ++i) {
+		memset(key, 'a', i);
+		key[i] = 'b';
+		key[i + 1] = '\0';
+		assert(trie_insert(trie, key, "x") != 0);
+	}
+
+	for (i=0; i<1000; i += 100) {
+		memset(key, 'a', i);
+		key[i] = '\0';
+		assert(trie_prefix_count(trie, key) == 1000 - i);
+	}
+
+	free(key);
+	trie_free(trie);
+
+	trie = generate_binary_trie();
+
+	assert(trie_prefix_count_binary(trie, bin_key3,
+	                                sizeof(bin_key3)) == 2);
+	assert(trie_prefix_count_binary(trie, bin_key,
+	                                sizeof(bin_key)) == 2);
+	assert(trie_prefix_count_binary(trie, bin_key2,
+	                                sizeof(bin_key2)) == 1);
+	assert(trie_prefix_count_binary(trie, bin_key4,
+	                                sizeof(bin_key4)) == 0);
+
+	trie_free(trie);
+}
+
+void test_trie_iterate_prefix(void)
+{
+	Trie *trie;
+	TrieIterator iter;
+	TriePair pair;
+	char *last;
+	unsigned int count;
+	size_t allocated;
+
+	trie = generate_trie();
+
+	/* Iterate over all keys, which are returned in order.  No memory
+	 * is allocated while iterating. */
+
+	allocated = alloc_test_get_allocated();
+	alloc_test_set_limit(0);
+
+	last = NULL;
+	count = 0;
+
+	for (trie_iterate_prefix(trie, "", &iter);
+	     trie_iter_has_more(&iter); ++count) {
+		pair = trie_iter_next(&iter);
+
+		assert(pair.key_length == (int) strlen((char *) pair.key));
+		assert(!strcmp((char *) pair.key, test_strings[*(int *)
+		                                               pair.value]));
+		assert(last == NULL || strcmp(last, (char *) pair.key) < 0);
+
+		last = (char *) pair.key;
+	}
+
+	assert(count == NUM_TEST_VALUES);
+	assert(alloc_test_get_allocated() == allocated);
+	alloc_test_set_limit(-1);
+
+	/* Iterate over keys with a prefix */
+
+	last = NULL;
+	count = 0;
+
+	for (trie_iterate_prefix(trie, "98", &iter);
+	     trie_iter_has_more(&iter); ++count) {
+		pair = trie_iter_next(&iter);
+
+		assert(!strncmp((char *) pair.key, "98", 2));
+		assert(last == NULL || strcmp(last, (char *) pair.key) < 0);
+
+		last = (char *) pair.key;
+	}
+
+	assert(count == 111);
+
+	/* No keys match */
+
+	trie_iterate_prefix(trie, "98765", &iter);
+	assert(!trie_iter_has_more(&iter));
+	pair = trie_iter_next(&iter);
+	assert(pair.key == NULL && pair.value == NULL);
+
+	trie_free(trie);
+
+	/* Binary keys, where one key is a prefix of another */
+
+	trie = generate_binary_trie();
+
+	trie_iterate_prefix_binary(trie, bin_key3, sizeof(bin_key3), &iter);
+
+	assert(trie_iter_has_more(&iter));
+	pair = trie_iter_next(&iter);
+	assert(pair.key_length == sizeof(bin_key));
+	assert(!memcmp(pair.key, bin_key, sizeof(bin_key)));
+	assert(!strcmp(pair.value, "hello world"));
+
+	assert(trie_iter_has_more(&iter));
+	pair = trie_iter_next(&iter);
+	assert(pair.key_length == sizeof(bin_key2));
+	assert(!memcmp(pair.key, bin_key2, sizeof(bin_key2)));
+	assert(!strcmp(pair.value, "goodbye world"));
+
+	assert(!trie_iter_has_more(&iter));
+
+	trie_free(trie);
+}
+
 static UnitTestFunction tests[] = {
 	test_trie_new_free,
 	test_trie_insert,
@@ -389,6 +715,11 @@ static UnitTestFunction tests[] = {
 	test_trie_insert_binary,
 	test_trie_insert_out_of_memory,
 	test_trie_remove_binary,
+	test_trie_node_sizes,
+	test_trie_long_prefixes,
+	test_trie_longest_prefix,
+	test_trie_prefix_count,
+	test_trie_iterate_prefix,
 	NULL
 };
 
@@ -0,0 +1,270 @@
+/*
+
+Copyright (c) 2005-2008, Simon Howard
+
+Permission to use, copy, modify, and/or distribute this software
+for any purpose with or without fee is hereby granted, provided
+that the above copyright notice and this permission notice appear
+in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "alloc-testing.h"
+#include "framework.h"
+
+#include "work-stealing-deque.h"
+
+#define NUM_THIEVES 3
+#define NUM_VALUES 100000
+
+int variable1, variable2, variable3, variable4;
+
+void test_work_stealing_deque_new_free(void)
+{
+	WorkStealingDeque *deque;
+	int i;
+
+	/* Create and destroy a deque */
+
+	deque = work_stealing_deque_new();
+	assert(deque != NULL);
+	work_stealing_deque_free(deque);
+
+	/* Add lots of values and then destroy */
+
+	deque = work_stealing_deque_new();
+
+	for (i=0; i<1000; ++i) {
+		assert(work_stealing_deque_push(deque, &variable1) != 0);
+	}
+
+	work_stealing_deque_free(deque);
+
+	/* Test allocation when there is no free memory */
+
+	alloc_test_set_limit(0);
+	deque = work_stealing_deque_new();
+	assert(deque == NULL);
+
+	alloc_test_set_limit(1);
+	deque = work_stealing_deque_new();
+	assert(deque == NULL);
+}
+
+void test_work_stealing_deque_push_pop(void)
+{
+	WorkStealingDeque *deque;
+	int values[1000];
+	int i;
+
+	deque = work_stealing_deque_new();
+
+	assert(work_stealing_deque_pop(deque) == NULL);
+	assert(work_stealing_deque_steal(deque) == NULL);
+
+	/* The owner removes the newest values, thieves the oldest */
+
+	assert(work_stealing_deque_push(deque, &variable1) != 0);
+	assert(work_stealing_deque_push(deque, &variable2) != 0);
+	assert(work_stealing_deque_push(deque, &variable3) != 0);
+	assert(work_stealing_deque_push(deque, &variable4) != 0);
+
+	assert(work_stealing_deque_pop(deque) == &variable4);
+	assert(work_stealing_deque_steal(deque) == &variable1);
+	assert(work_stealing_deque_pop(deque) == &variable3);
+	assert(work_stealing_deque_steal(deque) == &variable2);
+	assert(work_stealing_deque_pop(deque) == NULL);
+	assert(work_stealing_deque_steal(deque) == NULL);
+
+	/* Enlarge the array after values have been stolen, so that the
+	 * values wrap around the end of the array */
+
+	for (i=0; i<50; ++i) {
+		assert(work_stealing_deque_push(deque, &values[i]) != 0);
+	}
+
+	for (i=0; i<50; ++i) {
+		assert(work_stealing_deque_steal(deque) == &values[i]);
+	}
+
+	for (i=0; i<1000; ++i) {
+		assert(work_stealing_deque_push(deque, &values[i]) != 0);
+	}
+
+	for (i=0; i<500; ++i) {
+		assert(work_stealing_deque_steal(deque) == &values[i]);
+	}
+
+	for (i=999; i>=500; --i) {
+		assert(work_stealing_deque_pop(deque) == &values[i]);
+	}
+
+	assert(work_stealing_deque_pop(deque) == NULL);
+
+	work_stealing_deque_free(deque);
+}
+
+void test_work_stealing_deque_out_of_memory(void)
+{
+	WorkStealingDeque *deque;
+	int i;
+
+	deque = work_stealing_deque_new();
+
+	for (i=0; i<64; ++i) {
+		assert(work_stealing_deque_push(deque, &variable1) != 0);
+	}
+
+	/* The array is full and cannot be enlarged */
+
+	alloc_test_set_limit(0);
+	assert(work_stealing_deque_push(deque, &variable2) == 0);
+	alloc_test_set_limit(-1);
+
+	/* The deque is unchanged */
+
+	for (i=0; i<64; ++i) {
+		assert(work_stealing_deque_pop(deque) == &variable1);
+	}
+
+	assert(work_stealing_deque_pop(deque) == NULL);
+
+	work_stealing_deque_free(deque);
+}
+
+/* The owner adds values and removes some of them itself, while thieves
+ * steal the others.  Each thread counts the values it took; thieves
+ * stop when they steal the end marker, which is added after all other
+ * values. */
+
+static WorkStealingDeque *concurrent_deque;
+static int concurrent_values[NUM_VALUES];
+static unsigned char concurrent_taken[NUM_THIEVES + 1][NUM_VALUES];
+static int end_marker;
+
+static void take_value(unsigned char *taken, int *value)
+{
+	ptrdiff_t index;
+
+	index = value - concurrent_values;
+	assert(index >= 0 && index < NUM_VALUES);
+
+	++taken[index];
+}
+
+static void *thief_thread(void *arg)
+{
+	unsigned char *taken = arg;
+	int *value;
+
+	for (;;) {
+		value = work_stealing_deque_steal(concurrent_deque);
+
+		if (value == NULL) {
+			sched_yield();
+		} else if (value == &end_marker) {
+			break;
+		} else {
+			take_value(taken, value);
+		}
+	}
+
+	return NULL;
+}
+
+void test_work_stealing_deque_concurrent(void)
+{
+	pthread_t thieves[NUM_THIEVES];
+	unsigned char *taken;
+	int *value;
+	unsigned int total;
+	unsigned int i, j;
+
+	concurrent_deque = work_stealing_deque_new();
+
+	for (i=0; i<NUM_THIEVES; ++i) {
+		assert(pthread_create(&thieves[i], NULL, thief_thread,
+		                      concurrent_taken[i]) == 0);
+	}
+
+	/* Add values in bursts, to make the deque grow, and remove some
+	 * of them, racing with the thieves for the last value */
+
+	taken = concurrent_taken[NUM_THIEVES];
+
+	for (i=0; i<NUM_VALUES; ++i) {
+		assert(work_stealing_deque_push(concurrent_deque,
+		                                &concurrent_values[i]) != 0);
+
+		if (i % 3 == 0) {
+			value = work_stealing_deque_pop(concurrent_deque);
+
+			if (value != NULL) {
+				take_value(taken, value);
+			}
+		}
+
+		if (i % 1000 == 999) {
+			while ((value = work_stealing_deque_pop(
+			                    concurrent_deque)) != NULL) {
+				take_value(taken, value);
+			}
+		}
+	}
+
+	for (i=0; i<NUM_THIEVES; ++i) {
+		assert(work_stealing_deque_push(concurrent_deque,
+		                                &end_marker) != 0);
+	}
+
+	for (i=0; i<NUM_THIEVES; ++i) {
+		pthread_join(thieves[i], NULL);
+	}
+
+	/* Every value was taken exactly once */
+
+	for (j=0; j<NUM_VALUES; ++j) {
+		total = 0;
+
+		for (i=0; i<NUM_THIEVES + 1; ++i) {
+			total += concurrent_taken[i][j];
+		}
+
+		assert(total == 1);
+	}
+
+	assert(work_stealing_deque_pop(concurrent_deque) == NULL);
+
+	work_stealing_deque_free(concurrent_deque);
+}
+
+static UnitTestFunction tests[] = {
+	test_work_stealing_deque_new_free,
+	test_work_stealing_deque_push_pop,
+	test_work_stealing_deque_out_of_memory,
+	test_work_stealing_deque_concurrent,
+	NULL
+};
+
+int main(int argc, char *argv[])
+{
+	run_tests(tests);
+
+	return 0;
+}
+